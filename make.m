@@ -87,22 +87,103 @@ function make( varargin )
         );
     recompile( params, 'CollisionDetection.cpp', ...
         'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
-        'RigidBody.h', 'Collision.h', 'CollisionResolver.h'...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h'...
         );
     recompile( params, 'ImpulseMethod.cpp', ...
         'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
-        'RigidBody.h', 'Collision.h', 'CollisionResolver.h'...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h'...
         );
     recompile( params, 'PositionProjections.cpp', ...
         'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
-        'RigidBody.h', 'Collision.h', 'CollisionResolver.h'...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h'...
         );
     recompile( params, 'WoRB.cpp', ...
         'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
-        'RigidBody.h', 'Collision.h', 'CollisionResolver.h'...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h'...
+        );
+    recompile( params, 'SharedState.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'SharedState.h' ...
+        );
+    recompile( params, 'TriangleMesh.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'TriangleContacts.h' ...
+        );
+    recompile( params, 'HeightField.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'TriangleContacts.h' ...
+        );
+    recompile( params, 'Compound.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'Granular.h', 'Topology.h', 'ForceGenerators.h', 'MutualGravity.h' ...
+        );
+    recompile( params, 'ConvexHull.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'Granular.h', 'Topology.h', 'ForceGenerators.h', 'MutualGravity.h' ...
+        );
+    recompile( params, 'GJK.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'Granular.h', 'Topology.h', 'ForceGenerators.h', 'MutualGravity.h' ...
+        );
+    recompile( params, 'SceneQuery.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'TriangleContacts.h' ...
+        );
+    recompile( params, 'Triggers.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'Granular.h', 'Topology.h', 'ForceGenerators.h', 'MutualGravity.h' ...
+        );
+    recompile( params, 'Kinematic.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'Granular.h', 'Topology.h', 'ForceGenerators.h', 'MutualGravity.h' ...
+        );
+    recompile( params, 'Granular.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'Granular.h', 'Topology.h', 'ForceGenerators.h', 'MutualGravity.h' ...
+        );
+    recompile( params, 'ContactCache.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'Granular.h', 'Topology.h', 'ForceGenerators.h', 'MutualGravity.h' ...
+        );
+    recompile( params, 'DomainDecomposition.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'Granular.h', 'Topology.h', 'ForceGenerators.h', 'MutualGravity.h', ...
+        'SharedState.h', 'DomainDecomposition.h' ...
+        );
+    recompile( params, 'Topology.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'Granular.h', 'Topology.h', 'ForceGenerators.h', 'MutualGravity.h' ...
+        );
+    recompile( params, 'ProjectedGradient.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'Granular.h', 'Topology.h', 'ForceGenerators.h', 'MutualGravity.h' ...
+        );
+    recompile( params, 'ForceGenerators.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'Granular.h', 'Topology.h', 'ForceGenerators.h', 'MutualGravity.h' ...
+        );
+    recompile( params, 'MutualGravity.cpp', ...
+        'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', 'CandidatePairs.h', 'Policies.h', 'Solids.h', ...
+        'TriangleMesh.h', 'HeightField.h', 'Compound.h', 'ConvexHull.h', 'GJK.h', 'ContactCache.h', 'SceneQuery.h', 'Triggers.h', 'Granular.h', 'Topology.h', 'ForceGenerators.h', 'MutualGravity.h' ...
         );
     recompile( params, 'Platform.cpp', ...
-        'Utilities.h' ...
+        'Utilities.h', 'Topology.h' ...
         );
 
     % ------------------------------------------------------------------------------------
@@ -110,18 +191,18 @@ function make( varargin )
 
     recompile( params2, 'Utilities.cpp', ...
         'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
-        'RigidBody.h', 'Collision.h', 'CollisionResolver.h', ...
-        'Utilities.h', 'WoRB_TestBed.h' ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', ...
+        'Utilities.h', 'WoRB_TestBed.h', 'SharedState.h' ...
         );
     recompile( params2, 'WoRB_TestBed.cpp', ...
         'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
-        'RigidBody.h', 'Collision.h', 'CollisionResolver.h', ...
-        'Utilities.h', 'WoRB_TestBed.h' ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', ...
+        'Utilities.h', 'WoRB_TestBed.h', 'SharedState.h' ...
         );
     recompile( params2, 'mexFunction.cpp', ...
         'WoRB.h', 'Constants.h', 'Quaternion.h', 'QTensor.h', 'Geometry.h', ...
-        'RigidBody.h', 'Collision.h', 'CollisionResolver.h', ...
-        'Utilities.h', 'WoRB_TestBed.h', 'mexWoRB.h' ...
+        'RigidBody.h', 'Kinematic.h', 'Collision.h', 'CollisionResolver.h', ...
+        'Utilities.h', 'WoRB_TestBed.h', 'SharedState.h', 'mexWoRB.h' ...
         );
 
     % ------------------------------------------------------------------------------------
@@ -139,6 +220,22 @@ function make( varargin )
         'ImpulseMethod', ...
         'PositionProjections', ...
         'WoRB', ...
+        'SharedState', ...
+        'TriangleMesh', ...
+        'HeightField', ...
+        'Compound', ...
+        'ConvexHull', ...
+        'GJK', ...
+        'SceneQuery', ...
+        'Triggers', ...
+        'Kinematic', ...
+        'Granular', ...
+        'ContactCache', ...
+        'DomainDecomposition', ...
+        'Topology', ...
+        'ProjectedGradient', ...
+        'ForceGenerators', ...
+        'MutualGravity', ...
         'Platform', ...
         'Utilities', ...
         'WoRB_TestBed' ...
@@ -0,0 +1,3286 @@
+/**
+ *  @file      Benchmarks.cpp
+ *  @brief     Headless benchmarks for the WoRB framework.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-21
+ *  @copyright GNU Public License.
+ *
+ * Usage: WoRB_Bench <benchmark> [options]
+ *
+ * Run without arguments to list the available benchmarks.
+ */
+
+#include "WoRB.h"
+#include "SharedState.h"
+#include "SimulationServer.h"
+#include "DomainDecomposition.h"
+
+#include <cstdio>     // we use: printf, sprintf
+#include <cstdlib>    // we use: atoi, atof, rand
+#include <cstring>    // we use: strcmp, memset
+#include <vector>     // we use: std::vector
+#include <algorithm>  // we use: std::sort
+#include <cmath>      // we use: sin, cos
+#include <ctime>      // we use: clock_gettime
+
+#include <pthread.h>  // we use: pthread_create, pthread_join
+#include <signal.h>   // we use: kill, SIGTERM
+#include <unistd.h>   // we use: fork, usleep, getpid
+#include <sys/wait.h> // we use: waitpid
+#include <sys/ioctl.h>      // we use: ioctl
+#include <sys/syscall.h>    // we use: syscall, __NR_perf_event_open
+#include <linux/perf_event.h> // we use: perf_event_attr
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Common scene setup
+
+/** The system used by the benchmarks.
+ */
+typedef WorldOfRigidBodies<4096,16384> BenchWorld;
+
+/** Gets a uniform real number in range [0,1).
+ */
+static double Uniform ()
+{
+    return double( rand () ) / ( double( RAND_MAX ) + 1.0 );
+}
+
+/** Populates the system with `n` spheres dropped on the ground plane.
+ */
+template<class World>
+static void BuildSphereScene( World& worb, HalfSpace& ground,
+    std::vector<SolidSphere*>& bodies, unsigned n )
+{
+    srand( 1 ); // Reproducible scenes
+
+    worb.RemoveObjects ();
+    worb.Gravity = Const::g_n;
+    worb.Collisions.Restitution = 0.5;
+    worb.Collisions.Friction    = 0.2;
+
+    ground.Direction = Const::Y;
+    ground.Offset    = 0;
+    worb.Add( ground );
+
+    unsigned side = 1;
+    while ( side * side * side < n ) {
+        ++side;
+    }
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        double x = 1.2 * ( i % side );
+        double y = 1.2 * ( ( i / side ) % side ) + 0.6;
+        double z = 1.2 * ( i / side / side );
+
+        SolidSphere* ball = new SolidSphere(
+            SpatialVector( x + 0.1 * Uniform (), y, z + 0.1 * Uniform () ),
+            Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0, /*r=*/ 0.5, /*mass=*/ 1.0
+        );
+        ball->CanBeDeactivated = true;
+
+        bodies.push_back( ball );
+        worb.Add( ball );
+    }
+
+    worb.InitializeODE ();
+}
+
+/** Deallocates bodies created by the scene builders.
+ */
+template<class T>
+static void DeleteBodies( std::vector<T*>& bodies )
+{
+    for ( unsigned i = 0; i < bodies.size (); ++i ) {
+        delete bodies[i];
+    }
+    bodies.clear ();
+}
+
+/** Gets the value of the given percentile from the sorted samples.
+ */
+static double Percentile( const std::vector<double>& sorted, double p )
+{
+    if ( sorted.empty () ) {
+        return 0;
+    }
+    size_t k = size_t( p * ( sorted.size () - 1 ) + 0.5 );
+    return sorted[ k ];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// shm-latency: publication latency between the simulation and an external reader
+
+static int Bench_ShmLatency( int argc, char* argv[] )
+{
+    unsigned frames   = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 2000;
+    unsigned bodies   = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 256;
+    unsigned periodUs = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 1000;
+
+    const char* name = "worb-bench-latency";
+
+    // The segment name is private to the benchmark, so a segment left by
+    // a crashed run is replaced
+    //
+    SharedStatePublisher publisher;
+    if ( ! publisher.Open( name, bodies, 4 * bodies, 4, true ) ) {
+        return 1;
+    }
+
+    pid_t child = fork ();
+
+    if ( child == 0 ) // The reader process
+    {
+        SharedStateReader reader;
+        while ( ! reader.Open( name ) ) {
+            usleep( 1000 );
+        }
+
+        std::vector<double> latency;
+        latency.reserve( frames );
+
+        uint64_t lastSeen = 0;
+        unsigned torn = 0;
+
+        while ( lastSeen < frames )
+        {
+            uint64_t count = reader.GetFrameCount ();
+            if ( count == lastSeen ) {
+                continue; // Spin until a new frame appears
+            }
+
+            uint32_t seq;
+            const SharedFrame* frame = reader.GetLatestFrame( seq );
+            if ( ! frame ) {
+                ++torn;
+                continue;
+            }
+
+            double published = frame->PublishTime;
+            double observed  = MonotonicTime ();
+
+            // Touch all the bodies, as a visualizer would do
+            //
+            double sum = 0;
+            const SharedBody* b = reader.GetBodies( frame );
+            for ( unsigned i = 0; i < frame->BodyCount; ++i ) {
+                sum += b[i].X[1];
+            }
+
+            if ( ! reader.IsConsistent( frame, seq ) || sum != sum ) {
+                ++torn;
+                continue;
+            }
+
+            latency.push_back( observed - published );
+            lastSeen = count;
+        }
+
+        std::sort( latency.begin (), latency.end () );
+
+        printf( "Reader: observed %u frames, %u torn/retried reads\n",
+            unsigned( latency.size () ), torn );
+        printf( "Latency: min %.2f us, median %.2f us, p99 %.2f us, max %.2f us\n",
+            Percentile( latency, 0.0  ) * 1e6, Percentile( latency, 0.5 ) * 1e6,
+            Percentile( latency, 0.99 ) * 1e6, Percentile( latency, 1.0 ) * 1e6 );
+
+        fflush( stdout );
+        _exit( 0 );
+    }
+
+    // The publisher (simulation) process
+    //
+    BenchWorld* worb = new BenchWorld;
+    HalfSpace ground;
+    std::vector<SolidSphere*> objects;
+    BuildSphereScene( *worb, ground, objects, bodies );
+
+    double solveTime = 0, publishTime = 0;
+
+    for ( unsigned i = 0; i < frames; ++i )
+    {
+        double t0 = MonotonicTime ();
+        worb->SolveODE( 0.01 );
+        double t1 = MonotonicTime ();
+        publisher.Publish( *worb );
+        double t2 = MonotonicTime ();
+
+        solveTime   += t1 - t0;
+        publishTime += t2 - t1;
+
+        if ( periodUs > 0 ) {
+            usleep( periodUs );
+        }
+    }
+
+    int status = 0;
+    waitpid( child, &status, 0 );
+
+    printf( "Publisher: %u frames of %u bodies; SolveODE %.2f us, Publish %.2f us "
+            "per frame\n", frames, bodies,
+            solveTime / frames * 1e6, publishTime / frames * 1e6 );
+
+    publisher.Close ();
+    DeleteBodies( objects );
+    delete worb;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// server-load: throughput and latency of the simulation server under concurrent clients
+
+/** Holds the parameters and the results of a single load-test client.
+ */
+struct LoadClient
+{
+    const char* Path;           //!< Holds the server socket path
+    unsigned Bodies;            //!< Holds the number of bodies in the scene
+    unsigned Requests;          //!< Holds the number of Step requests to send
+    unsigned Depth;             //!< Holds the number of requests in flight
+    unsigned StepsPerRequest;   //!< Holds the number of time-steps per request
+    std::vector<double> Latency; //!< Holds the measured round-trip times, in `s`
+    bool Failed;                //!< Indicates whether the client has failed
+};
+
+static void* LoadClientThread( void* arg )
+{
+    using namespace WoRB::Protocol;
+
+    LoadClient& c = *(LoadClient*)arg;
+    c.Failed = true;
+
+    SimulationClient client;
+    for ( unsigned retry = 0; ! client.Connect( c.Path ); ++retry ) {
+        if ( retry > 1000 ) {
+            return 0;
+        }
+        usleep( 1000 );
+    }
+
+    // Load a scene of spheres resting in a grid on the ground
+    //
+    SceneParams scene;
+    memset( &scene, 0, sizeof( scene ) );
+    scene.Gravity[1]  = -9.81;
+    scene.Restitution = 0.5;
+    scene.Relaxation  = 0.2;
+    scene.Friction    = 0.2;
+    scene.BodyCount   = c.Bodies;
+    scene.GroundPlane = 1;
+
+    std::vector<BodySpec> specs( c.Bodies );
+    for ( unsigned i = 0; i < c.Bodies; ++i )
+    {
+        BodySpec& b = specs[i];
+        memset( &b, 0, sizeof( b ) );
+        b.Geometry = 0;
+        b.CanBeDeactivated = 1;
+        b.HalfExtent[0] = 0.5;
+        b.Mass = 1.0;
+        b.X[0] = 1.2 * ( i % 16 );
+        b.X[1] = 0.6 + 1.2 * ( i / 256 );
+        b.X[2] = 1.2 * ( ( i / 16 ) % 16 );
+        b.Q[0] = 1.0;
+    }
+
+    MessageHeader header;
+    std::vector<char> payload;
+
+    client.Send( LoadScene, 0, &scene, sizeof( scene ),
+        specs.empty () ? 0 : &specs[0], unsigned( specs.size () * sizeof( BodySpec ) ) );
+    if ( ! client.Flush () || ! client.Receive( header, payload ) || header.Status != Ok ) {
+        return 0;
+    }
+
+    // Keep `Depth` Step requests in flight; each one is tagged with its index
+    //
+    StepParams step;
+    step.Count    = c.StepsPerRequest;
+    step.Reserved = 0;
+    step.TimeStep = 0.01;
+
+    std::vector<double> sent( c.Requests );
+    c.Latency.reserve( c.Requests );
+
+    unsigned next = 0;
+    for ( unsigned done = 0; done < c.Requests; ++done )
+    {
+        while ( next < c.Requests && next < done + c.Depth ) {
+            sent[ next ] = MonotonicTime ();
+            client.Send( Step, next, &step, sizeof( step ) );
+            ++next;
+        }
+        if ( ! client.Flush () || ! client.Receive( header, payload )
+            || header.Status != Ok || header.Tag >= c.Requests ) {
+            return 0;
+        }
+        c.Latency.push_back( MonotonicTime () - sent[ header.Tag ] );
+    }
+
+    c.Failed = false;
+    return 0;
+}
+
+static int Bench_ServerLoad( int argc, char* argv[] )
+{
+    unsigned clients  = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 4;
+    unsigned bodies   = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 64;
+    unsigned requests = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 500;
+    unsigned depth    = argc >= 4 ? unsigned( atoi( argv[3] ) ) : 8;
+    unsigned steps    = argc >= 5 ? unsigned( atoi( argv[4] ) ) : 1;
+
+    if ( depth < 1 ) {
+        depth = 1;
+    }
+
+    char path[ 64 ];
+    sprintf( path, "/tmp/worb-bench-%d.sock", int( getpid () ) );
+
+    pid_t server = fork ();
+
+    if ( server == 0 ) // The server process
+    {
+        signal( SIGPIPE, SIG_IGN );
+        SimulationServer s;
+        if ( s.Listen( path ) ) {
+            s.Run ();
+        }
+        _exit( 0 );
+    }
+
+    std::vector<LoadClient> load( clients );
+    std::vector<pthread_t> threads( clients );
+
+    double t0 = MonotonicTime ();
+
+    for ( unsigned i = 0; i < clients; ++i )
+    {
+        load[i].Path            = path;
+        load[i].Bodies          = bodies;
+        load[i].Requests        = requests;
+        load[i].Depth           = depth;
+        load[i].StepsPerRequest = steps;
+        load[i].Failed          = true;
+        pthread_create( &threads[i], 0, LoadClientThread, &load[i] );
+    }
+
+    std::vector<double> latency;
+    unsigned failed = 0;
+
+    for ( unsigned i = 0; i < clients; ++i )
+    {
+        pthread_join( threads[i], 0 );
+        failed += load[i].Failed ? 1 : 0;
+        latency.insert( latency.end (), load[i].Latency.begin (), load[i].Latency.end () );
+    }
+
+    double elapsed = MonotonicTime () - t0;
+
+    kill( server, SIGTERM );
+    waitpid( server, 0, 0 );
+    unlink( path );
+
+    std::sort( latency.begin (), latency.end () );
+
+    double totalSteps = double( latency.size () ) * steps;
+
+    printf( "%u clients x %u requests of %u step(s), %u bodies, pipeline depth %u; "
+            "%u client(s) failed\n", clients, requests, steps, bodies, depth, failed );
+    printf( "Throughput: %.1f steps/s aggregate, %.1f requests/s in %.3f s\n",
+        totalSteps / elapsed, latency.size () / elapsed, elapsed );
+    printf( "Latency: min %.1f us, median %.1f us, p99 %.1f us, max %.1f us\n",
+        Percentile( latency, 0.0  ) * 1e6, Percentile( latency, 0.5 ) * 1e6,
+        Percentile( latency, 0.99 ) * 1e6, Percentile( latency, 1.0 ) * 1e6 );
+
+    return failed ? 1 : 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// policies: compile-time specialized vs run-time configurable systems
+
+/** The system with the default policies (the original behaviour).
+ */
+typedef WorldOfRigidBodies<4096,16384> DefaultWorld;
+
+/** The system specialized at compile-time.
+ */
+typedef WorldOfRigidBodies<4096,16384,
+    SweepAndPrune, SequentialImpulses, SemiImplicitEuler, NoDiagnostics> SpecializedWorld;
+
+/** The system configured at run-time.
+ */
+typedef WorldOfRigidBodies<4096,16384,
+    DynamicBroadphase, DynamicSolver, DynamicIntegrator, DynamicDiagnostics> DynamicWorld;
+
+/** Runs `steps` time-steps of the sphere scene and returns the time per step, in `s`.
+ */
+template<class World>
+static double TimeSteps( World& worb, unsigned bodies, unsigned steps, double& E_k )
+{
+    HalfSpace ground;
+    std::vector<SolidSphere*> objects;
+    BuildSphereScene( worb, ground, objects, bodies );
+
+    double t0 = MonotonicTime ();
+    for ( unsigned i = 0; i < steps; ++i ) {
+        worb.SolveODE( 0.01 );
+    }
+    double elapsed = MonotonicTime () - t0;
+
+    worb.CalculateTotals ();
+    E_k = worb.TotalKineticEnergy;
+
+    DeleteBodies( objects );
+    return elapsed / steps;
+}
+
+static int Bench_Policies( int argc, char* argv[] )
+{
+    unsigned bodies = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 1000;
+    unsigned steps  = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 200;
+
+    DefaultWorld*     defaultWorld = new DefaultWorld;
+    SpecializedWorld* specialized  = new SpecializedWorld;
+    DynamicWorld*     dynamic      = new DynamicWorld;
+
+    double E_k[4];
+
+    printf( "%u spheres, %u steps\n\n", bodies, steps );
+    printf( "%-50s %10s %12s\n", "Configuration", "us/step", "E_k" );
+
+    // Original method: all pairs, full diagnostics
+    //
+    double t0 = TimeSteps( *defaultWorld, bodies, steps, E_k[0] );
+
+    dynamic->BroadphaseMethod.Method = DynamicBroadphase::UseAllPairs;
+    dynamic->DiagnosticsMethod.Enabled = true;
+    double t1 = TimeSteps( *dynamic, bodies, steps, E_k[1] );
+
+    printf( "%-50s %10.1f %12.4f\n", "default policies (compile-time)", t0 * 1e6, E_k[0] );
+    printf( "%-50s %10.1f %12.4f\n", "default policies (run-time)",     t1 * 1e6, E_k[1] );
+
+    // Sweep and prune, no diagnostics
+    //
+    double t2 = TimeSteps( *specialized, bodies, steps, E_k[2] );
+
+    dynamic->BroadphaseMethod.Method = DynamicBroadphase::UseSweepAndPrune;
+    dynamic->DiagnosticsMethod.Enabled = false;
+    double t3 = TimeSteps( *dynamic, bodies, steps, E_k[3] );
+
+    printf( "%-50s %10.1f %12.4f\n", "sweep-and-prune, no diagnostics (compile-time)",
+        t2 * 1e6, E_k[2] );
+    printf( "%-50s %10.1f %12.4f\n", "sweep-and-prune, no diagnostics (run-time)",
+        t3 * 1e6, E_k[3] );
+
+    printf( "\nRun-time configuration overhead: %+.1f%% (default), %+.1f%% (specialized)\n",
+        ( t1 / t0 - 1 ) * 100, ( t3 / t2 - 1 ) * 100 );
+
+    delete dynamic;
+    delete specialized;
+    delete defaultWorld;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// mesh: static triangle-mesh scenery versus half-spaces
+
+/** Builds a bumpy terrain of `side` x `side` quads (two triangles each).
+ */
+static void BuildTerrain( TriangleMesh& mesh, unsigned side, double spacing )
+{
+    std::vector<double>   vertices;
+    std::vector<unsigned> indices;
+
+    const unsigned n = side + 1;
+    const double origin = -0.5 * side * spacing;
+
+    for ( unsigned i = 0; i < n; ++i ) {
+        for ( unsigned j = 0; j < n; ++j )
+        {
+            double x = origin + i * spacing;
+            double z = origin + j * spacing;
+            vertices.push_back( x );
+            vertices.push_back( 0.2 * sin( 0.7 * x ) * cos( 0.5 * z ) );
+            vertices.push_back( z );
+        }
+    }
+
+    for ( unsigned i = 0; i < side; ++i ) {
+        for ( unsigned j = 0; j < side; ++j )
+        {
+            unsigned v = i * n + j;
+            unsigned quad[6] = { v, v + 1, v + n, v + 1, v + n + 1, v + n };
+            indices.insert( indices.end (), quad, quad + 6 );
+        }
+    }
+
+    mesh.Build( &vertices[0], n * n, &indices[0], 2 * side * side );
+}
+
+/** Populates the system with `n` spheres and cuboids dropped above the origin.
+ */
+template<class World>
+static void DropBodies( World& worb, std::vector<SolidSphere*>& spheres,
+    std::vector<SolidCuboid*>& cuboids, unsigned n )
+{
+    srand( 1 ); // Reproducible scenes
+
+    unsigned side = 1;
+    while ( side * side * side < n ) {
+        ++side;
+    }
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        double x = 1.2 * ( i % side ) - 0.6 * side;
+        double y = 1.2 * ( ( i / side ) % side ) + 0.8;
+        double z = 1.2 * ( i / side / side ) - 0.6 * side;
+
+        SpatialVector position( x + 0.1 * Uniform (), y, z + 0.1 * Uniform () );
+
+        if ( i % 2 == 0 )
+        {
+            SolidSphere* ball = new SolidSphere( position,
+                Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0, /*r=*/ 0.5, /*mass=*/ 1.0 );
+            ball->CanBeDeactivated = true;
+            spheres.push_back( ball );
+            worb.Add( ball );
+        }
+        else
+        {
+            SolidCuboid* box = new SolidCuboid( position,
+                Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0,
+                /*halfExtent=*/ SpatialVector( 0.4, 0.4, 0.4 ), /*mass=*/ 1.0 );
+            box->CanBeDeactivated = true;
+            cuboids.push_back( box );
+            worb.Add( box );
+        }
+    }
+}
+
+/** Runs `steps` time-steps and returns the time per step, in `s`. Also measures
+ * the time of the narrowphase alone (on the final state of the system).
+ */
+template<class World>
+static double TimeScenery( World& worb, unsigned steps,
+    unsigned& contacts, double& detectTime )
+{
+    worb.InitializeODE ();
+
+    double t0 = MonotonicTime ();
+    contacts = 0;
+    for ( unsigned i = 0; i < steps; ++i ) {
+        worb.SolveODE( 0.01 );
+        contacts += worb.Collisions.Count ();
+    }
+    double elapsed = MonotonicTime () - t0;
+    contacts /= steps;
+
+    const unsigned repeat = 100;
+    t0 = MonotonicTime ();
+    for ( unsigned i = 0; i < repeat; ++i ) {
+        worb.Collisions.Initialize ();
+        worb.Pairs.Detect( worb.Collisions );
+    }
+    detectTime = ( MonotonicTime () - t0 ) / repeat;
+
+    return elapsed / steps;
+}
+
+static int Bench_Mesh( int argc, char* argv[] )
+{
+    unsigned side   = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 224;
+    unsigned bodies = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 500;
+    unsigned steps  = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 200;
+
+    SpecializedWorld* worb = new SpecializedWorld;
+    std::vector<SolidSphere*> spheres;
+    std::vector<SolidCuboid*> cuboids;
+
+    // Build the terrain BVH
+    //
+    TriangleMesh terrain;
+    double t0 = MonotonicTime ();
+    BuildTerrain( terrain, side, 0.5 );
+    double buildTime = MonotonicTime () - t0;
+
+    printf( "Terrain: %u triangles, %u BVH nodes, built in %.1f ms\n\n",
+        terrain.TriangleCount (), terrain.NodeCount (), buildTime * 1e3 );
+
+    printf( "%u bodies (spheres and cuboids), %u steps\n\n", bodies, steps );
+    printf( "%-40s %10s %10s %10s\n", "Scenery", "us/step", "detect us", "contacts" );
+
+    // The same bodies on a handful of half-spaces (ground and four walls)
+    //
+    const double wall = 0.25 * side;
+    HalfSpace planes[5];
+    planes[0].Direction =  Const::Y; planes[0].Offset = 0;
+    planes[1].Direction =  Const::X; planes[1].Offset = -wall;
+    planes[2].Direction = -Const::X; planes[2].Offset = -wall;
+    planes[3].Direction =  Const::Z; planes[3].Offset = -wall;
+    planes[4].Direction = -Const::Z; planes[4].Offset = -wall;
+
+    worb->RemoveObjects ();
+    worb->Gravity = Const::g_n;
+    worb->Collisions.Restitution = 0.5;
+    worb->Collisions.Friction    = 0.2;
+    for ( unsigned i = 0; i < 5; ++i ) {
+        worb->Add( planes[i] );
+    }
+    DropBodies( *worb, spheres, cuboids, bodies );
+
+    unsigned planeContacts = 0;
+    double planeDetect = 0;
+    double planeTime = TimeScenery( *worb, steps, planeContacts, planeDetect );
+    DeleteBodies( spheres );
+    DeleteBodies( cuboids );
+
+    printf( "%-40s %10.1f %10.1f %10u\n", "5 half-spaces",
+        planeTime * 1e6, planeDetect * 1e6, planeContacts );
+
+    // The same bodies on the terrain
+    //
+    worb->RemoveObjects ();
+    worb->Gravity = Const::g_n;
+    worb->Collisions.Restitution = 0.5;
+    worb->Collisions.Friction    = 0.2;
+    worb->Add( terrain );
+    DropBodies( *worb, spheres, cuboids, bodies );
+
+    unsigned meshContacts = 0;
+    double meshDetect = 0;
+    double meshTime = TimeScenery( *worb, steps, meshContacts, meshDetect );
+    DeleteBodies( spheres );
+    DeleteBodies( cuboids );
+
+    char label[64];
+    sprintf( label, "triangle mesh (%u triangles)", terrain.TriangleCount () );
+    printf( "%-40s %10.1f %10.1f %10u\n", label,
+        meshTime * 1e6, meshDetect * 1e6, meshContacts );
+
+    printf( "\nMesh cost relative to the half-spaces: %.2fx (step), %.2fx (detection)\n",
+        meshTime / planeTime, meshDetect / planeDetect );
+
+    delete worb;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// heightfield: per-body detection cost versus terrain size
+
+/** Measures the narrowphase time per body on a `side` x `side` terrain.
+ */
+static double TimeHeightField( unsigned side, HeightField::StorageType storage,
+    unsigned bodies, unsigned& contacts )
+{
+    const double spacing = 0.5;
+
+    std::vector<double> heights( side * side );
+    for ( unsigned row = 0; row < side; ++row ) {
+        for ( unsigned column = 0; column < side; ++column ) {
+            heights[ row * side + column ] =
+                0.5 * sin( 0.11 * column ) * cos( 0.07 * row ) + 0.1 * sin( 0.9 * column );
+        }
+    }
+
+    HeightField terrain;
+    terrain.Build( side, side, 0, 0, spacing, &heights[0], storage );
+
+    SpecializedWorld* worb = new SpecializedWorld;
+    worb->RemoveObjects ();
+    worb->Gravity = Const::g_n;
+    worb->Add( terrain );
+
+    // Scatter the bodies over the whole terrain, slightly penetrating the surface
+    //
+    srand( 1 ); // Reproducible scenes
+
+    std::vector<SolidSphere*> spheres;
+    std::vector<SolidCuboid*> cuboids;
+    const double size = ( side - 1 ) * spacing - 2;
+
+    for ( unsigned i = 0; i < bodies; ++i )
+    {
+        double x = 1 + size * Uniform ();
+        double z = 1 + size * Uniform ();
+        double y = terrain.HeightAt( x, z );
+
+        if ( i % 2 == 0 )
+        {
+            SolidSphere* ball = new SolidSphere( SpatialVector( x, y + 0.49, z ),
+                Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0, /*r=*/ 0.5, /*mass=*/ 1.0 );
+            spheres.push_back( ball );
+            worb->Add( ball );
+        }
+        else
+        {
+            SolidCuboid* box = new SolidCuboid( SpatialVector( x, y + 0.39, z ),
+                Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0,
+                /*halfExtent=*/ SpatialVector( 0.4, 0.4, 0.4 ), /*mass=*/ 1.0 );
+            cuboids.push_back( box );
+            worb->Add( box );
+        }
+    }
+
+    worb->InitializeODE ();
+    worb->SolveODE( 1e-4 ); // Finds the candidate pairs
+
+    const unsigned repeat = 50;
+    double t0 = MonotonicTime ();
+    for ( unsigned i = 0; i < repeat; ++i ) {
+        worb->Collisions.Initialize ();
+        worb->Pairs.Detect( worb->Collisions );
+    }
+    double elapsed = ( MonotonicTime () - t0 ) / repeat;
+    contacts = worb->Collisions.Count ();
+
+    DeleteBodies( spheres );
+    DeleteBodies( cuboids );
+    delete worb;
+
+    return elapsed / bodies;
+}
+
+static int Bench_HeightField( int argc, char* argv[] )
+{
+    unsigned bodies = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 1000;
+
+    printf( "%u bodies (spheres and cuboids) resting on the terrain\n\n", bodies );
+    printf( "%-12s %12s %12s %12s %12s\n",
+        "Terrain", "float ns", "int16 ns", "contacts", "int16 MB" );
+
+    static const unsigned sides[] = { 64, 256, 1024, 4096 };
+
+    for ( unsigned i = 0; i < sizeof( sides ) / sizeof( sides[0] ); ++i )
+    {
+        unsigned c32 = 0, c16 = 0;
+        double t32 = TimeHeightField( sides[i], HeightField::Float32, bodies, c32 );
+        double t16 = TimeHeightField( sides[i], HeightField::Int16,   bodies, c16 );
+
+        char label[32];
+        sprintf( label, "%u x %u", sides[i], sides[i] );
+        printf( "%-12s %12.1f %12.1f %12u %12.1f\n", label, t32 * 1e9, t16 * 1e9, c32,
+            sides[i] * sides[i] * sizeof(short) / 1048576.0 );
+    }
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// gjk: GJK iterations with and without the warm start from the cached simplex
+
+/** Populates the system with `n` rocks (convex hulls of random points) and cuboids
+ * placed on a grid just above the ground.
+ */
+template<class World>
+static void PlaceRocks( World& worb, std::vector<SolidConvexHull*>& hulls,
+    std::vector<SolidCuboid*>& cuboids, unsigned n )
+{
+    srand( 1 ); // Reproducible scenes
+
+    unsigned side = 1;
+    while ( side * side < n ) {
+        ++side;
+    }
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        SpatialVector position( 1.5 * ( i % side ), 0.6, 1.5 * ( i / side ) );
+
+        if ( i % 2 == 0 )
+        {
+            // Random points on an ellipsoid
+            //
+            double points[ 3 * 24 ];
+            for ( unsigned k = 0; k < 24; ++k )
+            {
+                double theta = 2 * Const::Pi * Uniform ();
+                double z = 2 * Uniform () - 1;
+                double r = sqrt( 1 - z * z );
+                points[ 3*k     ] = 0.6 * r * cos( theta );
+                points[ 3*k + 1 ] = 0.4 * z;
+                points[ 3*k + 2 ] = 0.5 * r * sin( theta );
+            }
+
+            SolidConvexHull* rock = new SolidConvexHull( position,
+                Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0, points, 24, /*mass=*/ 1.0 );
+            hulls.push_back( rock );
+            worb.Add( rock );
+        }
+        else
+        {
+            SolidCuboid* box = new SolidCuboid( position,
+                Quaternion( 1, 0, 0.2 * Uniform (), 0 ).Unit (), /*v=*/ 0.0, /*w=*/ 0.0,
+                /*halfExtent=*/ SpatialVector( 0.4, 0.4, 0.4 ), /*mass=*/ 1.0 );
+            cuboids.push_back( box );
+            worb.Add( box );
+        }
+    }
+}
+
+static int Bench_Gjk( int argc, char* argv[] )
+{
+    unsigned bodies = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 400;
+    unsigned steps  = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 200;
+
+    printf( "%u bodies (convex hulls and cuboids) resting on a true plane, %u steps\n\n",
+        bodies, steps );
+    printf( "%-12s %14s %12s %12s %12s\n",
+        "Simplex", "iterations", "queries", "us/step", "contacts" );
+
+    TruePlane ground;
+    ground.Direction = Const::Y;
+    ground.Offset = 0;
+
+    for ( unsigned warm = 0; warm < 2; ++warm )
+    {
+        SpecializedWorld* worb = new SpecializedWorld;
+        std::vector<SolidConvexHull*> hulls;
+        std::vector<SolidCuboid*> cuboids;
+
+        worb->RemoveObjects ();
+        worb->Gravity = Const::g_n;
+        worb->Collisions.Restitution = 0.2;
+        worb->Collisions.Friction    = 0.4;
+        worb->Collisions.Simplices.WarmStart = warm != 0;
+        worb->Add( ground );
+        PlaceRocks( *worb, hulls, cuboids, bodies );
+
+        // Let the bodies settle, then measure
+        //
+        worb->InitializeODE ();
+        for ( unsigned i = 0; i < steps; ++i ) {
+            worb->SolveODE( 0.01 );
+        }
+
+        worb->Collisions.Simplices.Queries = 0;
+        worb->Collisions.Simplices.Iterations = 0;
+
+        unsigned contacts = 0;
+        double t0 = MonotonicTime ();
+        for ( unsigned i = 0; i < steps; ++i ) {
+            worb->SolveODE( 0.01 );
+            contacts += worb->Collisions.Count ();
+        }
+        double elapsed = ( MonotonicTime () - t0 ) / steps;
+
+        printf( "%-12s %14.2f %12lu %12.1f %12u\n", warm ? "cached" : "cold",
+            worb->Collisions.Simplices.AverageIterations (),
+            worb->Collisions.Simplices.Queries / steps, elapsed * 1e6, contacts / steps );
+
+        DeleteBodies( hulls );
+        DeleteBodies( cuboids );
+        delete worb;
+    }
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// raycast: batched scene queries, brute force versus broadphase-accelerated
+
+static int Bench_RayCast( int argc, char* argv[] )
+{
+    unsigned bodies  = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 2000;
+    unsigned rays    = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 50000;
+    unsigned threads = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 4;
+    double   length  = argc >= 4 ? atof( argv[3] ) : 10.0;
+
+    const double area = 4 * sqrt( double( bodies ) ); // The side of the field, in m
+
+    printf( "%u bodies scattered over %.0f x %.0f m, %u sensor rays of %g m\n\n",
+        bodies, area, area, rays, length );
+    printf( "%-14s %8s %12s %12s %10s\n",
+        "Broadphase", "threads", "ms/batch", "Mrays/s", "hits" );
+
+    srand( 1 ); // Reproducible scenes
+
+    DynamicWorld* worb = new DynamicWorld;
+    std::vector<SolidSphere*> spheres;
+    std::vector<SolidCuboid*> cuboids;
+
+    HalfSpace ground;
+    ground.Direction = Const::Y;
+    ground.Offset    = 0;
+
+    worb->RemoveObjects ();
+    worb->Add( ground );
+
+    for ( unsigned i = 0; i < bodies; ++i )
+    {
+        SpatialVector position( area * Uniform (), 0.5 + 2 * Uniform (), area * Uniform () );
+
+        if ( i % 2 == 0 )
+        {
+            SolidSphere* ball = new SolidSphere( position, Quaternion( 1.0 ),
+                /*v=*/ 0.0, /*w=*/ 0.0, /*r=*/ 0.2 + 0.3 * Uniform (), /*mass=*/ 1.0 );
+            spheres.push_back( ball );
+            worb->Add( ball );
+        }
+        else
+        {
+            SolidCuboid* box = new SolidCuboid( position,
+                Quaternion( 1, 0, Uniform (), 0 ).Unit (), /*v=*/ 0.0, /*w=*/ 0.0,
+                /*halfExtent=*/ SpatialVector( 0.4, 0.3, 0.2 ), /*mass=*/ 1.0 );
+            cuboids.push_back( box );
+            worb->Add( box );
+        }
+    }
+
+    worb->InitializeODE ();
+
+    // Sensor rays from random points above the ground in random directions
+    //
+    std::vector<Ray> batch( rays );
+    std::vector<QueryHit> hits( rays );
+
+    for ( unsigned i = 0; i < rays; ++i )
+    {
+        SpatialVector origin( area * Uniform (), 0.2 + 3 * Uniform (), area * Uniform () );
+        SpatialVector direction( Uniform () - 0.5, 0.3 * ( Uniform () - 0.7 ), Uniform () - 0.5 );
+        batch[i] = Ray( origin, direction, length );
+    }
+
+    const DynamicBroadphase::MethodType method[] = {
+        DynamicBroadphase::UseAllPairs,
+        DynamicBroadphase::UseSweepAndPrune,
+        DynamicBroadphase::UseSweepAndPrune
+    };
+    const char* name[] = { "all-pairs", "sweep-prune", "sweep-prune" };
+    const unsigned threadCount[] = { 1, 1, threads };
+
+    for ( unsigned k = 0; k < 3; ++k )
+    {
+        worb->BroadphaseMethod.Method = method[k];
+        SceneQuery<DynamicWorld> query( *worb, threadCount[k] );
+
+        double t0 = MonotonicTime ();
+        unsigned hitCount = query.RayCast( &batch[0], rays, &hits[0] );
+        double elapsed = MonotonicTime () - t0;
+
+        printf( "%-14s %8u %12.2f %12.3f %10u\n", name[k], threadCount[k],
+            elapsed * 1e3, rays / elapsed * 1e-6, hitCount );
+    }
+
+    DeleteBodies( spheres );
+    DeleteBodies( cuboids );
+    delete worb;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// triggers: region monitoring by sensor geometries versus scanning all the bodies
+
+/** Populates the system with `n` spheres drifting over the field without gravity.
+ */
+static void BuildDriftingSpheres( SpecializedWorld& worb,
+    std::vector<SolidSphere*>& bodies, unsigned n, double area )
+{
+    srand( 1 ); // Reproducible scenes
+
+    worb.RemoveObjects ();
+    worb.Gravity = 0.0;
+    worb.Collisions.Restitution = 0.9;
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        SolidSphere* ball = new SolidSphere(
+            SpatialVector( area * Uniform (), 0, area * Uniform () ), Quaternion( 1.0 ),
+            /*v=*/ SpatialVector( 4 * Uniform () - 2, 0, 4 * Uniform () - 2 ),
+            /*w=*/ 0.0, /*r=*/ 0.3, /*mass=*/ 1.0
+        );
+        bodies.push_back( ball );
+        worb.Add( ball );
+    }
+}
+
+/** Tests whether the sphere overlaps the cuboid (closest point on the cuboid).
+ */
+static bool SphereInCuboid( const Sphere& sphere, const Cuboid& box )
+{
+    Quaternion p = box.Transform ().TransformInverse( sphere.Position () );
+    Quaternion d = 0.0;
+
+    for ( unsigned i = 0; i < 3; ++i )
+    {
+        if ( p[i] > box.HalfExtent[i] ) {
+            d[i] = p[i] - box.HalfExtent[i];
+        }
+        else if ( p[i] < -box.HalfExtent[i] ) {
+            d[i] = p[i] + box.HalfExtent[i];
+        }
+    }
+
+    return d.ImSquaredNorm () <= sphere.Radius * sphere.Radius;
+}
+
+static int Bench_Triggers( int argc, char* argv[] )
+{
+    unsigned bodies  = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 2000;
+    unsigned regions = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 64;
+    unsigned steps   = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 200;
+
+    const double area = 2 * sqrt( double( bodies ) ); // The side of the field, in m
+
+    // The regions are static cuboid sensors on a grid, placed by their frames
+    //
+    unsigned side = 1;
+    while ( side * side < regions ) {
+        ++side;
+    }
+
+    std::vector<Cuboid>  sensors( regions );
+    std::vector<QTensor> frames( regions );
+
+    for ( unsigned i = 0; i < regions; ++i )
+    {
+        double x = area * ( i % side + 0.5 ) / side;
+        double z = area * ( i / side + 0.5 ) / side;
+
+        frames[i].SetFromOrientationAndPosition(
+            Quaternion( 1, 0, 0.3, 0 ).Unit (), SpatialVector( x, 0, z ) );
+
+        sensors[i].HalfExtent = SpatialVector( 1, 1, 0.5 );
+        sensors[i].Frame      = &frames[i];
+        sensors[i].Sensor     = true;
+    }
+
+    printf( "%u spheres drifting over %.0f x %.0f m, %u regions, %u steps\n\n",
+        bodies, area, area, regions, steps );
+    printf( "%-24s %12s %12s %10s %10s\n",
+        "Method", "us/step", "us/monitor", "enters", "exits" );
+
+    SpecializedWorld* worb = new SpecializedWorld;
+    std::vector<SolidSphere*> spheres;
+
+    // Scan: test every body against every region after each time-step
+    //
+    BuildDriftingSpheres( *worb, spheres, bodies, area );
+    worb->InitializeODE ();
+
+    std::vector<char> inside( regions * bodies, 0 );
+    unsigned long enters[2] = { 0, 0 }, exits[2] = { 0, 0 };
+    double stepTime[2] = { 0, 0 }, monitorTime[2] = { 0, 0 };
+
+    for ( unsigned n = 0; n < steps; ++n )
+    {
+        double t0 = MonotonicTime ();
+        worb->SolveODE( 0.01 );
+        double t1 = MonotonicTime ();
+
+        for ( unsigned r = 0; r < regions; ++r ) {
+            for ( unsigned i = 0; i < bodies; ++i )
+            {
+                char now = SphereInCuboid( *spheres[i], sensors[r] ) ? 1 : 0;
+                char& was = inside[ r * bodies + i ];
+                if ( now != was ) {
+                    ++( now ? enters[0] : exits[0] );
+                    was = now;
+                }
+            }
+        }
+
+        stepTime[0]    += t1 - t0;
+        monitorTime[0] += MonotonicTime () - t1;
+    }
+
+    DeleteBodies( spheres );
+
+    // Sensors: the same scene with the regions added as sensor geometries
+    //
+    BuildDriftingSpheres( *worb, spheres, bodies, area );
+    for ( unsigned r = 0; r < regions; ++r ) {
+        worb->Add( sensors[r] );
+    }
+    worb->InitializeODE ();
+
+    for ( unsigned n = 0; n < steps; ++n )
+    {
+        double t0 = MonotonicTime ();
+        worb->SolveODE( 0.01 );
+        stepTime[1] += MonotonicTime () - t0;
+
+        for ( unsigned k = 0; k < worb->Triggers.Events.size (); ++k ) {
+            ++( worb->Triggers.Events[k].Type == TriggerEvent::Enter ? enters[1] : exits[1] );
+        }
+    }
+
+    // The sensors are monitored within the time-step; their cost is the difference
+    //
+    stepTime[0]   += monitorTime[0];
+    monitorTime[1] = stepTime[1] - ( stepTime[0] - monitorTime[0] );
+
+    const char* name[] = { "scan all bodies", "sensor geometries" };
+    for ( unsigned k = 0; k < 2; ++k )
+    {
+        printf( "%-24s %12.1f %12.1f %10lu %10lu\n", name[k],
+            stepTime[k] / steps * 1e6, monitorTime[k] / steps * 1e6, enters[k], exits[k] );
+    }
+
+    printf( "\nOverlap tests per step: %.1f (scan: %u)\n",
+        double( worb->Triggers.Tests ) / steps, regions * bodies );
+
+    DeleteBodies( spheres );
+    delete worb;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// kinematic: scripted pushers as kinematic bodies versus infinite-mass dynamic bodies
+
+/** The system used by the pushers (sweep-and-prune, full diagnostics).
+ */
+typedef WorldOfRigidBodies<4096,16384,SweepAndPrune> PusherWorld;
+
+/** Runs the scene of spheres swept by the pushers moving along the path, either
+ * as kinematic bodies or as dynamic bodies with infinite mass placed every step.
+ */
+static void TimePushers( PusherWorld& worb, unsigned bodies, unsigned pushers,
+    unsigned steps, bool kinematic, double& stepTime, double& E_total, double& maxSpeed )
+{
+    srand( 1 ); // Reproducible scenes
+
+    worb.RemoveObjects ();
+    worb.Gravity = Const::g_n;
+    worb.Collisions.Restitution = 0.3;
+    worb.Collisions.Friction    = 0.2;
+
+    HalfSpace ground;
+    ground.Direction = Const::Y;
+    ground.Offset    = 0;
+    worb.Add( ground );
+
+    unsigned side = 1;
+    while ( side * side < bodies ) {
+        ++side;
+    }
+
+    std::vector<SolidSphere*> spheres;
+    for ( unsigned i = 0; i < bodies; ++i )
+    {
+        SolidSphere* ball = new SolidSphere(
+            SpatialVector( i % side + 0.1 * Uniform (), 0.3, i / side + 0.1 * Uniform () ),
+            Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0, /*r=*/ 0.3, /*mass=*/ 1.0
+        );
+        spheres.push_back( ball );
+        worb.Add( ball );
+    }
+
+    // The pushers sweep the field back and forth along x, each in its own lane
+    //
+    const double lane = double( side ) / pushers;
+
+    std::vector<KeyframedMotion> path( pushers );
+    std::vector<SolidCuboid*> boxes;
+
+    for ( unsigned i = 0; i < pushers; ++i )
+    {
+        double z = lane * ( i + 0.5 );
+
+        double T = side + 2; // At 1 m/s
+
+        path[i].Add( 0,     SpatialVector( -1,       0.35, z ), Quaternion( 1.0 ) );
+        path[i].Add( T,     SpatialVector( side + 1, 0.35, z ), Quaternion( 1.0 ) );
+        path[i].Add( 2 * T, SpatialVector( -1,       0.35, z ), Quaternion( 1.0 ) );
+        path[i].Loop = true;
+
+        SolidCuboid* box = new SolidCuboid( SpatialVector( -1, 0.35, z ),
+            Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0,
+            /*halfExtent=*/ SpatialVector( 0.25, 0.3, lane / 2 ), /*mass=*/ 1e30 );
+
+        if ( kinematic ) {
+            box->SetKinematic( &path[i] );
+        }
+
+        boxes.push_back( box );
+        worb.Add( box );
+    }
+
+    worb.InitializeODE ();
+
+    stepTime = 0;
+
+    for ( unsigned n = 0; n < steps; ++n )
+    {
+        double t0 = MonotonicTime ();
+
+        if ( ! kinematic ) // Place the pushers (they cannot have a velocity)
+        {
+            for ( unsigned i = 0; i < pushers; ++i )
+            {
+                Quaternion X, Q;
+                path[i].GetPose( worb.Time + 0.01, X, Q );
+                boxes[i]->RigidBody::Position = X;
+                boxes[i]->CalculateDerivedQuantities ();
+            }
+        }
+
+        worb.SolveODE( 0.01 );
+
+        stepTime += MonotonicTime () - t0;
+    }
+
+    stepTime /= steps;
+
+    E_total = worb.TotalKineticEnergy + worb.TotalPotentialEnergy;
+
+    maxSpeed = 0;
+    for ( unsigned i = 0; i < bodies; ++i ) {
+        maxSpeed = std::max( maxSpeed, spheres[i]->Velocity.ImNorm () );
+    }
+
+    worb.RemoveObjects ();
+    DeleteBodies( spheres );
+    DeleteBodies( boxes );
+}
+
+static int Bench_Kinematic( int argc, char* argv[] )
+{
+    unsigned bodies  = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 1000;
+    unsigned pushers = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 8;
+    unsigned steps   = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 400;
+
+    printf( "%u spheres swept by %u pushers, %u steps\n\n", bodies, pushers, steps );
+    printf( "%-32s %10s %14s %14s\n", "Pushers", "us/step", "E_total", "max |v|" );
+
+    PusherWorld* worb = new PusherWorld;
+
+    const char* name[] = { "dynamic, infinite mass", "kinematic, keyframed" };
+    for ( unsigned k = 0; k < 2; ++k )
+    {
+        double stepTime, E_total, maxSpeed;
+        TimePushers( *worb, bodies, pushers, steps, k == 1, stepTime, E_total, maxSpeed );
+
+        printf( "%-32s %10.1f %14.6g %14.3f\n", name[k], stepTime * 1e6, E_total, maxSpeed );
+    }
+
+    delete worb;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// static: spheres falling on an architecture of infinite-mass cuboids
+
+static int Bench_Static( int argc, char* argv[] )
+{
+    unsigned blocks = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 2000;
+    unsigned bodies = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 500;
+    unsigned steps  = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 200;
+
+    srand( 1 ); // Reproducible scenes
+
+    SpecializedWorld* worb = new SpecializedWorld;
+
+    worb->RemoveObjects ();
+    worb->Gravity = Const::g_n;
+    worb->Collisions.Restitution = 0.3;
+    worb->Collisions.Friction    = 0.2;
+
+    HalfSpace ground;
+    ground.Direction = Const::Y;
+    ground.Offset    = 0;
+    worb->Add( ground );
+
+    // The architecture: walls of stacked blocks with infinite mass on a grid
+    //
+    unsigned side = 1;
+    while ( side * side * 4 < blocks ) {
+        ++side;
+    }
+
+    std::vector<SolidCuboid*> cuboids;
+    for ( unsigned i = 0; i < blocks; ++i )
+    {
+        unsigned cell = i / 4, level = i % 4;
+        SpatialVector position( 3.0 * ( cell % side ), 0.5 + level, 3.0 * ( cell / side ) );
+
+        SolidCuboid* block = new SolidCuboid( position, Quaternion( 1.0 ),
+            /*v=*/ 0.0, /*w=*/ 0.0, /*halfExtent=*/ SpatialVector( 1.0, 0.5, 0.25 ),
+            /*mass=*/ 1e30 );
+        cuboids.push_back( block );
+        worb->Add( block );
+    }
+
+    std::vector<SolidSphere*> spheres;
+    for ( unsigned i = 0; i < bodies; ++i )
+    {
+        SolidSphere* ball = new SolidSphere(
+            SpatialVector( 3.0 * side * Uniform (), 5 + 3 * Uniform (), 3.0 * side * Uniform () ),
+            Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0, /*r=*/ 0.3, /*mass=*/ 1.0
+        );
+        spheres.push_back( ball );
+        worb->Add( ball );
+    }
+
+    worb->InitializeODE ();
+
+    printf( "%u spheres falling on %u blocks with infinite mass, %u steps\n\n",
+        bodies, blocks, steps );
+
+    double contacts = 0;
+    double t0 = MonotonicTime ();
+    for ( unsigned n = 0; n < steps; ++n )
+    {
+        worb->SolveODE( 0.01 );
+        contacts += worb->Collisions.Count ();
+    }
+    double elapsed = MonotonicTime () - t0;
+
+    worb->CalculateTotals ();
+
+    printf( "%-24s %12.1f\n", "us/step", elapsed / steps * 1e6 );
+    printf( "%-24s %12.1f\n", "contacts/step", contacts / steps );
+    printf( "%-24s %12.4g\n", "E_k (final)", worb->TotalKineticEnergy );
+    printf( "%-24s %12.4g\n", "|p| (final)", worb->TotalLinearMomentum.ImNorm () );
+
+    DeleteBodies( spheres );
+    DeleteBodies( cuboids );
+    delete worb;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Granular media
+
+/** Fills the granular system with a slightly compressed lattice of `n` spheres
+ * in a box open at the top.
+ */
+static void BuildGranularBox( GranularSystem& dem, HalfSpace* walls, unsigned n )
+{
+    srand( 1 ); // Reproducible scenes
+
+    const double r = 0.05, spacing = 1.98 * r;
+    const unsigned side = 40;
+
+    dem.Clear ();
+    dem.Gravity     = Const::g_n;
+    dem.Stiffness   = 1e5;
+    dem.Restitution = 0.5;
+    dem.Friction    = 0.5;
+
+    // The floor and four side walls
+    //
+    const Quaternion normals[5] = { Const::Y, Const::X, -Const::X, Const::Z, -Const::Z };
+    const double offsets[5] = { 0, 0, -spacing * side, 0, -spacing * side };
+
+    for ( unsigned i = 0; i < 5; ++i )
+    {
+        walls[i].Direction = normals[i];
+        walls[i].Offset    = offsets[i];
+        dem.Add( walls[i] );
+    }
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        unsigned layer = i / ( side * side ), cell = i % ( side * side );
+
+        SpatialVector x( spacing * ( 0.5 + cell % side ), r + spacing * layer,
+            spacing * ( 0.5 + cell / side ) );
+        SpatialVector v( 0.1 * ( Uniform () - 0.5 ), 0, 0.1 * ( Uniform () - 0.5 ) );
+
+        dem.Add( x, v, r, /*mass=*/ 1.0 );
+    }
+}
+
+static int Bench_Granular( int argc, char* argv[] )
+{
+    unsigned particles = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 20000;
+    unsigned steps     = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 200;
+    unsigned threads   = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 4;
+
+    GranularSystem dem;
+    HalfSpace walls[5];
+
+    BuildGranularBox( dem, walls, particles );
+    const double h = dem.ContactDuration () / 15;
+
+    printf( "%u spheres settling in a box, %u steps of %.3g s\n\n", particles, steps, h );
+    printf( "%-8s %12s %14s %16s %18s %12s\n", "threads", "us/step", "contacts/step",
+        "pair tests/s", "contacts/s/core", "E_k (final)" );
+
+    for ( unsigned t = 1; t <= threads; t = t < threads && 2 * t > threads ? threads : 2 * t )
+    {
+        BuildGranularBox( dem, walls, particles );
+        dem.Threads = t;
+        dem.PairTests = dem.ContactEvaluations = 0;
+
+        double t0 = MonotonicTime ();
+        for ( unsigned n = 0; n < steps; ++n ) {
+            dem.Step( h );
+        }
+        double elapsed = MonotonicTime () - t0;
+
+        printf( "%-8u %12.1f %14.0f %16.4g %18.4g %12.6g\n", t,
+            elapsed / steps * 1e6, dem.ContactEvaluations / steps,
+            dem.PairTests / elapsed, dem.ContactEvaluations / elapsed / t,
+            dem.KineticEnergy () );
+    }
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Tall stacks
+
+/** Runs `stacks` stacks of `height` plates resting on the ground with the given
+ * solver policy and prints the impulse transfers per time-step and how the stacks
+ * settle.
+ */
+template<class Solver>
+static void TimeStacks( const char* label, unsigned stacks, unsigned height,
+    unsigned steps )
+{
+    typedef WorldOfRigidBodies<4096,16384,SweepAndPrune,Solver> World;
+
+    srand( 1 ); // Reproducible scenes
+
+    World* worb = new World;
+    worb->Gravity = Const::g_n;
+    worb->Collisions.Restitution = 0.2;
+    worb->Collisions.Friction    = 0.2;
+
+    HalfSpace ground;
+    ground.Direction = Const::Y;
+    ground.Offset    = 0;
+    worb->Add( ground );
+
+    const double thick = 0.2;
+
+    std::vector<SolidCuboid*> plates;
+    for ( unsigned s = 0; s < stacks; ++s )
+    {
+        for ( unsigned i = 0; i < height; ++i )
+        {
+            SolidCuboid* plate = new SolidCuboid(
+                SpatialVector( 6.0 * s, thick * ( 2 * i + 1 ), 0 ),
+                Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0,
+                /*halfExtent=*/ SpatialVector( 2, thick, 2 ), /*mass=*/ 1.0
+            );
+            plate->CanBeDeactivated = true;
+            plates.push_back( plate );
+            worb->Add( plate );
+        }
+    }
+
+    worb->InitializeODE ();
+
+    double transfers = 0, lateTransfers = 0;
+    unsigned asleep = 0; // The step since which all the plates are inactive
+    const unsigned late = steps - steps / 10;
+
+    double t0 = MonotonicTime ();
+    for ( unsigned n = 0; n < steps; ++n )
+    {
+        worb->SolveODE( 0.01 );
+
+        transfers += worb->Collisions.ImpulseIterations;
+        if ( n >= late ) {
+            lateTransfers += worb->Collisions.ImpulseIterations;
+        }
+
+        unsigned active = 0;
+        for ( unsigned i = 0; i < plates.size (); ++i ) {
+            active += plates[i]->IsActive ? 1 : 0;
+        }
+
+        if ( active ) {
+            asleep = 0;
+        }
+        else if ( ! asleep ) {
+            asleep = n + 1;
+        }
+    }
+    double elapsed = MonotonicTime () - t0;
+
+    // The sinking of the stacks
+    //
+    double sink = 0;
+    for ( unsigned s = 0; s < stacks; ++s )
+    {
+        const SolidCuboid* top = plates[ s * height + height - 1 ];
+        sink += thick * ( 2 * height - 1 ) - top->RigidBody::Position.y;
+    }
+
+    unsigned active = 0;
+    for ( unsigned i = 0; i < plates.size (); ++i ) {
+        active += plates[i]->IsActive ? 1 : 0;
+    }
+
+    char settled[32] = "never";
+    if ( asleep ) {
+        sprintf( settled, "%u", asleep );
+    }
+
+    printf( "%-20s %12.1f %14.0f %14.0f %8u %10s %12.4f\n", label,
+        elapsed / steps * 1e6, transfers / steps, lateTransfers / ( steps - late ),
+        active, settled, sink / stacks );
+
+    DeleteBodies( plates );
+    delete worb;
+}
+
+static int Bench_Stack( int argc, char* argv[] )
+{
+    unsigned height = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 50;
+    unsigned stacks = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 4;
+    unsigned steps  = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 1000;
+
+    printf( "%u stacks of %u plates, %u steps\n\n", stacks, height, steps );
+    printf( "%-20s %12s %14s %14s %8s %10s %12s\n", "solver", "us/step",
+        "transfers/step", "(last 10%)", "active", "asleep at", "top sink" );
+
+    TimeStacks<SequentialImpulses>( "sequential impulses", stacks, height, steps );
+    TimeStacks<ShockPropagation>( "shock propagation", stacks, height, steps );
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Contact reuse
+
+/** Runs a row of `stacks` stacks of `height` cubes that never fall asleep, with or
+ * without the reuse of the resting contacts (generated anew every `interval`
+ * time-steps), and prints the time-step cost, the narrowphase cost, the cuboid pairs
+ * in contact that ran the SAT and the height of the stacks.
+ *
+ * The narrowphase is timed apart from the time-steps, detecting the collisions once
+ * more after every time-step into a separate resolver configured the same way.
+ */
+static void TimeReuse( const char* label, bool reuse, unsigned interval,
+    unsigned stacks, unsigned height, unsigned steps )
+{
+    typedef WorldOfRigidBodies<4096,16384,SweepAndPrune,ShockPropagation> World;
+
+    World* worb = new World;
+    worb->Gravity = Const::g_n;
+    worb->Collisions.Restitution = 0.2;
+    worb->Collisions.Friction    = 0.2;
+    worb->Collisions.RestingContacts.Enabled = reuse;
+    worb->Collisions.RestingContacts.RefreshInterval = interval;
+
+    HalfSpace ground;
+    ground.Direction = Const::Y;
+    ground.Offset    = 0;
+    worb->Add( ground );
+
+    std::vector<Geometry*> shapes( 1, &ground );
+
+    // The stacks are further apart than the bounding spheres, so the sweep and prune
+    // finds only the pairs within a stack
+    //
+    std::vector<SolidCuboid*> cubes;
+    for ( unsigned s = 0; s < stacks; ++s )
+    {
+        for ( unsigned k = 0; k < height; ++k )
+        {
+            SolidCuboid* cube = new SolidCuboid(
+                SpatialVector( 2.0 * s, 0.5 + k, 0 ),
+                Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0,
+                /*halfExtent=*/ SpatialVector( 0.5, 0.5, 0.5 ), /*mass=*/ 1.0
+            );
+            cube->CanBeDeactivated = false;
+            cubes.push_back( cube );
+            shapes.push_back( cube );
+            worb->Add( cube );
+        }
+    }
+
+    worb->InitializeODE ();
+
+    // Let the stacks settle before timing
+    //
+    for ( unsigned n = 0; n < 50; ++n ) {
+        worb->SolveODE( 0.01 );
+    }
+
+    std::vector<Collision> area( 16384 );
+    CollisionResolver resolver( &area[0], unsigned( area.size () ) );
+    resolver.RestingContacts.Enabled = reuse;
+    resolver.RestingContacts.RefreshInterval = interval;
+
+    SweepAndPrune sweep;
+    CandidatePairs pairs;
+
+    double elapsed = 0, narrowphase = 0, contacts = 0;
+
+    for ( unsigned n = 0; n < steps; ++n )
+    {
+        double t0 = MonotonicTime ();
+        worb->SolveODE( 0.01 );
+        double t1 = MonotonicTime ();
+
+        resolver.Initialize ();
+        pairs.Clear ();
+        sweep.FindPairs( pairs, &shapes[0], unsigned( shapes.size () ) );
+
+        double t2 = MonotonicTime ();
+        pairs.Detect( resolver );
+        double t3 = MonotonicTime ();
+
+        elapsed     += t1 - t0;
+        narrowphase += t3 - t2;
+        contacts    += worb->Collisions.Count ();
+    }
+
+    double top = 0;
+    for ( unsigned i = height - 1; i < cubes.size (); i += height ) {
+        top += cubes[i]->RigidBody::Position.y;
+    }
+
+    const ContactCache& cache = resolver.RestingContacts;
+
+    printf( "%-10s %10.1f %14.1f %10.0f %10.0f %10.1f %12.6f\n", label,
+        elapsed / steps * 1e6, narrowphase / steps * 1e6, contacts / steps,
+        double( cache.Generated ) / steps, cache.ReuseRate () * 100, top / stacks );
+
+    DeleteBodies( cubes );
+    delete worb;
+}
+
+static int Bench_Reuse( int argc, char* argv[] )
+{
+    unsigned stacks   = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 256;
+    unsigned height   = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 4;
+    unsigned steps    = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 400;
+    unsigned interval = argc >= 4 ? unsigned( atoi( argv[3] ) ) : 8;
+
+    printf( "%u stacks of %u cubes, %u steps, refresh every %u steps\n\n",
+        stacks, height, steps, interval );
+    printf( "%-10s %10s %14s %10s %10s %10s %12s\n", "contacts", "us/step",
+        "narrowphase us", "contacts", "SAT/step", "reused %", "top height" );
+
+    TimeReuse( "detected", false, interval, stacks, height, steps );
+    TimeReuse( "reused", true, interval, stacks, height, steps );
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Spatial reordering
+
+/** Counts the cache misses of the calling thread with the hardware performance
+ * counters, if the kernel makes them available (otherwise Read returns -1).
+ */
+class CacheMissCounter
+{
+    int fd;
+
+public:
+
+    CacheMissCounter ()
+    {
+        perf_event_attr attr;
+        memset( &attr, 0, sizeof( attr ) );
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.size           = sizeof( attr );
+        attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+
+        fd = int( syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 ) );
+    }
+
+    ~CacheMissCounter ()
+    {
+        if ( fd >= 0 ) {
+            close( fd );
+        }
+    }
+
+    void Start ()
+    {
+        if ( fd >= 0 ) {
+            ioctl( fd, PERF_EVENT_IOC_RESET, 0 );
+            ioctl( fd, PERF_EVENT_IOC_ENABLE, 0 );
+        }
+    }
+
+    double Read ()
+    {
+        long long count = 0;
+        if ( fd < 0 ) {
+            return -1;
+        }
+        ioctl( fd, PERF_EVENT_IOC_DISABLE, 0 );
+        if ( read( fd, &count, sizeof( count ) ) != sizeof( count ) ) {
+            return -1;
+        }
+        return double( count );
+    }
+};
+
+/** Runs a layer of `bodies` spheres drifting without gravity in a strip of `rows`
+ * rows (so they collide now and then), created in a SolidArray in a random spatial
+ * order, and prints the time-step cost and the cache misses per time-step. The
+ * objects (and the solids in the array) are sorted by their Morton codes every
+ * `interval` time-steps (0 = never).
+ *
+ * Since the hardware counters are often unavailable (e.g. in virtual machines),
+ * the locality is also measured directly: the mean distance in memory between
+ * the bodies of the successive contacts, in the order they are resolved.
+ */
+static void TimeReorder( const char* label, unsigned interval,
+    unsigned bodies, unsigned rows, unsigned steps )
+{
+    typedef WorldOfRigidBodies<262144,65536,SweepAndPrune> World;
+
+    World* worb = new World;
+    worb->Gravity = 0.0;
+    worb->Collisions.Restitution = 0.9;
+    worb->Collisions.Friction    = 0.0;
+    worb->ReorderInterval = interval;
+
+    // Shuffle the places, so the memory order of the bodies is unrelated to
+    // their neighbourhood (as if they were created over time)
+    //
+    srand( 1 );
+    std::vector<unsigned> place( bodies );
+    for ( unsigned i = 0; i < bodies; ++i ) {
+        place[i] = i;
+    }
+    for ( unsigned i = bodies; i > 1; --i ) {
+        std::swap( place[i-1], place[ unsigned( Uniform () * i ) ] );
+    }
+
+    std::vector<Quaternion> position( bodies ), velocity( bodies );
+    std::vector<double> radius( bodies, 0.5 ), mass( bodies, 1.0 );
+
+    for ( unsigned i = 0; i < bodies; ++i )
+    {
+        double x = 1.2 * ( place[i] / rows );
+        double z = 1.2 * ( place[i] % rows );
+        double phi = 2 * Const::Pi * Uniform ();
+
+        position[i] = SpatialVector( x, 0.5, z );
+        velocity[i] = SpatialVector( cos( phi ), 0, sin( phi ) );
+    }
+
+    SolidArray<SolidSphere> spheres;
+    spheres.Create( bodies, &radius[0], &mass[0], &position[0], /*orientation=*/ 0,
+        &velocity[0] );
+
+    for ( unsigned i = 0; i < bodies; ++i ) {
+        spheres[i].CanBeDeactivated = false;
+    }
+
+    worb->Add( spheres );
+    worb->InitializeODE ();
+
+    for ( unsigned n = 0; n < 10; ++n ) {
+        worb->SolveODE( 0.01 );
+    }
+
+    CacheMissCounter misses;
+    double contacts = 0, elapsed = 0, missed = 0;
+    double distance = 0, jumps = 0;
+
+    for ( unsigned n = 0; n < steps; ++n )
+    {
+        misses.Start ();
+        double t0 = MonotonicTime ();
+
+        worb->SolveODE( 0.01 );
+
+        elapsed += MonotonicTime () - t0;
+        double m = misses.Read ();
+        missed = missed < 0 || m < 0 ? -1 : missed + m;
+
+        const unsigned count = worb->Collisions.Count ();
+        contacts += count;
+
+        const Collision* contact = worb->CollisionRegistry;
+        for ( unsigned c = 1; c < count; ++c )
+        {
+            const char* a = reinterpret_cast<const char*>( contact[c-1].Body_A );
+            const char* b = reinterpret_cast<const char*>( contact[c].Body_A );
+            distance += a < b ? double( b - a ) : double( a - b );
+            jumps += 1;
+        }
+    }
+
+    char missText[ 32 ] = "n/a";
+    if ( missed >= 0 ) {
+        sprintf( missText, "%.0f", missed / steps );
+    }
+
+    printf( "%-10s %10.1f %10.0f %14s %14.0f\n", label, elapsed / steps * 1e6,
+        contacts / steps, missText, jumps > 0 ? distance / jumps : 0.0 );
+
+    delete worb;
+}
+
+static int Bench_Reorder( int argc, char* argv[] )
+{
+    unsigned bodies   = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 262144;
+    unsigned steps    = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 10;
+    unsigned interval = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 5;
+    unsigned rows     = 16;
+
+    if ( bodies > 262144 ) {
+        bodies = 262144;
+    }
+
+    // The order matters once the solids do not fit in the last-level cache
+    //
+    printf( "%u spheres (%.0f MB) in %u rows, %u steps, reordered every %u steps\n\n",
+        bodies, bodies * double( sizeof( SolidSphere ) ) / 1e6, rows, steps, interval );
+    printf( "%-10s %10s %10s %14s %14s\n", "order", "us/step", "contacts", "misses/step",
+        "stride [B]" );
+
+    TimeReorder( "insertion", 0, bodies, rows, steps );
+    TimeReorder( "morton", interval, bodies, rows, steps );
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Parallel broadphase
+
+static int Bench_Broadphase( int argc, char* argv[] )
+{
+    unsigned bodies  = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 16000;
+    unsigned steps   = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 50;
+    unsigned threads = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 8;
+
+    typedef WorldOfRigidBodies<16400,65536,SweepAndPrune> World;
+
+    if ( bodies > 16384 ) {
+        bodies = 16384;
+    }
+
+    const double area = 4 * sqrt( double( bodies ) ); // The side of the field, in m
+
+    printf( "%u bodies drifting over %.0f x %.0f m, %u steps\n\n",
+        bodies, area, area, steps );
+    printf( "%-14s %8s %12s %12s %10s\n",
+        "Broadphase", "threads", "us/step", "pairs", "identical" );
+
+    srand( 1 ); // Reproducible scenes
+
+    World* worb = new World;
+    worb->Gravity = 0.0;
+
+    HalfSpace ground;
+    ground.Direction = Const::Y;
+    ground.Offset    = 0;
+    worb->Add( ground );
+
+    std::vector<Geometry*> shapes( 1, &ground );
+    std::vector<SolidSphere*> spheres;
+
+    for ( unsigned i = 0; i < bodies; ++i )
+    {
+        SolidSphere* ball = new SolidSphere(
+            SpatialVector( area * Uniform (), 0.5, area * Uniform () ), Quaternion( 1.0 ),
+            /*v=*/ SpatialVector( Uniform () - 0.5, 0, Uniform () - 0.5 ), /*w=*/ 0.0,
+            /*r=*/ 0.2 + 0.3 * Uniform (), /*mass=*/ 1.0 );
+        spheres.push_back( ball );
+        shapes.push_back( ball );
+        worb->Add( ball );
+    }
+
+    worb->InitializeODE ();
+
+    // Every broadphase keeps its own sorted order; the pairs of the parallel ones
+    // are compared with the serial pairs every time-step
+    //
+    std::vector<unsigned> threadCount;
+    for ( unsigned t = 1; t <= threads; t *= 2 ) {
+        threadCount.push_back( t );
+    }
+
+    const unsigned methods = unsigned( threadCount.size () );
+
+    SweepAndPrune serial;
+    std::vector<ParallelSweepAndPrune> parallel( methods );
+    for ( unsigned k = 0; k < methods; ++k ) {
+        parallel[k].Threads = threadCount[k];
+    }
+
+    CandidatePairs expected, found;
+    std::vector<double> elapsed( methods + 1, 0.0 );
+    std::vector<bool> identical( methods, true );
+    double pairCount = 0;
+
+    for ( unsigned n = 0; n < steps; ++n )
+    {
+        worb->SolveODE( 0.01 );
+
+        expected.Clear ();
+        double t0 = MonotonicTime ();
+        serial.FindPairs( expected, &shapes[0], unsigned( shapes.size () ) );
+        elapsed[0] += MonotonicTime () - t0;
+        pairCount += expected.Count ();
+
+        for ( unsigned k = 0; k < methods; ++k )
+        {
+            found.Clear ();
+            t0 = MonotonicTime ();
+            parallel[k].FindPairs( found, &shapes[0], unsigned( shapes.size () ) );
+            elapsed[k+1] += MonotonicTime () - t0;
+
+            if ( ! ( found == expected ) ) {
+                identical[k] = false;
+            }
+        }
+    }
+
+    printf( "%-14s %8u %12.1f %12.0f %10s\n", "sweep-prune", 1,
+        elapsed[0] / steps * 1e6, pairCount / steps, "-" );
+
+    for ( unsigned k = 0; k < methods; ++k ) {
+        printf( "%-14s %8u %12.1f %12.0f %10s\n", "parallel", threadCount[k],
+            elapsed[k+1] / steps * 1e6, pairCount / steps, identical[k] ? "yes" : "NO" );
+    }
+
+    DeleteBodies( spheres );
+    delete worb;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Domain decomposition
+
+/** Simulates the domain `index` of the spheres rolling on the ground along a strip
+ * (the same scene in every process) and gathers the final states into the table
+ * of the exchange. Returns false if a neighbour did not respond.
+ */
+static bool RunDomain( DomainExchange& exchange, unsigned index,
+    unsigned bodies, unsigned steps )
+{
+    typedef WorldOfRigidBodies<4096,16384,SweepAndPrune> World;
+
+    const unsigned rows = 8;
+    const double length = 1.5 * bodies / rows;
+    const double slab = length / exchange.GetDomainCount ();
+
+    World* worb = new World;
+    worb->Gravity = Const::g_n;
+    worb->Collisions.Restitution = 0.5;
+    worb->Collisions.Friction    = 0.2;
+
+    Domain<World>* domain = new Domain<World>(
+        *worb, exchange, index, slab * index, slab * ( index + 1 ) );
+    domain->GhostWidth = 2.5;
+
+    HalfSpace ground;
+    ground.Direction = Const::Y;
+    ground.Offset    = 0;
+    domain->AddScenery( ground );
+
+    srand( 1 ); // The same scene in every process
+
+    for ( unsigned i = 0; i < bodies; ++i )
+    {
+        double r = 0.3 + 0.2 * Uniform ();
+        double x = 1.5 * ( i / rows ) + 0.2 * Uniform ();
+        double z = 1.5 * ( i % rows ) + 0.2 * Uniform ();
+
+        SolidSphere* ball = new SolidSphere(
+            SpatialVector( x, r, z ), Quaternion( 1.0 ),
+            /*v=*/ SpatialVector( 2 * Uniform () - 1, 0, 2 * Uniform () - 1 ),
+            /*w=*/ 0.0, r, /*mass=*/ r * r * r );
+        ball->CanBeDeactivated = false;
+
+        domain->AddBody( i, ball );
+    }
+
+    domain->InitializeODE ();
+
+    bool ok = true;
+    for ( unsigned n = 0; ok && n < steps; ++n ) {
+        ok = domain->SolveODE( 0.01 );
+    }
+
+    domain->Gather ();
+
+    delete domain;
+    delete worb;
+
+    return ok;
+}
+
+/** Runs the scene in the given number of processes and copies the final states.
+ * Returns the wall time, or a negative value if a process failed.
+ */
+static double RunDomains( unsigned processes, unsigned bodies, unsigned steps,
+    std::vector<DomainRecord>& results )
+{
+    // The segment name is private to the benchmark, so a segment left by
+    // a crashed run is replaced
+    //
+    DomainExchange exchange;
+    if ( ! exchange.Create( "worb-bench-domains", processes, bodies, bodies, true ) ) {
+        return -1;
+    }
+
+    double t0 = MonotonicTime ();
+
+    std::vector<pid_t> child( processes );
+    for ( unsigned i = 0; i < processes; ++i )
+    {
+        child[i] = fork ();
+        if ( child[i] == 0 ) {
+            _exit( RunDomain( exchange, i, bodies, steps ) ? 0 : 1 );
+        }
+    }
+
+    bool ok = true;
+    for ( unsigned i = 0; i < processes; ++i )
+    {
+        int status = 0;
+        if ( child[i] < 0 || waitpid( child[i], &status, 0 ) != child[i]
+            || ! WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+            ok = false;
+        }
+    }
+
+    double elapsed = MonotonicTime () - t0;
+
+    const DomainRecord* table = exchange.GetResults ();
+    results.assign( table, table + bodies );
+
+    return ok ? elapsed : -1;
+}
+
+static int Bench_Domains( int argc, char* argv[] )
+{
+    unsigned bodies    = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 2000;
+    unsigned steps     = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 200;
+    unsigned processes = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 8;
+    double   tolerance = argc >= 4 ? atof( argv[3] ) : 0.05;
+
+    if ( bodies > 4096 ) {
+        bodies = 4096;
+    }
+
+    printf( "%u spheres rolling along a strip, %u steps, tolerance %g m\n\n",
+        bodies, steps, tolerance );
+    printf( "%-10s %10s %14s %14s %10s\n",
+        "processes", "time s", "max |dx| m", "max |dv| m/s", "result" );
+
+    std::vector<DomainRecord> reference, results;
+
+    double elapsed = RunDomains( 1, bodies, steps, reference );
+    if ( elapsed < 0 ) {
+        printf( "The single-process run failed\n" );
+        return 1;
+    }
+    printf( "%-10u %10.3f %14s %14s %10s\n", 1, elapsed, "-", "-", "-" );
+
+    int failed = 0;
+
+    for ( unsigned p = 2; p <= processes; ++p )
+    {
+        elapsed = RunDomains( p, bodies, steps, results );
+
+        // Every body has to be gathered exactly once, close to the reference
+        //
+        double dx = 0, dv = 0;
+        bool complete = elapsed >= 0;
+
+        for ( unsigned i = 0; complete && i < bodies; ++i )
+        {
+            const DomainRecord& a = reference[i];
+            const DomainRecord& b = results[i];
+            if ( b.Kind != DomainRecord::Result || b.Id != i ) {
+                complete = false;
+                break;
+            }
+            for ( unsigned k = 0; k < 3; ++k ) {
+                dx = std::max( dx, fabs( a.X[k] - b.X[k] ) );
+                dv = std::max( dv, fabs( a.P[k] - b.P[k] ) / a.Mass );
+            }
+        }
+
+        bool passed = complete && dx <= tolerance;
+        failed += passed ? 0 : 1;
+
+        if ( complete ) {
+            printf( "%-10u %10.3f %14.3g %14.3g %10s\n",
+                p, elapsed, dx, dv, passed ? "ok" : "FAILED" );
+        }
+        else {
+            printf( "%-10u %10s %14s %14s %10s\n", p, "-", "-", "-", "FAILED" );
+        }
+    }
+
+    return failed ? 1 : 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// NUMA placement
+
+/** Times the granular box on the given number of workers, either with the workers
+ * pinned to the nodes and the particles placed on their nodes, or left to the
+ * scheduler with the particles in the memory touched by the main thread.
+ */
+static double TimeGranularPlacement( const NumaTopology& topology, bool aware,
+    unsigned particles, unsigned steps, unsigned threads )
+{
+    std::vector<unsigned> cpus = topology.WorkerCpus( threads );
+    if ( aware ) {
+        SetWorkerCpus( &cpus[0], threads );
+    }
+
+    GranularSystem* dem = new GranularSystem;
+    HalfSpace walls[5];
+
+    BuildGranularBox( *dem, walls, particles );
+    dem->Threads = threads;
+    if ( aware ) {
+        dem->Distribute ();
+    }
+
+    const double h = dem->ContactDuration () / 15;
+
+    double t0 = MonotonicTime ();
+    for ( unsigned n = 0; n < steps; ++n ) {
+        dem->Step( h );
+    }
+    double elapsed = MonotonicTime () - t0;
+
+    delete dem;
+    SetWorkerCpus( 0, 0 );
+
+    return elapsed / steps;
+}
+
+static int Bench_Numa( int argc, char* argv[] )
+{
+    NumaTopology topology;
+    bool detected = topology.Detect ();
+
+    unsigned particles = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 20000;
+    unsigned steps     = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 100;
+    unsigned threads   = argc >= 3 ? unsigned( atoi( argv[2] ) ) : topology.CpuCount ();
+
+    if ( threads < 1 ) {
+        threads = 1;
+    }
+
+    printf( "%u node(s)%s:\n", topology.NodeCount (), detected ? "" : " (not detected)" );
+    for ( unsigned i = 0; i < topology.NodeCount (); ++i )
+    {
+        const std::vector<unsigned>& cpus = topology.Cpus( i );
+        printf( "    node %u: %u cpu(s), first %u, last %u\n",
+            i, unsigned( cpus.size () ), cpus.front (), cpus.back () );
+    }
+
+    printf( "\n%u spheres settling in a box, %u steps\n\n", particles, steps );
+    printf( "%-8s %14s %10s %14s %10s\n",
+        "threads", "naive us/step", "speedup", "NUMA us/step", "speedup" );
+
+    double base = 0;
+
+    for ( unsigned t = 1; t <= threads; t = t < threads && 2 * t > threads ? threads : 2 * t )
+    {
+        double naive = TimeGranularPlacement( topology, false, particles, steps, t );
+        double aware = TimeGranularPlacement( topology, true,  particles, steps, t );
+
+        if ( t == 1 ) {
+            base = naive;
+        }
+
+        printf( "%-8u %14.1f %10.2f %14.1f %10.2f\n",
+            t, naive * 1e6, base / naive, aware * 1e6, base / aware );
+    }
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Block solver
+
+/** Counts the manifolds among the registered contacts: the runs of 2 to 4
+ * consecutive contacts between the same bodies.
+ */
+static unsigned CountManifolds( const CollisionResolver& collisions )
+{
+    unsigned manifolds = 0;
+    for ( unsigned i = 0; i < collisions.Count (); )
+    {
+        unsigned end = i + 1;
+        while ( end < collisions.Count ()
+            && collisions[end].Body_A == collisions[i].Body_A
+            && collisions[end].Body_B == collisions[i].Body_B ) {
+            ++end;
+        }
+        manifolds += end - i >= 2 && end - i <= 4 ? 1 : 0;
+        i = end;
+    }
+    return manifolds;
+}
+
+/** Runs `stacks` stacks of `height` cubes resting on the ground (kept awake) with
+ * the given solver policy and prints the impulse iterations per manifold and how
+ * far the stacks sink and drift. The cubes are convex hulls, whose pairs keep
+ * persistent manifolds of up to four points (the cuboid detectors register
+ * a single contact for the resting faces).
+ */
+template<class Solver>
+static void TimeManifolds( const char* label, const Solver& solver,
+    unsigned stacks, unsigned height, unsigned steps )
+{
+    typedef WorldOfRigidBodies<4096,16384,SweepAndPrune,Solver> World;
+
+    World* worb = new World;
+    worb->SolverMethod = solver;
+    worb->Gravity = Const::g_n;
+    worb->Collisions.Restitution = 0.2;
+    worb->Collisions.Friction    = 0.5;
+
+    HalfSpace ground;
+    ground.Direction = Const::Y;
+    ground.Offset    = 0;
+    worb->Add( ground );
+
+    double corners[ 3 * 8 ];
+    for ( unsigned k = 0; k < 8; ++k )
+    {
+        corners[ 3*k     ] = k & 1 ? 0.5 : -0.5;
+        corners[ 3*k + 1 ] = k & 2 ? 0.5 : -0.5;
+        corners[ 3*k + 2 ] = k & 4 ? 0.5 : -0.5;
+    }
+
+    std::vector<SolidConvexHull*> cubes;
+    for ( unsigned s = 0; s < stacks; ++s )
+    {
+        for ( unsigned i = 0; i < height; ++i )
+        {
+            SolidConvexHull* cube = new SolidConvexHull(
+                SpatialVector( 3.0 * s, 0.5 + i, 0 ), Quaternion( 1.0 ),
+                /*v=*/ 0.0, /*w=*/ 0.0, corners, 8, /*mass=*/ 1.0
+            );
+            cube->CanBeDeactivated = false;
+            cubes.push_back( cube );
+            worb->Add( cube );
+        }
+    }
+
+    worb->InitializeODE ();
+
+    double iterations = 0, manifolds = 0, fallbacks = 0;
+
+    double t0 = MonotonicTime ();
+    for ( unsigned n = 0; n < steps; ++n )
+    {
+        worb->SolveODE( 0.01 );
+
+        iterations += worb->Collisions.ImpulseIterations;
+        manifolds  += CountManifolds( worb->Collisions );
+        fallbacks  += worb->Collisions.BlockFallbacks;
+    }
+    double elapsed = MonotonicTime () - t0;
+
+    // The sinking of the tops and the horizontal drift of the cubes
+    //
+    double sink = 0, drift = 0;
+    for ( unsigned s = 0; s < stacks; ++s )
+    {
+        sink += height - 0.5 - cubes[ s * height + height - 1 ]->RigidBody::Position.y;
+        for ( unsigned i = 0; i < height; ++i )
+        {
+            const Quaternion& x = cubes[ s * height + i ]->RigidBody::Position;
+            double dx = x.x - 3.0 * s;
+            drift = std::max( drift, sqrt( dx * dx + x.z * x.z ) );
+        }
+    }
+
+    printf( "%-20s %10.1f %12.1f %12.1f %14.2f %10.0f %10.4f %10.4f\n", label,
+        elapsed / steps * 1e6, manifolds / steps, iterations / steps,
+        manifolds ? iterations / manifolds : 0.0, fallbacks, sink / stacks, drift );
+
+    DeleteBodies( cubes );
+    delete worb;
+}
+
+static int Bench_Manifold( int argc, char* argv[] )
+{
+    unsigned height = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 10;
+    unsigned stacks = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 10;
+    unsigned steps  = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 500;
+
+    printf( "%u stacks of %u cubes, %u steps\n\n", stacks, height, steps );
+    printf( "%-20s %10s %12s %12s %14s %10s %10s %10s\n", "solver", "us/step",
+        "manifolds", "iterations", "per manifold", "fallbacks", "top sink", "drift" );
+
+    ShockPropagation layers;
+    TimeManifolds( "sequential impulses", SequentialImpulses (), stacks, height, steps );
+    TimeManifolds( "block solver", BlockImpulses (), stacks, height, steps );
+    TimeManifolds( "shock propagation", layers, stacks, height, steps );
+    layers.UseBlockSolver = true;
+    TimeManifolds( "shock + block solver", layers, stacks, height, steps );
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Accelerated projected gradient
+
+/** Gets the processor time of the process (of all its threads), in seconds.
+ */
+static double ProcessCpuTime ()
+{
+    timespec t;
+    clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &t );
+    return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+/** Holds one contact problem: the momenta of the bodies at the time of the impulse
+ * transfers, restored before each solve.
+ */
+struct ContactProblem
+{
+    std::vector<RigidBody*> Bodies;
+    std::vector<Quaternion> LinearMomentum;
+    std::vector<Quaternion> AngularMomentum;
+
+    void Save ()
+    {
+        LinearMomentum.resize( Bodies.size () );
+        AngularMomentum.resize( Bodies.size () );
+        for ( unsigned i = 0; i < Bodies.size (); ++i ) {
+            LinearMomentum[i]  = Bodies[i]->LinearMomentum;
+            AngularMomentum[i] = Bodies[i]->AngularMomentum;
+        }
+    }
+
+    void Restore( CollisionResolver& collisions, double h )
+    {
+        for ( unsigned i = 0; i < Bodies.size (); ++i ) {
+            Bodies[i]->LinearMomentum  = LinearMomentum[i];
+            Bodies[i]->AngularMomentum = AngularMomentum[i];
+            Bodies[i]->CalculateDerivedQuantities ();
+        }
+        collisions.UpdateDerivedQuantities( h );
+    }
+
+    /** Gets the largest velocity at which the bodies approach at the contacts.
+     */
+    double Residual( const CollisionResolver& collisions )
+    {
+        for ( unsigned i = 0; i < Bodies.size (); ++i ) {
+            Bodies[i]->CalculateDerivedQuantities ();
+        }
+
+        double residual = 0;
+        for ( unsigned i = 0; i < collisions.Count (); ++i )
+        {
+            const Collision& contact = collisions[i];
+
+            Quaternion V = contact.Body_A->Velocity + contact.Body_A->AngularVelocity
+                .Cross( contact.Position - contact.Body_A->Position );
+            if ( contact.Body_B ) {
+                V -= contact.Body_B->Velocity + contact.Body_B->AngularVelocity
+                    .Cross( contact.Position - contact.Body_B->Position );
+            }
+            residual = std::max( residual, -V.Dot( contact.Normal ) );
+        }
+        return residual;
+    }
+};
+
+/** Solver policy that resolves the collisions by the impulse transfers and, at the
+ * time-step `ProbeStep`, first solves the same contact problem by the impulse
+ * transfers and by the accelerated projected gradient with the growing iteration
+ * budgets and prints the velocity error and the processor time of each solve.
+ */
+class ConvergenceProbe
+{
+public:
+
+    ContactProblem* Problem;
+    unsigned ProbeStep;
+    unsigned Step;
+    unsigned MaxSweeps;
+    unsigned Threads;
+
+    ConvergenceProbe ()
+        : Problem( 0 ), ProbeStep( 0 ), Step( 0 ), MaxSweeps( 0 ), Threads( 1 )
+    {
+    }
+
+    void Resolve( CollisionResolver& collisions, double h )
+    {
+        collisions.UpdateDerivedQuantities( h );
+
+        if ( Problem && Step++ == ProbeStep ) {
+            Probe( collisions, h );
+        }
+
+        collisions.ImpulseTransfers( h );
+        collisions.PositionProjections ();
+    }
+
+private:
+
+    void Probe( CollisionResolver& collisions, double h )
+    {
+        const unsigned m = collisions.Count ();
+        const double eps = 1e-9; // Run the whole budgets
+
+        Problem->Save ();
+        printf( "%u contacts, approaching at up to %.4f m/s\n\n", m,
+            Problem->Residual( collisions ) );
+        Problem->Restore( collisions, h );
+
+        printf( "%8s   %12s %12s   %12s %12s\n", "sweeps",
+            "seq. error", "cpu ms", "APGD error", "cpu ms" );
+
+        for ( unsigned sweeps = 1; sweeps <= MaxSweeps; sweeps *= 2 )
+        {
+            // A sweep is one impulse transfer per contact, respectively one product
+            // with the Delassus matrix
+            //
+            double t0 = ProcessCpuTime ();
+            collisions.ImpulseTransfers( h, sweeps * m, eps );
+            double sequentialTime = ProcessCpuTime () - t0;
+            double sequentialError = Problem->Residual( collisions );
+            Problem->Restore( collisions, h );
+
+            t0 = ProcessCpuTime ();
+            collisions.AcceleratedImpulses( h, sweeps, eps, Threads );
+            double acceleratedTime = ProcessCpuTime () - t0;
+            double acceleratedError = Problem->Residual( collisions );
+            Problem->Restore( collisions, h );
+
+            printf( "%8u   %12.6f %12.3f   %12.6f %12.3f\n", sweeps,
+                sequentialError, sequentialTime * 1e3,
+                acceleratedError, acceleratedTime * 1e3 );
+        }
+    }
+};
+
+static int Bench_Convergence( int argc, char* argv[] )
+{
+    unsigned side    = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 8;
+    double   ratio   = argc >= 2 ? atof( argv[1] ) : 1e4;
+    unsigned sweeps  = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 1024;
+    unsigned threads = argc >= 4 ? unsigned( atoi( argv[3] ) ) : 1;
+
+    typedef WorldOfRigidBodies<4096,16384,SweepAndPrune,ConvergenceProbe> World;
+
+    World* worb = new World;
+    worb->Gravity = Const::g_n;
+    worb->Collisions.Restitution = 0;
+    worb->Collisions.Friction    = 0.5;
+
+    HalfSpace ground;
+    ground.Direction = Const::Y;
+    ground.Offset    = 0;
+    worb->Add( ground );
+
+    // Two layers of light cubes carrying a heavy plate, which carries another layer
+    // of light cubes
+    //
+    std::vector<SolidCuboid*> bodies;
+    for ( unsigned layer = 0; layer < 3; ++layer )
+    {
+        double y = layer < 2 ? 0.5 + layer : 3.0;
+        for ( unsigned i = 0; i < side * side; ++i )
+        {
+            SolidCuboid* cube = new SolidCuboid(
+                SpatialVector( 1.0 * ( i % side ), y, 1.0 * ( i / side ) ),
+                Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0,
+                /*halfExtent=*/ SpatialVector( 0.5, 0.5, 0.5 ), /*mass=*/ 1.0
+            );
+            bodies.push_back( cube );
+        }
+    }
+
+    SolidCuboid* plate = new SolidCuboid(
+        SpatialVector( 0.5 * ( side - 1 ), 2.25, 0.5 * ( side - 1 ) ),
+        Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0,
+        /*halfExtent=*/ SpatialVector( 0.5 * side, 0.25, 0.5 * side ), /*mass=*/ ratio
+    );
+    bodies.push_back( plate );
+
+    ContactProblem problem;
+    for ( unsigned i = 0; i < bodies.size (); ++i ) {
+        bodies[i]->CanBeDeactivated = false;
+        problem.Bodies.push_back( bodies[i] );
+        worb->Add( bodies[i] );
+    }
+
+    worb->SolverMethod.Problem   = &problem;
+    worb->SolverMethod.ProbeStep = 10;
+    worb->SolverMethod.MaxSweeps = sweeps;
+    worb->SolverMethod.Threads   = threads;
+
+    printf( "%u light cubes (mass 1) around a plate of mass %g, %u thread(s)\n",
+        unsigned( bodies.size () - 1 ), ratio, threads );
+
+    worb->InitializeODE ();
+    for ( unsigned n = 0; n <= 10; ++n ) {
+        worb->SolveODE( 0.01 );
+    }
+
+    DeleteBodies( bodies );
+    delete worb;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Force generators
+
+/** Holds the user loop applying the same forces as the generators of Bench_Forces,
+ * coded per body with RigidBody::AddForceAtPoint.
+ */
+struct HandCodedForces
+{
+    std::vector<SolidSphere*>* Bodies;
+    Quaternion Anchor;
+    double RestLength, Stiffness, Damping, Linear, Quadratic;
+    double Surface, Volume, Height, Density;
+    Quaternion Wind;
+
+    void Apply( double g )
+    {
+        std::vector<SolidSphere*>& bodies = *Bodies;
+
+        for ( unsigned i = 0; i + 1 < bodies.size (); ++i )
+        {
+            RigidBody& a = *bodies[i];
+            RigidBody& b = *bodies[ i + 1 ];
+
+            Quaternion pA = a.ToWorld( Anchor );
+            Quaternion pB = b.ToWorld( -Anchor );
+            Quaternion v = a.Velocity + a.AngularVelocity.Cross( pA - a.Position )
+                - b.Velocity - b.AngularVelocity.Cross( pB - b.Position );
+
+            Quaternion d = pA - pB;
+            double length = d.ImNorm ();
+            double stretch = length - RestLength;
+            Quaternion F = ( - Stiffness * stretch - Damping * v.Dot( d ) / length )
+                / length * d;
+            double E = 0.25 * Stiffness * stretch * stretch;
+
+            a.AddForceAtPoint( pA, F, E );
+            b.AddForceAtPoint( pB, -F, E );
+        }
+
+        for ( unsigned i = 0; i < bodies.size (); ++i )
+        {
+            RigidBody& body = *bodies[i];
+
+            double speed = body.Velocity.ImNorm ();
+            body.AddExternalForce( - ( Linear + Quadratic * speed ) * body.Velocity );
+
+            double s = 0.5 * ( Surface - body.Position.y + 0.5 * Height ) / ( 0.5 * Height );
+            s = s < 0 ? 0 : s > 1 ? 1 : s;
+            body.AddExternalForce( SpatialVector( 0, s * Density * Volume * g, 0 ) );
+
+            Quaternion F = body.Mass () * Wind;
+            body.AddExternalForce( F, - F.Dot( body.Position ) );
+        }
+    }
+};
+
+/** Gets the time of a call of the function, in `s` (best of the repetitions).
+ */
+template<class Function>
+static double BestOf( unsigned repeat, Function& function )
+{
+    double best = 1e30;
+    for ( unsigned r = 0; r < repeat; ++r )
+    {
+        double t0 = MonotonicTime ();
+        function ();
+        best = std::min( best, MonotonicTime () - t0 );
+    }
+    return best;
+}
+
+/** Applies the forces of the registry after clearing the accumulators.
+ */
+struct RegistryPass
+{
+    BenchWorld* World;
+    std::vector<SolidSphere*>* Bodies;
+
+    void operator () ()
+    {
+        for ( unsigned i = 0; i < Bodies->size (); ++i ) {
+            (*Bodies)[i]->ClearAccumulators ();
+        }
+        World->Forces.Apply( World->Gravity );
+    }
+};
+
+/** Applies the hand-coded forces after clearing the accumulators.
+ */
+struct HandCodedPass
+{
+    HandCodedForces* Forces;
+    double g;
+
+    void operator () ()
+    {
+        std::vector<SolidSphere*>& bodies = *Forces->Bodies;
+        for ( unsigned i = 0; i < bodies.size (); ++i ) {
+            bodies[i]->ClearAccumulators ();
+        }
+        Forces->Apply( g );
+    }
+};
+
+static int Bench_Forces( int argc, char* argv[] )
+{
+    unsigned n       = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 4000;
+    unsigned repeat  = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 200;
+    unsigned threads = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 4;
+
+    n = std::max( 2u, std::min( n, 4000u ) );
+
+    srand( 1 ); // Reproducible scenes
+
+    BenchWorld* worb = new BenchWorld;
+    worb->Gravity = Const::g_n;
+
+    // A chain of spheres bobbing in the water, linked by springs between their
+    // surfaces, with a drag, a buoyancy and a wind on every sphere
+    //
+    HandCodedForces hand;
+    std::vector<SolidSphere*> bodies;
+    hand.Bodies = &bodies;
+    hand.Anchor = SpatialVector( 0.25, 0, 0 );
+    hand.RestLength = 0.5;
+    hand.Stiffness = 200;
+    hand.Damping = 2;
+    hand.Linear = 0.5;
+    hand.Quadratic = 0.1;
+    hand.Surface = 0;
+    hand.Height = 0.5;
+    hand.Volume = 4.0 / 3.0 * Const::Pi * 0.25 * 0.25 * 0.25;
+    hand.Density = 1000;
+    hand.Wind = SpatialVector( 0.3, 0, 0.1 );
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        SolidSphere* ball = new SolidSphere(
+            SpatialVector( 1.0 * i + 0.1 * Uniform (), 0.2 * Uniform () - 0.1, 0 ),
+            Quaternion( 1.0 ),
+            /*v=*/ SpatialVector( Uniform () - 0.5, Uniform () - 0.5, 0 ),
+            /*w=*/ SpatialVector( 0, 0, Uniform () - 0.5 ), /*r=*/ 0.25, /*mass=*/ 30.0
+        );
+        bodies.push_back( ball );
+        worb->Add( ball );
+    }
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        if ( i + 1 < n ) {
+            worb->Forces.AddSpring( bodies[i], hand.Anchor, bodies[ i + 1 ], -hand.Anchor,
+                hand.RestLength, hand.Stiffness, hand.Damping );
+        }
+        worb->Forces.AddDrag( bodies[i], hand.Linear, hand.Quadratic );
+        worb->Forces.AddBuoyancy( bodies[i], Const::Y, hand.Surface,
+            hand.Volume, hand.Height, hand.Density );
+        worb->Forces.AddField( bodies[i], hand.Wind );
+    }
+
+    worb->InitializeODE ();
+
+    const double g = worb->Gravity.ImNorm ();
+
+    // Check that both give the same forces, torques and energies
+    //
+    HandCodedPass handPass = { &hand, g };
+    RegistryPass registryPass = { worb, &bodies };
+
+    std::vector<Quaternion> force( n ), torque( n );
+    std::vector<double> energy( n );
+
+    handPass ();
+    for ( unsigned i = 0; i < n; ++i ) {
+        force[i] = bodies[i]->Force;
+        torque[i] = bodies[i]->Torque;
+        energy[i] = bodies[i]->PotentialEnergy;
+    }
+
+    registryPass ();
+    double deviation = 0;
+    for ( unsigned i = 0; i < n; ++i ) {
+        deviation = std::max( deviation, ( bodies[i]->Force - force[i] ).ImNorm () );
+        deviation = std::max( deviation, ( bodies[i]->Torque - torque[i] ).ImNorm () );
+        deviation = std::max( deviation, fabs( bodies[i]->PotentialEnergy - energy[i] ) );
+    }
+
+    printf( "%u bodies: %u springs, %u drags, %u buoyancies, %u fields\n",
+        n, worb->Forces.SpringCount (), worb->Forces.DragCount (),
+        worb->Forces.BuoyancyCount (), worb->Forces.FieldCount () );
+    printf( "largest difference of the forces, torques and energies: %g\n\n", deviation );
+
+    printf( "%-24s %12s %16s\n", "forces", "us/pass", "ns/generator" );
+
+    double t = BestOf( repeat, handPass );
+    printf( "%-24s %12.1f %16.1f\n", "hand-coded loop", t * 1e6,
+        t * 1e9 / worb->Forces.Count () );
+
+    for ( unsigned k = 1; k <= threads; k *= 2 )
+    {
+        worb->Forces.Threads = k;
+        t = BestOf( repeat, registryPass );
+
+        char label[ 64 ];
+        sprintf( label, "registry, %u thread%s", k, k > 1 ? "s" : "" );
+        printf( "%-24s %12.1f %16.1f\n", label, t * 1e6, t * 1e9 / worb->Forces.Count () );
+    }
+
+    DeleteBodies( bodies );
+    delete worb;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Mutual gravity: the Barnes-Hut octree versus the direct summation
+
+/** Applies the mutual gravity after clearing the accumulators, using the octree or
+ * the direct summation.
+ */
+struct AttractionPass
+{
+    MutualGravity* Attraction;
+    std::vector<SolidSphere*>* Bodies;
+    bool Direct;
+
+    void operator () ()
+    {
+        std::vector<SolidSphere*>& bodies = *Bodies;
+        for ( unsigned i = 0; i < bodies.size (); ++i ) {
+            bodies[i]->ClearAccumulators ();
+        }
+
+        std::vector<RigidBody*> list( bodies.begin (), bodies.end () );
+        if ( Direct ) {
+            Attraction->ApplyDirect( &list[0], unsigned( list.size () ) );
+        }
+        else {
+            Attraction->Apply( &list[0], unsigned( list.size () ) );
+        }
+    }
+};
+
+/** Creates a cloud of spheres: a few clusters of random radii in a ball, with
+ * the density of the bodies falling off from the centres of the clusters.
+ */
+static void CreateCloud( std::vector<SolidSphere*>& bodies, unsigned n )
+{
+    const unsigned clusters = 8;
+    Quaternion centre[ clusters ];
+    double radius[ clusters ];
+
+    for ( unsigned c = 0; c < clusters; ++c ) {
+        centre[c] = SpatialVector( 200 * Uniform () - 100, 200 * Uniform () - 100,
+            200 * Uniform () - 100 );
+        radius[c] = 5 + 30 * Uniform ();
+    }
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        // A random direction and a distance concentrated towards the centre
+        //
+        Quaternion d;
+        do {
+            d = SpatialVector( 2 * Uniform () - 1, 2 * Uniform () - 1, 2 * Uniform () - 1 );
+        } while ( d.ImSquaredNorm () > 1 || d.ImSquaredNorm () < 1e-6 );
+
+        unsigned c = i % clusters;
+        double r = radius[c] * Uniform () * Uniform ();
+
+        SolidSphere* ball = new SolidSphere(
+            centre[c] + ( r / d.ImNorm () ) * d, Quaternion( 1.0 ),
+            /*v=*/ SpatialVector( 0, 0, 0 ), /*w=*/ SpatialVector( 0, 0, 0 ),
+            /*r=*/ 0.25, /*mass=*/ 1e3 * ( 1 + Uniform () )
+        );
+        bodies.push_back( ball );
+    }
+}
+
+static int Bench_NBody( int argc, char* argv[] )
+{
+    unsigned n       = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 32000;
+    unsigned check   = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 2000;
+    unsigned threads = argc >= 3 ? unsigned( atoi( argv[2] ) ) : 4;
+
+    n = std::max( 2u, n );
+    check = std::max( 2u, std::min( check, n ) );
+
+    srand( 1 ); // Reproducible scenes
+
+    MutualGravity attraction;
+    attraction.Softening = 0.5;
+
+    // Check the forces and the potential energy against the direct summation
+    //
+    {
+        std::vector<SolidSphere*> bodies;
+        CreateCloud( bodies, check );
+
+        AttractionPass direct = { &attraction, &bodies, true };
+        direct ();
+
+        std::vector<Quaternion> force( check );
+        double energy = 0;
+        for ( unsigned i = 0; i < check; ++i ) {
+            force[i] = bodies[i]->Force;
+            energy += bodies[i]->PotentialEnergy;
+        }
+
+        printf( "%u bodies, checked against the direct summation (%lu interactions)\n\n",
+            check, attraction.Interactions );
+        printf( "%8s %8s %14s %14s %14s %14s\n", "theta", "nodes", "interactions",
+            "rms error", "max error", "energy error" );
+
+        const double angles[] = { 0.0, 0.3, 0.5, 0.7, 1.0 };
+        for ( unsigned k = 0; k < sizeof( angles ) / sizeof( angles[0] ); ++k )
+        {
+            attraction.OpeningAngle = angles[k];
+            AttractionPass tree = { &attraction, &bodies, false };
+            tree ();
+
+            double sum = 0, largest = 0, E = 0;
+            for ( unsigned i = 0; i < check; ++i )
+            {
+                double e = ( bodies[i]->Force - force[i] ).ImNorm () / force[i].ImNorm ();
+                sum += e * e;
+                largest = std::max( largest, e );
+                E += bodies[i]->PotentialEnergy;
+            }
+
+            printf( "%8.1f %8u %14lu %14.3e %14.3e %14.3e\n", angles[k],
+                attraction.NodeCount, attraction.Interactions,
+                sqrt( sum / check ), largest, fabs( E - energy ) / fabs( energy ) );
+        }
+
+        DeleteBodies( bodies );
+    }
+
+    // Time the octree and the direct summation for growing number of bodies
+    //
+    attraction.OpeningAngle = 0.5;
+
+    printf( "\n%8s %14s %14s %16s %10s\n", "bodies", "tree [ms]", "direct [ms]",
+        "interactions/n", "speedup" );
+
+    for ( unsigned m = 1000; m <= n; m *= 2 )
+    {
+        std::vector<SolidSphere*> bodies;
+        CreateCloud( bodies, m );
+
+        AttractionPass tree = { &attraction, &bodies, false };
+        double t = BestOf( 3, tree );
+        unsigned long interactions = attraction.Interactions;
+
+        // The direct summation only up to a few seconds per pass
+        //
+        if ( m <= 16000 )
+        {
+            AttractionPass direct = { &attraction, &bodies, true };
+            double t_direct = BestOf( 1, direct );
+            printf( "%8u %14.2f %14.2f %16.1f %10.1f\n", m, t * 1e3, t_direct * 1e3,
+                double( interactions ) / m, t_direct / t );
+        }
+        else
+        {
+            printf( "%8u %14.2f %14s %16.1f %10s\n", m, t * 1e3, "-",
+                double( interactions ) / m, "-" );
+        }
+
+        DeleteBodies( bodies );
+    }
+
+    // Scaling of the octree on more threads
+    //
+    {
+        std::vector<SolidSphere*> bodies;
+        CreateCloud( bodies, n );
+
+        printf( "\n%u bodies, theta %.1f\n", n, attraction.OpeningAngle );
+        printf( "%-24s %14s\n", "octree", "ms/pass" );
+
+        for ( unsigned k = 1; k <= threads; k *= 2 )
+        {
+            attraction.Threads = k;
+            AttractionPass tree = { &attraction, &bodies, false };
+            double t = BestOf( 3, tree );
+
+            char label[ 64 ];
+            sprintf( label, "%u thread%s", k, k > 1 ? "s" : "" );
+            printf( "%-24s %14.2f\n", label, t * 1e3 );
+        }
+
+        DeleteBodies( bodies );
+    }
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Bulk creation of the bodies
+
+/** The system of the bulk creation benchmark, large enough for a million bodies.
+ */
+typedef WorldOfRigidBodies<1048576,1024,SweepAndPrune> BulkWorld;
+
+/** Holds the parameters of the spheres of the bulk creation benchmark.
+ */
+struct BulkScene
+{
+    std::vector<double> Radius, Mass;
+    std::vector<Quaternion> Position, Velocity;
+};
+
+/** Prints the timings of a creation of the scene and the totals of the system.
+ */
+static void ReportBulk( const char* label, unsigned n, double create, double init,
+    const BulkWorld& worb )
+{
+    const double bytes = double( n ) * sizeof( SolidSphere );
+    printf( "%-24s %10.1f %10.1f %10.1f %10.1f %10.1f %14.6e\n", label,
+        create * 1e3, init * 1e3, ( create + init ) * 1e3,
+        ( create + init ) * 1e9 / n, bytes / ( create + init ) / 1e9,
+        worb.TotalKineticEnergy );
+}
+
+static int Bench_Bulk( int argc, char* argv[] )
+{
+    unsigned n       = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 1000000;
+    unsigned threads = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 4;
+
+    n = std::max( 1u, std::min( n, 1048576u ) );
+
+    srand( 1 ); // Reproducible scenes
+
+    // Spheres scattered in a cube in a random order
+    //
+    BulkScene scene;
+    const double side = 2 * pow( double( n ), 1.0 / 3.0 );
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        scene.Radius.push_back( 0.1 + 0.2 * Uniform () );
+        scene.Mass.push_back( 1 + 9 * Uniform () );
+        scene.Position.push_back(
+            SpatialVector( side * Uniform (), side * Uniform (), side * Uniform () ) );
+        scene.Velocity.push_back(
+            SpatialVector( Uniform () - 0.5, Uniform () - 0.5, Uniform () - 0.5 ) );
+    }
+
+    printf( "%u spheres, %u bytes each\n\n", n, unsigned( sizeof( SolidSphere ) ) );
+
+    // The reference: filling the same amount of newly allocated memory
+    //
+    {
+        const size_t bytes = size_t( n ) * sizeof( SolidSphere );
+        double t0 = MonotonicTime ();
+        char* block = static_cast<char*>( operator new( bytes ) );
+        memset( block, 1, bytes );
+        double t = MonotonicTime () - t0;
+        operator delete( block );
+
+        printf( "filling %.0f MB of new memory: %.1f ms (%.2f GB/s)\n\n",
+            bytes / 1e6, t * 1e3, bytes / t / 1e9 );
+    }
+
+    printf( "%-24s %10s %10s %10s %10s %10s %14s\n", "creation", "new [ms]",
+        "init [ms]", "total [ms]", "ns/body", "GB/s", "E_k [J]" );
+
+    // One at a time: a new body and World::Add per body
+    //
+    {
+        BulkWorld* worb = new BulkWorld;
+        std::vector<SolidSphere*> bodies;
+
+        double t0 = MonotonicTime ();
+        for ( unsigned i = 0; i < n; ++i )
+        {
+            SolidSphere* ball = new SolidSphere( scene.Position[i], Quaternion( 1.0 ),
+                scene.Velocity[i], SpatialVector( 0, 0, 0 ),
+                scene.Radius[i], scene.Mass[i] );
+            bodies.push_back( ball );
+            worb->Add( ball );
+        }
+        double t1 = MonotonicTime ();
+        worb->InitializeODE ();
+        double t2 = MonotonicTime ();
+
+        ReportBulk( "one at a time", n, t1 - t0, t2 - t1, *worb );
+
+        delete worb;
+        DeleteBodies( bodies );
+    }
+
+    // In bulk: a SolidArray created and initialized on 1, 2, 4, ... threads
+    //
+    for ( unsigned k = 1; k <= threads; k *= 2 )
+    {
+        BulkWorld* worb = new BulkWorld;
+        worb->Threads = k;
+
+        SolidArray<SolidSphere> spheres;
+
+        double t0 = MonotonicTime ();
+        spheres.Create( n, &scene.Radius[0], &scene.Mass[0], &scene.Position[0],
+            /*orientation=*/ 0, &scene.Velocity[0], /*angularVelocity=*/ 0, k );
+        worb->Add( spheres );
+        double t1 = MonotonicTime ();
+        worb->InitializeODE ();
+        double t2 = MonotonicTime ();
+
+        char label[ 64 ];
+        sprintf( label, "bulk, %u thread%s", k, k > 1 ? "s" : "" );
+        ReportBulk( label, n, t1 - t0, t2 - t1, *worb );
+
+        delete worb;
+    }
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Worker pool
+
+/** Holds the workers that took part in a region or the chunks of a ParallelFor
+ * (every worker or chunk sets its own flag).
+ */
+struct PoolProbe
+{
+    std::vector<unsigned char> Seen;
+    unsigned Workers;
+};
+
+static void ProbeRegion( void* context, unsigned worker, unsigned workers )
+{
+    PoolProbe& probe = *static_cast<PoolProbe*>( context );
+    probe.Seen[ worker ] = 1;
+    if ( worker == 0 ) {
+        probe.Workers = workers;
+    }
+}
+
+static void ProbeChunk( void* context, unsigned begin, unsigned )
+{
+    static_cast<PoolProbe*>( context )->Seen[ begin ] = 1;
+}
+
+static void EmptyRegion( void*, unsigned, unsigned )
+{
+}
+
+static void EmptyChunk( void*, unsigned, unsigned )
+{
+}
+
+static unsigned CountSeen( const PoolProbe& probe )
+{
+    unsigned count = 0;
+    for ( unsigned i = 0; i < probe.Seen.size (); ++i ) {
+        count += probe.Seen[i];
+    }
+    return count;
+}
+
+static int Bench_Pool( int argc, char* argv[] )
+{
+    unsigned threads = argc >= 1 ? unsigned( atoi( argv[0] ) ) : 8;
+    unsigned calls   = argc >= 2 ? unsigned( atoi( argv[1] ) ) : 20000;
+
+    threads = std::max( 2u, std::min( threads, 256u ) );
+    calls = std::max( 1u, calls );
+
+    // Grow the pool to all the threads first; the narrower regions that follow
+    // must still get exactly the threads they ask for
+    //
+    PoolProbe probe;
+    probe.Seen.assign( threads, 0 );
+    ParallelRegion( threads, ProbeRegion, &probe );
+
+    printf( "pool of %u threads, %u calls\n\n", threads, calls );
+    printf( "%-8s %8s %8s %14s %16s\n",
+        "threads", "workers", "chunks", "us/region", "us/ParallelFor" );
+
+    bool ok = true;
+
+    for ( unsigned t = 1; t <= threads; t = t < threads && 2 * t > threads ? threads : 2 * t )
+    {
+        probe.Seen.assign( threads, 0 );
+        probe.Workers = 0;
+        ParallelRegion( t, ProbeRegion, &probe );
+        const unsigned workers = CountSeen( probe );
+        ok = ok && workers == t && probe.Workers == t;
+
+        probe.Seen.assign( 1000, 0 );
+        ParallelFor( 1000, t, ProbeChunk, &probe );
+        const unsigned chunks = CountSeen( probe );
+        ok = ok && chunks == t;
+
+        double t0 = MonotonicTime ();
+        for ( unsigned n = 0; n < calls; ++n ) {
+            ParallelRegion( t, EmptyRegion, 0 );
+        }
+        double t1 = MonotonicTime ();
+        for ( unsigned n = 0; n < calls; ++n ) {
+            ParallelFor( 1000, t, EmptyChunk, 0 );
+        }
+        double t2 = MonotonicTime ();
+
+        printf( "%-8u %8u %8u %14.2f %16.2f\n", t, workers, chunks,
+            ( t1 - t0 ) / calls * 1e6, ( t2 - t1 ) / calls * 1e6 );
+    }
+
+    printf( "\nworkers and chunks as requested: %s\n", ok ? "yes" : "NO" );
+
+    return ok ? 0 : 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Benchmark registry
+
+static const struct Benchmark
+{
+    const char* Name;
+    int ( *Run )( int argc, char* argv[] );
+    const char* Usage;
+}
+Benchmarks[] =
+{
+    { "shm-latency", Bench_ShmLatency,
+      "[frames=2000] [bodies=256] [period_us=1000]\n"
+      "    Latency between SharedStatePublisher::Publish and an external reader." },
+    { "server-load", Bench_ServerLoad,
+      "[clients=4] [bodies=64] [requests=500] [depth=8] [steps=1]\n"
+      "    Steps/s and round-trip latency of pipelined Step requests sent by\n"
+      "    concurrent clients to a SimulationServer." },
+    { "policies", Bench_Policies,
+      "[bodies=1000] [steps=200]\n"
+      "    Time-step cost of systems specialized at compile-time by policies versus\n"
+      "    systems configured at run-time (Dynamic* policies)." },
+    { "mesh", Bench_Mesh,
+      "[side=224] [bodies=500] [steps=200]\n"
+      "    BVH build time of a side x side quad terrain and the time-step cost of\n"
+      "    bodies resting on it versus the same bodies on five half-spaces." },
+    { "heightfield", Bench_HeightField,
+      "[bodies=1000]\n"
+      "    Narrowphase time per body on height-field terrains from 64 x 64 to\n"
+      "    4096 x 4096 vertices, with float and int16 height storage." },
+    { "gjk", Bench_Gjk,
+      "[bodies=400] [steps=200]\n"
+      "    Average GJK iterations per query and the time-step cost of resting convex\n"
+      "    hulls and cuboids, starting GJK from scratch versus from the cached simplex." },
+    { "raycast", Bench_RayCast,
+      "[bodies=2000] [rays=50000] [threads=4] [length=10]\n"
+      "    Time of a batch of sensor rays cast against scattered bodies, testing all\n"
+      "    the bodies versus the sweep-and-prune candidates, on one and more threads." },
+    { "triggers", Bench_Triggers,
+      "[bodies=2000] [regions=64] [steps=200]\n"
+      "    Cost of reporting the bodies entering and leaving static regions: scanning\n"
+      "    every body against every region versus sensor geometries in the broadphase." },
+    { "kinematic", Bench_Kinematic,
+      "[bodies=1000] [pushers=8] [steps=400]\n"
+      "    Time-step cost and the system totals of spheres swept by scripted pushers,\n"
+      "    moved as dynamic bodies with infinite mass versus kinematic bodies." },
+    { "static", Bench_Static,
+      "[blocks=2000] [bodies=500] [steps=200]\n"
+      "    Time-step cost of spheres falling on walls of cuboids with infinite mass\n"
+      "    (static bodies)." },
+    { "granular", Bench_Granular,
+      "[particles=20000] [steps=200] [threads=4]\n"
+      "    Time-step cost and the contact evaluations per second per core of the\n"
+      "    discrete element granular system on one and more threads." },
+    { "stack", Bench_Stack,
+      "[height=50] [stacks=4] [steps=1000]\n"
+      "    Impulse transfers per time-step of tall stacks of plates and the time-step\n"
+      "    at which they fall asleep, without and with shock propagation." },
+    { "reuse", Bench_Reuse,
+      "[stacks=256] [height=4] [steps=400] [refresh=8]\n"
+      "    Time-step and narrowphase cost and the cuboid pairs tested by the SAT per\n"
+      "    time-step of resting stacks, detecting all the contacts versus reusing the\n"
+      "    contacts of the pairs that did not move." },
+    { "reorder", Bench_Reorder,
+      "[bodies=262144] [steps=10] [interval=5]\n"
+      "    Time-step cost, cache misses per time-step and the mean distance in memory\n"
+      "    between the bodies of successive contacts, for a layer of spheres created\n"
+      "    in a random spatial order, in the order of creation versus moved in memory\n"
+      "    to the Morton order of their positions (with the contacts sorted by body)." },
+    { "broadphase", Bench_Broadphase,
+      "[bodies=16000] [steps=50] [threads=8]\n"
+      "    Broadphase cost of drifting spheres, sweep and prune versus the parallel\n"
+      "    sweep and prune on 1, 2, 4, ... threads, checking that the pairs are the same." },
+    { "domains", Bench_Domains,
+      "[bodies=2000] [steps=200] [processes=8] [tolerance=0.05]\n"
+      "    Runs spheres rolling along a strip split into 2 to `processes` domains\n"
+      "    simulated by separate processes, and checks the final positions against\n"
+      "    the single-process run. The runs are bit-identical until the contact\n"
+      "    chains reach beyond the ghost layer, after which the order of the impulse\n"
+      "    transfers differs and the chaotic collisions diverge slowly." },
+    { "numa", Bench_Numa,
+      "[particles=20000] [steps=100] [threads=cpus]\n"
+      "    Scaling of the granular system with the workers left to the scheduler\n"
+      "    and with the workers pinned to the NUMA nodes and the particles placed\n"
+      "    on the nodes of their workers (first touch)." },
+    { "manifold", Bench_Manifold,
+      "[height=10] [stacks=10] [steps=500]\n"
+      "    Impulse iterations per contact manifold of the stacks of cubes resolved\n"
+      "    contact by contact and with the manifolds resolved as blocks, with and\n"
+      "    without shock propagation." },
+    { "convergence", Bench_Convergence,
+      "[side=8] [ratio=1e4] [sweeps=1024] [threads=1]\n"
+      "    Velocity error and processor time of one contact problem of light cubes\n"
+      "    around a heavy plate (mass ratio `ratio`), solved by the impulse transfers\n"
+      "    and by the accelerated projected gradient with 1, 2, 4, ... sweeps." },
+    { "forces", Bench_Forces,
+      "[bodies=4000] [repeat=200] [threads=4]\n"
+      "    Time of applying the springs, drags, buoyancies and fields acting on a chain\n"
+      "    of spheres, coded per body versus registered as force generators." },
+    { "nbody", Bench_NBody,
+      "[bodies=32000] [check=2000] [threads=4]\n"
+      "    Force and energy errors of the mutual gravity of a cloud of bodies\n"
+      "    approximated by the Barnes-Hut octree for several opening angles, checked\n"
+      "    against the direct summation, and the time of both for growing number of\n"
+      "    bodies." },
+    { "bulk", Bench_Bulk,
+      "[bodies=1000000] [threads=4]\n"
+      "    Time of creating and initializing a scene of spheres in a random order\n"
+      "    (with the sweep and prune built), one body at a time versus in bulk\n"
+      "    (SolidArray) on 1, 2, 4, ... threads, and the memory bandwidth it reaches." },
+    { "pool", Bench_Pool,
+      "[threads=8] [calls=20000]\n"
+      "    Cost of an empty ParallelRegion and ParallelFor on 1, 2, 4, ... threads of\n"
+      "    the worker pool, after the pool was grown to all the threads; checks that\n"
+      "    every call runs on exactly the threads it asks for (exit status 1 if not)." },
+};
+
+int main( int argc, char* argv[] )
+{
+    const unsigned count = sizeof( Benchmarks ) / sizeof( Benchmarks[0] );
+
+    for ( unsigned i = 0; argc >= 2 && i < count; ++i )
+    {
+        if ( strcmp( argv[1], Benchmarks[i].Name ) == 0 ) {
+            return Benchmarks[i].Run( argc - 2, argv + 2 );
+        }
+    }
+
+    printf( "Usage: WoRB_Bench <benchmark> [options]\n\n" );
+    for ( unsigned i = 0; i < count; ++i ) {
+        printf( "  %s %s\n\n", Benchmarks[i].Name, Benchmarks[i].Usage );
+    }
+
+    return argc >= 2 ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+/**
+ *  @file      CApiExample.c
+ *  @brief     An example of a host driving the WoRB framework through its C interface.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-23
+ *  @copyright GNU Public License.
+ *
+ * Usage: WoRB_CApiExample [bodies [steps]]
+ *
+ * Creates spheres in bulk, drops them on the ground and reads their positions
+ * in place through a strided view (see WoRB_CAPI.h).
+ */
+
+#include "WoRB_CAPI.h"
+
+#include <stdio.h>   /* we use: printf */
+#include <stdlib.h>  /* we use: atoi, malloc, free */
+
+int main( int argc, char* argv[] )
+{
+    size_t n     = argc >= 2 ? (size_t)atoi( argv[1] ) : 100;
+    size_t steps = argc >= 3 ? (size_t)atoi( argv[2] ) : 500;
+
+    const double g[3]      = { 0, -9.81, 0 };
+    const double up[3]     = { 0, 1, 0 };
+    const double push[3]   = { 1, 0, 0 };
+
+    double* radius   = (double*)malloc( n * sizeof( double ) );
+    double* mass     = (double*)malloc( n * sizeof( double ) );
+    double* position = (double*)malloc( 3 * n * sizeof( double ) );
+
+    worb_world* world = worb_create( n );
+    worb_diagnostics diag;
+    worb_view x;
+    size_t i, first = 0;
+
+    if ( ! world || ! radius || ! mass || ! position ) {
+        printf( "Failed to create the world\n" );
+        return 1;
+    }
+
+    printf( "libworb ABI version %d\n", worb_abi_version () );
+
+    for ( i = 0; i < n; ++i )
+    {
+        radius[i] = 0.5;
+        mass[i]   = 1.0;
+        position[3*i+0] = 1.2 * (double)( i % 10 );
+        position[3*i+1] = 0.6 + 1.2 * (double)( i / 100 );
+        position[3*i+2] = 1.2 * (double)( ( i / 10 ) % 10 );
+    }
+
+    worb_set_gravity( world, g );
+    worb_set_contact_parameters( world, 0.5, 0.2, 0.2 );
+    worb_add_half_space( world, up, 0.0 );
+
+    if ( worb_add_spheres( world, n, radius, mass, position,
+                           NULL, NULL, NULL, &first ) != WORB_OK ) {
+        printf( "Failed to add the spheres\n" );
+        return 1;
+    }
+
+    if ( n > 0 ) {
+        worb_apply_impulse( world, first, push, position );
+    }
+
+    worb_step( world, 0.01, steps );
+    worb_get_diagnostics( world, &diag );
+
+    printf( "t = %.3f s, %u bodies, %u contacts, E_k = %.4f J, E_p = %.4f J\n",
+        diag.time, (unsigned)diag.body_count, (unsigned)diag.contact_count,
+        diag.total_kinetic_energy, diag.total_potential_energy );
+
+    /* Read the positions in place (no copy)
+     */
+    x = worb_get_view( world, WORB_POSITION );
+    for ( i = 0; i < x.count && i < 5; ++i )
+    {
+        const double* p = (const double*)( (const char*)x.data + i * x.stride );
+        printf( "x(%u) = [ %8.4f %8.4f %8.4f ]\n", (unsigned)i, p[0], p[1], p[2] );
+    }
+
+    worb_destroy( world );
+
+    free( position );
+    free( mass );
+    free( radius );
+
+    return 0;
+}
@@ -0,0 +1,212 @@
+#ifndef _WORB_CANDIDATE_PAIRS_H_INCLUDED
+#define _WORB_CANDIDATE_PAIRS_H_INCLUDED
+
+/**
+ *  @file      CandidatePairs.h
+ *  @brief     Definitions for the CandidatePairs class, which holds the pairs of
+ *             geometries found by the broadphase, bucketed by their geometry classes.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-25
+ *  @copyright GNU Public License.
+ */
+
+#include "Geometry.h"
+
+#include <vector>  // we use: std::vector
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Holds the candidate pairs of geometries to be tested for collision.
+     *
+     * Pairs are kept in separate buckets, one for each (class A, class B) combination,
+     * so that the narrowphase runs a tight homogeneous loop over every bucket
+     * (all sphere-sphere pairs, then all sphere-cuboid pairs, etc.) instead of
+     * dispatching on the geometry classes of every pair.
+     *
+     * Within a bucket, the class of A is not greater than the class of B; the pairs
+     * of the same class keep the order in which they were added. Combinations that
+     * have no detector are not stored at all. The contacts are hence registered
+     * bucket by bucket, not in the order in which the pairs were added.
+     *
+     * The pairs involving a sensor geometry never reach the buckets (and the solver);
+     * they are kept in a separate list, with the sensor as A, for TriggerVolumes.
+     * The pairs of the scenery, the static and the kinematic bodies (that cannot
+     * respond to the collision) are not stored either, nor are the pairs of
+     * the same collision group (see Geometry::Group).
+     */
+    class CandidatePairs
+    {
+    public:
+
+        /** Holds a single pair of geometries.
+         */
+        struct Pair
+        {
+            const Geometry* A;
+            const Geometry* B;
+        };
+
+    private:
+
+        enum { ClassCount = 8 };
+
+        /** Holds the pairs in buckets indexed by the classes of A and B.
+         */
+        std::vector<Pair> Bucket[ ClassCount ][ ClassCount ];
+
+        /** Holds the pairs with a sensor (the sensor is A).
+         */
+        std::vector<Pair> SensorPairs;
+
+        /** Indicates whether the geometry cannot be moved by a collision response
+         * (scenery, a static or a kinematic body).
+         */
+        static bool IsImmovable( const Geometry* g )
+        {
+            return g->Body == 0 || g->Body->InverseMass == 0;
+        }
+
+        /** Indicates whether the geometry never moves (scenery or a static body).
+         */
+        static bool IsStationary( const Geometry* g )
+        {
+            return g->Body == 0 || g->Body->IsStatic ();
+        }
+
+        /** Checks whether the lists of pairs are equal.
+         */
+        static bool IsSame( const std::vector<Pair>& a, const std::vector<Pair>& b )
+        {
+            if ( a.size () != b.size () ) {
+                return false;
+            }
+            for ( size_t i = 0; i < a.size (); ++i ) {
+                if ( a[i].A != b[i].A || a[i].B != b[i].B ) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /** Indicates whether the combination of classes has a detector.
+         */
+        static bool HasDetector( unsigned classA, unsigned classB )
+        {
+            return classA == Geometry::_Sphere
+                || classA == Geometry::_Cuboid
+                || classB == Geometry::_ConvexHull
+                || classB == Geometry::_Compound;
+        }
+
+    public:
+
+        /** Removes all the pairs (the allocated capacity is kept).
+         */
+        void Clear ()
+        {
+            for ( unsigned i = 0; i < ClassCount; ++i ) {
+                for ( unsigned j = i; j < ClassCount; ++j ) {
+                    Bucket[i][j].clear ();
+                }
+            }
+            SensorPairs.clear ();
+        }
+
+        /** Adds the pair of geometries to its bucket.
+         */
+        void Add( const Geometry* A, const Geometry* B )
+        {
+            if ( A->Group && A->Group == B->Group ) {
+                return;
+            }
+
+            if ( A->Sensor || B->Sensor )
+            {
+                // Skip the pairs of sensors and the pairs where nothing moves
+                //
+                if ( A->Sensor == B->Sensor || ( IsStationary( A ) && IsStationary( B ) ) ) {
+                    return;
+                }
+
+                Pair pair = { A->Sensor ? A : B, A->Sensor ? B : A };
+                SensorPairs.push_back( pair );
+                return;
+            }
+
+            // Skip the pairs where neither geometry responds to the collision
+            //
+            if ( IsImmovable( A ) && IsImmovable( B ) ) {
+                return;
+            }
+
+            if ( A->Class > B->Class ) {
+                const Geometry* T = A; A = B; B = T;
+            }
+
+            if ( HasDetector( A->Class, B->Class ) ) {
+                Pair pair = { A, B };
+                Bucket[ A->Class ][ B->Class ].push_back( pair );
+            }
+        }
+
+        /** Appends the pairs of the other list after the pairs already kept, bucket
+         * by bucket, so that the lists filled from the consecutive parts of a sweep
+         * merge into the list filled by the whole sweep.
+         */
+        void Append( const CandidatePairs& other )
+        {
+            for ( unsigned i = 0; i < ClassCount; ++i ) {
+                for ( unsigned j = i; j < ClassCount; ++j ) {
+                    Bucket[i][j].insert( Bucket[i][j].end (),
+                        other.Bucket[i][j].begin (), other.Bucket[i][j].end () );
+                }
+            }
+            SensorPairs.insert( SensorPairs.end (),
+                other.SensorPairs.begin (), other.SensorPairs.end () );
+        }
+
+        /** Checks whether the lists hold the same pairs in the same order.
+         */
+        bool operator == ( const CandidatePairs& other ) const
+        {
+            for ( unsigned i = 0; i < ClassCount; ++i ) {
+                for ( unsigned j = i; j < ClassCount; ++j ) {
+                    if ( ! IsSame( Bucket[i][j], other.Bucket[i][j] ) ) {
+                        return false;
+                    }
+                }
+            }
+            return IsSame( SensorPairs, other.SensorPairs );
+        }
+
+        /** Gets the number of pairs in all the buckets.
+         */
+        unsigned Count () const
+        {
+            size_t count = 0;
+            for ( unsigned i = 0; i < ClassCount; ++i ) {
+                for ( unsigned j = i; j < ClassCount; ++j ) {
+                    count += Bucket[i][j].size ();
+                }
+            }
+            return unsigned( count );
+        }
+
+        /** Gets the pairs with a sensor geometry (the sensor is A).
+         */
+        const std::vector<Pair>& GetSensorPairs () const
+        {
+            return SensorPairs;
+        }
+
+        /** Detects and registers collisions between all the pairs, bucket by bucket.
+         */
+        void Detect( CollisionResolver& owner ) const;
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_CANDIDATE_PAIRS_H_INCLUDED
@@ -61,6 +61,13 @@ namespace WoRB {
             return ! Body_B;
         }
 
+        /** Returns true if none of the bodies in the collision is active.
+         */
+        bool IsAsleep () const
+        {
+            return ( ! Body_A || ! Body_A->IsActive ) && ( ! Body_B || ! Body_B->IsActive );
+        }
+
     private:
                                                                                    /*@}*/
         /////////////////////////////////////////////////////////////////////////////////
@@ -100,6 +107,24 @@ namespace WoRB {
             BouncingVelocity = GetBouncingVelocity( h );
         }
 
+        /** Exchanges the roles of the bodies, keeping the derived quantities valid.
+         * The contact frame is reflected, so the relative velocity in contact
+         * coordinates does not change.
+         */
+        void SwapBodies ()
+        {
+            RigidBody* temp = Body_A;
+            Body_A = Body_B;
+            Body_B = temp;
+
+            Quaternion r = RelativePosition[0];
+            RelativePosition[0] = RelativePosition[1];
+            RelativePosition[1] = r;
+
+            Normal  = -Normal;
+            ToWorld = -ToWorld;
+        }
+
         /** Applies the linear & angular impulses needed to resolve the collision.
          */
         void ImpulseTransfer( 
@@ -112,7 +137,8 @@ namespace WoRB {
         void PositionProjection( 
             Quaternion X_jolt[2], //!< Returned applied position jolt
             Quaternion Q_jolt[2], //!< Returned applied orientation jolt
-            double relaxation     //!< Position projections relaxation coefficient
+            double relaxation,    //!< Position projections relaxation coefficient
+            bool keepAsleep       //!< Whether the inactive bodies are left in place
         );
 
     private:
@@ -25,6 +25,10 @@ void Geometry::Detect( CollisionResolver& owner, const Geometry* B ) const
     typedef const Sphere*     Sphere_    ;
     typedef const HalfSpace*  HalfSpace_ ;
     typedef const TruePlane*  TruePlane_ ;
+    typedef const TriangleMesh* TriangleMesh_ ;
+    typedef const HeightField*  HeightField_ ;
+    typedef const Compound*     Compound_ ;
+    typedef const ConvexHull*   ConvexHull_ ;
 
     switch( Class )
     {
@@ -34,6 +38,10 @@ void Geometry::Detect( CollisionResolver& owner, const Geometry* B ) const
             case _Cuboid:    Cuboid_(B)   ->Check( owner, *Sphere_(this) ); break;
             case _HalfSpace: Sphere_(this)->Check( owner, *HalfSpace_(B) ); break;
             case _TruePlane: Sphere_(this)->Check( owner, *TruePlane_(B) ); break;
+            case _TriangleMesh: TriangleMesh_(B)->Check( owner, *Sphere_(this) ); break;
+            case _HeightField:  HeightField_(B) ->Check( owner, *Sphere_(this) ); break;
+            case _ConvexHull: ConvexCheck( owner, *this, *B );           break;
+            case _Compound:  Compound_(B)->Detect( owner, this );        break;
         }
         break;
 
@@ -42,7 +50,11 @@ void Geometry::Detect( CollisionResolver& owner, const Geometry* B ) const
             case _Sphere:    Cuboid_(this)->Check( owner, *Sphere_(B)    ); break;
             case _Cuboid:    Cuboid_(this)->Check( owner, *Cuboid_(B)    ); break;
             case _HalfSpace: Cuboid_(this)->Check( owner, *HalfSpace_(B) ); break;
-            case _TruePlane: /* not implemented */                        ; break;
+            case _TruePlane: ConvexCheck( owner, *this, *B );            break;
+            case _TriangleMesh: TriangleMesh_(B)->Check( owner, *Cuboid_(this) ); break;
+            case _HeightField:  HeightField_(B) ->Check( owner, *Cuboid_(this) ); break;
+            case _ConvexHull: ConvexCheck( owner, *this, *B );           break;
+            case _Compound:  Compound_(B)->Detect( owner, this );        break;
         }
         break;
 
@@ -50,19 +62,191 @@ void Geometry::Detect( CollisionResolver& owner, const Geometry* B ) const
         {
             case _Sphere:    Sphere_(B)->Check( owner, *HalfSpace_(this) ); break;
             case _Cuboid:    Cuboid_(B)->Check( owner, *HalfSpace_(this) ); break;
-            case _HalfSpace: /* not implemented */                        ; break;
-            case _TruePlane: /* not implemented */                        ; break;
+            case _HalfSpace: /* scenery */                                ; break;
+            case _TruePlane: /* scenery */                                ; break;
+            case _TriangleMesh: /* scenery */                             ; break;
+            case _HeightField:  /* scenery */                             ; break;
+            case _ConvexHull: ConvexCheck( owner, *this, *B );           break;
+            case _Compound:  Compound_(B)->Detect( owner, this );        break;
         }
         break;
 
         case _TruePlane: switch( B->Class )
         {
             case _Sphere:    Sphere_(B)->Check( owner, *TruePlane_(this) ); break;
-            case _Cuboid:    /* not implemented */                        ; break;
-            case _HalfSpace: /* not implemented */                        ; break;
-            case _TruePlane: /* not implemented */                        ; break;
+            case _Cuboid:    ConvexCheck( owner, *this, *B );            break;
+            case _HalfSpace: /* scenery */                                ; break;
+            case _TruePlane: /* scenery */                                ; break;
+            case _TriangleMesh: /* scenery */                             ; break;
+            case _HeightField:  /* scenery */                             ; break;
+            case _ConvexHull: ConvexCheck( owner, *this, *B );           break;
+            case _Compound:  Compound_(B)->Detect( owner, this );        break;
         }
         break;
+
+        case _TriangleMesh: switch( B->Class )
+        {
+            case _Sphere:    TriangleMesh_(this)->Check( owner, *Sphere_(B) ); break;
+            case _Cuboid:    TriangleMesh_(this)->Check( owner, *Cuboid_(B) ); break;
+            case _HalfSpace: /* scenery */                                ; break;
+            case _TruePlane: /* scenery */                                ; break;
+            case _TriangleMesh: /* scenery */                             ; break;
+            case _HeightField:  /* scenery */                             ; break;
+            case _ConvexHull: TriangleMesh_(this)->Check( owner, *ConvexHull_(B) ); break;
+            case _Compound:  Compound_(B)->Detect( owner, this );        break;
+        }
+        break;
+
+        case _HeightField: switch( B->Class )
+        {
+            case _Sphere:    HeightField_(this)->Check( owner, *Sphere_(B) ); break;
+            case _Cuboid:    HeightField_(this)->Check( owner, *Cuboid_(B) ); break;
+            case _HalfSpace: /* scenery */                                ; break;
+            case _TruePlane: /* scenery */                                ; break;
+            case _TriangleMesh: /* scenery */                             ; break;
+            case _HeightField:  /* scenery */                             ; break;
+            case _ConvexHull: HeightField_(this)->Check( owner, *ConvexHull_(B) ); break;
+            case _Compound:  Compound_(B)->Detect( owner, this );        break;
+        }
+        break;
+
+        case _ConvexHull: switch( B->Class )
+        {
+            case _Sphere:
+            case _Cuboid:
+            case _HalfSpace:
+            case _TruePlane:
+            case _ConvexHull: ConvexCheck( owner, *this, *B );           break;
+            case _TriangleMesh: TriangleMesh_(B)->Check( owner, *ConvexHull_(this) ); break;
+            case _HeightField:  HeightField_(B) ->Check( owner, *ConvexHull_(this) ); break;
+            case _Compound:  Compound_(B)->Detect( owner, this );        break;
+        }
+        break;
+
+        case _Compound:
+            Compound_(this)->Detect( owner, B );
+            break;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void CandidatePairs::Detect( CollisionResolver& owner ) const
+{
+    typedef const Cuboid*     Cuboid_    ;
+    typedef const Sphere*     Sphere_    ;
+    typedef const HalfSpace*  HalfSpace_ ;
+    typedef const TruePlane*  TruePlane_ ;
+    typedef const TriangleMesh* TriangleMesh_ ;
+    typedef const HeightField*  HeightField_ ;
+    typedef const Compound*     Compound_ ;
+    typedef const ConvexHull*   ConvexHull_ ;
+
+    // Every bucket is processed in its own loop calling a single detector.
+
+    const std::vector<Pair>& ss = Bucket[ Geometry::_Sphere ][ Geometry::_Sphere ];
+    for ( size_t i = 0; i < ss.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+        Sphere_( ss[i].A )->Check( owner, *Sphere_( ss[i].B ) );
+    }
+
+    const std::vector<Pair>& sc = Bucket[ Geometry::_Sphere ][ Geometry::_Cuboid ];
+    for ( size_t i = 0; i < sc.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+        Cuboid_( sc[i].B )->Check( owner, *Sphere_( sc[i].A ) );
+    }
+
+    const std::vector<Pair>& sh = Bucket[ Geometry::_Sphere ][ Geometry::_HalfSpace ];
+    for ( size_t i = 0; i < sh.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+        Sphere_( sh[i].A )->Check( owner, *HalfSpace_( sh[i].B ) );
+    }
+
+    const std::vector<Pair>& sp = Bucket[ Geometry::_Sphere ][ Geometry::_TruePlane ];
+    for ( size_t i = 0; i < sp.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+        Sphere_( sp[i].A )->Check( owner, *TruePlane_( sp[i].B ) );
+    }
+
+    const std::vector<Pair>& sm = Bucket[ Geometry::_Sphere ][ Geometry::_TriangleMesh ];
+    for ( size_t i = 0; i < sm.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+        TriangleMesh_( sm[i].B )->Check( owner, *Sphere_( sm[i].A ) );
+    }
+
+    const std::vector<Pair>& sf = Bucket[ Geometry::_Sphere ][ Geometry::_HeightField ];
+    for ( size_t i = 0; i < sf.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+        HeightField_( sf[i].B )->Check( owner, *Sphere_( sf[i].A ) );
+    }
+
+    const std::vector<Pair>& cc = Bucket[ Geometry::_Cuboid ][ Geometry::_Cuboid ];
+    for ( size_t i = 0; i < cc.size () && owner.HasSpaceForMoreContacts (); ++i )
+    {
+        const Cuboid& A = *Cuboid_( cc[i].A );
+        const Cuboid& B = *Cuboid_( cc[i].B );
+
+        // The resting pairs reuse their contacts instead of running the SAT; the pairs
+        // separated on a face axis (most of them) are rejected before the lookup
+        //
+        if ( owner.RestingContacts.Enabled )
+        {
+            if ( ! A.IntersectsOnFaceAxes( B ) || owner.RestingContacts.Reuse( owner, A, B ) ) {
+                continue;
+            }
+        }
+
+        unsigned first = owner.Count ();
+        if ( A.Check( owner, B ) ) {
+            owner.RestingContacts.Store( owner, A, B, first );
+        }
+    }
+
+    const std::vector<Pair>& ch = Bucket[ Geometry::_Cuboid ][ Geometry::_HalfSpace ];
+    for ( size_t i = 0; i < ch.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+        Cuboid_( ch[i].A )->Check( owner, *HalfSpace_( ch[i].B ) );
+    }
+
+    const std::vector<Pair>& cm = Bucket[ Geometry::_Cuboid ][ Geometry::_TriangleMesh ];
+    for ( size_t i = 0; i < cm.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+        TriangleMesh_( cm[i].B )->Check( owner, *Cuboid_( cm[i].A ) );
+    }
+
+    const std::vector<Pair>& cf = Bucket[ Geometry::_Cuboid ][ Geometry::_HeightField ];
+    for ( size_t i = 0; i < cf.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+        HeightField_( cf[i].B )->Check( owner, *Cuboid_( cf[i].A ) );
+    }
+
+    const std::vector<Pair>& cp = Bucket[ Geometry::_Cuboid ][ Geometry::_TruePlane ];
+    for ( size_t i = 0; i < cp.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+        ConvexCheck( owner, *cp[i].A, *cp[i].B );
+    }
+
+    // Convex hulls are B in all the buckets except the one with compounds
+    //
+    for ( unsigned k = 0; k <= Geometry::_ConvexHull; ++k )
+    {
+        const std::vector<Pair>& xv = Bucket[ k ][ Geometry::_ConvexHull ];
+
+        if ( k == Geometry::_TriangleMesh ) {
+            for ( size_t i = 0; i < xv.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+                TriangleMesh_( xv[i].A )->Check( owner, *ConvexHull_( xv[i].B ) );
+            }
+        }
+        else if ( k == Geometry::_HeightField ) {
+            for ( size_t i = 0; i < xv.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+                HeightField_( xv[i].A )->Check( owner, *ConvexHull_( xv[i].B ) );
+            }
+        }
+        else {
+            for ( size_t i = 0; i < xv.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+                ConvexCheck( owner, *xv[i].A, *xv[i].B );
+            }
+        }
+    }
+
+    // Compounds are always B (they have the highest class)
+    //
+    for ( unsigned k = 0; k < ClassCount; ++k )
+    {
+        const std::vector<Pair>& xc = Bucket[ k ][ Geometry::_Compound ];
+        for ( size_t i = 0; i < xc.size () && owner.HasSpaceForMoreContacts (); ++i ) {
+            Compound_( xc[i].B )->Detect( owner, xc[i].A );
+        }
     }
 }
 
@@ -249,7 +433,7 @@ unsigned Cuboid::RegisterContactOnAxis_Thorough
         };
         Quaternion vertexPos( 0, vertices[i][0], vertices[i][1], vertices[i][2] );
         vertexPos = vertexPos.ComponentWiseProduct( B.HalfExtent );
-        vertexPos = B.Body->ToWorld( vertexPos );
+        vertexPos = B.Transform ()( vertexPos );
 
         // Calculate the distance between the B's vertex and the A's center
         // projected on A's axis
@@ -340,7 +524,7 @@ unsigned Cuboid::RegisterContactOnAxis
     return owner.RegisterNewContact(
         /* a */ Body,
         /* b */ B.Body,
-        /* X */ B.Body->ToWorld( contactPointOn_B ),
+        /* X */ B.Transform ()( contactPointOn_B ),
         /* N */ normal,
         /* d */ penetration
     );
@@ -457,8 +641,8 @@ unsigned Cuboid::Check( CollisionResolver& owner, const Cuboid& B ) const
     // (Note that, from here, we continue in world coordinates.)
     //
     Quaternion contactPoint_world = FindContactPointOnEdges(
-        Body->ToWorld( ptOn_Edge_A ),   axis_A, HalfExtent[ axisIndex_A ],
-        B.Body->ToWorld( ptOn_Edge_B ), axis_B, B.HalfExtent[ axisIndex_B ], use_A
+        Transform ()( ptOn_Edge_A ),   axis_A, HalfExtent[ axisIndex_A ],
+        B.Transform ()( ptOn_Edge_B ), axis_B, B.HalfExtent[ axisIndex_B ], use_A
     );
 
     return owner.RegisterNewContact(
@@ -476,7 +660,7 @@ unsigned Cuboid::Check( CollisionResolver& owner, const Quaternion& point ) cons
 {
     // Transform the point into cuboid coordinates i.e. body-fixed frame
     //
-    Quaternion pointInBodySpace = Body->ToWorld.TransformInverse( point );
+    Quaternion pointInBodySpace = Transform ().TransformInverse( point );
 
     Quaternion normal;
     double min_depth = Const::Max;
@@ -512,7 +696,7 @@ unsigned Cuboid::Check( CollisionResolver& owner, const Sphere& B ) const
     // Transform the center of the sphere into cuboid coordinates
     //
     Quaternion center = B.Position ();
-    Quaternion relCenter = Body->ToWorld.TransformInverse( center );
+    Quaternion relCenter = Transform ().TransformInverse( center );
 
     // Early out check to see if we can exclude the contact
     //
@@ -541,7 +725,7 @@ unsigned Cuboid::Check( CollisionResolver& owner, const Sphere& B ) const
 
     // New contact at the closest point in world coordinates
     //
-    Quaternion closestPointWorld = Body->ToWorld( closestPoint );
+    Quaternion closestPointWorld = Transform ()( closestPoint );
 
     return owner.RegisterNewContact(
         /* a */ Body,
@@ -605,7 +789,7 @@ unsigned Cuboid::Check( CollisionResolver& owner, const HalfSpace& plane ) const
         // Switch to world coordinates and find out penetration of the
         // contact point into the half-space
         //
-        contactPoint = Body->ToWorld( contactPoint );
+        contactPoint = Transform ()( contactPoint );
         double penetration = plane.Offset - contactPoint.Dot( plane.Direction );
 
         // Register a new contact at the point of contact
@@ -642,7 +826,7 @@ unsigned Cuboid::Check( CollisionResolver& owner, const HalfSpace& plane ) const
 
         vertexPos = vertexPos.ComponentWiseProduct( HalfExtent );
 
-        vertexPos = Body->ToWorld( vertexPos );
+        vertexPos = Transform ()( vertexPos );
 
         // Calculate the penetration of the vertex into the half-space
         //
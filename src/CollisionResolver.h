@@ -13,6 +13,10 @@
 
 #include "Geometry.h"
 #include "Collision.h"
+#include "GJK.h"
+#include "ContactCache.h"
+
+#include <vector>  // we use: std::vector
 
 namespace WoRB 
 {
@@ -50,6 +54,83 @@ namespace WoRB
          */
         unsigned CollisionCount;
 
+        /** Holds the scratch data of the shock propagation: the bodies in contact
+         * (sorted), their heights, the contacts of every body, the contacts
+         * ordered by layer, the lower bodies hidden while a layer is resolved and
+         * the saved restitution of the contacts.
+         */
+        std::vector<RigidBody*> StackBodies, StackHidden;
+        std::vector<double> StackRestitution;
+        std::vector<unsigned> StackHeight;
+        std::vector<unsigned> StackStart, StackContacts, StackOrder, StackLayer;
+
+        /** Holds the scratch data of SortByBodies: the contacts in the sorted order
+         * and the start of every body in the sorted contacts.
+         */
+        std::vector<Collision> SortedCollisions;
+        std::vector<unsigned> SortStart;
+
+        /** Holds the scratch data of BlockImpulseTransfers: the first contact and
+         * the number of the contacts of the manifold of every contact.
+         */
+        std::vector<unsigned> ManifoldFirst, ManifoldSize;
+
+        /** Holds the scratch data of AcceleratedImpulses: the contacts solved, their
+         * bodies (sorted) and the bodies of every contact, the contacts of every body
+         * (the sparse Jacobian by body), the impulse sums of the bodies, the
+         * diagonal preconditioner and the vectors of the iteration (three components
+         * per contact), and the residuals and the dot products summed by every worker.
+         */
+        std::vector<unsigned> GradientContacts, GradientSide;
+        std::vector<RigidBody*> GradientBodies;
+        std::vector<unsigned> GradientStart, GradientIncidence;
+        std::vector<Quaternion> GradientP, GradientL;
+        std::vector<double> GradientRhs, GradientGamma, GradientNext, GradientY, GradientG;
+        std::vector<double> GradientScale, GradientResidual, GradientDot;
+        std::vector<double> GradientPartial;
+        double GradientStep;
+        unsigned GradientThreads;
+
+        /** Performs the impulse transfers on the given contacts (on all the contacts,
+         * if `subset` is null) and returns the number of transfers. If `blocks` is
+         * set, the manifolds found by FindManifolds are resolved as blocks.
+         */
+        unsigned TransferImpulses( const unsigned* subset, unsigned count,
+            double timeStep, unsigned maxIterations, double velocityEPS,
+            bool blocks = false );
+
+        /** Finds the manifold of every contact (see BlockImpulseTransfers).
+         */
+        void FindManifolds ();
+
+        /** Updates the velocities of the contacts of the bodies (a null body is
+         * skipped) after their velocity and angular velocity jolts.
+         */
+        void PropagateJolts( RigidBody* const bodies[2],
+            const Quaternion V_jolt[2], const Quaternion W_jolt[2], double timeStep );
+
+        /** Calculates `N x + rhs` into `out` (N being the Delassus operator of
+         * the contacts solved by AcceleratedImpulses, without forming it).
+         */
+        void GradientProduct( const std::vector<double>& x, const double* rhs,
+            std::vector<double>& out );
+
+        static void GradientBodyBatch( void* context, unsigned begin, unsigned end );
+        static void GradientContactBatch( void* context, unsigned begin, unsigned end );
+        static void GradientProjectBatch( void* context, unsigned begin, unsigned end );
+
+        /** Runs a product (see GradientProduct) and all the iterations of
+         * AcceleratedImpulses in a single parallel region, the passes over
+         * the bodies and over the contacts separated by barriers.
+         */
+        static void GradientProductRegion( void* context, unsigned worker, unsigned workers );
+        static void GradientIterateRegion( void* context, unsigned worker, unsigned workers );
+
+        /** Resolves the manifold of `count` (2 to 4) contacts from `first` at once.
+         * Returns false, without applying any impulse, if the block is singular.
+         */
+        bool TransferManifold( unsigned first, unsigned count, double timeStep );
+
     public:
                                                                                    /*@}*/
         /////////////////////////////////////////////////////////////////////////////////
@@ -66,6 +147,33 @@ namespace WoRB
         /** Holds the friction coefficient common for all collisions.
          */
         double Friction;
+
+        /** Holds the GJK simplices and the contact manifolds of the convex pairs
+         * kept between the time-steps.
+         */
+        SimplexCache Simplices;
+
+        /** Holds the contacts of the resting cuboid pairs kept between the time-steps,
+         * which are reused instead of running the detector.
+         */
+        ContactCache RestingContacts;
+
+        /** Holds the number of impulse transfers performed since the registry was
+         * cleared.
+         */
+        unsigned ImpulseIterations;
+
+        /** Holds the number of the manifolds resolved as a block and the number of
+         * the manifolds that fell back to the single contact (since the registry
+         * was cleared).
+         */
+        unsigned BlockSolves, BlockFallbacks;
+
+        /** Holds the number of the iterations and the final residual (the largest
+         * projected gradient, in `m/s`) of the last AcceleratedImpulses.
+         */
+        unsigned GradientIterations;
+        double GradientError;
                                                                                    /*@}*/
         /////////////////////////////////////////////////////////////////////////////////
         /** @name Constructor                                                          */
@@ -78,9 +186,16 @@ namespace WoRB
             , NextFree( allocationArea )
             , FreeCount( length )
             , CollisionCount( 0 )
+            , GradientStep( 0 )
+            , GradientThreads( 1 )
             , Restitution( 1.0 )
             , Relaxation( 0.2 )
             , Friction( 0.0 )
+            , ImpulseIterations( 0 )
+            , BlockSolves( 0 )
+            , BlockFallbacks( 0 )
+            , GradientIterations( 0 )
+            , GradientError( 0 )
         {
         }
                                                                                    /*@}*/
@@ -118,6 +233,10 @@ namespace WoRB
             NextFree = Collisions;
             FreeCount = MaxCollisionCount;
             CollisionCount = 0;
+            ImpulseIterations = 0;
+            BlockSolves = BlockFallbacks = 0;
+            Simplices.NextFrame ();
+            RestingContacts.NextFrame ();
         }
 
         /** Registers a new contact.
@@ -136,6 +255,16 @@ namespace WoRB
                 return 0;
             }
 
+            // Static bodies take part as scenery, so the collision response never
+            // spends time on their (zero) inverse mass and inertia
+            //
+            if ( body_A && body_A->IsStatic () ) {
+                body_A = 0;
+            }
+            if ( body_B && body_B->IsStatic () ) {
+                body_B = 0;
+            }
+
             // Add contact the list of maintained collisions.
             //
             NextFree->Body_A        = body_A;
@@ -154,6 +283,21 @@ namespace WoRB
             return 1;
         }
 
+        /** Sorts the contacts by the lower RigidBody::Order of their bodies (stable,
+         * counting sort), so the contacts of the same and of the neighbouring bodies
+         * are resolved in succession. The orders must be less than `bodyCount`.
+         */
+        void SortByBodies( unsigned bodyCount );
+
+        /** Updates the geometries of the states kept between the time-steps
+         * (Simplices and RestingContacts) moved in memory.
+         */
+        void Relocate( const Relocation& moved )
+        {
+            Simplices.Relocate( moved );
+            RestingContacts.Relocate( moved );
+        }
+
         /** Updates drived quantities (like contact velocity and axis info).
          */
         void UpdateDerivedQuantities( double timeStep )
@@ -172,10 +316,65 @@ namespace WoRB
         void ImpulseTransfers( double timeStep, 
             unsigned maxIterations = 0, double velocityEPS = 0.01 );
 
+        /** Resolves collisions using the impulse transfers, resolving the contact
+         * manifolds (2 to 4 consecutive contacts between the same bodies, as
+         * registered by the cuboid detectors) as blocks.
+         *
+         * When the contact with the largest bouncing velocity belongs to a manifold,
+         * the normal impulses of all its contacts are found together, as the exact
+         * solution of the linear complementarity problem of the block (enumerating
+         * the sets of the pushing contacts), followed by a single friction impulse
+         * in the tangent plane at the centre of the manifold, limited by the friction
+         * cone of the total normal impulse. The single contacts, and the manifolds
+         * with a singular block, are resolved as by ImpulseTransfers.
+         */
+        void BlockImpulseTransfers( double timeStep,
+            unsigned maxIterations = 0, double velocityEPS = 0.01 );
+
+        /** Resolves collisions all at once, solving the cone complementarity problem
+         * of the normal and the friction impulses of all the contacts (except those
+         * between the inactive bodies) with the Nesterov-accelerated projected
+         * gradient method, restarted whenever the momentum points uphill. The step
+         * of every contact is scaled by its inverse effective mass along the normal
+         * (the diagonal of the Delassus matrix), which keeps the friction cones and
+         * offsets the spread of the masses of the bodies.
+         *
+         * The Jacobian is kept sparse by body (the contacts of every body), and
+         * the products with the Delassus matrix `N = J M^-1 J^T` are evaluated
+         * without forming it, as the impulse sums of the bodies followed by
+         * the velocities at the contacts. Both passes and the projections onto
+         * the friction cones run on `threads` threads. The iteration stops when
+         * the projected gradient falls below `velocityEPS` or after `maxIterations`
+         * (by default 200).
+         */
+        void AcceleratedImpulses( double timeStep, unsigned maxIterations = 0,
+            double velocityEPS = 0.01, unsigned threads = 1 );
+
+        /** Resolves the collisions once more layer by layer from the bottom up (shock
+         * propagation), following ImpulseTransfers.
+         *
+         * The height of every body in the contact graph is its distance from the
+         * scenery (or from the bodies with infinite mass); the bodies not supported
+         * by the scenery are on the top. The contacts are then resolved in the order
+         * of their layers, treating the lower body of a contact between the layers
+         * as having infinite mass, so the bodies that rest on the others are pushed
+         * out by the already resolved support instead of pushing it back down.
+         * The layers are resolved inelastically, with at most `maxIterations`
+         * transfers per layer (by default, 8 per contact in the layer). If `blocks`
+         * is set, the manifolds are resolved as blocks, as by BlockImpulseTransfers.
+         */
+        void ShockPropagation( double timeStep,
+            unsigned maxIterations = 0, double velocityEPS = 0.01, bool blocks = false );
+
         /** Resolves collisions using the position projection method.
+         *
+         * By default, the inactive bodies in contact with the active ones are
+         * woken up and projected as well. If `keepAsleep` is set, the inactive
+         * bodies are treated as having infinite mass and are never woken up, and the
+         * contacts between them are skipped, so the sleeping stacks stay asleep.
          */
-        void PositionProjections(
-            unsigned maxIterations = 0, double positionEPS = 0.01 );
+        void PositionProjections( unsigned maxIterations = 0,
+            double positionEPS = 0.01, bool keepAsleep = false );
                                                                                    /*@}*/
         /////////////////////////////////////////////////////////////////////////////////
         /** @name Miscellanous methods                                                 */
@@ -200,14 +399,17 @@ namespace WoRB
             return contact;
         }
 
-        /** Finds a collision with the largest penetration.
+        /** Finds a collision with the largest penetration. If `skipAsleep` is set,
+         * the collisions between the inactive bodies (or with the scenery) are
+         * skipped, so the bodies that fell asleep are not moved.
          */
-        Collision* FindLargestPenetration( double eps )
+        Collision* FindLargestPenetration( double eps, bool skipAsleep = false )
         {
             Collision* contact = 0;
             for ( unsigned i = 0; i < CollisionCount; ++i )
             {
-                if ( Collisions[i].Penetration > eps )
+                if ( Collisions[i].Penetration > eps
+                    && ! ( skipAsleep && Collisions[i].IsAsleep () ) )
                 {
                     eps = Collisions[i].Penetration;
                     contact = &Collisions[i];
@@ -0,0 +1,273 @@
+/**
+ *  @file      Compound.cpp
+ *  @brief     Implementation of the Compound geometry: combined mass properties,
+ *             the child BVH and the collision detection.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-27
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+
+#include <algorithm> // we use: std::nth_element, std::max
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void Compound::AddSphere( const Quaternion& position, double radius, double mass )
+{
+    Sphere sphere;
+    sphere.Radius = radius;
+
+    Child child;
+    child.Shape    = 0;
+    child.IsSphere = true;
+    child.Index    = unsigned( Spheres.size () );
+    child.Local.SetFromOrientationAndPosition( Quaternion( 1.0 ), position );
+    child.Mass     = mass;
+    child.Radius   = radius;
+
+    Spheres.push_back( sphere );
+    Children.push_back( child );
+}
+
+void Compound::AddCuboid( const Quaternion& position, const Quaternion& orientation,
+    const Quaternion& halfExtent, double mass )
+{
+    Cuboid cuboid;
+    cuboid.HalfExtent = halfExtent;
+
+    Child child;
+    child.Shape    = 0;
+    child.IsSphere = false;
+    child.Index    = unsigned( Cuboids.size () );
+    child.Local.SetFromOrientationAndPosition( orientation.Unit (), position );
+    child.Mass     = mass;
+    child.Radius   = halfExtent.ImNorm ();
+
+    Cuboids.push_back( cuboid );
+    Children.push_back( child );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Compares children by the position of their centers along the given axis.
+     */
+    template<class T>
+    struct CenterLess
+    {
+        unsigned Axis;
+        CenterLess( unsigned axis ) : Axis( axis ) {}
+        bool operator () ( const T& a, const T& b ) const {
+            return a.Local.Column(3)[ Axis ] < b.Local.Column(3)[ Axis ];
+        }
+    };
+}
+
+Quaternion Compound::Build ()
+{
+    Nodes.clear ();
+    Radius = 0;
+
+    if ( Children.empty () ) {
+        return 0.0;
+    }
+
+    // Find the combined mass and the center of mass
+    //
+    double mass = 0;
+    Quaternion centerOfMass;
+
+    for ( unsigned i = 0; i < Children.size (); ++i ) {
+        mass += Children[i].Mass;
+        centerOfMass += Children[i].Local.Column(3) * Children[i].Mass;
+    }
+
+    centerOfMass = mass > 0 ? centerOfMass * ( 1.0 / mass ) : Quaternion( 0.0 );
+    centerOfMass.w = 0;
+
+    // Move the children into the frame centered at the center of mass and sum
+    // their moments of inertia about it (the parallel axis theorem)
+    //
+    QTensor inertia( QTensor::Zero );
+
+    for ( unsigned i = 0; i < Children.size (); ++i )
+    {
+        Child& child = Children[i];
+
+        child.Local.m.xw -= centerOfMass.x;
+        child.Local.m.yw -= centerOfMass.y;
+        child.Local.m.zw -= centerOfMass.z;
+
+        Quaternion d = child.Local.Column(3);
+        double m = child.Mass;
+
+        QTensor I_child = child.IsSphere
+            ? Spheres[ child.Index ].MomentOfInertia( m )
+            : Cuboids[ child.Index ].MomentOfInertia( m );
+
+        QTensor I = child.Local( I_child ); // rotated into the body frame
+
+        double dd = d.ImSquaredNorm ();
+        I.m.xx += m * ( dd - d.x * d.x );
+        I.m.yy += m * ( dd - d.y * d.y );
+        I.m.zz += m * ( dd - d.z * d.z );
+        I.m.xy -= m * d.x * d.y;  I.m.yx -= m * d.x * d.y;
+        I.m.xz -= m * d.x * d.z;  I.m.zx -= m * d.x * d.z;
+        I.m.yz -= m * d.y * d.z;  I.m.zy -= m * d.y * d.z;
+
+        inertia += I;
+
+        Radius = std::max( Radius, d.ImNorm () + child.Radius );
+    }
+
+    inertia.m.ww = 1;
+
+    if ( Body )
+    {
+        Body->SetupMass( mass );
+        Body->SetMomentOfInertia( inertia );
+        Body->CalculateDerivedQuantities( /*fromMomenta*/ false );
+    }
+
+    // Build the BVH (reordering the children) and bind the child geometries
+    //
+    Nodes.reserve( 2 * Children.size () );
+    BuildNode( 0, unsigned( Children.size () ) );
+
+    for ( unsigned i = 0; i < Children.size (); ++i )
+    {
+        Child& child = Children[i];
+
+        child.Shape = child.IsSphere ? static_cast<Geometry*>( &Spheres[ child.Index ] )
+                                     : static_cast<Geometry*>( &Cuboids[ child.Index ] );
+        child.Shape->Body  = Body;
+        child.Shape->Frame = &child.World;
+    }
+
+    return centerOfMass;
+}
+
+unsigned Compound::BuildNode( unsigned first, unsigned count )
+{
+    // Find the bounding box of the child centers
+    //
+    Quaternion lo( 0,  Const::Max,  Const::Max,  Const::Max );
+    Quaternion hi( 0, -Const::Max, -Const::Max, -Const::Max );
+
+    for ( unsigned i = first; i < first + count; ++i ) {
+        Quaternion c = Children[i].Local.Column(3);
+        for ( unsigned k = 0; k < 3; ++k ) {
+            lo[k] = std::min( lo[k], c[k] );
+            hi[k] = std::max( hi[k], c[k] );
+        }
+    }
+
+    // The bounding sphere is centered at the center of the box
+    //
+    Node node;
+    node.Center = 0.5 * ( lo + hi );
+    node.Center.w = 0;
+    node.Radius = 0;
+    for ( unsigned i = first; i < first + count; ++i ) {
+        double r = ( Children[i].Local.Column(3) - node.Center ).ImNorm ()
+                 + Children[i].Radius;
+        node.Radius = std::max( node.Radius, r );
+    }
+    node.Offset = first;
+    node.Count  = count;
+
+    unsigned nodeIndex = unsigned( Nodes.size () );
+    Nodes.push_back( node );
+
+    if ( count <= 2 ) {
+        return nodeIndex;
+    }
+
+    // Median split along the axis with the largest extent
+    //
+    unsigned axis = 0;
+    for ( unsigned k = 1; k < 3; ++k ) {
+        if ( hi[k] - lo[k] > hi[axis] - lo[axis] ) {
+            axis = k;
+        }
+    }
+
+    unsigned mid = first + count / 2;
+    std::nth_element( Children.begin () + first, Children.begin () + mid,
+        Children.begin () + first + count, CenterLess<Child>( axis ) );
+
+    BuildNode( first, mid - first );
+    unsigned right = BuildNode( mid, first + count - mid );
+
+    Nodes[ nodeIndex ].Offset = right;
+    Nodes[ nodeIndex ].Count  = 0;
+
+    return nodeIndex;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void Compound::Detect( CollisionResolver& owner, const Geometry* B ) const
+{
+    if ( Nodes.empty () || ! owner.HasSpaceForMoreContacts () ) {
+        return;
+    }
+
+    double radius = BoundingRadius( *B );
+
+    if ( radius < 0 )
+    {
+        // Unbounded geometry (scenery); test all the children
+        //
+        for ( unsigned i = 0; i < Children.size (); ++i ) {
+            UpdateFrame( Children[i] );
+            Children[i].Shape->Detect( owner, B );
+        }
+        return;
+    }
+
+    // Test the bounding sphere of the compound first
+    //
+    Quaternion center = B->Position ();
+    double reach = radius + Radius;
+    if ( ( center - Position () ).ImSquaredNorm () > reach * reach ) {
+        return;
+    }
+
+    // Descend the BVH with the bounding sphere of B in the body frame
+    //
+    Quaternion localCenter = Body->ToWorld.TransformInverse( center );
+
+    unsigned stack[ 64 ];
+    unsigned top = 0;
+    stack[ top++ ] = 0;
+
+    while ( top > 0 )
+    {
+        const Node& node = Nodes[ stack[ --top ] ];
+
+        reach = radius + node.Radius;
+        if ( ( localCenter - node.Center ).ImSquaredNorm () > reach * reach ) {
+            continue;
+        }
+
+        if ( node.Count > 0 )
+        {
+            for ( unsigned i = node.Offset; i < node.Offset + node.Count; ++i ) {
+                UpdateFrame( Children[i] );
+                Children[i].Shape->Detect( owner, B );
+            }
+        }
+        else
+        {
+            unsigned index = unsigned( &node - &Nodes[0] );
+            stack[ top++ ] = node.Offset;  // right child
+            stack[ top++ ] = index + 1;    // left child (visited first)
+        }
+    }
+}
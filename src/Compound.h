@@ -0,0 +1,143 @@
+#ifndef _WORB_COMPOUND_H_INCLUDED
+#define _WORB_COMPOUND_H_INCLUDED
+
+/**
+ *  @file      Compound.h
+ *  @brief     Definitions for the Compound class, a geometry of a rigid body made
+ *             of several child spheres and cuboids.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-27
+ *  @copyright GNU Public License.
+ */
+
+#include "Geometry.h"
+
+#include <vector>  // we use: std::vector
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Encapsulates the geometry of a rigid body made of child spheres and cuboids,
+     * each with its own mass and offset (position and orientation) relative to
+     * the body.
+     *
+     * The children are added first; Build then computes the combined mass and
+     * moment of inertia, moves the origin of the body frame to the combined center
+     * of mass and builds a BVH of the children's bounding spheres in the body frame.
+     * The BVH does not change when the body moves.
+     *
+     * Collision detection first tests the compound's bounding sphere, then descends
+     * the BVH and runs the child detectors only for the overlapping children.
+     * Contacts are registered for the compound's body.
+     */
+    class Compound : public Geometry
+    {
+    public:
+
+        /** Holds a node of the flattened BVH (in the body frame).
+         */
+        struct Node
+        {
+            Quaternion Center;  //!< Holds the center of the bounding sphere
+            double   Radius;    //!< Holds the radius of the bounding sphere
+            unsigned Offset;    //!< Holds the first child (leaf) or the right child
+            unsigned Count;     //!< Holds the number of children; 0 for interior nodes
+        };
+
+        Compound ()
+            : Geometry( Geometry::_Compound )
+            , Radius( 0 )
+        {
+        }
+
+        /** Adds a child sphere centered at the given position (in the body frame).
+         */
+        void AddSphere( const Quaternion& position, double radius, double mass );
+
+        /** Adds a child cuboid at the given position and orientation (in the body
+         * frame).
+         */
+        void AddCuboid( const Quaternion& position, const Quaternion& orientation,
+            const Quaternion& halfExtent, double mass );
+
+        /** Sets up the body mass and moment of inertia, moves the body frame to
+         * the center of mass and builds the BVH of the children.
+         * @return the center of mass in the frame in which the children were added.
+         */
+        Quaternion Build ();
+
+        /** Gets the number of children.
+         */
+        unsigned ChildCount () const
+        {
+            return unsigned( Children.size () );
+        }
+
+        /** Gets the child geometry with the given index (in the BVH order).
+         */
+        const Geometry& GetChild( unsigned index ) const
+        {
+            return *Children[ index ].Shape;
+        }
+
+        /** Updates the world transforms of all the children, so that their
+         * positions are current outside the collision detection (e.g. for the
+         * scene queries).
+         */
+        void UpdateFrames () const
+        {
+            for ( unsigned i = 0; i < Children.size (); ++i ) {
+                UpdateFrame( Children[i] );
+            }
+        }
+
+        /** Holds the radius of the sphere bounding all the children (centered at
+         * the center of mass).
+         */
+        double Radius;
+
+        /////////////////////////////////////////////////////////////////////////////////
+
+        /** Detects and registers collisions between the children and the other
+         * geometry.
+         */
+        void Detect( CollisionResolver& owner, const Geometry* B ) const;
+
+    private:
+
+        /** Holds a child geometry.
+         */
+        struct Child
+        {
+            Geometry* Shape;        //!< Points to the child in Spheres or Cuboids
+            bool      IsSphere;     //!< Indicates whether the child is in Spheres
+            unsigned  Index;        //!< Holds the index in Spheres or Cuboids
+            QTensor   Local;        //!< Holds the transform into the body frame
+            mutable QTensor World;  //!< Holds the transform into the world frame
+            double    Mass;         //!< Holds the mass
+            double    Radius;       //!< Holds the radius of the bounding sphere
+        };
+
+        /** Updates the world transform of the child.
+         */
+        void UpdateFrame( const Child& child ) const
+        {
+            child.World = Body->ToWorld * child.Local;
+        }
+
+        /** Builds the BVH subtree over the given range of children; returns
+         * the index of its root.
+         */
+        unsigned BuildNode( unsigned first, unsigned count );
+
+        std::vector<Child>  Children;  //!< Holds the children in the BVH order
+        std::vector<Node>   Nodes;     //!< Holds the flattened BVH
+        std::vector<Sphere> Spheres;   //!< Holds the child spheres
+        std::vector<Cuboid> Cuboids;   //!< Holds the child cuboids
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_COMPOUND_H_INCLUDED
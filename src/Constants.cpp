@@ -33,6 +33,8 @@ const double Const::NaN = std::numeric_limits<double>::quiet_NaN ();
 
 const Quaternion Const::g_n( 0, 0, -9.80665, 0 ); // Standard gravity along y-axis
 
+const double Const::G = 6.67384e-11; // CODATA 2010
+
 /////////////////////////////////////////////////////////////////////////////////////////
 
 const Quaternion Const::X ( 0, 1, 0, 0 );
@@ -45,6 +45,10 @@ namespace WoRB
          */
         const static Quaternion g_n;
 
+        /** Gets the gravitational constant (in m^3 kg^-1 s^-2).
+         */
+        const static double G;
+
         /////////////////////////////////////////////////////////////////////////////////
 
         /** Represents Pi.
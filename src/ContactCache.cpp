@@ -0,0 +1,253 @@
+/**
+ *  @file      ContactCache.cpp
+ *  @brief     Implementation of the contact reuse for the resting pairs of geometries.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-02
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+
+#include <algorithm>  // we use: std::sort
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Gets the coordinates of the world vector in the frame of the geometry.
+     */
+    inline Quaternion ToLocal( const Geometry& G, const Quaternion& v )
+    {
+        return Quaternion( 0, v.Dot( G.Axis(0) ), v.Dot( G.Axis(1) ), v.Dot( G.Axis(2) ) );
+    }
+
+    /** Gets the world vector with the coordinates in the frame of the geometry.
+     */
+    inline Quaternion ToWorld( const Geometry& G, const Quaternion& v )
+    {
+        return G.Axis(0) * v.x + G.Axis(1) * v.y + G.Axis(2) * v.z;
+    }
+
+    /** Gets the body as registered with the contacts (the static bodies are scenery).
+     */
+    inline const RigidBody* Registered( const Geometry& G )
+    {
+        return G.Body && G.Body->IsStatic () ? 0 : G.Body;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned ContactCache::Lookup( const Geometry* A, const Geometry* B )
+{
+    unsigned index = Cursor;
+
+    if ( index >= Entries.size () || Entries[index].A != A || Entries[index].B != B )
+    {
+        Map::iterator entry = Index.find( Key( A, B ) );
+        if ( entry == Index.end () ) {
+            return None;
+        }
+        index = entry->second;
+    }
+
+    Cursor = index + 1;
+
+    CachedContacts& state = Entries[index];
+
+    if ( state.LastFrame + 1 < Frame ) {
+        state.IsValid = false; // Not used in the last time-step; generate anew
+    }
+    state.LastFrame  = Frame;
+    state.LastLookup = ++Lookups;
+
+    return index;
+}
+
+void ContactCache::Reindex ()
+{
+    Index.clear ();
+    for ( unsigned i = 0; i < Entries.size (); ++i ) {
+        Index[ Key( Entries[i].A, Entries[i].B ) ] = i;
+    }
+}
+
+void ContactCache::Relocate( const Relocation& moved )
+{
+    for ( unsigned i = 0; i < Entries.size (); ++i )
+    {
+        Entries[i].A = moved( Entries[i].A );
+        Entries[i].B = moved( Entries[i].B );
+    }
+
+    Reindex ();
+}
+
+void ContactCache::NextFrame ()
+{
+    enum { EvictionPeriod = 32 };
+
+    Cursor = 0;
+    Current = None;
+
+    if ( ++Frame % EvictionPeriod != 0 ) {
+        return;
+    }
+
+    // Drop the unused states and sort the rest in the order of the last lookups
+    //
+    unsigned count = 0;
+    for ( unsigned i = 0; i < Entries.size (); ++i )
+    {
+        if ( Entries[i].LastFrame + EvictionPeriod >= Frame ) {
+            Entries[ count++ ] = Entries[i];
+        }
+    }
+    Entries.resize( count );
+
+    std::sort( Entries.begin (), Entries.end () );
+
+    Reindex ();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+bool ContactCache::Reuse( CollisionResolver& owner, const Geometry& A, const Geometry& B )
+{
+    Current = None;
+
+    if ( ! Enabled || ! ( A.Frame || A.Body ) || ! ( B.Frame || B.Body ) ) {
+        return false;
+    }
+
+    Current = Lookup( &A, &B );
+    if ( Current == None ) {
+        return false;
+    }
+
+    CachedContacts& state = Entries[ Current ];
+
+    if ( ! state.IsValid || state.Age + 1 >= RefreshInterval ) {
+        state.IsValid = false;
+        return false;
+    }
+
+    // Compare the pose of B in the frame of A with the pose at the generation
+    //
+    Quaternion origin = A.Position ();
+
+    Quaternion delta = ToLocal( A, B.Position () - origin ) - state.RelativePosition;
+    if ( delta.ImNorm () > LinearTolerance ) {
+        state.IsValid = false;
+        return false;
+    }
+
+    for ( unsigned k = 0; k < 3; ++k )
+    {
+        // For the small rotations, the displacement of the unit axis is the angle
+        //
+        delta = ToLocal( A, B.Axis(k) ) - state.RelativeAxis[k];
+        if ( delta.ImNorm () > AngularTolerance ) {
+            state.IsValid = false;
+            return false;
+        }
+    }
+
+    // Move the contacts with the bodies and refresh their penetration from
+    // the separation of the contact points along the normal
+    //
+    RigidBody* bodyA = A.Body;
+    RigidBody* bodyB = B.Body;
+
+    for ( unsigned i = 0; i < state.PointCount; ++i )
+    {
+        Quaternion pointA = origin + ToWorld( A, state.LocalA[i] );
+        Quaternion pointB = B.Position () + ToWorld( B, state.LocalB[i] );
+        Quaternion normal = ToWorld( A, state.LocalNormal[i] );
+
+        double separation = ( pointA - pointB ).Dot( normal );
+        if ( ! state.FirstIsA[i] ) {
+            separation = -separation;
+        }
+
+        Quaternion position = ( pointA + pointB ) * 0.5;
+        position.w = 0;
+
+        if ( state.FirstIsA[i] ) {
+            owner.RegisterNewContact( bodyA, bodyB, position, normal,
+                state.Penetration[i] - separation );
+        }
+        else {
+            owner.RegisterNewContact( bodyB, bodyA, position, normal,
+                state.Penetration[i] - separation );
+        }
+    }
+
+    ++state.Age;
+    ++Reused;
+
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void ContactCache::Store( const CollisionResolver& owner,
+    const Geometry& A, const Geometry& B, unsigned first )
+{
+    ++Generated;
+
+    if ( ! Enabled || ! ( A.Frame || A.Body ) || ! ( B.Frame || B.Body ) ) {
+        return;
+    }
+
+    if ( Current == None )
+    {
+        Current = unsigned( Entries.size () );
+        Entries.push_back( CachedContacts( &A, &B ) );
+        Index[ Key( &A, &B ) ] = Current;
+
+        Cursor = Current + 1;
+    }
+
+    CachedContacts& state = Entries[ Current ];
+    state.LastFrame  = Frame;
+    state.LastLookup = ++Lookups;
+
+    // The contacts are not kept if some were lost for the lack of space
+    //
+    unsigned count = owner.Count () - first;
+    state.IsValid = count <= CachedContacts::MaxPoints
+                 && owner.HasSpaceForMoreContacts ();
+    state.Age = 0;
+    state.PointCount = 0;
+
+    if ( ! state.IsValid ) {
+        return;
+    }
+
+    Quaternion origin = A.Position ();
+
+    state.RelativePosition = ToLocal( A, B.Position () - origin );
+    for ( unsigned k = 0; k < 3; ++k ) {
+        state.RelativeAxis[k] = ToLocal( A, B.Axis(k) );
+    }
+
+    const RigidBody* bodyA = Registered( A );
+    const RigidBody* bodyB = Registered( B );
+
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        const Collision& contact = owner[ first + i ];
+
+        state.LocalA[i]      = ToLocal( A, contact.Position - origin );
+        state.LocalB[i]      = ToLocal( B, contact.Position - B.Position () );
+        state.LocalNormal[i] = ToLocal( A, contact.Normal );
+        state.Penetration[i] = contact.Penetration;
+        state.FirstIsA[i]    = contact.Body_A == bodyA && contact.Body_B == bodyB;
+    }
+
+    state.PointCount = count;
+}
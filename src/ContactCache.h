@@ -0,0 +1,218 @@
+#ifndef _WORB_CONTACT_CACHE_H_INCLUDED
+#define _WORB_CONTACT_CACHE_H_INCLUDED
+
+/**
+ *  @file      ContactCache.h
+ *  @brief     Definitions for the ContactCache class, which keeps the contacts of the
+ *             resting pairs of geometries so that their narrowphase can be skipped.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-02
+ *  @copyright GNU Public License.
+ */
+
+#include "Geometry.h"
+
+#include <map>     // we use: std::map
+#include <vector>  // we use: std::vector
+#include <utility> // we use: std::pair
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Holds the contacts generated for a pair of geometries, together with
+     * the relative pose of the pair at the time of the generation.
+     */
+    struct CachedContacts
+    {
+        enum { MaxPoints = 4 };
+
+        /** Holds the pair of geometries.
+         */
+        const Geometry* A;
+        const Geometry* B;
+
+        /** Holds the position and the axes of B in the frame of A at the generation.
+         */
+        Quaternion RelativePosition;
+        Quaternion RelativeAxis[3];
+
+        /** Holds the contacts: the contact point in the frames of A and B, the normal
+         * in the frame of A and the penetration at the generation.
+         */
+        Quaternion LocalA[ MaxPoints ];
+        Quaternion LocalB[ MaxPoints ];
+        Quaternion LocalNormal[ MaxPoints ];
+        double Penetration[ MaxPoints ];
+
+        /** Indicates whether the contact was registered with the body of A first.
+         */
+        bool FirstIsA[ MaxPoints ];
+
+        unsigned PointCount; //!< Holds the number of the contacts
+
+        /** Holds the number of the time-steps the contacts were reused since
+         * they were generated.
+         */
+        unsigned Age;
+
+        /** Indicates whether the contacts may be reused (they are all kept and
+         * the pair was tested in the last time-step).
+         */
+        bool IsValid;
+
+        /** Holds the number of the frame in which the state was last used and
+         * the number of the lookup that found it (counted over all the frames).
+         */
+        unsigned LastFrame;
+        unsigned long LastLookup;
+
+        CachedContacts( const Geometry* a = 0, const Geometry* b = 0 )
+            : A( a ), B( b ), PointCount( 0 ), Age( 0 ), IsValid( false )
+            , LastFrame( 0 ), LastLookup( 0 )
+        {
+        }
+
+        /** Orders the states by the last lookup.
+         */
+        bool operator < ( const CachedContacts& other ) const
+        {
+            return LastLookup < other.LastLookup;
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Caches the contacts per pair of geometries, so that the detector is skipped
+     * for the pairs whose relative pose barely changed since their contacts were
+     * generated. The cached contacts are moved with the bodies and their penetration
+     * is refreshed from the relative motion.
+     *
+     * The states are kept in an array in the order of the lookups (restored when
+     * the unused states are evicted), since the broadphase finds the resting pairs
+     * in the same order every time-step: the state following the last one found is
+     * tried first, and the index of all the states is searched only on a miss.
+     */
+    class ContactCache
+    {
+        typedef std::pair<const Geometry*, const Geometry*> Key;
+        typedef std::map<Key, unsigned> Map;
+
+        enum { None = ~0u };
+
+        std::vector<CachedContacts> Entries; //!< The states in the order of lookups
+        Map Index;                           //!< The indices of the states by pair
+        unsigned Frame;
+        unsigned long Lookups;
+
+        /** Holds the index of the state that is tried first by the next lookup.
+         */
+        unsigned Cursor;
+
+        /** Holds the index of the state of the pair found by the last Reuse, if any.
+         */
+        unsigned Current;
+
+        /** Finds the state of the pair; returns None if there is no state.
+         */
+        unsigned Lookup( const Geometry* A, const Geometry* B );
+
+        /** Rebuilds the index of the states.
+         */
+        void Reindex ();
+
+    public:
+
+        /** Updates the geometries of the states moved in memory.
+         */
+        void Relocate( const Relocation& moved );
+
+        /** Indicates whether the contacts are reused.
+         */
+        bool Enabled;
+
+        /** Holds the largest displacement of B relative to A for which the contacts
+         * are reused, in `m`.
+         */
+        double LinearTolerance;
+
+        /** Holds the largest rotation of B relative to A for which the contacts
+         * are reused, in `rad`.
+         */
+        double AngularTolerance;
+
+        /** Holds the number of time-steps after which the contacts are generated
+         * again, regardless of the motion (1 generates them every time-step).
+         */
+        unsigned RefreshInterval;
+
+        /** Holds the number of the pairs in contact that ran the detector (counted
+         * also when the reuse is disabled) and the number of the pairs that reused
+         * their contacts.
+         */
+        unsigned long Generated, Reused;
+
+        ContactCache ()
+            : Frame( 1 )
+            , Lookups( 0 )
+            , Cursor( 0 )
+            , Current( None )
+            , Enabled( true )
+            , LinearTolerance( 5e-3 )
+            , AngularTolerance( 5e-3 )
+            , RefreshInterval( 8 )
+            , Generated( 0 )
+            , Reused( 0 )
+        {
+        }
+
+        /** Advances to the next time-step, periodically evicting the unused states
+         * and restoring the order of the lookups.
+         */
+        void NextFrame ();
+
+        /** Registers the cached contacts of the pair moved with the bodies, if the pose
+         * of B relative to A changed less than the tolerances since the contacts were
+         * generated (and less than RefreshInterval time-steps ago).
+         * @return true if the contacts were reused, so the detector may be skipped.
+         */
+        bool Reuse( CollisionResolver& owner, const Geometry& A, const Geometry& B );
+
+        /** Caches the contacts of the pair registered by the detector from the index
+         * `first` on (at least one), together with the relative pose of the pair.
+         * Must follow the Reuse of the same pair that returned false; the pairs
+         * without contacts are not stored.
+         */
+        void Store( const CollisionResolver& owner,
+            const Geometry& A, const Geometry& B, unsigned first );
+
+        /** Removes all the states and clears the statistics.
+         */
+        void Clear ()
+        {
+            Entries.clear ();
+            Index.clear ();
+            Cursor = 0;
+            Current = None;
+            Generated = Reused = 0;
+        }
+
+        /** Gets the number of cached states.
+         */
+        unsigned Count () const
+        {
+            return unsigned( Entries.size () );
+        }
+
+        /** Gets the fraction of the pairs that reused their contacts.
+         */
+        double ReuseRate () const
+        {
+            return Generated + Reused ? double( Reused ) / ( Generated + Reused ) : 0.0;
+        }
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_CONTACT_CACHE_H_INCLUDED
@@ -0,0 +1,303 @@
+/**
+ *  @file      ConvexHull.cpp
+ *  @brief     Implementation of the ConvexHull construction and mass properties.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-28
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+
+#include <algorithm> // we use: std::sort, std::max
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Holds a face of the hull: its plane and the vertices in counter-clockwise
+     * order (seen from the outside).
+     */
+    struct Face
+    {
+        Quaternion Normal;
+        double Distance;
+        std::vector<unsigned> Index;
+    };
+
+    /** Orders the indices lexicographically by their planar coordinates.
+     */
+    struct PlanarLess
+    {
+        const std::vector<double>& U;
+        const std::vector<double>& V;
+        PlanarLess( const std::vector<double>& u, const std::vector<double>& v )
+            : U( u ), V( v ) {}
+        bool operator () ( unsigned a, unsigned b ) const {
+            return U[a] < U[b] || ( U[a] == U[b] && V[a] < V[b] );
+        }
+    };
+
+    /** Checks if the points a, b, c (given by their planar coordinates) make
+     * a counter-clockwise turn.
+     */
+    bool IsLeftTurn( unsigned a, unsigned b, unsigned c,
+        const std::vector<double>& U, const std::vector<double>& V, double eps )
+    {
+        return ( U[b] - U[a] ) * ( V[c] - V[a] ) - ( V[b] - V[a] ) * ( U[c] - U[a] ) > eps;
+    }
+
+    /** Adds the outer product `s * a b^T` to the tensor.
+     */
+    void AddOuter( QTensor& T, const Quaternion& a, const Quaternion& b, double s )
+    {
+        T.m.xx += s * a.x * b.x;  T.m.xy += s * a.x * b.y;  T.m.xz += s * a.x * b.z;
+        T.m.yx += s * a.y * b.x;  T.m.yy += s * a.y * b.y;  T.m.yz += s * a.y * b.z;
+        T.m.zx += s * a.z * b.x;  T.m.zy += s * a.z * b.y;  T.m.zz += s * a.z * b.z;
+    }
+}
+
+bool ConvexHull::Build( const double* points, unsigned count )
+{
+    Vertices.clear ();
+    First.clear ();
+    Adjacency.clear ();
+    Planes.clear ();
+    Radius = Volume = 0;
+
+    if ( count < 4 || count > MaxPoints ) {
+        return false;
+    }
+
+    // Merge the coincident points and find the scale of the point set
+    //
+    std::vector<Quaternion> P;
+    double scale = 0;
+
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        Quaternion p( 0, points[ 3*i ], points[ 3*i + 1 ], points[ 3*i + 2 ] );
+
+        bool duplicate = false;
+        for ( unsigned j = 0; j < P.size () && ! duplicate; ++j ) {
+            duplicate = ( P[j] - p ).ImSquaredNorm () < 1e-24;
+        }
+        if ( ! duplicate ) {
+            P.push_back( p );
+            scale = std::max( scale, fabs( p.x ) + fabs( p.y ) + fabs( p.z ) );
+        }
+    }
+
+    const unsigned n = unsigned( P.size () );
+    const double eps = 1e-9 * ( scale > 0 ? scale : 1 );
+
+    // Find the faces by testing the planes through all the triples of points
+    //
+    std::vector<Face> faces;
+
+    for ( unsigned i = 0; i < n; ++i ) {
+        for ( unsigned j = i + 1; j < n; ++j ) {
+            for ( unsigned k = j + 1; k < n; ++k )
+            {
+                Quaternion N = ( P[j] - P[i] ).Cross( P[k] - P[i] );
+                double length = N.ImNorm ();
+                if ( length < eps * scale ) {
+                    continue; // Collinear points
+                }
+                N = N * ( 1.0 / length );
+                double D = N.Dot( P[i] );
+
+                bool above = false, below = false;
+                for ( unsigned m = 0; m < n && !( above && below ); ++m ) {
+                    double s = N.Dot( P[m] ) - D;
+                    above = above || s > eps;
+                    below = below || s < -eps;
+                }
+
+                if ( above && below ) {
+                    continue; // Not a face
+                }
+                if ( ! above && ! below ) {
+                    return false; // All the points are coplanar
+                }
+                if ( above ) {
+                    N = -N; D = -D; // Make the normal point outwards
+                }
+
+                bool known = false;
+                for ( unsigned f = 0; f < faces.size () && ! known; ++f ) {
+                    known = faces[f].Normal.Dot( N ) > 1 - 1e-9
+                         && fabs( faces[f].Distance - D ) < eps;
+                }
+                if ( known ) {
+                    continue;
+                }
+
+                Face face;
+                face.Normal = N;
+                face.Distance = D;
+                for ( unsigned m = 0; m < n; ++m ) {
+                    if ( fabs( N.Dot( P[m] ) - D ) <= eps ) {
+                        face.Index.push_back( m );
+                    }
+                }
+                faces.push_back( face );
+            }
+        }
+    }
+
+    if ( faces.size () < 4 ) {
+        return false;
+    }
+
+    // Reduce every face to its polygon: the 2D convex hull of the points on
+    // the face (without the inner and the collinear points), counter-clockwise
+    // seen from the outside; see Andrew's monotone chain algorithm.
+    //
+    std::vector<double> U( n ), V( n );
+
+    for ( unsigned f = 0; f < faces.size (); ++f )
+    {
+        Face& face = faces[f];
+
+        Quaternion u = ( P[ face.Index[1] ] - P[ face.Index[0] ] ).Unit ();
+        Quaternion v = face.Normal.Cross( u );
+
+        for ( unsigned i = 0; i < face.Index.size (); ++i ) {
+            U[ face.Index[i] ] = P[ face.Index[i] ].Dot( u );
+            V[ face.Index[i] ] = P[ face.Index[i] ].Dot( v );
+        }
+
+        std::vector<unsigned> sorted( face.Index );
+        std::sort( sorted.begin (), sorted.end (), PlanarLess( U, V ) );
+
+        const double tol = eps * scale;
+        std::vector<unsigned> polygon( 2 * sorted.size () );
+        unsigned k = 0;
+
+        for ( unsigned i = 0; i < sorted.size (); ++i ) { // The lower chain
+            while ( k >= 2 && ! IsLeftTurn( polygon[k-2], polygon[k-1], sorted[i], U, V, tol ) ) {
+                --k;
+            }
+            polygon[ k++ ] = sorted[i];
+        }
+
+        unsigned lower = k + 1;
+        for ( unsigned i = unsigned( sorted.size () ) - 1; i-- > 0; ) { // The upper chain
+            while ( k >= lower && ! IsLeftTurn( polygon[k-2], polygon[k-1], sorted[i], U, V, tol ) ) {
+                --k;
+            }
+            polygon[ k++ ] = sorted[i];
+        }
+
+        --k; // The last point is the first one
+        polygon.resize( k );
+        face.Index = polygon;
+    }
+
+    // Keep only the points on the faces; build the adjacency from the face edges
+    //
+    std::vector<unsigned> remap( n, unsigned(-1) );
+    std::vector< std::vector<unsigned> > neighbours;
+
+    for ( unsigned f = 0; f < faces.size (); ++f ) {
+        for ( unsigned i = 0; i < faces[f].Index.size (); ++i )
+        {
+            unsigned& index = faces[f].Index[i];
+            if ( remap[ index ] == unsigned(-1) ) {
+                remap[ index ] = unsigned( Vertices.size () );
+                Vertices.push_back( P[ index ] );
+                neighbours.push_back( std::vector<unsigned> () );
+            }
+            index = remap[ index ];
+        }
+    }
+
+    for ( unsigned f = 0; f < faces.size (); ++f )
+    {
+        const std::vector<unsigned>& index = faces[f].Index;
+        for ( unsigned i = 0; i < index.size (); ++i )
+        {
+            unsigned a = index[i], b = index[ ( i + 1 ) % index.size () ];
+            if ( std::find( neighbours[a].begin (), neighbours[a].end (), b ) == neighbours[a].end () ) {
+                neighbours[a].push_back( b );
+                neighbours[b].push_back( a );
+            }
+        }
+    }
+
+    First.push_back( 0 );
+    for ( unsigned i = 0; i < Vertices.size (); ++i ) {
+        Adjacency.insert( Adjacency.end (), neighbours[i].begin (), neighbours[i].end () );
+        First.push_back( unsigned( Adjacency.size () ) );
+    }
+
+    // Integrate the volume, the centroid and the covariance over the tetrahedra
+    // spanned by a reference point inside the hull and the (fan-triangulated) faces
+    //
+    Quaternion reference;
+    for ( unsigned i = 0; i < Vertices.size (); ++i ) {
+        reference += Vertices[i];
+    }
+    reference = reference * ( 1.0 / Vertices.size () );
+
+    double volume = 0;
+    Quaternion moment;
+    QTensor covariance( QTensor::Zero );
+
+    for ( unsigned f = 0; f < faces.size (); ++f )
+    {
+        const std::vector<unsigned>& index = faces[f].Index;
+        for ( unsigned i = 1; i + 1 < index.size (); ++i )
+        {
+            Quaternion a = Vertices[ index[0]   ] - reference;
+            Quaternion b = Vertices[ index[i]   ] - reference;
+            Quaternion c = Vertices[ index[i+1] ] - reference;
+
+            double det = a.Dot( b.Cross( c ) );
+            Quaternion s = a + b + c;
+
+            volume += det / 6;
+            moment += s * ( det / 24 );
+
+            AddOuter( covariance, a, a, det / 120 );
+            AddOuter( covariance, b, b, det / 120 );
+            AddOuter( covariance, c, c, det / 120 );
+            AddOuter( covariance, s, s, det / 120 );
+        }
+    }
+
+    if ( volume <= 0 ) {
+        return false;
+    }
+
+    // Move the covariance to the centroid and convert it to the inertia tensor
+    //
+    Quaternion d = moment * ( 1.0 / volume );
+    AddOuter( covariance, d, d, -volume );
+
+    double trace = covariance.m.xx + covariance.m.yy + covariance.m.zz;
+    UnitInertia = QTensor( trace, trace, trace ) - covariance;
+    UnitInertia.m.ww = 1;
+    Volume = volume;
+
+    // Center the vertices at the centroid
+    //
+    Offset = reference + d;
+    Offset.w = 0;
+
+    for ( unsigned i = 0; i < Vertices.size (); ++i ) {
+        Vertices[i] -= Offset;
+        Radius = std::max( Radius, Vertices[i].ImNorm () );
+    }
+
+    for ( unsigned f = 0; f < faces.size (); ++f ) {
+        Quaternion plane = faces[f].Normal;
+        plane.w = faces[f].Distance - faces[f].Normal.Dot( Offset );
+        Planes.push_back( plane );
+    }
+
+    return true;
+}
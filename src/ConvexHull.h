@@ -0,0 +1,160 @@
+#ifndef _WORB_CONVEX_HULL_H_INCLUDED
+#define _WORB_CONVEX_HULL_H_INCLUDED
+
+/**
+ *  @file      ConvexHull.h
+ *  @brief     Definitions for the ConvexHull class, a convex polyhedron geometry
+ *             with hill-climbing support queries.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-28
+ *  @copyright GNU Public License.
+ */
+
+#include "Geometry.h"
+
+#include <vector>  // we use: std::vector
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Encapsulates a convex polyhedron given by the convex hull of a set of points.
+     *
+     * The hull is built once from the points (in the body frame): the faces are
+     * found and the points that are not vertices of the hull are dropped. The
+     * vertices are stored with their adjacency (the hull edges), so the support
+     * vertex in a given direction is found by hill-climbing from a start vertex;
+     * when the start vertex is the last support vertex (as it is in GJK iterations
+     * and between time-steps), only a few vertices are visited.
+     *
+     * Collisions are detected by the generic GJK/EPA narrowphase (see GJK.h).
+     */
+    class ConvexHull : public Geometry
+    {
+    public:
+
+        /** Holds the maximum number of points accepted by Build.
+         * (The faces are found by testing all the triples of points.)
+         */
+        enum { MaxPoints = 128 };
+
+        ConvexHull ()
+            : Geometry( Geometry::_ConvexHull )
+            , Radius( 0 )
+            , Volume( 0 )
+        {
+        }
+
+        /** Builds the hull from the given points (three coordinates per point).
+         * The vertices are moved so that the centroid of the solid hull is at
+         * the origin of the body frame.
+         * @return false if there are less than 4 non-coplanar or more than
+         *         MaxPoints points.
+         */
+        bool Build( const double* points, unsigned count );
+
+        /** Gets the centroid of the solid hull in the frame of the original points
+         * (i.e. the displacement applied to the vertices by Build).
+         */
+        Quaternion Centroid () const
+        {
+            return Offset;
+        }
+
+        /** Gets the number of vertices.
+         */
+        unsigned VertexCount () const
+        {
+            return unsigned( Vertices.size () );
+        }
+
+        /** Gets the vertex with the given index (in the body frame).
+         */
+        const Quaternion& GetVertex( unsigned index ) const
+        {
+            return Vertices[ index ];
+        }
+
+        /** Gets the number of faces.
+         */
+        unsigned FaceCount () const
+        {
+            return unsigned( Planes.size () );
+        }
+
+        /** Gets the plane of the face with the given index (in the body frame):
+         * the outward unit normal in x, y, z and the distance from the origin in w.
+         */
+        const Quaternion& GetPlane( unsigned index ) const
+        {
+            return Planes[ index ];
+        }
+
+        /** Finds the index of the vertex furthest along the given direction (in the
+         * body frame), hill-climbing from the given start vertex.
+         */
+        unsigned Support( const Quaternion& direction, unsigned start = 0 ) const
+        {
+            unsigned current = start < Vertices.size () ? start : 0;
+            double best = Vertices[ current ].Dot( direction );
+
+            for ( bool climbing = true; climbing; )
+            {
+                climbing = false;
+                for ( unsigned k = First[ current ]; k < First[ current + 1 ]; ++k )
+                {
+                    unsigned next = Adjacency[k];
+                    double value = Vertices[ next ].Dot( direction );
+                    if ( value > best ) {
+                        best = value;
+                        current = next;
+                        climbing = true;
+                        break;
+                    }
+                }
+            }
+
+            return current;
+        }
+
+        /** Gets the moment of inertia of the solid hull with the given mass
+         * (uniform density), about its centroid.
+         */
+        QTensor MomentOfInertia( double mass ) const
+        {
+            return Volume > 0 ? UnitInertia * ( mass / Volume ) : QTensor( QTensor::Zero );
+        }
+
+        /** Sets body mass and moment of inertia of the hull.
+         */
+        void SetMass( double mass )
+        {
+            Body->SetupMass( mass );
+            QTensor I = MomentOfInertia( mass );
+            I.m.ww = 1;
+            Body->SetMomentOfInertia( I );
+            Body->CalculateDerivedQuantities( /*fromMomenta*/ false );
+        }
+
+        /** Holds the radius of the sphere bounding the hull (centered at the centroid).
+         */
+        double Radius;
+
+        /** Holds the volume of the hull.
+         */
+        double Volume;
+
+    private:
+
+        std::vector<Quaternion> Vertices;   //!< Holds the vertices in the body frame
+        std::vector<unsigned>   First;      //!< Holds the first neighbour of a vertex
+        std::vector<unsigned>   Adjacency;  //!< Holds the neighbours of all vertices
+        std::vector<Quaternion> Planes;     //!< Holds the face planes in the body frame
+        QTensor    UnitInertia;             //!< Holds the inertia with unit density
+        Quaternion Offset;                  //!< Holds the centroid of the input points
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_CONVEX_HULL_H_INCLUDED
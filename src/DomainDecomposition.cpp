@@ -0,0 +1,284 @@
+/**
+ *  @file      DomainDecomposition.cpp
+ *  @brief     Implementation of the shared memory mailboxes of the domains and
+ *             the conversion of the bodies to and from the exchanged records.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-03
+ *  @copyright GNU Public License.
+ */
+
+#include "DomainDecomposition.h"
+
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <sched.h>
+#endif
+
+#include <cstring> // we use: memset
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Full memory barrier; orders the message data and the message numbers.
+//
+static inline void MemoryFence ()
+{
+    #ifdef _WIN32
+        MemoryBarrier ();
+    #else
+        __sync_synchronize ();
+    #endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Gives up the rest of the time slice while waiting for a neighbour.
+//
+static inline void YieldProcessor ()
+{
+    #ifdef _WIN32
+        SwitchToThread ();
+    #else
+        sched_yield ();
+    #endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Holds the header of the segment (followed by the mailboxes and the results).
+     */
+    struct DomainHeader
+    {
+        uint32_t Magic;       //!< Holds the segment signature, SharedStateHeader::Tag
+        uint32_t DomainCount; //!< Holds the number of the domains
+        uint32_t Capacity;    //!< Holds the capacity of a message, in records
+        uint32_t BodyCount;   //!< Holds the number of the records in the result table
+
+        enum { Size = 64 };
+    };
+}
+
+DomainExchange::DomainExchange ()
+    : DomainCount( 0 )
+    , Capacity( 0 )
+    , BodyCount( 0 )
+    , Timeout( 10.0 )
+{
+}
+
+bool DomainExchange::Create( const char* name, unsigned domains, unsigned capacity,
+    unsigned bodies, bool replace )
+{
+    DomainCount = domains > 1 ? domains : 1;
+    Capacity    = capacity;
+    BodyCount   = bodies;
+
+    const size_t mailboxSize = sizeof( DomainMailbox )
+                             + 2 * size_t( capacity ) * sizeof( DomainRecord );
+    const size_t length = DomainHeader::Size
+                        + 2 * ( DomainCount - 1 ) * mailboxSize
+                        + size_t( bodies ) * sizeof( DomainRecord );
+
+    if ( ! Segment.Create( name, length, replace ) ) {
+        Printf( "WoRB: Failed to create shared memory segment '%s'\n", name );
+        return false;
+    }
+
+    char* base = (char*)Segment.GetAddress ();
+    memset( base, 0, length );
+
+    DomainHeader* header = (DomainHeader*)base;
+    header->DomainCount = DomainCount;
+    header->Capacity    = Capacity;
+    header->BodyCount   = BodyCount;
+    header->Magic       = SharedStateHeader::Tag;
+
+    return true;
+}
+
+DomainMailbox* DomainExchange::Mailbox( unsigned from, unsigned to ) const
+{
+    // Every boundary has the mailbox to the right followed by the mailbox to the left
+    //
+    const size_t mailboxSize = sizeof( DomainMailbox )
+                             + 2 * size_t( Capacity ) * sizeof( DomainRecord );
+    const unsigned boundary = from < to ? from : to;
+    const unsigned index = 2 * boundary + ( from < to ? 0 : 1 );
+
+    return (DomainMailbox*)( (char*)Segment.GetAddress () + DomainHeader::Size
+                           + index * mailboxSize );
+}
+
+void DomainExchange::Post( unsigned from, unsigned to, unsigned number, unsigned count )
+{
+    DomainMailbox* mailbox = Mailbox( from, to );
+
+    mailbox->Count[ number % 2 ] = count;
+
+    MemoryFence ();
+    mailbox->Number[ number % 2 ] = number;
+}
+
+const DomainRecord* DomainExchange::Receive( unsigned from, unsigned to,
+    unsigned number, unsigned& count ) const
+{
+    DomainMailbox* mailbox = Mailbox( from, to );
+    const unsigned buffer = number % 2;
+
+    double deadline = 0;
+
+    while ( mailbox->Number[ buffer ] != number )
+    {
+        if ( deadline == 0 ) {
+            deadline = MonotonicTime () + Timeout;
+        }
+        else if ( MonotonicTime () > deadline ) {
+            count = 0;
+            return 0;
+        }
+        YieldProcessor ();
+    }
+
+    MemoryFence ();
+    count = mailbox->Count[ buffer ];
+
+    return Records( mailbox, buffer );
+}
+
+DomainRecord* DomainExchange::GetResults () const
+{
+    const size_t mailboxSize = sizeof( DomainMailbox )
+                             + 2 * size_t( Capacity ) * sizeof( DomainRecord );
+
+    return (DomainRecord*)( (char*)Segment.GetAddress () + DomainHeader::Size
+                          + 2 * ( DomainCount - 1 ) * mailboxSize );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void WoRB::PackBody( DomainRecord& record, unsigned id, DomainRecord::RecordKind kind,
+    const Geometry& solid )
+{
+    const RigidBody& body = *solid.Body;
+
+    memset( &record, 0, sizeof( record ) );
+
+    record.Id    = id;
+    record.Kind  = kind;
+    record.Flags = ( body.IsActive ? 1 : 0 ) | ( body.CanBeDeactivated ? 2 : 0 );
+
+    if ( solid.IsSphere () )
+    {
+        record.Shape = 0;
+        record.Extent[0] = static_cast<const Sphere&>( solid ).Radius;
+    }
+    else
+    {
+        const Quaternion& e = static_cast<const Cuboid&>( solid ).HalfExtent;
+        record.Shape = 1;
+        record.Extent[0] = e.x;
+        record.Extent[1] = e.y;
+        record.Extent[2] = e.z;
+    }
+
+    record.Mass = body.Mass ();
+
+    for ( unsigned i = 0; i < 3; ++i ) {
+        record.X[i] = body.Position[i];
+        record.P[i] = body.LinearMomentum[i];
+        record.L[i] = body.AngularMomentum[i];
+    }
+
+    record.Q[0] = body.Orientation.w;
+    record.Q[1] = body.Orientation.x;
+    record.Q[2] = body.Orientation.y;
+    record.Q[3] = body.Orientation.z;
+
+    record.AverageKineticEnergy   = body.AverageKineticEnergy;
+    record.KineticEnergyThreshold = body.KineticEnergyThreshold;
+}
+
+void WoRB::UnpackState( const DomainRecord& record, RigidBody& body )
+{
+    body.Position        = Quaternion( 0, record.X[0], record.X[1], record.X[2] );
+    body.Orientation     = Quaternion( record.Q[0], record.Q[1], record.Q[2], record.Q[3] );
+    body.LinearMomentum  = Quaternion( 0, record.P[0], record.P[1], record.P[2] );
+    body.AngularMomentum = Quaternion( 0, record.L[0], record.L[1], record.L[2] );
+
+    body.IsActive         = ( record.Flags & 1 ) != 0;
+    body.CanBeDeactivated = ( record.Flags & 2 ) != 0;
+
+    body.AverageKineticEnergy   = record.AverageKineticEnergy;
+    body.KineticEnergyThreshold = record.KineticEnergyThreshold;
+
+    body.CalculateDerivedQuantities ();
+}
+
+Geometry* WoRB::CreateBody( const DomainRecord& record )
+{
+    Geometry* solid = 0;
+
+    if ( record.Shape == 0 )
+    {
+        solid = new SolidSphere( 0.0, Quaternion( 1.0 ), 0.0, 0.0,
+            record.Extent[0], record.Mass );
+    }
+    else
+    {
+        solid = new SolidCuboid( 0.0, Quaternion( 1.0 ), 0.0, 0.0,
+            SpatialVector( record.Extent[0], record.Extent[1], record.Extent[2] ),
+            record.Mass );
+    }
+
+    UnpackState( record, *solid->Body );
+
+    return solid;
+}
+
+void WoRB::DeleteBody( Geometry* solid )
+{
+    if ( solid->IsSphere () ) {
+        delete static_cast<SolidSphere*>( static_cast<Sphere*>( solid ) );
+    }
+    else {
+        delete static_cast<SolidCuboid*>( static_cast<Cuboid*>( solid ) );
+    }
+}
+
+void WoRB::PackChange( DomainRecord& record, unsigned id,
+    const RigidBody& before, const RigidBody& after )
+{
+    memset( &record, 0, sizeof( record ) );
+
+    record.Id   = id;
+    record.Kind = DomainRecord::Impulse;
+
+    for ( unsigned i = 0; i < 3; ++i ) {
+        record.X[i] = after.Position[i]        - before.Position[i];
+        record.P[i] = after.LinearMomentum[i]  - before.LinearMomentum[i];
+        record.L[i] = after.AngularMomentum[i] - before.AngularMomentum[i];
+    }
+
+    // The rotation from the orientation without the contacts to the final one
+    //
+    Quaternion dQ = after.Orientation * before.Orientation.Conjugate ();
+    record.Q[0] = dQ.w;
+    record.Q[1] = dQ.x;
+    record.Q[2] = dQ.y;
+    record.Q[3] = dQ.z;
+}
+
+void WoRB::ApplyChange( const DomainRecord& record, RigidBody& body )
+{
+    body.Position        += Quaternion( 0, record.X[0], record.X[1], record.X[2] );
+    body.LinearMomentum  += Quaternion( 0, record.P[0], record.P[1], record.P[2] );
+    body.AngularMomentum += Quaternion( 0, record.L[0], record.L[1], record.L[2] );
+
+    body.Orientation = Quaternion( record.Q[0], record.Q[1], record.Q[2], record.Q[3] )
+                     * body.Orientation;
+
+    body.CalculateDerivedQuantities ();
+}
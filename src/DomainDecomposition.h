@@ -0,0 +1,574 @@
+#ifndef _WORB_DOMAIN_DECOMPOSITION_H_INCLUDED
+#define _WORB_DOMAIN_DECOMPOSITION_H_INCLUDED
+
+/**
+ *  @file      DomainDecomposition.h
+ *  @brief     Definitions for the DomainExchange and Domain classes, which split
+ *             a system of rigid bodies into spatial subdomains simulated by
+ *             separate processes on the same host.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-03
+ *  @copyright GNU Public License.
+ *
+ * The world is cut into slabs along the x-axis and every slab (domain) is simulated
+ * by its own process, with its own WorldOfRigidBodies. Every body has a global id
+ * and is owned by the domain whose slab contains its position.
+ *
+ * Every time-step runs in two exchanges between the neighbouring domains:
+ *
+ * @li Before the time-step, the bodies that crossed a boundary migrate to the
+ *     neighbour (with their full state), and every domain sends to its left
+ *     neighbour the ghost copies of the bodies within GhostWidth of their
+ *     common boundary.
+ * @li After the time-step, every domain sends back to its right neighbour the
+ *     changes of momenta and positions caused by the contacts with the ghosts,
+ *     which the owners apply to their bodies.
+ *
+ * A contact between the bodies of two domains is owned by the left domain: only
+ * the left domain sees the ghosts, and the right domain receives the result.
+ * The ghosts are put in a collision group (see Geometry::Group) together with
+ * the scenery, so that the contacts among the ghosts and between the ghosts and
+ * the scenery are left to their owners.
+ *
+ * The mailboxes of the exchanges are kept in a single shared memory segment:
+ * two mailboxes per boundary (one per direction), each with two message buffers
+ * used alternately, followed by a table where the domains gather the final state
+ * of their bodies. A domain writes the next message into a buffer only after it
+ * has received the neighbour's reply to the previous message in that buffer,
+ * so no buffer is overwritten before it is read.
+ */
+
+#include "SharedState.h"
+
+#include <map>     // we use: std::map
+#include <vector>  // we use: std::vector
+#include <cmath>   // we use: HUGE_VAL
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Holds a body as exchanged between the domains.
+     */
+    struct DomainRecord
+    {
+        /** Enumerates the kinds of the records.
+         */
+        enum RecordKind
+        {
+            Ghost,    //!< A copy of a body near the boundary
+            Migrant,  //!< A body passed to the neighbour, which becomes its owner
+            Impulse,  //!< The changes of a ghost caused by the contacts (P, L, X, Q)
+            Result    //!< The final state of a body, gathered by its owner
+        };
+
+        uint32_t Id;          //!< Holds the global id of the body
+        uint32_t Kind;        //!< Holds the RecordKind
+        uint32_t Shape;       //!< Holds 0 for a sphere and 1 for a cuboid
+        uint32_t Flags;       //!< Holds IsActive (bit 0) and CanBeDeactivated (bit 1)
+        double   Extent[3];   //!< Holds the radius, or the half-extents of a cuboid
+        double   Mass;        //!< Holds the mass of the body, in `kg`
+        double   X[3];        //!< Holds the position (or its change), in `m`
+        double   Q[4];        //!< Holds the orientation (or its change) as (w, x, y, z)
+        double   P[3];        //!< Holds the linear momentum (or its change)
+        double   L[3];        //!< Holds the angular momentum (or its change)
+        double   AverageKineticEnergy;   //!< See RigidBody::AverageKineticEnergy
+        double   KineticEnergyThreshold; //!< See RigidBody::KineticEnergyThreshold
+    };
+
+    /** Holds a mailbox from a domain to its neighbour (followed by the records of
+     * its two message buffers).
+     */
+    struct DomainMailbox
+    {
+        volatile uint32_t Number[2]; //!< Holds the number of the message in the buffer
+        uint32_t Count[2];           //!< Holds the number of the records in the buffer
+        uint32_t Reserved[12];       //!< Reserved; pads the mailbox to a cache line
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Encapsulates the shared memory mailboxes of the domains.
+     *
+     * The segment is created by the parent process before the domain processes
+     * are started (e.g. forked), which inherit the mapping.
+     */
+    class DomainExchange
+    {
+        SharedMemory Segment;  //!< Holds the mapped shared memory segment
+        unsigned DomainCount;  //!< Holds the number of the domains
+        unsigned Capacity;     //!< Holds the capacity of a message, in records
+        unsigned BodyCount;    //!< Holds the capacity of the result table
+
+        /** Gets the mailbox from the domain to its neighbour.
+         */
+        DomainMailbox* Mailbox( unsigned from, unsigned to ) const;
+
+        /** Gets the records of the message buffer of the mailbox.
+         */
+        DomainRecord* Records( DomainMailbox* mailbox, unsigned buffer ) const
+        {
+            return (DomainRecord*)( mailbox + 1 ) + buffer * Capacity;
+        }
+
+    public:
+
+        /** Holds the time a domain waits for a message of its neighbour before
+         * giving up (e.g. if the neighbour has died), in `s`.
+         */
+        double Timeout;
+
+        DomainExchange ();
+
+        /** Creates the segment for the given number of domains, records per message
+         * and bodies in the result table. Fails if the segment exists, unless
+         * `replace` is set (see SharedMemory::Create).
+         */
+        bool Create( const char* name, unsigned domains, unsigned capacity,
+            unsigned bodies, bool replace = false );
+
+        /** Unmaps the segment; it is removed by the process that created it.
+         */
+        void Close ()
+        {
+            Segment.Close ();
+        }
+
+        /** Gets the number of the domains.
+         */
+        unsigned GetDomainCount () const
+        {
+            return DomainCount;
+        }
+
+        /** Gets the capacity of a message, in records.
+         */
+        unsigned GetCapacity () const
+        {
+            return Capacity;
+        }
+
+        /** Gets the buffer for the message with the given number (counted from 1)
+         * from the domain to its neighbour.
+         */
+        DomainRecord* BeginMessage( unsigned from, unsigned to, unsigned number )
+        {
+            return Records( Mailbox( from, to ), number % 2 );
+        }
+
+        /** Posts the message written into the buffer given by BeginMessage.
+         */
+        void Post( unsigned from, unsigned to, unsigned number, unsigned count );
+
+        /** Waits for the message with the given number from the neighbour.
+         * @return the records of the message, or 0 on timeout.
+         */
+        const DomainRecord* Receive( unsigned from, unsigned to, unsigned number,
+            unsigned& count ) const;
+
+        /** Gets the table of the final states, indexed by the body ids.
+         */
+        DomainRecord* GetResults () const;
+
+        /** Gets the number of the records in the table of the final states.
+         */
+        unsigned GetResultCount () const
+        {
+            return BodyCount;
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Writes the shape and the state of the solid sphere or cuboid into the record.
+     */
+    void PackBody( DomainRecord& record, unsigned id, DomainRecord::RecordKind kind,
+        const Geometry& solid );
+
+    /** Copies the state from the record into the body.
+     */
+    void UnpackState( const DomainRecord& record, RigidBody& body );
+
+    /** Creates a solid sphere or cuboid from the record.
+     */
+    Geometry* CreateBody( const DomainRecord& record );
+
+    /** Deletes the solid sphere or cuboid.
+     */
+    void DeleteBody( Geometry* solid );
+
+    /** Writes the changes of the state of the body from `before` into the record.
+     */
+    void PackChange( DomainRecord& record, unsigned id,
+        const RigidBody& before, const RigidBody& after );
+
+    /** Applies the changes of the state in the record to the body.
+     */
+    void ApplyChange( const DomainRecord& record, RigidBody& body );
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Simulates the bodies of a single domain in a world of rigid bodies.
+     *
+     * The domain owns its bodies (solid spheres and cuboids created with `new`):
+     * the bodies that leave the slab are deleted and the bodies that enter it are
+     * created from the records of the neighbours. The objects of the world are
+     * set up by the domain every time-step.
+     */
+    template<class World>
+    class Domain
+    {
+        World& worb;
+        DomainExchange& Exchange;
+
+        unsigned Index;   //!< Holds the index of the domain (from left to right)
+        double   Lower;   //!< Holds the left boundary of the slab (x)
+        double   Upper;   //!< Holds the right boundary of the slab (x)
+        unsigned Message; //!< Holds the number of the last message
+
+        std::vector<Geometry*> Scenery;
+        std::vector<Geometry*> Owned;
+        std::vector<unsigned>  OwnedId;
+
+        /** Holds the ghosts by the ids of their bodies, and their states after
+         * the time-step without the contacts.
+         */
+        std::map<unsigned, Geometry*> Ghosts;
+        std::vector<RigidBody> FreeMotion;
+
+        /** Posts the records to the neighbour and receives the neighbour's message
+         * with the same number.
+         */
+        const DomainRecord* Swap( unsigned neighbour, const std::vector<DomainRecord>& out,
+            unsigned& count )
+        {
+            unsigned n = unsigned( out.size () );
+            if ( n > Exchange.GetCapacity () ) {
+                Printf( "WoRB: Domain %u: message overflow (%u records)\n", Index, n );
+                n = Exchange.GetCapacity ();
+            }
+
+            DomainRecord* buffer = Exchange.BeginMessage( Index, neighbour, Message );
+            for ( unsigned i = 0; i < n; ++i ) {
+                buffer[i] = out[i];
+            }
+            Exchange.Post( Index, neighbour, Message, n );
+
+            return Exchange.Receive( neighbour, Index, Message, count );
+        }
+
+        /** Gets the body of the geometry.
+         */
+        static RigidBody& BodyOf( Geometry* g )
+        {
+            return *g->Body;
+        }
+
+        /** Passes the bodies that left the slab to the neighbours and the ghosts
+         * to the left neighbour; takes over the bodies that entered the slab and
+         * updates the ghosts from the right neighbour.
+         */
+        bool ExchangeBodies ()
+        {
+            ++Message;
+
+            std::vector<DomainRecord> toLeft, toRight;
+            DomainRecord record;
+
+            unsigned kept = 0;
+            for ( unsigned i = 0; i < Owned.size (); ++i )
+            {
+                double x = BodyOf( Owned[i] ).Position.x;
+
+                if ( x < Lower && Index > 0 ) {
+                    PackBody( record, OwnedId[i], DomainRecord::Migrant, *Owned[i] );
+                    toLeft.push_back( record );
+                    DeleteBody( Owned[i] );
+                    continue;
+                }
+                if ( x >= Upper && Index + 1 < Exchange.GetDomainCount () ) {
+                    PackBody( record, OwnedId[i], DomainRecord::Migrant, *Owned[i] );
+                    toRight.push_back( record );
+                    DeleteBody( Owned[i] );
+                    continue;
+                }
+                if ( x < Lower + GhostWidth && Index > 0 ) {
+                    PackBody( record, OwnedId[i], DomainRecord::Ghost, *Owned[i] );
+                    toLeft.push_back( record );
+                }
+
+                Owned[ kept ] = Owned[i];
+                OwnedId[ kept ] = OwnedId[i];
+                ++kept;
+            }
+
+            Owned.resize( kept );
+            OwnedId.resize( kept );
+
+            // The ghosts not sent again are dropped
+            //
+            std::map<unsigned, Geometry*> previous;
+            previous.swap( Ghosts );
+
+            for ( unsigned side = 0; side < 2; ++side )
+            {
+                if ( side == 0 ? Index == 0 : Index + 1 >= Exchange.GetDomainCount () ) {
+                    continue;
+                }
+
+                unsigned count = 0;
+                const DomainRecord* in = side == 0
+                    ? Swap( Index - 1, toLeft, count )
+                    : Swap( Index + 1, toRight, count );
+                if ( ! in ) {
+                    Printf( "WoRB: Domain %u: no message from the neighbour\n", Index );
+                    return false;
+                }
+
+                for ( unsigned i = 0; i < count; ++i )
+                {
+                    if ( in[i].Kind == DomainRecord::Migrant )
+                    {
+                        Owned.push_back( CreateBody( in[i] ) );
+                        OwnedId.push_back( in[i].Id );
+                        continue;
+                    }
+
+                    // Update the ghost in place, so the geometry stays the same
+                    // for the caches of the world
+                    //
+                    std::map<unsigned, Geometry*>::iterator ghost = previous.find( in[i].Id );
+                    if ( ghost != previous.end () ) {
+                        UnpackState( in[i], BodyOf( ghost->second ) );
+                        Ghosts[ in[i].Id ] = ghost->second;
+                        previous.erase( ghost );
+                    }
+                    else {
+                        Geometry* g = CreateBody( in[i] );
+                        g->Group = GhostGroup;
+                        Ghosts[ in[i].Id ] = g;
+                    }
+                }
+            }
+
+            for ( std::map<unsigned, Geometry*>::iterator i = previous.begin ();
+                  i != previous.end (); ++i ) {
+                DeleteBody( i->second );
+            }
+
+            return true;
+        }
+
+        /** Sends the changes of the ghosts caused by the contacts to their owners
+         * (the right neighbour) and applies the changes received from the left
+         * neighbour to the owned bodies.
+         */
+        bool ExchangeImpulses ()
+        {
+            ++Message;
+
+            std::vector<DomainRecord> toRight;
+            DomainRecord record;
+
+            unsigned k = 0;
+            for ( std::map<unsigned, Geometry*>::iterator i = Ghosts.begin ();
+                  i != Ghosts.end (); ++i, ++k )
+            {
+                const RigidBody& after = BodyOf( i->second );
+                if ( ! ( after.LinearMomentum == FreeMotion[k].LinearMomentum )
+                  || ! ( after.Position == FreeMotion[k].Position )
+                  || ! ( after.AngularMomentum == FreeMotion[k].AngularMomentum )
+                  || ! ( after.Orientation == FreeMotion[k].Orientation ) )
+                {
+                    PackChange( record, i->first, FreeMotion[k], after );
+                    toRight.push_back( record );
+                }
+            }
+
+            std::vector<DomainRecord> none;
+
+            for ( unsigned side = 0; side < 2; ++side )
+            {
+                if ( side == 0 ? Index == 0 : Index + 1 >= Exchange.GetDomainCount () ) {
+                    continue;
+                }
+
+                unsigned count = 0;
+                const DomainRecord* in = side == 0
+                    ? Swap( Index - 1, none, count )
+                    : Swap( Index + 1, toRight, count );
+                if ( ! in ) {
+                    Printf( "WoRB: Domain %u: no message from the neighbour\n", Index );
+                    return false;
+                }
+
+                std::map<unsigned, unsigned> slot;
+                for ( unsigned j = 0; count > 0 && j < OwnedId.size (); ++j ) {
+                    slot[ OwnedId[j] ] = j;
+                }
+
+                for ( unsigned i = 0; i < count; ++i )
+                {
+                    std::map<unsigned, unsigned>::iterator j = slot.find( in[i].Id );
+                    if ( j != slot.end () ) {
+                        ApplyChange( in[i], BodyOf( Owned[ j->second ] ) );
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        /** Sets up the objects of the world: the scenery, the owned bodies and
+         * the ghosts.
+         */
+        void SetupWorld ()
+        {
+            worb.RemoveObjects ();
+
+            for ( unsigned i = 0; i < Scenery.size (); ++i ) {
+                worb.Add( Scenery[i] );
+            }
+            for ( unsigned i = 0; i < Owned.size (); ++i ) {
+                worb.Add( Owned[i] );
+            }
+            for ( std::map<unsigned, Geometry*>::iterator i = Ghosts.begin ();
+                  i != Ghosts.end (); ++i ) {
+                worb.Add( i->second );
+            }
+        }
+
+    public:
+
+        /** Holds the collision group of the ghosts and the scenery.
+         */
+        enum { GhostGroup = 0x7FFFFFFF };
+
+        /** Holds the distance from the left boundary within which the bodies are
+         * copied to the left neighbour, in `m`; it has to cover the diameters of
+         * two largest bodies and their motion during a time-step.
+         */
+        double GhostWidth;
+
+        /** Constructs the domain of the slab [lower, upper) along the x-axis;
+         * the outer boundaries of the first and the last domain are ignored.
+         */
+        Domain( World& world, DomainExchange& exchange, unsigned index,
+            double lower, double upper )
+            : worb( world )
+            , Exchange( exchange )
+            , Index( index )
+            , Lower( index == 0 ? -HUGE_VAL : lower )
+            , Upper( index + 1 >= exchange.GetDomainCount () ? HUGE_VAL : upper )
+            , Message( 0 )
+            , GhostWidth( 2.0 )
+        {
+        }
+
+        ~Domain ()
+        {
+            for ( unsigned i = 0; i < Owned.size (); ++i ) {
+                DeleteBody( Owned[i] );
+            }
+            for ( std::map<unsigned, Geometry*>::iterator i = Ghosts.begin ();
+                  i != Ghosts.end (); ++i ) {
+                DeleteBody( i->second );
+            }
+        }
+
+        /** Adds a scenery object (kept by reference; it is put in the ghost group).
+         */
+        void AddScenery( Geometry& object )
+        {
+            object.Group = GhostGroup;
+            Scenery.push_back( &object );
+        }
+
+        /** Adds the body with the given global id, if it is in the slab of
+         * the domain; the domain takes the ownership (otherwise the body is deleted).
+         * The body must be a SolidSphere or a SolidCuboid created with `new`.
+         */
+        void AddBody( unsigned id, Geometry* solid )
+        {
+            double x = solid->Body->Position.x;
+            if ( x < Lower || x >= Upper ) {
+                DeleteBody( solid );
+                return;
+            }
+            Owned.push_back( solid );
+            OwnedId.push_back( id );
+        }
+
+        /** Gets the number of the bodies owned by the domain.
+         */
+        unsigned GetOwnedCount () const
+        {
+            return unsigned( Owned.size () );
+        }
+
+        /** Gets the number of the ghosts in the last time-step.
+         */
+        unsigned GetGhostCount () const
+        {
+            return unsigned( Ghosts.size () );
+        }
+
+        /** Prepares the world (see WorldOfRigidBodies::InitializeODE).
+         */
+        void InitializeODE ()
+        {
+            SetupWorld ();
+            worb.InitializeODE ();
+        }
+
+        /** Performs the time-step `h` of the domain together with the neighbours.
+         * @return false if a neighbour did not respond.
+         */
+        bool SolveODE( double h )
+        {
+            if ( ! ExchangeBodies () ) {
+                return false;
+            }
+
+            SetupWorld ();
+
+            // Move the ghosts without the contacts, as the world would (see
+            // WorldOfRigidBodies::SolveODE), to find the changes caused by
+            // the contacts
+            //
+            FreeMotion.clear ();
+            for ( std::map<unsigned, Geometry*>::iterator i = Ghosts.begin ();
+                  i != Ghosts.end (); ++i )
+            {
+                RigidBody body = BodyOf( i->second );
+                Quaternion f_g = body.Mass () * worb.Gravity;
+                body.AddExternalForce( f_g, - f_g.Dot( body.Position ) );
+                worb.IntegratorMethod.Integrate( body, h );
+                FreeMotion.push_back( body );
+            }
+
+            worb.SolveODE( h );
+
+            return ExchangeImpulses ();
+        }
+
+        /** Writes the final state of the owned bodies into the result table.
+         */
+        void Gather ()
+        {
+            DomainRecord* results = Exchange.GetResults ();
+
+            for ( unsigned i = 0; i < Owned.size (); ++i )
+            {
+                if ( OwnedId[i] < Exchange.GetResultCount () ) {
+                    PackBody( results[ OwnedId[i] ], OwnedId[i],
+                        DomainRecord::Result, *Owned[i] );
+                }
+            }
+        }
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_DOMAIN_DECOMPOSITION_H_INCLUDED
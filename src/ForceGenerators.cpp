@@ -0,0 +1,423 @@
+/**
+ *  @file      ForceGenerators.cpp
+ *  @brief     Implementation of the ForceRegistry class, which holds the springs, drags,
+ *             buoyancies and force fields acting on the rigid bodies.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-03
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+
+#include <cmath>      // we use: sqrt
+#include <algorithm>  // we use: std::min
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+/** Checks whether the forces act on the body (i.e. it is neither kinematic nor static).
+ */
+static inline bool IsForced( const RigidBody* body )
+{
+    return body && ! body->Kinematic && ! body->IsStatic ();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Registration
+
+unsigned ForceRegistry::AddSpring( RigidBody* a, const Quaternion& anchorA,
+    RigidBody* b, const Quaternion& anchorB,
+    double restLength, double stiffness, double damping )
+{
+    Springs& s = SpringSet;
+
+    s.BodyA.push_back( a );
+    s.BodyB.push_back( b );
+    s.AX.push_back( anchorA.x ); s.AY.push_back( anchorA.y ); s.AZ.push_back( anchorA.z );
+    s.BX.push_back( anchorB.x ); s.BY.push_back( anchorB.y ); s.BZ.push_back( anchorB.z );
+    s.RestLength.push_back( restLength );
+    s.Stiffness.push_back( stiffness );
+    s.Damping.push_back( damping );
+
+    return s.Count () - 1;
+}
+
+unsigned ForceRegistry::AddAnchoredSpring( RigidBody* body, const Quaternion& anchor,
+    const Quaternion& worldPoint,
+    double restLength, double stiffness, double damping )
+{
+    return AddSpring( body, anchor, 0, worldPoint, restLength, stiffness, damping );
+}
+
+unsigned ForceRegistry::AddDrag( RigidBody* body, double linear, double quadratic )
+{
+    DragSet.Body.push_back( body );
+    DragSet.Linear.push_back( linear );
+    DragSet.Quadratic.push_back( quadratic );
+
+    return DragSet.Count () - 1;
+}
+
+unsigned ForceRegistry::AddBuoyancy( RigidBody* body, const Quaternion& direction,
+    double offset, double volume, double height, double density )
+{
+    Buoyancies& b = BuoyancySet;
+
+    Quaternion n = direction.Unit ();
+
+    b.Body.push_back( body );
+    b.NX.push_back( n.x ); b.NY.push_back( n.y ); b.NZ.push_back( n.z );
+    b.Offset.push_back( offset );
+    b.Volume.push_back( volume );
+    b.HalfHeight.push_back( 0.5 * height );
+    b.Density.push_back( density );
+
+    return b.Count () - 1;
+}
+
+unsigned ForceRegistry::AddField( RigidBody* body, const Quaternion& acceleration )
+{
+    FieldSet.Body.push_back( body );
+    FieldSet.AX.push_back( acceleration.x );
+    FieldSet.AY.push_back( acceleration.y );
+    FieldSet.AZ.push_back( acceleration.z );
+
+    return FieldSet.Count () - 1;
+}
+
+void ForceRegistry::Clear ()
+{
+    SpringSet   = Springs ();
+    DragSet     = Drags ();
+    BuoyancySet = Buoyancies ();
+    FieldSet    = Fields ();
+}
+
+void ForceRegistry::Relocate( const Relocation& moved )
+{
+    for ( unsigned i = 0; i < SpringSet.Count (); ++i )
+    {
+        SpringSet.BodyA[i] = moved( SpringSet.BodyA[i] );
+        SpringSet.BodyB[i] = moved( SpringSet.BodyB[i] );
+    }
+    for ( unsigned i = 0; i < DragSet.Count (); ++i ) {
+        DragSet.Body[i] = moved( DragSet.Body[i] );
+    }
+    for ( unsigned i = 0; i < BuoyancySet.Count (); ++i ) {
+        BuoyancySet.Body[i] = moved( BuoyancySet.Body[i] );
+    }
+    for ( unsigned i = 0; i < FieldSet.Count (); ++i ) {
+        FieldSet.Body[i] = moved( FieldSet.Body[i] );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Evaluation: the gather loop followed by the loop over the arrays only
+
+void ForceRegistry::SpringBatch( void* context, unsigned begin, unsigned end )
+{
+    Springs& s = static_cast<ForceRegistry*>( context )->SpringSet;
+
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        const RigidBody& a = *s.BodyA[i];
+        Quaternion pA = a.ToWorld( Quaternion( 0, s.AX[i], s.AY[i], s.AZ[i] ) );
+        Quaternion v = a.Velocity + a.AngularVelocity.Cross( pA - a.Position );
+
+        Quaternion pB( 0, s.BX[i], s.BY[i], s.BZ[i] );
+        if ( s.BodyB[i] )
+        {
+            const RigidBody& b = *s.BodyB[i];
+            pB = b.ToWorld( pB );
+            v -= b.Velocity + b.AngularVelocity.Cross( pB - b.Position );
+        }
+
+        s.PAX[i] = pA.x; s.PAY[i] = pA.y; s.PAZ[i] = pA.z;
+        s.PBX[i] = pB.x; s.PBY[i] = pB.y; s.PBZ[i] = pB.z;
+        s.VX[i]  = v.x;  s.VY[i]  = v.y;  s.VZ[i]  = v.z;
+    }
+
+    const double* PAX = &s.PAX[0]; const double* PAY = &s.PAY[0]; const double* PAZ = &s.PAZ[0];
+    const double* PBX = &s.PBX[0]; const double* PBY = &s.PBY[0]; const double* PBZ = &s.PBZ[0];
+    const double* VX = &s.VX[0]; const double* VY = &s.VY[0]; const double* VZ = &s.VZ[0];
+    const double* L0 = &s.RestLength[0];
+    const double* K = &s.Stiffness[0];
+    const double* C = &s.Damping[0];
+    double* FX = &s.FX[0]; double* FY = &s.FY[0]; double* FZ = &s.FZ[0];
+    double* E = &s.Energy[0];
+
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        double dx = PAX[i] - PBX[i];
+        double dy = PAY[i] - PBY[i];
+        double dz = PAZ[i] - PBZ[i];
+
+        double length = sqrt( dx * dx + dy * dy + dz * dz );
+        double inverse = length > 0 ? 1.0 / length : 0.0;
+
+        double stretch = length - L0[i];
+        double rate = ( VX[i] * dx + VY[i] * dy + VZ[i] * dz ) * inverse;
+        double f = ( - K[i] * stretch - C[i] * rate ) * inverse;
+
+        FX[i] = f * dx;
+        FY[i] = f * dy;
+        FZ[i] = f * dz;
+        E[i] = 0.5 * K[i] * stretch * stretch;
+    }
+}
+
+void ForceRegistry::DragBatch( void* context, unsigned begin, unsigned end )
+{
+    Drags& d = static_cast<ForceRegistry*>( context )->DragSet;
+
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        const Quaternion& v = d.Body[i]->Velocity;
+        d.VX[i] = v.x; d.VY[i] = v.y; d.VZ[i] = v.z;
+    }
+
+    const double* VX = &d.VX[0]; const double* VY = &d.VY[0]; const double* VZ = &d.VZ[0];
+    const double* K1 = &d.Linear[0];
+    const double* K2 = &d.Quadratic[0];
+    double* FX = &d.FX[0]; double* FY = &d.FY[0]; double* FZ = &d.FZ[0];
+
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        double speed = sqrt( VX[i] * VX[i] + VY[i] * VY[i] + VZ[i] * VZ[i] );
+        double k = - ( K1[i] + K2[i] * speed );
+
+        FX[i] = k * VX[i];
+        FY[i] = k * VY[i];
+        FZ[i] = k * VZ[i];
+    }
+}
+
+void ForceRegistry::BuoyancyBatch( void* context, unsigned begin, unsigned end )
+{
+    ForceRegistry& self = *static_cast<ForceRegistry*>( context );
+    Buoyancies& b = self.BuoyancySet;
+
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        const Quaternion& x = b.Body[i]->Position;
+        b.Depth[i] = b.Offset[i] - ( b.NX[i] * x.x + b.NY[i] * x.y + b.NZ[i] * x.z );
+    }
+
+    const double g = self.GravityMagnitude;
+    const double* NX = &b.NX[0]; const double* NY = &b.NY[0]; const double* NZ = &b.NZ[0];
+    const double* Depth = &b.Depth[0];
+    const double* H = &b.HalfHeight[0];
+    const double* V = &b.Volume[0];
+    const double* Rho = &b.Density[0];
+    double* FX = &b.FX[0]; double* FY = &b.FY[0]; double* FZ = &b.FZ[0];
+
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        // The submerged fraction of the column
+        //
+        double s = H[i] > 0 ? 0.5 * ( Depth[i] + H[i] ) / H[i] : ( Depth[i] > 0 ? 1 : 0 );
+        s = s < 0 ? 0 : s > 1 ? 1 : s;
+
+        double f = s * Rho[i] * V[i] * g;
+
+        FX[i] = f * NX[i];
+        FY[i] = f * NY[i];
+        FZ[i] = f * NZ[i];
+    }
+}
+
+void ForceRegistry::FieldBatch( void* context, unsigned begin, unsigned end )
+{
+    Fields& f = static_cast<ForceRegistry*>( context )->FieldSet;
+
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        const RigidBody& body = *f.Body[i];
+        f.X[i] = body.Position.x; f.Y[i] = body.Position.y; f.Z[i] = body.Position.z;
+        f.Mass[i] = body.Mass ();
+    }
+
+    const double* AX = &f.AX[0]; const double* AY = &f.AY[0]; const double* AZ = &f.AZ[0];
+    const double* X = &f.X[0]; const double* Y = &f.Y[0]; const double* Z = &f.Z[0];
+    const double* M = &f.Mass[0];
+    double* FX = &f.FX[0]; double* FY = &f.FY[0]; double* FZ = &f.FZ[0];
+    double* E = &f.Energy[0];
+
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        FX[i] = M[i] * AX[i];
+        FY[i] = M[i] * AY[i];
+        FZ[i] = M[i] * AZ[i];
+        E[i] = - ( FX[i] * X[i] + FY[i] * Y[i] + FZ[i] * Z[i] );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Accumulation of the forces on the bodies
+
+void ForceRegistry::SpringScatter( void* context, unsigned begin, unsigned end )
+{
+    const Springs& s = static_cast<ForceRegistry*>( context )->SpringSet;
+
+    // The energy of the spring is split between its bodies
+    //
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        Quaternion F( 0, s.FX[i], s.FY[i], s.FZ[i] );
+        double E = s.BodyB[i] ? 0.5 * s.Energy[i] : s.Energy[i];
+
+        if ( IsForced( s.BodyA[i] ) ) {
+            s.BodyA[i]->AddForceAtPoint(
+                Quaternion( 0, s.PAX[i], s.PAY[i], s.PAZ[i] ), F, E );
+        }
+        if ( IsForced( s.BodyB[i] ) ) {
+            s.BodyB[i]->AddForceAtPoint(
+                Quaternion( 0, s.PBX[i], s.PBY[i], s.PBZ[i] ), -F, E );
+        }
+    }
+}
+
+void ForceRegistry::DragScatter( void* context, unsigned begin, unsigned end )
+{
+    const Drags& d = static_cast<ForceRegistry*>( context )->DragSet;
+
+    for ( unsigned i = begin; i < end; ++i ) {
+        if ( IsForced( d.Body[i] ) ) {
+            d.Body[i]->AddExternalForce( Quaternion( 0, d.FX[i], d.FY[i], d.FZ[i] ) );
+        }
+    }
+}
+
+void ForceRegistry::BuoyancyScatter( void* context, unsigned begin, unsigned end )
+{
+    const Buoyancies& b = static_cast<ForceRegistry*>( context )->BuoyancySet;
+
+    for ( unsigned i = begin; i < end; ++i ) {
+        if ( IsForced( b.Body[i] ) ) {
+            b.Body[i]->AddExternalForce( Quaternion( 0, b.FX[i], b.FY[i], b.FZ[i] ) );
+        }
+    }
+}
+
+void ForceRegistry::FieldScatter( void* context, unsigned begin, unsigned end )
+{
+    const Fields& f = static_cast<ForceRegistry*>( context )->FieldSet;
+
+    for ( unsigned i = begin; i < end; ++i ) {
+        if ( IsForced( f.Body[i] ) ) {
+            f.Body[i]->AddExternalForce(
+                Quaternion( 0, f.FX[i], f.FY[i], f.FZ[i] ), f.Energy[i] );
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Evaluates all the generators and accumulates their forces.
+//
+void ForceRegistry::Evaluate( unsigned count, RangeFunction batch, RangeFunction scatter )
+{
+    // The blocks are accumulated while the states of their bodies are still
+    // in the cache
+    //
+    for ( unsigned begin = 0; begin < count; begin += BlockSize )
+    {
+        unsigned end = std::min( count, begin + BlockSize );
+        batch( this, begin, end );
+        scatter( this, begin, end );
+    }
+}
+
+void ForceRegistry::EvaluateRegion( void* context, unsigned worker, unsigned workers )
+{
+    ForceRegistry& self = *static_cast<ForceRegistry*>( context );
+
+    const unsigned count[4] = {
+        self.SpringSet.Count (), self.DragSet.Count (),
+        self.BuoyancySet.Count (), self.FieldSet.Count ()
+    };
+    const RangeFunction batch[4] = {
+        SpringBatch, DragBatch, BuoyancyBatch, FieldBatch
+    };
+
+    // The generators of a type only read the bodies, so no barrier is needed
+    // between the types
+    //
+    for ( unsigned t = 0; t < 4; ++t )
+    {
+        unsigned begin = unsigned( (unsigned long long)count[t] * worker / workers );
+        unsigned end = unsigned( (unsigned long long)count[t] * ( worker + 1 ) / workers );
+        if ( begin < end ) {
+            batch[t]( context, begin, end );
+        }
+    }
+}
+
+void ForceRegistry::Apply( const Quaternion& gravity )
+{
+    GravityMagnitude = gravity.ImNorm ();
+
+    Springs& s = SpringSet;
+    const unsigned springs = s.Count ();
+    if ( s.FX.size () != springs )
+    {
+        s.PAX.resize( springs ); s.PAY.resize( springs ); s.PAZ.resize( springs );
+        s.PBX.resize( springs ); s.PBY.resize( springs ); s.PBZ.resize( springs );
+        s.VX.resize( springs );  s.VY.resize( springs );  s.VZ.resize( springs );
+        s.FX.resize( springs );  s.FY.resize( springs );  s.FZ.resize( springs );
+        s.Energy.resize( springs );
+    }
+
+    Drags& d = DragSet;
+    const unsigned drags = d.Count ();
+    if ( d.FX.size () != drags )
+    {
+        d.VX.resize( drags ); d.VY.resize( drags ); d.VZ.resize( drags );
+        d.FX.resize( drags ); d.FY.resize( drags ); d.FZ.resize( drags );
+    }
+
+    Buoyancies& b = BuoyancySet;
+    const unsigned buoyancies = b.Count ();
+    if ( b.FX.size () != buoyancies )
+    {
+        b.Depth.resize( buoyancies );
+        b.FX.resize( buoyancies ); b.FY.resize( buoyancies ); b.FZ.resize( buoyancies );
+    }
+
+    Fields& f = FieldSet;
+    const unsigned fields = f.Count ();
+    if ( f.FX.size () != fields )
+    {
+        f.X.resize( fields );  f.Y.resize( fields );  f.Z.resize( fields );
+        f.Mass.resize( fields );
+        f.FX.resize( fields ); f.FY.resize( fields ); f.FZ.resize( fields );
+        f.Energy.resize( fields );
+    }
+
+    // A thread gets at least a block of the instances; with a single thread
+    // (asked for or left by that limit) the blocks are evaluated serially
+    //
+    const unsigned total = springs + drags + buoyancies + fields;
+    const unsigned threads = Threads <= 1 ? 1
+        : std::min( Threads, ( total + BlockSize - 1 ) / BlockSize );
+
+    if ( threads <= 1 )
+    {
+        Evaluate( springs,    SpringBatch,   SpringScatter   );
+        Evaluate( drags,      DragBatch,     DragScatter     );
+        Evaluate( buoyancies, BuoyancyBatch, BuoyancyScatter );
+        Evaluate( fields,     FieldBatch,    FieldScatter    );
+        return;
+    }
+
+    // All the types are evaluated in one parallel region; the forces are added
+    // to the bodies (shared between the instances) afterwards by this thread
+    //
+    ParallelRegion( threads, EvaluateRegion, this );
+
+    SpringScatter  ( this, 0, springs    );
+    DragScatter    ( this, 0, drags      );
+    BuoyancyScatter( this, 0, buoyancies );
+    FieldScatter   ( this, 0, fields     );
+}
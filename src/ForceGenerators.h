@@ -0,0 +1,217 @@
+#ifndef _WORB_FORCE_GENERATORS_H_INCLUDED
+#define _WORB_FORCE_GENERATORS_H_INCLUDED
+
+/**
+ *  @file      ForceGenerators.h
+ *  @brief     Definitions for the ForceRegistry class, which holds the springs, drags,
+ *             buoyancies and force fields acting on the rigid bodies.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-03
+ *  @copyright GNU Public License.
+ */
+
+#include "RigidBody.h"
+
+#include <vector>  // we use: std::vector
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Holds the force generators of a system and applies them before the integration
+     * (see WorldOfRigidBodies::Forces).
+     *
+     * Every type of generator keeps its instances as a structure of arrays. A pass
+     * over the instances first gathers the states of their bodies into the arrays,
+     * then evaluates all the forces in a loop over the arrays only (without branches
+     * on the type and without pointers, so the compiler can vectorize it), both in
+     * parallel over the instances. The forces are then added to the bodies in
+     * a serial loop, since several instances may act on the same body.
+     *
+     * The kinematic and the static bodies are not affected by the forces.
+     * The springs act between the anchor points and wake the bodies, as the internal
+     * forces do (see RigidBody::AddForceAtPoint); the drag, the buoyancy and the fields
+     * act at the centres of mass and do not wake the bodies, as the gravity does.
+     */
+    class ForceRegistry
+    {
+        typedef std::vector<double> Array;
+
+        /** Holds the springs (damped, between the anchor points fixed to the bodies,
+         * or to a body and a fixed point in world).
+         */
+        struct Springs
+        {
+            std::vector<RigidBody*> BodyA, BodyB; //!< BodyB is null for the world
+            Array AX, AY, AZ;   //!< The anchors on A, in body frame
+            Array BX, BY, BZ;   //!< The anchors on B in body frame, or in world
+            Array RestLength, Stiffness, Damping;
+
+            Array PAX, PAY, PAZ; //!< The gathered anchors on A, in world
+            Array PBX, PBY, PBZ; //!< The gathered anchors on B, in world
+            Array VX, VY, VZ;    //!< The gathered relative velocities of the anchors
+            Array FX, FY, FZ;    //!< The forces acting on A (-F acts on B)
+            Array Energy;        //!< The potential energies
+
+            unsigned Count () const { return unsigned( BodyA.size () ); }
+        };
+
+        /** Holds the drags `F = -( k1 + k2 |v| ) v` (linear and quadratic in
+         * the velocity of the centre of mass).
+         */
+        struct Drags
+        {
+            std::vector<RigidBody*> Body;
+            Array Linear, Quadratic;
+
+            Array VX, VY, VZ;  //!< The gathered velocities
+            Array FX, FY, FZ;  //!< The forces
+
+            unsigned Count () const { return unsigned( Body.size () ); }
+        };
+
+        /** Holds the buoyancies of the bodies in a fluid below a plane. The body
+         * is approximated by a column of the given height: the submerged fraction
+         * of its volume grows linearly from 0, with the top of the column at
+         * the surface, to 1, with the bottom of the column at the surface.
+         */
+        struct Buoyancies
+        {
+            std::vector<RigidBody*> Body;
+            Array NX, NY, NZ;  //!< The normal of the surface (pointing out of the fluid)
+            Array Offset;      //!< The offset of the surface along its normal
+            Array Volume, HalfHeight, Density;
+
+            Array Depth;       //!< The gathered depth of the centre of mass
+            Array FX, FY, FZ;  //!< The forces
+
+            unsigned Count () const { return unsigned( Body.size () ); }
+        };
+
+        /** Holds the constant acceleration fields `F = m a` (e.g. wind or a local
+         * gravity), with the potential energy `-F . x`.
+         */
+        struct Fields
+        {
+            std::vector<RigidBody*> Body;
+            Array AX, AY, AZ;  //!< The accelerations
+
+            Array X, Y, Z, Mass; //!< The gathered positions and masses
+            Array FX, FY, FZ;    //!< The forces
+            Array Energy;        //!< The potential energies
+
+            unsigned Count () const { return unsigned( Body.size () ); }
+        };
+
+        Springs     SpringSet;
+        Drags       DragSet;
+        Buoyancies  BuoyancySet;
+        Fields      FieldSet;
+
+        /** Holds the magnitude of the gravity during Apply.
+         */
+        double GravityMagnitude;
+
+        enum { BlockSize = 256 }; //!< The instances evaluated at once by a single thread
+
+        typedef void ( *RangeFunction )( void* context, unsigned begin, unsigned end );
+
+        /** Evaluates the instances of a type (`batch`) and adds their forces to
+         * the bodies (`scatter`) on a single thread, by blocks.
+         */
+        void Evaluate( unsigned count, RangeFunction batch, RangeFunction scatter );
+
+        /** Evaluates the chunk of the worker of the instances of every type
+         * (the forces are added to the bodies after the region).
+         */
+        static void EvaluateRegion( void* context, unsigned worker, unsigned workers );
+
+        static void SpringBatch( void* context, unsigned begin, unsigned end );
+        static void DragBatch( void* context, unsigned begin, unsigned end );
+        static void BuoyancyBatch( void* context, unsigned begin, unsigned end );
+        static void FieldBatch( void* context, unsigned begin, unsigned end );
+
+        static void SpringScatter( void* context, unsigned begin, unsigned end );
+        static void DragScatter( void* context, unsigned begin, unsigned end );
+        static void BuoyancyScatter( void* context, unsigned begin, unsigned end );
+        static void FieldScatter( void* context, unsigned begin, unsigned end );
+
+    public:
+
+        /** Holds the number of the threads evaluating the forces (at most one
+         * per BlockSize instances); 1 evaluates them by blocks on the calling thread.
+         */
+        unsigned Threads;
+
+        ForceRegistry ()
+            : GravityMagnitude( 0 )
+            , Threads( 1 )
+        {
+        }
+
+        /** Adds a spring between the anchors fixed to the bodies (in body frames),
+         * with the force `-k ( l - l_0 ) - c dl/dt` along the spring.
+         * Returns the index of the spring.
+         */
+        unsigned AddSpring( RigidBody* a, const Quaternion& anchorA,
+            RigidBody* b, const Quaternion& anchorB,
+            double restLength, double stiffness, double damping = 0 );
+
+        /** Adds a spring between the anchor fixed to the body (in body frame) and
+         * a fixed point in world. Returns the index of the spring.
+         */
+        unsigned AddAnchoredSpring( RigidBody* body, const Quaternion& anchor,
+            const Quaternion& worldPoint,
+            double restLength, double stiffness, double damping = 0 );
+
+        /** Adds a drag with the linear and the quadratic coefficients (in `kg/s` and
+         * `kg/m`). Returns the index of the drag.
+         */
+        unsigned AddDrag( RigidBody* body, double linear, double quadratic = 0 );
+
+        /** Adds the buoyancy of the body (approximated by a column of the given
+         * volume and height) in a fluid of the given density below the plane
+         * `direction . x = offset`. The buoyancy is opposite to the gravity of
+         * the system, so the direction should point up. Returns the index of
+         * the buoyancy.
+         */
+        unsigned AddBuoyancy( RigidBody* body, const Quaternion& direction, double offset,
+            double volume, double height, double density = 1000 );
+
+        /** Adds a constant acceleration field acting on the body.
+         * Returns the index of the field.
+         */
+        unsigned AddField( RigidBody* body, const Quaternion& acceleration );
+
+        /** Gets the number of the springs, the drags, the buoyancies and the fields.
+         */
+        unsigned SpringCount () const    { return SpringSet.Count (); }
+        unsigned DragCount () const      { return DragSet.Count (); }
+        unsigned BuoyancyCount () const  { return BuoyancySet.Count (); }
+        unsigned FieldCount () const     { return FieldSet.Count (); }
+
+        /** Gets the number of all the generators.
+         */
+        unsigned Count () const
+        {
+            return SpringCount () + DragCount () + BuoyancyCount () + FieldCount ();
+        }
+
+        /** Removes all the generators (e.g. after the bodies were removed).
+         */
+        void Clear ();
+
+        /** Updates the bodies of the generators moved in memory.
+         */
+        void Relocate( const Relocation& moved );
+
+        /** Evaluates all the generators and adds their forces to the bodies
+         * (`gravity` being the gravity of the system, which the buoyancy opposes).
+         */
+        void Apply( const Quaternion& gravity );
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_FORCE_GENERATORS_H_INCLUDED
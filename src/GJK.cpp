@@ -0,0 +1,929 @@
+/**
+ *  @file      GJK.cpp
+ *  @brief     Implementation of the GJK distance query, the EPA penetration query,
+ *             the simplex cache and the persistent contact manifold.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-28
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+
+#include <algorithm> // we use: std::swap, std::min
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+SupportShape::SupportShape( const Geometry& shape,
+    const Quaternion& otherCenter, double otherRadius )
+    : Type( _Point )
+    , Hull( 0 )
+    , Frame( 0 )
+    , Center( shape.Position () )
+    , Margin( 0 )
+    , Hint( 0 )
+{
+    if ( shape.IsSphere () )
+    {
+        Margin = static_cast<const Sphere&>( shape ).Radius;
+    }
+    else if ( shape.IsCuboid () )
+    {
+        Type = _Box;
+        for ( unsigned i = 0; i < 3; ++i ) {
+            Axis[i] = shape.Axis( i );
+            Half[i] = static_cast<const Cuboid&>( shape ).HalfExtent[i];
+        }
+    }
+    else if ( shape.IsConvexHull () )
+    {
+        Type  = _Hull;
+        Hull  = &static_cast<const ConvexHull&>( shape );
+        Frame = &shape.Transform ();
+    }
+    else if ( shape.IsHalfSpace () || shape.IsTruePlane () )
+    {
+        // Clip the plane to a square around the projection of the other shape
+        //
+        Quaternion N = shape.IsHalfSpace ()
+            ? static_cast<const HalfSpace&>( shape ).Direction
+            : static_cast<const TruePlane&>( shape ).Direction;
+        double offset = shape.IsHalfSpace ()
+            ? static_cast<const HalfSpace&>( shape ).Offset
+            : static_cast<const TruePlane&>( shape ).Offset;
+
+        double size = ( otherRadius > 0 ? otherRadius : 0 ) + 1;
+        Quaternion tangent = N.Cross( fabs( N.x ) < 0.9 ? Quaternion( 0, 1, 0, 0 )
+                                                        : Quaternion( 0, 0, 1, 0 ) );
+        Type = _Box;
+        Axis[0] = N;
+        Axis[1] = tangent.Unit ();
+        Axis[2] = N.Cross( Axis[1] );
+        Half[0] = shape.IsHalfSpace () ? size : 0; // The true plane has no thickness
+        Half[1] = size;
+        Half[2] = size;
+
+        Center = otherCenter - ( N.Dot( otherCenter ) - offset + Half[0] ) * N;
+        Center.w = 0;
+    }
+}
+
+SupportShape::SupportShape( const Quaternion& A, const Quaternion& B, const Quaternion& C )
+    : Type( _Triangle )
+    , Hull( 0 )
+    , Frame( 0 )
+    , Center( ( A + B + C ) * ( 1.0 / 3.0 ) )
+    , Margin( 0 )
+    , Hint( 0 )
+{
+    Axis[0] = A;
+    Axis[1] = B;
+    Axis[2] = C;
+}
+
+SupportShape::SupportShape( const Quaternion& center, const Quaternion& halfExtent,
+    double margin )
+    : Type( _Box )
+    , Hull( 0 )
+    , Frame( 0 )
+    , Center( center )
+    , Margin( margin )
+    , Hint( 0 )
+{
+    Axis[0] = Const::X;
+    Axis[1] = Const::Y;
+    Axis[2] = Const::Z;
+    for ( unsigned i = 0; i < 3; ++i ) {
+        Half[i] = halfExtent[i];
+    }
+}
+
+Quaternion SupportShape::Support( const Quaternion& d ) const
+{
+    switch( Type )
+    {
+        case _Point:
+            return Center;
+
+        case _Box:
+            return Center
+                + ( d.Dot( Axis[0] ) >= 0 ? Half[0] : -Half[0] ) * Axis[0]
+                + ( d.Dot( Axis[1] ) >= 0 ? Half[1] : -Half[1] ) * Axis[1]
+                + ( d.Dot( Axis[2] ) >= 0 ? Half[2] : -Half[2] ) * Axis[2];
+
+        case _Hull:
+        {
+            // Rotate the direction into the hull frame and climb from the last vertex
+            //
+            Quaternion local( 0, d.Dot( Frame->Column(0) ),
+                                 d.Dot( Frame->Column(1) ),
+                                 d.Dot( Frame->Column(2) ) );
+            Hint = Hull->Support( local, Hint );
+            return (*Frame)( Hull->GetVertex( Hint ) );
+        }
+
+        case _Triangle:
+        {
+            double a = d.Dot( Axis[0] ), b = d.Dot( Axis[1] ), c = d.Dot( Axis[2] );
+            return a >= b ? ( a >= c ? Axis[0] : Axis[2] ) : ( b >= c ? Axis[1] : Axis[2] );
+        }
+    }
+
+    return Center;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Holds a point of the Minkowski difference A - B with the points of A and B
+     * and the direction in which it was found.
+     */
+    struct SupportPoint
+    {
+        Quaternion W, A, B, Direction;
+    };
+
+    /** Finds the point of A - B furthest along the direction.
+     */
+    SupportPoint Support( const SupportShape& A, const SupportShape& B,
+        const Quaternion& direction )
+    {
+        SupportPoint p;
+        p.A = A.Support( direction );
+        p.B = B.Support( -direction );
+        p.W = p.A - p.B;
+        p.Direction = direction;
+        return p;
+    }
+
+    /** Holds the GJK simplex with the barycentric coordinates of the point closest
+     * to the origin.
+     */
+    struct Simplex
+    {
+        SupportPoint P[4];
+        double Lambda[4];
+        unsigned Count;
+
+        Quaternion Set( const SupportPoint& a )
+        {
+            P[0] = a; Lambda[0] = 1; Count = 1;
+            return a.W;
+        }
+
+        Quaternion Set( const SupportPoint& a, const SupportPoint& b, double u, double v )
+        {
+            P[0] = a; P[1] = b; Lambda[0] = u; Lambda[1] = v; Count = 2;
+            return u * a.W + v * b.W;
+        }
+
+        Quaternion Set( const SupportPoint& a, const SupportPoint& b, const SupportPoint& c,
+            double u, double v, double w )
+        {
+            P[0] = a; P[1] = b; P[2] = c;
+            Lambda[0] = u; Lambda[1] = v; Lambda[2] = w; Count = 3;
+            return u * a.W + v * b.W + w * c.W;
+        }
+    };
+
+    /** Reduces the segment to the feature closest to the origin.
+     */
+    Quaternion SolveSegment( Simplex& s, SupportPoint a, SupportPoint b )
+    {
+        Quaternion ab = b.W - a.W;
+        double length = ab.ImSquaredNorm ();
+        double t = length > 0 ? -a.W.Dot( ab ) / length : 0;
+
+        return t <= 0 ? s.Set( a ) : t >= 1 ? s.Set( b ) : s.Set( a, b, 1 - t, t );
+    }
+
+    /** Reduces the triangle to the feature closest to the origin.
+     * See Ericson, Real-Time Collision Detection, Section 5.1.5.
+     */
+    Quaternion SolveTriangle( Simplex& s, SupportPoint a, SupportPoint b, SupportPoint c )
+    {
+        Quaternion ab = b.W - a.W, ac = c.W - a.W;
+
+        double d1 = -ab.Dot( a.W ), d2 = -ac.Dot( a.W );
+        if ( d1 <= 0 && d2 <= 0 ) {
+            return s.Set( a );
+        }
+
+        double d3 = -ab.Dot( b.W ), d4 = -ac.Dot( b.W );
+        if ( d3 >= 0 && d4 <= d3 ) {
+            return s.Set( b );
+        }
+
+        double vc = d1 * d4 - d3 * d2;
+        if ( vc <= 0 && d1 >= 0 && d3 <= 0 ) {
+            double t = d1 / ( d1 - d3 );
+            return s.Set( a, b, 1 - t, t );
+        }
+
+        double d5 = -ab.Dot( c.W ), d6 = -ac.Dot( c.W );
+        if ( d6 >= 0 && d5 <= d6 ) {
+            return s.Set( c );
+        }
+
+        double vb = d5 * d2 - d1 * d6;
+        if ( vb <= 0 && d2 >= 0 && d6 <= 0 ) {
+            double t = d2 / ( d2 - d6 );
+            return s.Set( a, c, 1 - t, t );
+        }
+
+        double va = d3 * d6 - d5 * d4;
+        if ( va <= 0 && ( d4 - d3 ) >= 0 && ( d5 - d6 ) >= 0 ) {
+            double t = ( d4 - d3 ) / ( ( d4 - d3 ) + ( d5 - d6 ) );
+            return s.Set( b, c, 1 - t, t );
+        }
+
+        double sum = va + vb + vc;
+        if ( sum <= 1e-300 ) {
+            return SolveSegment( s, a, b ); // Degenerate triangle
+        }
+
+        double v = vb / sum, w = vc / sum;
+        return s.Set( a, b, c, 1 - v - w, v, w );
+    }
+
+    /** Reduces the tetrahedron to the feature closest to the origin; keeps it
+     * if the origin is inside.
+     */
+    Quaternion SolveTetrahedron( Simplex& s )
+    {
+        static const unsigned face[4][4] = {
+            { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 }
+        };
+
+        SupportPoint p[4] = { s.P[0], s.P[1], s.P[2], s.P[3] };
+
+        bool inside = true;
+        double best = Const::Max;
+        Simplex closest;
+        Quaternion v;
+
+        for ( unsigned f = 0; f < 4; ++f )
+        {
+            const SupportPoint& a = p[ face[f][0] ];
+            const SupportPoint& b = p[ face[f][1] ];
+            const SupportPoint& c = p[ face[f][2] ];
+            const SupportPoint& d = p[ face[f][3] ];
+
+            // Skip the faces with the origin on the same side as the opposite vertex
+            //
+            Quaternion n = ( b.W - a.W ).Cross( c.W - a.W );
+            if ( n.Dot( -a.W ) * n.Dot( d.W - a.W ) > 0 ) {
+                continue;
+            }
+
+            inside = false;
+
+            Simplex t;
+            Quaternion q = SolveTriangle( t, a, b, c );
+            if ( q.ImSquaredNorm () < best ) {
+                best = q.ImSquaredNorm ();
+                closest = t;
+                v = q;
+            }
+        }
+
+        if ( inside ) {
+            return Quaternion( 0, 0, 0, 0 );
+        }
+
+        s = closest;
+        return v;
+    }
+
+    /** Reduces the simplex to the feature closest to the origin.
+     * @return the point of the simplex closest to the origin.
+     */
+    Quaternion Solve( Simplex& s )
+    {
+        switch( s.Count )
+        {
+            case 1:  return s.Set( s.P[0] );
+            case 2:  return SolveSegment( s, s.P[0], s.P[1] );
+            case 3:  return SolveTriangle( s, s.P[0], s.P[1], s.P[2] );
+            default: return SolveTetrahedron( s );
+        }
+    }
+
+    /** Adds the point unless it is already in the simplex.
+     * @return false if the point is a duplicate.
+     */
+    bool Add( Simplex& s, const SupportPoint& p )
+    {
+        for ( unsigned i = 0; i < s.Count; ++i ) {
+            if ( ( s.P[i].W - p.W ).ImSquaredNorm () < 1e-20 ) {
+                return false;
+            }
+        }
+        s.P[ s.Count++ ] = p;
+        return true;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Expands the simplex containing the origin to a tetrahedron.
+     * @return false if A - B is flat (has no volume).
+     */
+    bool BlowUp( const SupportShape& A, const SupportShape& B, Simplex& s )
+    {
+        static const Quaternion axis[6] = {
+            Quaternion( 0, 1, 0, 0 ), Quaternion( 0, -1,  0,  0 ),
+            Quaternion( 0, 0, 1, 0 ), Quaternion( 0,  0, -1,  0 ),
+            Quaternion( 0, 0, 0, 1 ), Quaternion( 0,  0,  0, -1 )
+        };
+
+        if ( s.Count == 0 ) {
+            s.P[ s.Count++ ] = Support( A, B, axis[0] );
+        }
+
+        for ( unsigned i = 0; s.Count == 1 && i < 6; ++i ) {
+            SupportPoint p = Support( A, B, axis[i] );
+            if ( ( p.W - s.P[0].W ).ImSquaredNorm () > 1e-16 ) {
+                s.P[ s.Count++ ] = p;
+            }
+        }
+
+        if ( s.Count == 2 )
+        {
+            // Search in the directions perpendicular to the segment
+            //
+            Quaternion d = s.P[1].W - s.P[0].W;
+            unsigned k = fabs( d.x ) < fabs( d.y ) ? ( fabs( d.x ) < fabs( d.z ) ? 0 : 4 )
+                                                   : ( fabs( d.y ) < fabs( d.z ) ? 2 : 4 );
+            Quaternion e1 = d.Cross( axis[k] ).Unit ();
+            Quaternion e2 = d.Cross( e1 ).Unit ();
+            Quaternion dir[4] = { e1, -e1, e2, -e2 };
+
+            for ( unsigned i = 0; s.Count == 2 && i < 4; ++i ) {
+                SupportPoint p = Support( A, B, dir[i] );
+                if ( ( p.W - s.P[0].W ).Cross( d ).ImSquaredNorm () > 1e-16 * d.ImSquaredNorm () ) {
+                    s.P[ s.Count++ ] = p;
+                }
+            }
+        }
+
+        if ( s.Count == 3 )
+        {
+            // Search along the normal of the triangle
+            //
+            Quaternion n = ( s.P[1].W - s.P[0].W ).Cross( s.P[2].W - s.P[0].W );
+            Quaternion dir[2] = { n, -n };
+
+            for ( unsigned i = 0; s.Count == 3 && i < 2; ++i ) {
+                SupportPoint p = Support( A, B, dir[i] );
+                if ( fabs( n.Dot( p.W - s.P[0].W ) ) > 1e-8 * n.ImNorm () ) {
+                    s.P[ s.Count++ ] = p;
+                }
+            }
+        }
+
+        return s.Count == 4;
+    }
+
+    /** Implements the Expanding Polytope Algorithm: expands the polytope A - B
+     * from the tetrahedron containing the origin towards the face of A - B closest
+     * to the origin.
+     */
+    class Polytope
+    {
+        enum { MaxVertices = 72, MaxFaces = 192, MaxEdges = 96, MaxIterations = 64 };
+
+        struct Face
+        {
+            unsigned I[3];
+            Quaternion Normal;
+            double Distance;
+        };
+
+        SupportPoint Vertex[ MaxVertices ];
+        Face Faces[ MaxFaces ];
+        unsigned Edge[ MaxEdges ][2];
+        unsigned VertexCount, FaceCount, EdgeCount;
+
+        void AddFace( unsigned a, unsigned b, unsigned c )
+        {
+            Face& f = Faces[ FaceCount++ ];
+            f.I[0] = a; f.I[1] = b; f.I[2] = c;
+
+            Quaternion n = ( Vertex[b].W - Vertex[a].W ).Cross( Vertex[c].W - Vertex[a].W );
+            double length = n.ImNorm ();
+
+            if ( length > 1e-300 ) {
+                f.Normal = n * ( 1.0 / length );
+                f.Distance = f.Normal.Dot( Vertex[a].W );
+            }
+            else {
+                f.Normal = Quaternion( 0, 0, 0, 0 );
+                f.Distance = Const::Max; // Degenerate face; never the closest one
+            }
+        }
+
+        void AddEdge( unsigned a, unsigned b )
+        {
+            // The edge shared by two removed faces is not on the horizon
+            //
+            for ( unsigned i = 0; i < EdgeCount; ++i ) {
+                if ( Edge[i][0] == b && Edge[i][1] == a ) {
+                    --EdgeCount;
+                    Edge[i][0] = Edge[ EdgeCount ][0];
+                    Edge[i][1] = Edge[ EdgeCount ][1];
+                    return;
+                }
+            }
+            if ( EdgeCount < MaxEdges ) {
+                Edge[ EdgeCount ][0] = a;
+                Edge[ EdgeCount ][1] = b;
+                ++EdgeCount;
+            }
+        }
+
+    public:
+
+        /** Finds the normal (pointing from the origin towards the closest face),
+         * the depth and the witness points on the cores of A and B.
+         */
+        void Expand( const SupportShape& A, const SupportShape& B, const Simplex& s,
+            Quaternion& normal, double& depth, Quaternion& pointA, Quaternion& pointB )
+        {
+            VertexCount = FaceCount = 0;
+
+            for ( unsigned i = 0; i < 4; ++i ) {
+                Vertex[ VertexCount++ ] = s.P[i];
+            }
+
+            // Orient the faces of the tetrahedron outwards
+            //
+            if ( ( Vertex[1].W - Vertex[0].W ).Cross( Vertex[2].W - Vertex[0].W )
+                    .Dot( Vertex[3].W - Vertex[0].W ) > 0 ) {
+                std::swap( Vertex[1], Vertex[2] );
+            }
+
+            AddFace( 0, 1, 2 );
+            AddFace( 0, 3, 1 );
+            AddFace( 0, 2, 3 );
+            AddFace( 1, 3, 2 );
+
+            unsigned closest = 0;
+
+            for ( unsigned iteration = 0; ; ++iteration )
+            {
+                closest = 0;
+                for ( unsigned i = 1; i < FaceCount; ++i ) {
+                    if ( Faces[i].Distance < Faces[ closest ].Distance ) {
+                        closest = i;
+                    }
+                }
+
+                if ( iteration >= MaxIterations || VertexCount >= MaxVertices ) {
+                    break;
+                }
+
+                const Face& face = Faces[ closest ];
+                SupportPoint p = Support( A, B, face.Normal );
+
+                if ( p.W.Dot( face.Normal ) - face.Distance
+                        <= 1e-6 * ( 1 + fabs( face.Distance ) ) ) {
+                    break; // Converged; the face is on the surface of A - B
+                }
+
+                // Remove the faces visible from the new point, collecting the horizon
+                //
+                EdgeCount = 0;
+                for ( unsigned i = FaceCount; i-- > 0; )
+                {
+                    const Face& f = Faces[i];
+                    if ( f.Normal.Dot( p.W - Vertex[ f.I[0] ].W ) > 1e-12 )
+                    {
+                        AddEdge( f.I[0], f.I[1] );
+                        AddEdge( f.I[1], f.I[2] );
+                        AddEdge( f.I[2], f.I[0] );
+                        Faces[i] = Faces[ --FaceCount ];
+                    }
+                }
+
+                if ( FaceCount + EdgeCount > MaxFaces || EdgeCount == 0 ) {
+                    break; // Should not happen; keep the best face found so far
+                }
+
+                unsigned index = VertexCount++;
+                Vertex[ index ] = p;
+
+                for ( unsigned i = 0; i < EdgeCount; ++i ) {
+                    AddFace( Edge[i][0], Edge[i][1], index );
+                }
+            }
+
+            const Face& face = Faces[ closest ];
+            normal = face.Normal;
+            depth  = face.Distance;
+
+            // The witness points from the barycentric coordinates of the projection
+            // of the origin on the closest face
+            //
+            const SupportPoint& a = Vertex[ face.I[0] ];
+            const SupportPoint& b = Vertex[ face.I[1] ];
+            const SupportPoint& c = Vertex[ face.I[2] ];
+
+            Quaternion v0 = b.W - a.W, v1 = c.W - a.W, v2 = depth * normal - a.W;
+            double d00 = v0.Dot( v0 ), d01 = v0.Dot( v1 ), d11 = v1.Dot( v1 );
+            double d20 = v2.Dot( v0 ), d21 = v2.Dot( v1 );
+            double denom = d00 * d11 - d01 * d01;
+
+            double v = 0, w = 0;
+            if ( fabs( denom ) > 1e-300 ) {
+                v = ( d11 * d20 - d01 * d21 ) / denom;
+                w = ( d00 * d21 - d01 * d20 ) / denom;
+            }
+            double u = 1 - v - w;
+
+            pointA = u * a.A + v * b.A + w * c.A;
+            pointB = u * a.B + v * b.B + w * c.B;
+        }
+    };
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+bool WoRB::ConvexQuery( const SupportShape& A, const SupportShape& B,
+    ConvexContact& result, SimplexState* state )
+{
+    enum { MaxIterations = 64 };
+
+    const double margin = A.Margin + B.Margin;
+
+    Simplex s;
+    s.Count = 0;
+
+    // Warm start from the directions of the last simplex
+    //
+    Quaternion v = A.Center - B.Center;
+
+    if ( state )
+    {
+        for ( unsigned i = 0; i < state->DirectionCount; ++i ) {
+            Add( s, Support( A, B, state->Direction[i] ) );
+        }
+        if ( s.Count > 0 ) {
+            v = Solve( s );
+        }
+    }
+
+    if ( s.Count == 0 && v.ImSquaredNorm () < 1e-20 ) {
+        v = Quaternion( 0, 1, 0, 0 );
+    }
+
+    // Iterate towards the point of A - B closest to the origin
+    //
+    bool overlap = false;
+    bool separated = false;
+    result.Iterations = 0;
+
+    while ( result.Iterations < MaxIterations )
+    {
+        double vv = v.ImSquaredNorm ();
+
+        if ( s.Count == 4 || ( s.Count > 0 && vv < 1e-20 ) ) {
+            overlap = true; // The origin is in the simplex; the cores overlap
+            break;
+        }
+
+        SupportPoint p = Support( A, B, -v );
+        ++result.Iterations;
+
+        double vw = v.Dot( p.W );
+
+        if ( vw > 0 && vw * vw > vv * margin * margin ) {
+            separated = true; // v separates the shapes (with their margins)
+            break;
+        }
+
+        if ( s.Count > 0 && vv - vw <= 1e-10 + 1e-6 * vv ) {
+            break; // Converged; v is the closest point
+        }
+
+        if ( ! Add( s, p ) ) {
+            break; // No progress
+        }
+
+        v = Solve( s );
+    }
+
+    if ( state )
+    {
+        state->DirectionCount = s.Count;
+        for ( unsigned i = 0; i < s.Count; ++i ) {
+            state->Direction[i] = s.P[i].Direction;
+        }
+    }
+
+    if ( separated ) {
+        result.Penetration = -1;
+        return false;
+    }
+
+    if ( ! overlap )
+    {
+        // The cores are apart; the shapes touch if the distance is within the margins
+        //
+        double distance = v.ImNorm ();
+        if ( distance > margin || s.Count == 0 ) {
+            result.Penetration = margin - distance;
+            return false;
+        }
+
+        Quaternion pointA, pointB;
+        for ( unsigned i = 0; i < s.Count; ++i ) {
+            pointA += s.Lambda[i] * s.P[i].A;
+            pointB += s.Lambda[i] * s.P[i].B;
+        }
+
+        result.Normal = v * ( 1.0 / distance );
+        result.PointA = pointA - A.Margin * result.Normal;
+        result.PointB = pointB + B.Margin * result.Normal;
+        result.Penetration = margin - distance;
+        return true;
+    }
+
+    // The cores overlap; find the penetration with EPA
+    //
+    if ( s.Count < 4 && ! BlowUp( A, B, s ) ) {
+        result.Penetration = -1;
+        return false;
+    }
+
+    Polytope polytope;
+    Quaternion normal, pointA, pointB;
+    double depth;
+    polytope.Expand( A, B, s, normal, depth, pointA, pointB );
+
+    // Moving A by -depth * normal separates the cores
+    //
+    result.Normal = -normal;
+    result.PointA = pointA - A.Margin * result.Normal;
+    result.PointB = pointB + B.Margin * result.Normal;
+    result.Penetration = depth + margin;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+SimplexState& SimplexCache::Find( const Geometry* A, const Geometry* B )
+{
+    SimplexState& state = Entries[ Key( A, B ) ];
+
+    if ( state.LastFrame + 1 < Frame ) {
+        state.DirectionCount = 0; // Not used in the last time-step; start anew
+        state.PointCount = 0;
+    }
+    state.LastFrame = Frame;
+
+    return state;
+}
+
+void SimplexCache::Relocate( const Relocation& moved )
+{
+    Map entries;
+    for ( Map::const_iterator i = Entries.begin (); i != Entries.end (); ++i ) {
+        entries[ Key( moved( i->first.first ), moved( i->first.second ) ) ] = i->second;
+    }
+    Entries.swap( entries );
+}
+
+void SimplexCache::NextFrame ()
+{
+    enum { EvictionPeriod = 32 };
+
+    if ( ++Frame % EvictionPeriod != 0 ) {
+        return;
+    }
+
+    for ( Map::iterator i = Entries.begin (); i != Entries.end (); )
+    {
+        if ( i->second.LastFrame + EvictionPeriod < Frame ) {
+            Entries.erase( i++ );
+        }
+        else {
+            ++i;
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Reduces the manifold to four points: the deepest one and the three points
+     * spanning the largest area with it.
+     */
+    void ReduceManifold( Quaternion* worldA, Quaternion* worldB, unsigned count,
+        const Quaternion& N, Quaternion* localA, Quaternion* localB )
+    {
+        unsigned keep[4] = { 0, 0, 0, 0 };
+
+        double best = -Const::Max;
+        for ( unsigned i = 0; i < count; ++i ) {
+            double depth = ( worldB[i] - worldA[i] ).Dot( N );
+            if ( depth > best ) { best = depth; keep[0] = i; }
+        }
+
+        best = -1;
+        for ( unsigned i = 0; i < count; ++i ) {
+            double d = ( worldA[i] - worldA[ keep[0] ] ).ImSquaredNorm ();
+            if ( d > best ) { best = d; keep[1] = i; }
+        }
+
+        best = -1;
+        for ( unsigned i = 0; i < count; ++i ) {
+            double area = ( worldA[ keep[1] ] - worldA[ keep[0] ] )
+                   .Cross( worldA[i] - worldA[ keep[0] ] ).ImSquaredNorm ();
+            if ( area > best ) { best = area; keep[2] = i; }
+        }
+
+        best = -1;
+        for ( unsigned i = 0; i < count; ++i )
+        {
+            double d = Const::Max;
+            for ( unsigned k = 0; k < 3; ++k ) {
+                d = std::min( d, ( worldA[i] - worldA[ keep[k] ] ).ImSquaredNorm () );
+            }
+            if ( d > best ) { best = d; keep[3] = i; }
+        }
+
+        Quaternion tempA[4], tempB[4];
+        for ( unsigned k = 0; k < 4; ++k ) {
+            tempA[k] = localA[ keep[k] ];
+            tempB[k] = localB[ keep[k] ];
+        }
+        for ( unsigned k = 0; k < 4; ++k ) {
+            localA[k] = tempA[k];
+            localB[k] = tempB[k];
+        }
+    }
+}
+
+unsigned WoRB::ConvexCheck( CollisionResolver& owner, const Geometry& geometryA,
+    const Geometry& geometryB )
+{
+    if ( ! owner.HasSpaceForMoreContacts () ) {
+        return 0;
+    }
+
+    // The geometry with a body is A; two scenery geometries never collide
+    //
+    const Geometry* A = &geometryA;
+    const Geometry* B = &geometryB;
+    if ( ! A->Body ) {
+        std::swap( A, B );
+    }
+    if ( ! A->Body ) {
+        return 0;
+    }
+
+    // Test the bounding spheres first
+    //
+    Quaternion centerA = A->Position ();
+    Quaternion centerB = B->Position ();
+    double radiusA = BoundingRadius( *A );
+    double radiusB = BoundingRadius( *B );
+
+    if ( radiusB >= 0 )
+    {
+        double reach = radiusA + radiusB;
+        if ( ( centerA - centerB ).ImSquaredNorm () > reach * reach ) {
+            return 0;
+        }
+    }
+    else if ( B->IsHalfSpace () )
+    {
+        const HalfSpace& plane = static_cast<const HalfSpace&>( *B );
+        if ( plane.Direction.Dot( centerA ) - plane.Offset > radiusA ) {
+            return 0;
+        }
+    }
+    else if ( B->IsTruePlane () )
+    {
+        const TruePlane& plane = static_cast<const TruePlane&>( *B );
+        if ( fabs( plane.Direction.Dot( centerA ) - plane.Offset ) > radiusA ) {
+            return 0;
+        }
+    }
+    else {
+        return 0; // Not a convex geometry
+    }
+
+    SupportShape shapeA( *A, centerB, radiusB );
+    SupportShape shapeB( *B, centerA, radiusA );
+
+    SimplexCache& cache = owner.Simplices;
+    SimplexState& state = cache.Find( A, B );
+
+    if ( ! cache.WarmStart ) {
+        state.DirectionCount = 0;
+        state.HintA = state.HintB = 0;
+    }
+
+    shapeA.Hint = state.HintA;
+    shapeB.Hint = state.HintB;
+
+    ConvexContact contact;
+    bool touching = ConvexQuery( shapeA, shapeB, contact, &state );
+
+    state.HintA = shapeA.Hint;
+    state.HintB = shapeB.Hint;
+
+    ++cache.Queries;
+    cache.Iterations += contact.Iterations;
+
+    if ( ! touching ) {
+        state.PointCount = 0;
+        return 0;
+    }
+
+    const Quaternion& N = contact.Normal;
+
+    // Refresh the persistent manifold: drop the points that separated or slid
+    // apart, or that are close to the new point; then add the new point
+    //
+    const double SeparationTolerance = 0.01;
+    const double DriftTolerance = 0.02;
+
+    const QTensor* frameA = &A->Transform ();
+    const QTensor* frameB = B->Body ? &B->Transform () : 0;
+
+    Quaternion worldA[ SimplexState::MaxPoints + 1 ];
+    Quaternion worldB[ SimplexState::MaxPoints + 1 ];
+    unsigned count = 0;
+
+    for ( unsigned i = 0; i < state.PointCount; ++i )
+    {
+        Quaternion pA = (*frameA)( state.LocalA[i] );
+        Quaternion pB = frameB ? (*frameB)( state.LocalB[i] ) : state.LocalB[i];
+
+        Quaternion d = pB - pA;
+        double depth = d.Dot( N );
+        Quaternion drift = d - depth * N;
+
+        if ( depth < -SeparationTolerance
+            || drift.ImSquaredNorm () > DriftTolerance * DriftTolerance
+            || ( pA - contact.PointA ).ImSquaredNorm () < DriftTolerance * DriftTolerance ) {
+            continue;
+        }
+
+        state.LocalA[ count ] = state.LocalA[i];
+        state.LocalB[ count ] = state.LocalB[i];
+        worldA[ count ] = pA;
+        worldB[ count ] = pB;
+        ++count;
+    }
+
+    Quaternion localA[ SimplexState::MaxPoints + 1 ];
+    Quaternion localB[ SimplexState::MaxPoints + 1 ];
+    for ( unsigned i = 0; i < count; ++i ) {
+        localA[i] = state.LocalA[i];
+        localB[i] = state.LocalB[i];
+    }
+
+    localA[ count ] = frameA->TransformInverse( contact.PointA );
+    localB[ count ] = frameB ? frameB->TransformInverse( contact.PointB ) : contact.PointB;
+    worldA[ count ] = contact.PointA;
+    worldB[ count ] = contact.PointB;
+    ++count;
+
+    if ( count > SimplexState::MaxPoints )
+    {
+        ReduceManifold( worldA, worldB, count, N, localA, localB );
+        count = SimplexState::MaxPoints;
+
+        for ( unsigned i = 0; i < count; ++i ) {
+            worldA[i] = (*frameA)( localA[i] );
+            worldB[i] = frameB ? (*frameB)( localB[i] ) : localB[i];
+        }
+    }
+
+    state.PointCount = count;
+    for ( unsigned i = 0; i < count; ++i ) {
+        state.LocalA[i] = localA[i];
+        state.LocalB[i] = localB[i];
+    }
+
+    // Register the penetrating points
+    //
+    unsigned contacts = 0;
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        double depth = ( worldB[i] - worldA[i] ).Dot( N );
+        if ( depth > 0 ) {
+            contacts += owner.RegisterNewContact( A->Body, B->Body,
+                0.5 * ( worldA[i] + worldB[i] ), N, depth );
+        }
+    }
+
+    return contacts;
+}
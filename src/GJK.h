@@ -0,0 +1,210 @@
+#ifndef _WORB_GJK_H_INCLUDED
+#define _WORB_GJK_H_INCLUDED
+
+/**
+ *  @file      GJK.h
+ *  @brief     Definitions for the generic convex narrowphase: support mappings,
+ *             the GJK distance/overlap query, EPA penetration and the simplex cache.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-28
+ *  @copyright GNU Public License.
+ */
+
+#include "Geometry.h"
+
+#include <map>     // we use: std::map
+#include <utility> // we use: std::pair
+
+namespace WoRB
+{
+    class ConvexHull;
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Represents a convex geometry in the world frame by its support mapping,
+     * i.e. the point of the geometry furthest along a given direction.
+     *
+     * A shape consists of a core (a point, a box, a convex hull or a triangle)
+     * inflated by a margin: a sphere is a point with a margin equal to its radius.
+     * The unbounded geometries are clipped around the other shape of the pair:
+     * a half-space becomes a cube below the plane surface and a true plane becomes
+     * a flat square, both large enough to contain the other shape's footprint.
+     */
+    class SupportShape
+    {
+        enum Kind { _Point, _Box, _Hull, _Triangle };
+
+        Kind Type;               //!< Holds the kind of the core
+        Quaternion Axis[3];      //!< Holds the box axes or the triangle corners
+        double Half[3];          //!< Holds the box half-extents
+        const ConvexHull* Hull;  //!< Points to the hull geometry
+        const QTensor* Frame;    //!< Points to the hull transform
+
+    public:
+
+        /** Makes the support mapping of the geometry; the unbounded geometries
+         * are clipped around the sphere with the given center and radius.
+         */
+        SupportShape( const Geometry& shape, const Quaternion& otherCenter, double otherRadius );
+
+        /** Makes the support mapping of the triangle ABC.
+         */
+        SupportShape( const Quaternion& A, const Quaternion& B, const Quaternion& C );
+
+        /** Makes the support mapping of the axis-aligned box with the given center
+         * and half-extents, inflated by the margin (a sphere if the half-extents
+         * are zero).
+         */
+        SupportShape( const Quaternion& center, const Quaternion& halfExtent, double margin );
+
+        /** Gets the point of the core furthest along the given direction.
+         */
+        Quaternion Support( const Quaternion& direction ) const;
+
+        /** Holds a point inside the core.
+         */
+        Quaternion Center;
+
+        /** Holds the margin around the core.
+         */
+        double Margin;
+
+        /** Holds the last support vertex of a hull (the start of the hill-climbing).
+         */
+        mutable unsigned Hint;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Holds the result of the GJK/EPA query between two convex shapes A and B.
+     */
+    struct ConvexContact
+    {
+        Quaternion Normal;    //!< Holds the unit normal pointing from B towards A
+        Quaternion PointA;    //!< Holds the point on the surface of A closest to B
+        Quaternion PointB;    //!< Holds the point on the surface of B closest to A
+        double Penetration;   //!< Holds the penetration depth (negative if apart)
+        unsigned Iterations;  //!< Holds the number of GJK iterations
+    };
+
+    /** Holds the state kept between the time-steps for a pair of convex geometries.
+     */
+    struct SimplexState
+    {
+        enum { MaxPoints = 4 };
+
+        /** Holds the directions of the support points of the last GJK simplex.
+         */
+        Quaternion Direction[4];
+        unsigned DirectionCount;
+
+        /** Holds the last support vertices of the hulls.
+         */
+        unsigned HintA, HintB;
+
+        /** Holds the persistent contact manifold as the pairs of points in
+         * the frames of A and B (or in the world frame for the scenery).
+         */
+        Quaternion LocalA[ MaxPoints ];
+        Quaternion LocalB[ MaxPoints ];
+        unsigned PointCount;
+
+        /** Holds the number of the frame in which the state was last used.
+         */
+        unsigned LastFrame;
+
+        SimplexState ()
+            : DirectionCount( 0 ), HintA( 0 ), HintB( 0 ), PointCount( 0 ), LastFrame( 0 )
+        {
+        }
+    };
+
+    /** Caches the GJK simplices and the contact manifolds per pair of geometries,
+     * so that the queries between resting geometries start from the last simplex.
+     */
+    class SimplexCache
+    {
+        typedef std::pair<const Geometry*, const Geometry*> Key;
+        typedef std::map<Key, SimplexState> Map;
+
+        Map Entries;
+        unsigned Frame;
+
+    public:
+
+        /** Indicates whether GJK starts from the last simplex of the pair.
+         * If disabled, every query starts from scratch (the contact manifolds
+         * are kept regardless).
+         */
+        bool WarmStart;
+
+        /** Holds the number of GJK queries.
+         */
+        unsigned long Queries;
+
+        /** Holds the total number of GJK iterations.
+         */
+        unsigned long Iterations;
+
+        SimplexCache ()
+            : Frame( 1 ), WarmStart( true ), Queries( 0 ), Iterations( 0 )
+        {
+        }
+
+        /** Finds (or creates) the state of the pair; the state not used in the last
+         * time-step is reset.
+         */
+        SimplexState& Find( const Geometry* A, const Geometry* B );
+
+        /** Advances to the next time-step, periodically evicting the unused states.
+         */
+        void NextFrame ();
+
+        /** Updates the geometries of the states moved in memory.
+         */
+        void Relocate( const Relocation& moved );
+
+        /** Removes all the states and clears the statistics.
+         */
+        void Clear ()
+        {
+            Entries.clear ();
+            Queries = Iterations = 0;
+        }
+
+        /** Gets the number of cached states.
+         */
+        unsigned Count () const
+        {
+            return unsigned( Entries.size () );
+        }
+
+        /** Gets the average number of GJK iterations per query.
+         */
+        double AverageIterations () const
+        {
+            return Queries ? double( Iterations ) / Queries : 0.0;
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Runs GJK (and EPA if the cores overlap) between the shapes. If the state is
+     * given, the query is warm-started from its simplex and the simplex is stored
+     * back into it.
+     * @return true if the shapes (including their margins) touch or overlap.
+     */
+    bool ConvexQuery( const SupportShape& A, const SupportShape& B,
+        ConvexContact& result, SimplexState* state = 0 );
+
+    /** Checks for collision between two convex geometries (spheres, cuboids,
+     * convex hulls, half-spaces and true planes) using GJK/EPA, maintaining
+     * a persistent contact manifold of up to four points in the simplex cache.
+     * @return the number of registered contacts.
+     */
+    unsigned ConvexCheck( CollisionResolver& owner, const Geometry& A, const Geometry& B );
+
+} // namespace WoRB
+
+#endif // _WORB_GJK_H_INCLUDED
@@ -16,6 +16,11 @@
 namespace WoRB 
 {
     class CollisionResolver;
+    class CandidatePairs;
+    class TriangleMesh;
+    class ConvexHull;
+    struct Ray;
+    struct QueryHit;
 
     void Printf( const char* format, ... );
 
@@ -26,6 +31,8 @@ namespace WoRB
      */
     class Geometry
     {
+        friend class CandidatePairs;
+
     protected:
 
         enum GeometryClass
@@ -33,7 +40,11 @@ namespace WoRB
             _Sphere,
             _Cuboid,
             _HalfSpace,
-            _TruePlane
+            _TruePlane,
+            _TriangleMesh,
+            _HeightField,
+            _ConvexHull,
+            _Compound
         };
 
         /** Holds the geometry class of the object.
@@ -45,6 +56,9 @@ namespace WoRB
         Geometry( GeometryClass type, RigidBody* body = 0 )
             : Class( type )
             , Body( body )
+            , Frame( 0 )
+            , Sensor( false )
+            , Group( 0 )
         {
         }
 
@@ -54,6 +68,10 @@ namespace WoRB
         bool IsSphere ()    const { return Class == _Sphere;    }
         bool IsHalfSpace () const { return Class == _HalfSpace; }
         bool IsTruePlane () const { return Class == _TruePlane; }
+        bool IsTriangleMesh () const { return Class == _TriangleMesh; }
+        bool IsHeightField () const { return Class == _HeightField; }
+        bool IsConvexHull () const { return Class == _ConvexHull; }
+        bool IsCompound ()  const { return Class == _Compound;  }
 
         /** Returns class of the geometry as a string.
          */
@@ -65,6 +83,10 @@ namespace WoRB
                 case _Cuboid:    return "Cuboid";
                 case _HalfSpace: return "HalfSpace";
                 case _TruePlane: return "TruePlane";
+                case _TriangleMesh: return "TriangleMesh";
+                case _HeightField: return "HeightField";
+                case _ConvexHull: return "ConvexHull";
+                case _Compound:  return "Compound";
             }
             return "(unknown)";
         }
@@ -74,13 +96,37 @@ namespace WoRB
          */
         RigidBody* Body;
 
+        /** The transform from the geometry's own frame into the world frame, if it
+         * differs from the body's (e.g. a child of a Compound); null otherwise.
+         */
+        const QTensor* Frame;
+
+        /** Indicates whether the geometry is a sensor (trigger volume): it takes part
+         * in the broadphase and the overlap tests, but never registers collisions;
+         * the geometries entering and leaving it are reported by TriggerVolumes.
+         * A static sensor (without a body) is placed by its Frame.
+         */
+        bool Sensor;
+
+        /** Holds the collision group of the geometry; the geometries of the same
+         * non-zero group never collide with each other.
+         */
+        unsigned Group;
+
+        /** Gets the transform from the geometry's frame into the world frame.
+         */
+        const QTensor& Transform () const
+        {
+            return Frame ? *Frame : Body->ToWorld;
+        }
+
         /** Gets the position vector of the geometry.
          */
         Quaternion Position () const
         {
             // Column with index 3 holds the position
             //
-            return Body ? Body->ToWorld.Column(3) : 0.0; 
+            return Frame ? Frame->Column(3) : Body ? Body->ToWorld.Column(3) : 0.0; 
         }
 
         /** Gets the unit base vector (axes) of the geometry, given by the index.
@@ -89,7 +135,7 @@ namespace WoRB
         {
             // Axes are columns of the q-tensor with indices 0-2
             //
-            return Body ? Body->ToWorld.Column( index ) : 0.0;
+            return Frame ? Frame->Column( index ) : Body ? Body->ToWorld.Column( index ) : 0.0;
         }
 
         /////////////////////////////////////////////////////////////////////////////////
@@ -171,15 +217,20 @@ namespace WoRB
             return ( 4.0/3.0 * Const::Pi ) * Radius * Radius * Radius;
         }
 
+        /** Gets the principal moment of inertia of the sphere with the given mass.
+         */
+        QTensor MomentOfInertia( double mass ) const
+        {
+            double Ixx = (2.0/5.0) * mass * Radius * Radius;
+            return QTensor( Ixx, Ixx, Ixx );
+        }
+
         /** Sets body mass and principal moment of inertia of the sphere.
          */
         void SetMass( double mass )
         {
             Body->SetupMass( mass );
-
-            double Ixx = (2.0/5.0) * mass * Radius * Radius;
-            Body->SetMomentOfInertia( QTensor( Ixx, Ixx, Ixx ) );
-
+            Body->SetMomentOfInertia( MomentOfInertia( mass ) );
             Body->CalculateDerivedQuantities( /*fromMomenta*/ false );
         }
 
@@ -247,21 +298,26 @@ namespace WoRB
             return 8.0 * HalfExtent.x * HalfExtent.y * HalfExtent.z;
         }
 
-        /** Sets body mass and principal moment of inertia of the cuboid.
+        /** Gets the principal moment of inertia of the cuboid with the given mass.
          */
-        void SetMass( double mass )
+        QTensor MomentOfInertia( double mass ) const
         {
-            Body->SetupMass( mass );
-
             Quaternion extent = 2.0 * HalfExtent;
             Quaternion sq = extent.ComponentWiseProduct( extent );
 
-            Body->SetMomentOfInertia( QTensor(
+            return QTensor(
                 mass * ( sq.y + sq.z ) / 12,
                 mass * ( sq.x + sq.z ) / 12,
                 mass * ( sq.x + sq.y ) / 12
-            ) );
+            );
+        }
 
+        /** Sets body mass and principal moment of inertia of the cuboid.
+         */
+        void SetMass( double mass )
+        {
+            Body->SetupMass( mass );
+            Body->SetMomentOfInertia( MomentOfInertia( mass ) );
             Body->CalculateDerivedQuantities( /*fromMomenta*/ false );
         }
 
@@ -281,6 +337,23 @@ namespace WoRB
             return distance <= plane.Offset;
         }
 
+        /** Tests for the overlap of this and some other cuboid on the face axes only
+         * (the first six axes of the SAT); false means that they are separated.
+         */
+        bool IntersectsOnFaceAxes( const Cuboid& B ) const
+        {
+            Quaternion displacement = B.Position() - Position();
+
+            // The touching cuboids overlap, as in CheckOverlapOnAxis
+            //
+            return GetPenetrationOnAxis( B, Axis(0),   displacement ) >= 0
+                && GetPenetrationOnAxis( B, Axis(1),   displacement ) >= 0
+                && GetPenetrationOnAxis( B, Axis(2),   displacement ) >= 0
+                && GetPenetrationOnAxis( B, B.Axis(0), displacement ) >= 0
+                && GetPenetrationOnAxis( B, B.Axis(1), displacement ) >= 0
+                && GetPenetrationOnAxis( B, B.Axis(2), displacement ) >= 0;
+        }
+
         /** Tests for intersection between this and some other cuboid.
          */
         bool Intersects( const Cuboid& B ) const
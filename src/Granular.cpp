@@ -0,0 +1,648 @@
+/**
+ *  @file      Granular.cpp
+ *  @brief     Implementation of the discrete element (soft-sphere) granular system.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-01
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+
+#include <cmath>  // we use: sqrt, log, floor
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** The partner codes of the walls and the obstacles in the friction history;
+     * the particles are coded by their indices.
+     */
+    const unsigned WallPartner     = 0x80000000u;
+    const unsigned ObstaclePartner = 0xC0000000u;
+
+    /** Holds the contact law parameters of a force pass.
+     */
+    struct Material
+    {
+        double k;     //!< The normal stiffness
+        double kt;    //!< The tangential stiffness
+        double zeta;  //!< The damping ratio
+        double mu;    //!< The friction coefficient
+        double h;     //!< The time-step
+    };
+
+    /** Holds the forces accumulated on a particle and its friction history.
+     */
+    struct Accumulator
+    {
+        double fx, fy, fz;   //!< The force
+        double tx, ty, tz;   //!< The torque
+        double radius;       //!< The radius of the particle
+
+        const unsigned* oldPartner; //!< The springs of the last time-step
+        const double* oldX;
+        const double* oldY;
+        const double* oldZ;
+        unsigned oldCount;
+
+        unsigned* partner;   //!< The springs being written
+        double* sx;
+        double* sy;
+        double* sz;
+        unsigned capacity;   //!< The number of the slots
+        unsigned count;      //!< The number of the contacts found
+    };
+
+    /** Applies the spring-dashpot contact law to the contact with the partner.
+     * The unit normal (nx,ny,nz) points toward the particle, (vx,vy,vz) is the velocity
+     * of the particle relative to the partner at the contact point and `inverseMass`
+     * is the sum of the inverse masses.
+     */
+    void Contact( Accumulator& acc, const Material& m, unsigned partner,
+        double nx, double ny, double nz, double overlap,
+        double vx, double vy, double vz, double inverseMass )
+    {
+        double effectiveMass = 1 / inverseMass;
+
+        // Normal spring-dashpot (no attraction)
+        //
+        double vn = vx * nx + vy * ny + vz * nz;
+        double fn = m.k * overlap - 2 * m.zeta * sqrt( m.k * effectiveMass ) * vn;
+        if ( fn < 0 ) {
+            fn = 0;
+        }
+
+        // The tangential spring of the last time-step, rotated to the current
+        // tangent plane with its length kept
+        //
+        double sx = 0, sy = 0, sz = 0;
+        for ( unsigned s = 0; s < acc.oldCount; ++s )
+        {
+            if ( acc.oldPartner[s] == partner )
+            {
+                sx = acc.oldX[s]; sy = acc.oldY[s]; sz = acc.oldZ[s];
+
+                double length2 = sx * sx + sy * sy + sz * sz;
+                double sn = sx * nx + sy * ny + sz * nz;
+                sx -= sn * nx; sy -= sn * ny; sz -= sn * nz;
+
+                double projected2 = sx * sx + sy * sy + sz * sz;
+                if ( projected2 > 0 ) {
+                    double scale = sqrt( length2 / projected2 );
+                    sx *= scale; sy *= scale; sz *= scale;
+                }
+                break;
+            }
+        }
+
+        // Stretch the spring by the sliding during the time-step
+        //
+        double tx = vx - vn * nx, ty = vy - vn * ny, tz = vz - vn * nz;
+        sx += tx * m.h; sy += ty * m.h; sz += tz * m.h;
+
+        double gamma_t = 2 * m.zeta * sqrt( m.kt * effectiveMass );
+        double ftx = -m.kt * sx - gamma_t * tx;
+        double fty = -m.kt * sy - gamma_t * ty;
+        double ftz = -m.kt * sz - gamma_t * tz;
+
+        // Coulomb limit: the contact slides and the spring is kept at the limit
+        //
+        double ft2 = ftx * ftx + fty * fty + ftz * ftz;
+        double limit = m.mu * fn;
+        if ( ft2 > limit * limit )
+        {
+            double scale = limit / sqrt( ft2 );
+            ftx *= scale; fty *= scale; ftz *= scale;
+
+            if ( m.kt > 0 ) {
+                sx = -( ftx + gamma_t * tx ) / m.kt;
+                sy = -( fty + gamma_t * ty ) / m.kt;
+                sz = -( ftz + gamma_t * tz ) / m.kt;
+            }
+        }
+
+        acc.fx += fn * nx + ftx;
+        acc.fy += fn * ny + fty;
+        acc.fz += fn * nz + ftz;
+
+        // The torque of the tangential force acting at -r n
+        //
+        acc.tx -= acc.radius * ( ny * ftz - nz * fty );
+        acc.ty -= acc.radius * ( nz * ftx - nx * ftz );
+        acc.tz -= acc.radius * ( nx * fty - ny * ftx );
+
+        // Keep the spring, if there is a free slot
+        //
+        if ( acc.count < acc.capacity )
+        {
+            acc.partner[ acc.count ] = partner;
+            acc.sx[ acc.count ] = sx;
+            acc.sy[ acc.count ] = sy;
+            acc.sz[ acc.count ] = sz;
+        }
+
+        ++acc.count;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void GranularSystem::Clear ()
+{
+    X.clear (); Y.clear (); Z.clear ();
+    VX.clear (); VY.clear (); VZ.clear ();
+    WX.clear (); WY.clear (); WZ.clear ();
+    QW.clear (); QX.clear (); QY.clear (); QZ.clear ();
+    FX.clear (); FY.clear (); FZ.clear ();
+    TX.clear (); TY.clear (); TZ.clear ();
+    Radius.clear ();
+    InverseMass.clear ();
+    InverseInertia.clear ();
+
+    for ( unsigned k = 0; k < 2; ++k )
+    {
+        Partner[k].clear ();
+        SpringX[k].clear (); SpringY[k].clear (); SpringZ[k].clear ();
+    }
+
+    ContactCount.clear ();
+    TestCount.clear ();
+    CellOf.clear ();
+    Sorted.clear ();
+
+    Walls.clear ();
+    Obstacles.clear ();
+
+    Contacts = 0;
+}
+
+/** Moves the array to new memory of its exact size (placed by its allocator).
+ */
+template<class Array>
+static void Reallocate( Array& array )
+{
+    Array( array.begin (), array.end () ).swap( array );
+}
+
+void GranularSystem::Distribute ()
+{
+    Reallocate( X ); Reallocate( Y ); Reallocate( Z );
+    Reallocate( VX ); Reallocate( VY ); Reallocate( VZ );
+    Reallocate( WX ); Reallocate( WY ); Reallocate( WZ );
+    Reallocate( QW ); Reallocate( QX ); Reallocate( QY ); Reallocate( QZ );
+    Reallocate( FX ); Reallocate( FY ); Reallocate( FZ );
+    Reallocate( TX ); Reallocate( TY ); Reallocate( TZ );
+    Reallocate( Radius );
+    Reallocate( InverseMass );
+    Reallocate( InverseInertia );
+
+    for ( unsigned k = 0; k < 2; ++k )
+    {
+        Reallocate( Partner[k] );
+        Reallocate( SpringX[k] ); Reallocate( SpringY[k] ); Reallocate( SpringZ[k] );
+    }
+
+    Reallocate( ContactCount );
+    Reallocate( TestCount );
+    Reallocate( CellOf );
+}
+
+unsigned GranularSystem::Add( const Quaternion& position, const Quaternion& velocity,
+    double radius, double mass )
+{
+    double inverseMass = mass > 0 ? 1 / mass : 0;
+
+    X.push_back( position.x ); Y.push_back( position.y ); Z.push_back( position.z );
+    VX.push_back( velocity.x ); VY.push_back( velocity.y ); VZ.push_back( velocity.z );
+    WX.push_back( 0 ); WY.push_back( 0 ); WZ.push_back( 0 );
+    QW.push_back( 1 ); QX.push_back( 0 ); QY.push_back( 0 ); QZ.push_back( 0 );
+    FX.push_back( 0 ); FY.push_back( 0 ); FZ.push_back( 0 );
+    TX.push_back( 0 ); TY.push_back( 0 ); TZ.push_back( 0 );
+    Radius.push_back( radius );
+    InverseMass.push_back( inverseMass );
+    InverseInertia.push_back( 2.5 * inverseMass / ( radius * radius ) ); // 2/5 m r^2
+
+    for ( unsigned k = 0; k < 2; ++k )
+    {
+        Partner[k].resize( Partner[k].size () + MaxHistory );
+        SpringX[k].resize( SpringX[k].size () + MaxHistory );
+        SpringY[k].resize( SpringY[k].size () + MaxHistory );
+        SpringZ[k].resize( SpringZ[k].size () + MaxHistory );
+    }
+
+    ContactCount.push_back( 0 );
+    TestCount.push_back( 0 );
+
+    return Count () - 1;
+}
+
+unsigned GranularSystem::Add( const Sphere& sphere, double mass )
+{
+    const RigidBody* body = sphere.Body;
+
+    if ( ! body ) {
+        return Add( sphere.Position (), 0.0, sphere.Radius, mass );
+    }
+
+    unsigned i = Add( sphere.Position (), body->Velocity, sphere.Radius,
+        body->InverseMass > 0 ? 1 / body->InverseMass : 0 );
+
+    WX[i] = body->AngularVelocity.x;
+    WY[i] = body->AngularVelocity.y;
+    WZ[i] = body->AngularVelocity.z;
+
+    QW[i] = body->Orientation.w;
+    QX[i] = body->Orientation.x;
+    QY[i] = body->Orientation.y;
+    QZ[i] = body->Orientation.z;
+
+    return i;
+}
+
+void GranularSystem::ClearHistory ()
+{
+    for ( unsigned i = 0; i < Count (); ++i ) {
+        ContactCount[i] = 0;
+    }
+}
+
+double GranularSystem::ContactDuration () const
+{
+    double maxInverseMass = 0;
+    for ( unsigned i = 0; i < Count (); ++i )
+    {
+        if ( InverseMass[i] > maxInverseMass ) {
+            maxInverseMass = InverseMass[i];
+        }
+    }
+
+    if ( maxInverseMass <= 0 || Stiffness <= 0 ) {
+        return 0;
+    }
+
+    // Half the period of the undamped oscillator of two such particles
+    //
+    return Const::Pi * sqrt( 0.5 / ( maxInverseMass * Stiffness ) );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void GranularSystem::BuildCells ()
+{
+    const unsigned N = Count ();
+
+    double lo[3] = { X[0], Y[0], Z[0] };
+    double hi[3] = { X[0], Y[0], Z[0] };
+    double maxRadius = 0;
+
+    for ( unsigned i = 0; i < N; ++i )
+    {
+        double p[3] = { X[i], Y[i], Z[i] };
+        for ( unsigned a = 0; a < 3; ++a )
+        {
+            if ( p[a] < lo[a] ) lo[a] = p[a];
+            if ( p[a] > hi[a] ) hi[a] = p[a];
+        }
+        if ( Radius[i] > maxRadius ) {
+            maxRadius = Radius[i];
+        }
+    }
+
+    // The cells are as large as the largest particle, so the contacts are only
+    // between the neighbouring cells. If the particles are scattered, the cells
+    // grow to keep the grid at a few cells per particle.
+    //
+    CellSize = maxRadius > 0 ? 2 * maxRadius : 1;
+    const double maxCells = 4.0 * N + 64;
+
+    for ( ;; )
+    {
+        double total = 1;
+        for ( unsigned a = 0; a < 3; ++a ) {
+            total *= floor( ( hi[a] - lo[a] ) / CellSize ) + 1;
+        }
+        if ( total <= maxCells ) {
+            break;
+        }
+        CellSize *= 1.26;
+    }
+
+    for ( unsigned a = 0; a < 3; ++a )
+    {
+        Origin[a] = lo[a];
+        Cells[a]  = int( floor( ( hi[a] - lo[a] ) / CellSize ) ) + 1;
+    }
+
+    const unsigned cellCount = unsigned( Cells[0] * Cells[1] * Cells[2] );
+
+    // Counting sort of the particles by cell
+    //
+    CellOf.resize( N );
+    Sorted.resize( N );
+    CellStart.assign( cellCount + 1, 0 );
+
+    for ( unsigned i = 0; i < N; ++i )
+    {
+        unsigned cell = unsigned( CellCoordinate( X[i], 0 )
+            + Cells[0] * ( CellCoordinate( Y[i], 1 ) + Cells[1] * CellCoordinate( Z[i], 2 ) ) );
+
+        CellOf[i] = cell;
+        ++CellStart[ cell + 1 ];
+    }
+
+    for ( unsigned c = 0; c < cellCount; ++c ) {
+        CellStart[ c + 1 ] += CellStart[c];
+    }
+
+    std::vector<unsigned> next( CellStart.begin (), CellStart.end () - 1 );
+    for ( unsigned i = 0; i < N; ++i ) {
+        Sorted[ next[ CellOf[i] ]++ ] = i;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void GranularSystem::CalculateForces( unsigned begin, unsigned end, double h )
+{
+    Material m = { Stiffness, Stiffness * TangentialStiffness, DampingRatio, Friction, h };
+
+    const unsigned old = 1 - Current;
+
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        const unsigned slots = i * MaxHistory;
+
+        Accumulator acc = {
+            0, 0, 0, 0, 0, 0, Radius[i],
+            &Partner[old][slots], &SpringX[old][slots], &SpringY[old][slots],
+            &SpringZ[old][slots],
+            ContactCount[i] < MaxHistory ? ContactCount[i] : MaxHistory,
+            &Partner[Current][slots], &SpringX[Current][slots], &SpringY[Current][slots],
+            &SpringZ[Current][slots],
+            MaxHistory, 0
+        };
+
+        const double xi = X[i], yi = Y[i], zi = Z[i];
+        const double ri = Radius[i];
+        const double im = InverseMass[i];
+        unsigned tests = 0;
+
+        // The particles in the neighbouring cells
+        //
+        const int cx = CellCoordinate( xi, 0 );
+        const int cy = CellCoordinate( yi, 1 );
+        const int cz = CellCoordinate( zi, 2 );
+
+        for ( int z = cz - 1; z <= cz + 1; ++z )
+        {
+            if ( z < 0 || z >= Cells[2] ) continue;
+
+            for ( int y = cy - 1; y <= cy + 1; ++y )
+            {
+                if ( y < 0 || y >= Cells[1] ) continue;
+
+                for ( int x = cx - 1; x <= cx + 1; ++x )
+                {
+                    if ( x < 0 || x >= Cells[0] ) continue;
+
+                    unsigned cell = unsigned( x + Cells[0] * ( y + Cells[1] * z ) );
+
+                    for ( unsigned k = CellStart[cell]; k < CellStart[ cell + 1 ]; ++k )
+                    {
+                        unsigned j = Sorted[k];
+                        if ( j == i ) {
+                            continue;
+                        }
+
+                        ++tests;
+
+                        double dx = xi - X[j], dy = yi - Y[j], dz = zi - Z[j];
+                        double reach = ri + Radius[j];
+                        double d2 = dx * dx + dy * dy + dz * dz;
+
+                        if ( d2 >= reach * reach || d2 <= 0 ) {
+                            continue;
+                        }
+
+                        double inverseMass = im + InverseMass[j];
+                        if ( inverseMass <= 0 ) {
+                            continue;
+                        }
+
+                        double d = sqrt( d2 );
+                        double nx = dx / d, ny = dy / d, nz = dz / d;
+
+                        // v_i - v_j - ( r_i w_i + r_j w_j ) x n
+                        //
+                        double rj = Radius[j];
+                        double wx = ri * WX[i] + rj * WX[j];
+                        double wy = ri * WY[i] + rj * WY[j];
+                        double wz = ri * WZ[i] + rj * WZ[j];
+
+                        Contact( acc, m, j, nx, ny, nz, reach - d,
+                            VX[i] - VX[j] - ( wy * nz - wz * ny ),
+                            VY[i] - VY[j] - ( wz * nx - wx * nz ),
+                            VZ[i] - VZ[j] - ( wx * ny - wy * nx ),
+                            inverseMass );
+                    }
+                }
+            }
+        }
+
+        // The scenery
+        //
+        if ( im > 0 )
+        {
+            for ( unsigned w = 0; w < Walls.size (); ++w )
+            {
+                const HalfSpace& wall = *Walls[w];
+                double nx = wall.Direction.x, ny = wall.Direction.y, nz = wall.Direction.z;
+
+                double overlap = ri + wall.Offset - ( xi * nx + yi * ny + zi * nz );
+                if ( overlap <= 0 ) {
+                    continue;
+                }
+
+                double wx = ri * WX[i], wy = ri * WY[i], wz = ri * WZ[i];
+
+                Contact( acc, m, WallPartner + w, nx, ny, nz, overlap,
+                    VX[i] - ( wy * nz - wz * ny ),
+                    VY[i] - ( wz * nx - wx * nz ),
+                    VZ[i] - ( wx * ny - wy * nx ),
+                    im );
+            }
+
+            for ( unsigned o = 0; o < Obstacles.size (); ++o )
+            {
+                const Sphere& obstacle = *Obstacles[o];
+                Quaternion centre = obstacle.Position ();
+
+                double dx = xi - centre.x, dy = yi - centre.y, dz = zi - centre.z;
+                double reach = ri + obstacle.Radius;
+                double d2 = dx * dx + dy * dy + dz * dz;
+
+                if ( d2 >= reach * reach || d2 <= 0 ) {
+                    continue;
+                }
+
+                double d = sqrt( d2 );
+                double nx = dx / d, ny = dy / d, nz = dz / d;
+
+                Quaternion v = 0.0, w = 0.0;
+                if ( obstacle.Body ) {
+                    v = obstacle.Body->Velocity;
+                    w = obstacle.Body->AngularVelocity;
+                }
+
+                double wx = ri * WX[i] + obstacle.Radius * w.x;
+                double wy = ri * WY[i] + obstacle.Radius * w.y;
+                double wz = ri * WZ[i] + obstacle.Radius * w.z;
+
+                Contact( acc, m, ObstaclePartner + o, nx, ny, nz, reach - d,
+                    VX[i] - v.x - ( wy * nz - wz * ny ),
+                    VY[i] - v.y - ( wz * nx - wx * nz ),
+                    VZ[i] - v.z - ( wx * ny - wy * nx ),
+                    im );
+            }
+        }
+
+        FX[i] = acc.fx; FY[i] = acc.fy; FZ[i] = acc.fz;
+        TX[i] = acc.tx; TY[i] = acc.ty; TZ[i] = acc.tz;
+
+        ContactCount[i] = acc.count;
+        TestCount[i]    = tests;
+    }
+}
+
+void GranularSystem::Integrate( unsigned begin, unsigned end, double h )
+{
+    const double gx = Gravity.x, gy = Gravity.y, gz = Gravity.z;
+
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        const double im = InverseMass[i];
+        if ( im <= 0 ) {
+            continue;
+        }
+
+        // Semi-implicit Euler: the velocities first, then the positions
+        //
+        VX[i] += h * ( FX[i] * im + gx );
+        VY[i] += h * ( FY[i] * im + gy );
+        VZ[i] += h * ( FZ[i] * im + gz );
+
+        X[i] += h * VX[i];
+        Y[i] += h * VY[i];
+        Z[i] += h * VZ[i];
+
+        const double iI = InverseInertia[i];
+        WX[i] += h * TX[i] * iI;
+        WY[i] += h * TY[i] * iI;
+        WZ[i] += h * TZ[i] * iI;
+
+        // dQ/dt = 1/2 W Q
+        //
+        double wx = 0.5 * h * WX[i], wy = 0.5 * h * WY[i], wz = 0.5 * h * WZ[i];
+        double qw = QW[i], qx = QX[i], qy = QY[i], qz = QZ[i];
+
+        qw += - wx * QX[i] - wy * QY[i] - wz * QZ[i];
+        qx +=   wx * QW[i] + wy * QZ[i] - wz * QY[i];
+        qy +=   wy * QW[i] + wz * QX[i] - wx * QZ[i];
+        qz +=   wz * QW[i] + wx * QY[i] - wy * QX[i];
+
+        double norm = 1 / sqrt( qw * qw + qx * qx + qy * qy + qz * qz );
+        QW[i] = qw * norm; QX[i] = qx * norm; QY[i] = qy * norm; QZ[i] = qz * norm;
+    }
+}
+
+void GranularSystem::ForceBatch( void* context, unsigned begin, unsigned end )
+{
+    GranularSystem* self = static_cast<GranularSystem*>( context );
+    self->CalculateForces( begin, end, self->StepSize );
+}
+
+void GranularSystem::IntegrateBatch( void* context, unsigned begin, unsigned end )
+{
+    GranularSystem* self = static_cast<GranularSystem*>( context );
+    self->Integrate( begin, end, self->StepSize );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void GranularSystem::Step( double h )
+{
+    const unsigned N = Count ();
+
+    ++TimeStepCount;
+    Contacts = 0;
+
+    if ( N == 0 ) {
+        return;
+    }
+
+    // The damping ratio of the oscillator that rebounds with the restitution
+    //
+    if ( Restitution <= 0 ) {
+        DampingRatio = 1;
+    }
+    else if ( Restitution >= 1 ) {
+        DampingRatio = 0;
+    }
+    else {
+        double lnE = log( Restitution );
+        DampingRatio = -lnE / sqrt( Const::Pi * Const::Pi + lnE * lnE );
+    }
+
+    StepSize = h;
+
+    BuildCells ();
+
+    Current = 1 - Current;
+    ParallelFor( N, Threads, ForceBatch, this );
+
+    double tests = 0;
+    for ( unsigned i = 0; i < N; ++i )
+    {
+        Contacts += ContactCount[i];
+        tests    += TestCount[i];
+    }
+
+    PairTests          += tests;
+    ContactEvaluations += Contacts;
+
+    ParallelFor( N, Threads, IntegrateBatch, this );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void GranularSystem::Store( unsigned index, RigidBody& body ) const
+{
+    body.Set_XQVW(
+        SpatialVector( X[index], Y[index], Z[index] ),
+        Quaternion( QW[index], QX[index], QY[index], QZ[index] ),
+        SpatialVector( VX[index], VY[index], VZ[index] ),
+        SpatialVector( WX[index], WY[index], WZ[index] )
+    );
+}
+
+double GranularSystem::KineticEnergy () const
+{
+    double E = 0;
+
+    for ( unsigned i = 0; i < Count (); ++i )
+    {
+        if ( InverseMass[i] <= 0 ) {
+            continue;
+        }
+
+        double v2 = VX[i] * VX[i] + VY[i] * VY[i] + VZ[i] * VZ[i];
+        double w2 = WX[i] * WX[i] + WY[i] * WY[i] + WZ[i] * WZ[i];
+
+        E += 0.5 * v2 / InverseMass[i] + 0.5 * w2 / InverseInertia[i];
+    }
+
+    return E;
+}
@@ -0,0 +1,274 @@
+#ifndef _WORB_GRANULAR_H_INCLUDED
+#define _WORB_GRANULAR_H_INCLUDED
+
+/**
+ *  @file      Granular.h
+ *  @brief     Definitions for the GranularSystem class, the discrete element (soft-sphere)
+ *             mode for the bulk materials made of many spheres.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-01
+ *  @copyright GNU Public License.
+ */
+
+#include "Geometry.h"
+#include "RigidBody.h"
+#include "Topology.h"
+
+#include <vector>  // we use: std::vector
+#include <cmath>   // we use: floor
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Simulates a granular material made only of spheres with the discrete element
+     * method, as a specialized alternative to WorldOfRigidBodies.
+     *
+     * The particles are soft: the overlapping spheres repel with a linear
+     * spring-dashpot normal force, and the tangential force is a spring stretched
+     * by the sliding at the contact (the friction history) with a dashpot, limited
+     * by the Coulomb friction. The neighbours are found in a uniform grid of cells
+     * (cell lists) rebuilt every time-step, and the integration is semi-implicit
+     * Euler with time-steps well below the contact duration (see ContactDuration).
+     *
+     * The state is kept as a structure of arrays. Every particle sums the forces
+     * of its own contacts (each pair is evaluated from both sides), so the force
+     * pass and the integration run in parallel over the particles without locking.
+     * The arrays indexed by the particles are allocated with FirstTouchAllocator,
+     * so with the workers pinned, Distribute places every chunk of the particles
+     * on the NUMA node of the worker that processes it.
+     *
+     * The scenery uses the engine's definitions: the half-spaces and the spheres
+     * of the rigid body scenes can be added as walls and obstacles with infinite mass,
+     * and the particles are created from and copied back to the spheres.
+     */
+    class GranularSystem
+    {
+        enum { MaxHistory = 16 }; //!< The maximum number of tracked contacts per particle
+
+        /** The arrays indexed by the particles.
+         */
+        typedef std::vector< double, FirstTouchAllocator<double> > Array;
+        typedef std::vector< unsigned, FirstTouchAllocator<unsigned> > IndexArray;
+
+        /** Holds the particle state (structure of arrays).
+         */
+        Array X, Y, Z;     //!< The positions
+        Array VX, VY, VZ;  //!< The velocities
+        Array WX, WY, WZ;  //!< The angular velocities
+        Array QW, QX, QY, QZ; //!< The orientations
+        Array FX, FY, FZ;  //!< The forces of the last force pass
+        Array TX, TY, TZ;  //!< The torques of the last force pass
+        Array Radius;      //!< The radii
+        Array InverseMass; //!< The inverse masses
+        Array InverseInertia; //!< The inverse moments of inertia
+
+        /** Holds the tangential springs of the contacts (the friction history) of
+         * the last and the current time-step, MaxHistory slots per particle.
+         * The partner is the index of the other particle, or the index of the wall
+         * or the obstacle with the top bits set.
+         */
+        IndexArray Partner[2];
+        Array SpringX[2], SpringY[2], SpringZ[2];
+        unsigned Current; //!< Indexes the history being written by the force pass
+
+        /** Holds the number of contacts and the number of pair tests of every
+         * particle during the last force pass.
+         */
+        IndexArray ContactCount, TestCount;
+
+        /** Holds the cell lists: the cell of every particle, the particles ordered
+         * by cell and the first particle in every cell (with the sentinel at the end).
+         */
+        IndexArray CellOf;
+        std::vector<unsigned> CellStart, Sorted;
+        double CellSize;
+        double Origin[3];
+        int Cells[3];
+
+        /** Holds the scenery with infinite mass.
+         */
+        std::vector<const HalfSpace*> Walls;
+        std::vector<const Sphere*> Obstacles;
+
+        /** Gets the cell of the coordinate along the axis, clamped to the grid.
+         */
+        int CellCoordinate( double coordinate, unsigned axis ) const
+        {
+            int cell = int( floor( ( coordinate - Origin[axis] ) / CellSize ) );
+            return cell < 0 ? 0 : cell >= Cells[axis] ? Cells[axis] - 1 : cell;
+        }
+
+        /** Sorts the particles into the cells.
+         */
+        void BuildCells ();
+
+        /** Calculates the forces and the torques acting on the particles in range.
+         */
+        void CalculateForces( unsigned begin, unsigned end, double h );
+
+        /** Integrates the particles in range.
+         */
+        void Integrate( unsigned begin, unsigned end, double h );
+
+        static void ForceBatch( void* context, unsigned begin, unsigned end );
+        static void IntegrateBatch( void* context, unsigned begin, unsigned end );
+
+        /** Holds the damping ratio derived from the restitution by Step.
+         */
+        double DampingRatio;
+        double StepSize;
+
+    public:
+
+        /** Holds the normal stiffness of the contacts (force per overlap).
+         */
+        double Stiffness;
+
+        /** Holds the tangential stiffness as a fraction of the normal stiffness.
+         */
+        double TangentialStiffness;
+
+        /** Holds the coefficient of restitution of the normal impacts,
+         * which gives the damping of both the normal and the tangential dashpot.
+         */
+        double Restitution;
+
+        /** Holds the Coulomb friction coefficient.
+         */
+        double Friction;
+
+        /** Holds the gravitational acceleration.
+         */
+        Quaternion Gravity;
+
+        /** Holds the number of threads used by Step (including the calling thread).
+         */
+        unsigned Threads;
+
+        /** Holds the number of time-steps performed.
+         */
+        unsigned long TimeStepCount;
+
+        /** Holds the number of the particle pairs tested by the cell lists and
+         * the number of the contacts evaluated (from both sides), summed over
+         * all the time-steps.
+         */
+        double PairTests, ContactEvaluations;
+
+        /** Holds the number of the contacts (from both sides) in the last time-step.
+         */
+        unsigned Contacts;
+
+        GranularSystem ()
+            : Current( 0 )
+            , CellSize( 0 )
+            , DampingRatio( 0 )
+            , StepSize( 0 )
+            , Stiffness( 1e5 )
+            , TangentialStiffness( 2.0 / 7.0 )
+            , Restitution( 0.5 )
+            , Friction( 0.5 )
+            , Gravity( 0.0 )
+            , Threads( 1 )
+            , TimeStepCount( 0 )
+            , PairTests( 0 )
+            , ContactEvaluations( 0 )
+            , Contacts( 0 )
+        {
+        }
+
+        /** Gets the number of the particles.
+         */
+        unsigned Count () const
+        {
+            return unsigned( Radius.size () );
+        }
+
+        /** Removes all the particles and the scenery.
+         */
+        void Clear ();
+
+        /** Adds the particle with the given state; returns its index.
+         * The orientation is the identity.
+         */
+        unsigned Add( const Quaternion& position, const Quaternion& velocity,
+            double radius, double mass );
+
+        /** Adds the particle with the shape and the state of the sphere; the mass
+         * and the velocities are taken from its rigid body, if any (otherwise the
+         * given mass is used). Returns its index.
+         */
+        unsigned Add( const Sphere& sphere, double mass = 1.0 );
+
+        /** Adds the half-space as a wall with infinite mass. The wall is kept by
+         * reference, so it may be moved between the time-steps.
+         */
+        void Add( const HalfSpace& wall )
+        {
+            Walls.push_back( &wall );
+        }
+
+        /** Adds the sphere as an obstacle with infinite mass. The obstacle is kept by
+         * reference; if it has a rigid body, its velocities are felt by the contacts.
+         */
+        void AddObstacle( const Sphere& obstacle )
+        {
+            Obstacles.push_back( &obstacle );
+        }
+
+        /** Forgets the tangential springs of all the contacts.
+         */
+        void ClearHistory ();
+
+        /** Moves the arrays of the particles to new memory placed by FirstTouch,
+         * so that, with the workers pinned (see SetWorkerCpus) and `Threads` equal
+         * to their number, the pages of every chunk of the particles are on the node
+         * of the worker processing it. Must follow the last Add.
+         */
+        void Distribute ();
+
+        /** Gets the duration of an impact between the two lightest particles;
+         * the time-step should be at most a tenth of it.
+         */
+        double ContactDuration () const;
+
+        /** Advances the system for the time-step `h`.
+         */
+        void Step( double h );
+
+        /** Gets the position of the particle.
+         */
+        SpatialVector GetPosition( unsigned index ) const
+        {
+            return SpatialVector( X[index], Y[index], Z[index] );
+        }
+
+        /** Gets the velocity of the particle.
+         */
+        SpatialVector GetVelocity( unsigned index ) const
+        {
+            return SpatialVector( VX[index], VY[index], VZ[index] );
+        }
+
+        /** Gets the radius of the particle.
+         */
+        double GetRadius( unsigned index ) const
+        {
+            return Radius[index];
+        }
+
+        /** Copies the state of the particle to the rigid body (e.g. of the sphere
+         * it was created from, for rendering).
+         */
+        void Store( unsigned index, RigidBody& body ) const;
+
+        /** Gets the total kinetic energy of the particles.
+         */
+        double KineticEnergy () const;
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_GRANULAR_H_INCLUDED
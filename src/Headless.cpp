@@ -0,0 +1,176 @@
+/**
+ *  @file      Headless.cpp
+ *  @brief     The headless runner: simulates without rendering, optionally serving
+ *             simulations to local clients (see SimulationServer).
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-22
+ *  @copyright GNU Public License.
+ *
+ * Usage:
+ *
+ *     WoRB_Headless --server <socket-path>
+ *     WoRB_Headless [--bodies n] [--steps n] [--publish name [--replace]]
+ *
+ * In server mode, every client connected to the socket gets its own system of rigid
+ * bodies controlled through the protocol defined in ServerProtocol.h. Otherwise,
+ * `n` spheres are dropped on the ground plane and the diagnostics are displayed
+ * every 100 time-steps, optionally publishing the state into shared memory.
+ * The segment must not exist, unless `--replace` is given to remove a stale one
+ * (left by a crashed publisher).
+ */
+
+#include "WoRB.h"
+#include "SharedState.h"
+#include "SimulationServer.h"
+
+#include <cstdio>   // we use: printf
+#include <cstdlib>  // we use: atoi
+#include <cstring>  // we use: strcmp
+#include <vector>   // we use: std::vector
+
+#include <signal.h> // we use: signal, SIGINT, SIGTERM, SIGPIPE
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+static SimulationServer Server;
+
+static void OnTerminate( int )
+{
+    Server.Stop ();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+static int RunStandalone( unsigned n, unsigned steps, const char* publish,
+    bool replace )
+{
+    typedef WorldOfRigidBodies<4096,16384> World;
+
+    if ( n + 1 > 4096 ) {
+        Printf( "WoRB: Too many bodies: %u\n", n );
+        return 1;
+    }
+
+    World* worb = new World;
+    worb->RemoveObjects ();
+    worb->Gravity = Const::g_n;
+    worb->Collisions.Restitution = 0.5;
+    worb->Collisions.Friction    = 0.2;
+
+    HalfSpace ground;
+    ground.Direction = Const::Y;
+    ground.Offset    = 0;
+    worb->Add( ground );
+
+    unsigned side = 1;
+    while ( side * side * side < n ) {
+        ++side;
+    }
+
+    std::vector<SolidSphere*> bodies;
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        SolidSphere* ball = new SolidSphere(
+            SpatialVector( 1.2 * ( i % side ) + 0.01 * ( i % 7 ),
+                           1.2 * ( ( i / side ) % side ) + 0.6,
+                           1.2 * ( i / side / side ) + 0.01 * ( i % 5 ) ),
+            Quaternion( 1.0 ), /*v=*/ 0.0, /*w=*/ 0.0, /*r=*/ 0.5, /*mass=*/ 1.0
+        );
+        ball->CanBeDeactivated = true;
+
+        bodies.push_back( ball );
+        worb->Add( ball );
+    }
+
+    worb->InitializeODE ();
+
+    SharedStatePublisher publisher;
+    if ( publish && ! publisher.Open( publish, n, 4 * n, 4, replace ) ) {
+        return 1;
+    }
+
+    double t0 = MonotonicTime ();
+
+    for ( unsigned i = 1; i <= steps; ++i )
+    {
+        worb->SolveODE( 0.01 );
+
+        if ( publisher.IsOpen () ) {
+            publisher.Publish( *worb );
+        }
+
+        if ( i % 100 == 0 || i == steps ) {
+            Printf( "t = %8.3f  contacts = %5u  E_k = %12.4f  E_p = %12.4f\n",
+                worb->Time, worb->Collisions.Count (),
+                worb->TotalKineticEnergy, worb->TotalPotentialEnergy );
+        }
+    }
+
+    double elapsed = MonotonicTime () - t0;
+    Printf( "%u steps of %u bodies in %.3f s (%.1f steps/s)\n",
+        steps, n, elapsed, elapsed > 0 ? steps / elapsed : 0 );
+
+    for ( unsigned i = 0; i < bodies.size (); ++i ) {
+        delete bodies[i];
+    }
+    delete worb;
+
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+int main( int argc, char* argv[] )
+{
+    const char* socketPath = 0;
+    const char* publish    = 0;
+    unsigned    bodies     = 100;
+    unsigned    steps      = 1000;
+    bool        replace    = false;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( strcmp( argv[i], "--server" ) == 0 && i + 1 < argc ) {
+            socketPath = argv[ ++i ];
+        }
+        else if ( strcmp( argv[i], "--publish" ) == 0 && i + 1 < argc ) {
+            publish = argv[ ++i ];
+        }
+        else if ( strcmp( argv[i], "--replace" ) == 0 ) {
+            replace = true;
+        }
+        else if ( strcmp( argv[i], "--bodies" ) == 0 && i + 1 < argc ) {
+            bodies = unsigned( atoi( argv[ ++i ] ) );
+        }
+        else if ( strcmp( argv[i], "--steps" ) == 0 && i + 1 < argc ) {
+            steps = unsigned( atoi( argv[ ++i ] ) );
+        }
+        else
+        {
+            printf( "Usage: %s --server <socket-path>\n"
+                    "       %s [--bodies n] [--steps n] [--publish name [--replace]]\n",
+                    argv[0], argv[0] );
+            return 1;
+        }
+    }
+
+    if ( ! socketPath ) {
+        return RunStandalone( bodies, steps, publish, replace );
+    }
+
+    signal( SIGPIPE, SIG_IGN );
+    signal( SIGINT,  OnTerminate );
+    signal( SIGTERM, OnTerminate );
+
+    if ( ! Server.Listen( socketPath ) ) {
+        return 1;
+    }
+
+    Printf( "WoRB: Serving on %s\n", socketPath );
+    Server.Run ();
+
+    return 0;
+}
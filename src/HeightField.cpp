@@ -0,0 +1,336 @@
+/**
+ *  @file      HeightField.cpp
+ *  @brief     Implementation of the HeightField terrain and the sphere-terrain
+ *             and cuboid-terrain collision detectors.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-27
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+#include "TriangleContacts.h"
+#include "SceneQuery.h"
+
+#include <algorithm> // we use: std::min, std::max
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+bool HeightField::Build( unsigned columns, unsigned rows,
+    double originX, double originZ, double spacing,
+    const double* heights, StorageType storage )
+{
+    if ( columns < 2 || rows < 2 || spacing <= 0 ) {
+        return false;
+    }
+
+    Storage = storage;
+    Columns = columns;
+    Rows    = rows;
+    OriginX = originX;
+    OriginZ = originZ;
+    Spacing = spacing;
+
+    const unsigned count = columns * rows;
+
+    MinHeight = MaxHeight = heights[0];
+    for ( unsigned i = 1; i < count; ++i ) {
+        MinHeight = std::min( MinHeight, heights[i] );
+        MaxHeight = std::max( MaxHeight, heights[i] );
+    }
+
+    Heights32.clear ();
+    Heights16.clear ();
+
+    if ( storage == Int16 )
+    {
+        // Map [MinHeight,MaxHeight] to [-32767,32767]
+        //
+        Offset = 0.5 * ( MinHeight + MaxHeight );
+        Scale  = ( MaxHeight - MinHeight ) / 65534;
+        if ( Scale <= 0 ) {
+            Scale = 1;
+        }
+
+        Heights16.resize( count );
+        for ( unsigned i = 0; i < count; ++i ) {
+            double q = ( heights[i] - Offset ) / Scale;
+            Heights16[i] = short( q < 0 ? q - 0.5 : q + 0.5 );
+        }
+    }
+    else
+    {
+        Offset = 0;
+        Scale  = 1;
+
+        Heights32.resize( count );
+        for ( unsigned i = 0; i < count; ++i ) {
+            Heights32[i] = float( heights[i] );
+        }
+    }
+
+    return true;
+}
+
+double HeightField::HeightAt( double x, double z ) const
+{
+    unsigned column = 0, row = 0;
+    if ( ! FindCell( x, z, column, row ) ) {
+        return MinHeight;
+    }
+
+    double u = ( x - OriginX ) / Spacing - column;
+    double v = ( z - OriginZ ) / Spacing - row;
+
+    double h10 = Height( column + 1, row     );
+    double h01 = Height( column,     row + 1 );
+
+    if ( u + v <= 1 ) {
+        double h00 = Height( column, row );
+        return h00 + u * ( h10 - h00 ) + v * ( h01 - h00 );
+    }
+
+    double h11 = Height( column + 1, row + 1 );
+    return h11 + ( 1 - u ) * ( h01 - h11 ) + ( 1 - v ) * ( h10 - h11 );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Sets up the triangle ABC with its (upward) unit normal.
+     */
+    inline void SetTriangle( TriangleMesh::Triangle& T,
+        const Quaternion& A, const Quaternion& B, const Quaternion& C )
+    {
+        T.A = A;
+        T.B = B;
+        T.C = C;
+        T.Normal = ( B - A ).Cross( C - A );
+        T.Normal = T.Normal * ( 1.0 / T.Normal.ImNorm () );
+    }
+
+    /** Passes the triangles visited by HeightField::Query to the contact generator.
+     */
+    template<class Contacts>
+    struct CellVisitor
+    {
+        Contacts& Generator;
+
+        CellVisitor( Contacts& generator )
+            : Generator( generator )
+        {
+        }
+
+        void operator () ( const TriangleMesh::Triangle& T )
+        {
+            Generator.Test( T );
+        }
+    };
+
+    /** Detects contacts between the generator's body and the cells overlapping
+     * the given axis-aligned box.
+     */
+    template<class Contacts>
+    unsigned CheckCells( const HeightField& terrain,
+        const Quaternion& boxMin, const Quaternion& boxMax, Contacts& contacts )
+    {
+        CellVisitor<Contacts> visitor( contacts );
+        terrain.Query( boxMin, boxMax, visitor );
+        return contacts.Sink.ContactCount;
+    }
+}
+
+bool HeightField::GetCell( unsigned column, unsigned row,
+    TriangleMesh::Triangle* T, double above ) const
+{
+    double h00 = Height( column,     row     );
+    double h10 = Height( column + 1, row     );
+    double h01 = Height( column,     row + 1 );
+    double h11 = Height( column + 1, row + 1 );
+
+    if ( above > std::max( std::max( h00, h10 ), std::max( h01, h11 ) ) ) {
+        return false;
+    }
+
+    double x0 = OriginX + column * Spacing, x1 = x0 + Spacing;
+    double z0 = OriginZ + row    * Spacing, z1 = z0 + Spacing;
+
+    Quaternion P00( 0, x0, h00, z0 ), P10( 0, x1, h10, z0 );
+    Quaternion P01( 0, x0, h01, z1 ), P11( 0, x1, h11, z1 );
+
+    SetTriangle( T[0], P00, P01, P10 );
+    SetTriangle( T[1], P10, P01, P11 );
+    return true;
+}
+
+unsigned HeightField::Check( CollisionResolver& owner, const Sphere& B ) const
+{
+    if ( ! owner.HasSpaceForMoreContacts () ) {
+        return 0;
+    }
+
+    Quaternion center = B.Position ();
+    Quaternion r( 0, B.Radius, B.Radius, B.Radius );
+
+    SphereTriangleContacts contacts( owner, B, /*oneSided*/ true );
+    return CheckCells( *this, center - r, center + r, contacts );
+}
+
+unsigned HeightField::Check( CollisionResolver& owner, const Cuboid& B ) const
+{
+    if ( ! owner.HasSpaceForMoreContacts () ) {
+        return 0;
+    }
+
+    // The axis-aligned box enclosing the cuboid
+    //
+    Quaternion center = B.Position ();
+    Quaternion extent;
+    for ( unsigned k = 0; k < 3; ++k ) {
+        for ( unsigned i = 0; i < 3; ++i ) {
+            extent[k] += fabs( B.Axis(i)[k] ) * B.HalfExtent[i];
+        }
+    }
+
+    CuboidTriangleContacts contacts( owner, B, /*oneSided*/ true );
+    return CheckCells( *this, center - extent, center + extent, contacts );
+}
+
+unsigned HeightField::Check( CollisionResolver& owner, const ConvexHull& B ) const
+{
+    if ( ! owner.HasSpaceForMoreContacts () ) {
+        return 0;
+    }
+
+    Quaternion center = B.Position ();
+    Quaternion r( 0, B.Radius, B.Radius, B.Radius );
+
+    ConvexTriangleContacts contacts( owner, B, /*oneSided*/ true );
+    return CheckCells( *this, center - r, center + r, contacts );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+bool HeightField::RayCast( const Ray& ray, QueryHit& hit ) const
+{
+    if ( Columns < 2 ) {
+        return false;
+    }
+
+    const Quaternion& o = ray.Origin;
+    const Quaternion& d = ray.Direction;
+
+    // A ray starting below the surface is inside the terrain
+    //
+    unsigned column, row;
+    if ( FindCell( o.x, o.z, column, row ) && o.y <= HeightAt( o.x, o.z ) )
+    {
+        hit.Shape    = this;
+        hit.Distance = 0;
+        hit.Position = o;
+        hit.Normal   = Const::Y;
+        return true;
+    }
+
+    // Clip the ray by the bounds of the terrain
+    //
+    const double lower[3] = { OriginX, MinHeight, OriginZ };
+    const double upper[3] = { OriginX + ( Columns - 1 ) * Spacing, MaxHeight,
+                              OriginZ + ( Rows    - 1 ) * Spacing };
+
+    double tmin = 0, tmax = ray.MaxDistance;
+    for ( unsigned k = 0; k < 3; ++k )
+    {
+        if ( fabs( d[k] ) < 1e-14 )
+        {
+            if ( o[k] < lower[k] || o[k] > upper[k] ) {
+                return false;
+            }
+            continue;
+        }
+
+        double t1 = ( lower[k] - o[k] ) / d[k];
+        double t2 = ( upper[k] - o[k] ) / d[k];
+        tmin = std::max( tmin, std::min( t1, t2 ) );
+        tmax = std::min( tmax, std::max( t1, t2 ) );
+
+        if ( tmin > tmax ) {
+            return false;
+        }
+    }
+
+    // Walk the cells under the ray from the entry point (2D DDA); the hits
+    // in a cell are closer than the hits in the cells that follow
+    //
+    const int lastColumn = int( Columns ) - 2;
+    const int lastRow    = int( Rows ) - 2;
+
+    Quaternion entry = ray.At( tmin );
+    int c = std::min( std::max( int( floor( ( entry.x - OriginX ) / Spacing ) ), 0 ), lastColumn );
+    int r = std::min( std::max( int( floor( ( entry.z - OriginZ ) / Spacing ) ), 0 ), lastRow );
+
+    const int stepX = d.x >= 0 ? 1 : -1;
+    const int stepZ = d.z >= 0 ? 1 : -1;
+
+    double nextX = Const::Max, deltaX = Const::Max;
+    if ( fabs( d.x ) >= 1e-14 ) {
+        nextX  = ( OriginX + ( c + ( stepX > 0 ? 1 : 0 ) ) * Spacing - o.x ) / d.x;
+        deltaX = Spacing / fabs( d.x );
+    }
+
+    double nextZ = Const::Max, deltaZ = Const::Max;
+    if ( fabs( d.z ) >= 1e-14 ) {
+        nextZ  = ( OriginZ + ( r + ( stepZ > 0 ? 1 : 0 ) ) * Spacing - o.z ) / d.z;
+        deltaZ = Spacing / fabs( d.z );
+    }
+
+    Ray segment( ray );
+    segment.MaxDistance = tmax;
+    TriangleMesh::Triangle T[2];
+
+    for ( ;; )
+    {
+        GetCell( unsigned( c ), unsigned( r ), T );
+
+        int closest = -1;
+        for ( int i = 0; i < 2; ++i )
+        {
+            double distance;
+            if ( RayTriangle( segment, T[i].A, T[i].B, T[i].C, distance ) ) {
+                segment.MaxDistance = distance;
+                closest = i;
+            }
+        }
+
+        if ( closest >= 0 )
+        {
+            hit.Shape    = this;
+            hit.Distance = segment.MaxDistance;
+            hit.Position = ray.At( hit.Distance );
+            hit.Normal   = T[ closest ].Normal;
+            return true;
+        }
+
+        if ( nextX < nextZ )
+        {
+            c += stepX;
+            if ( nextX > tmax || c < 0 || c > lastColumn ) {
+                break;
+            }
+            nextX += deltaX;
+        }
+        else
+        {
+            r += stepZ;
+            if ( nextZ > tmax || r < 0 || r > lastRow ) {
+                break;
+            }
+            nextZ += deltaZ;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,188 @@
+#ifndef _WORB_HEIGHT_FIELD_H_INCLUDED
+#define _WORB_HEIGHT_FIELD_H_INCLUDED
+
+/**
+ *  @file      HeightField.h
+ *  @brief     Definitions for the HeightField class, a static terrain geometry
+ *             given as a regular grid of heights.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-27
+ *  @copyright GNU Public License.
+ */
+
+#include "Geometry.h"
+#include "TriangleMesh.h"
+
+#include <vector>  // we use: std::vector
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Encapsulates a static terrain (scenery) given as heights (along the y-axis)
+     * over a regular grid in the xz-plane.
+     *
+     * The grid has `Columns` vertices along the x-axis and `Rows` vertices along
+     * the z-axis, spaced by `Spacing` from the corner at (`OriginX`, `OriginZ`).
+     * Every cell is split into two triangles along its (column+1, row) to
+     * (column, row+1) diagonal. The terrain is solid below the surface, so the
+     * contacts (like the HalfSpace contacts) always push bodies upwards.
+     *
+     * The heights are stored either as floats or, for large terrains, as 16-bit
+     * integers quantized between the lowest and the highest height.
+     *
+     * The detectors index directly into the cells under the body's footprint,
+     * so the cost per body does not depend on the size of the terrain.
+     */
+    class HeightField : public Geometry
+    {
+    public:
+
+        /** Enumerates the height storage types.
+         */
+        enum StorageType
+        {
+            Float32,  //!< Single precision floats
+            Int16     //!< 16-bit integers, quantized between MinHeight and MaxHeight
+        };
+
+        HeightField ()
+            : Geometry( Geometry::_HeightField )
+            , Storage( Float32 )
+            , Columns( 0 ), Rows( 0 )
+            , OriginX( 0 ), OriginZ( 0 ), Spacing( 1 )
+            , MinHeight( 0 ), MaxHeight( 0 )
+            , Scale( 1 ), Offset( 0 )
+        {
+        }
+
+        /** Builds the terrain from `columns` x `rows` heights, where
+         * `heights[ row * columns + column ]` is the height at the vertex
+         * ( originX + column * spacing, originZ + row * spacing ).
+         * @return false if the grid has less than 2 x 2 vertices.
+         */
+        bool Build( unsigned columns, unsigned rows,
+            double originX, double originZ, double spacing,
+            const double* heights, StorageType storage = Float32 );
+
+        /** Gets the height at the given grid vertex.
+         */
+        double Height( unsigned column, unsigned row ) const
+        {
+            unsigned index = row * Columns + column;
+            return Storage == Int16 ? Offset + Scale * Heights16[ index ]
+                                    : Heights32[ index ];
+        }
+
+        /** Finds the cell containing the given point (projected onto the xz-plane).
+         * @return false if the point is outside the terrain.
+         */
+        bool FindCell( double x, double z, unsigned& column, unsigned& row ) const
+        {
+            double u = ( x - OriginX ) / Spacing;
+            double v = ( z - OriginZ ) / Spacing;
+
+            if ( u < 0 || v < 0 || u >= Columns - 1 || v >= Rows - 1 ) {
+                return false;
+            }
+
+            column = unsigned( u );
+            row    = unsigned( v );
+            return true;
+        }
+
+        /** Gets the height of the surface above the given point.
+         * @return MinHeight if the point is outside the terrain.
+         */
+        double HeightAt( double x, double z ) const;
+
+        /** Calls `visitor( triangle )` for both triangles of every cell under the
+         * footprint of the given axis-aligned box, skipping the cells below the box.
+         */
+        template<class Visitor>
+        void Query( const Quaternion& boxMin, const Quaternion& boxMax,
+            Visitor& visitor ) const
+        {
+            if ( Columns < 2 || boxMin.y > MaxHeight ) {
+                return;
+            }
+
+            // The range of cells under the footprint of the box
+            //
+            double u0 = ( boxMin.x - OriginX ) / Spacing;
+            double u1 = ( boxMax.x - OriginX ) / Spacing;
+            double v0 = ( boxMin.z - OriginZ ) / Spacing;
+            double v1 = ( boxMax.z - OriginZ ) / Spacing;
+
+            if ( u1 < 0 || v1 < 0 || u0 >= Columns - 1 || v0 >= Rows - 1 ) {
+                return; // Outside the terrain
+            }
+
+            unsigned c0 = u0 < 0 ? 0 : unsigned( u0 );
+            unsigned r0 = v0 < 0 ? 0 : unsigned( v0 );
+            unsigned c1 = u1 < Columns - 2 ? unsigned( u1 ) : Columns - 2;
+            unsigned r1 = v1 < Rows    - 2 ? unsigned( v1 ) : Rows    - 2;
+
+            TriangleMesh::Triangle T[2];
+
+            for ( unsigned row = r0; row <= r1; ++row ) {
+                for ( unsigned column = c0; column <= c1; ++column )
+                {
+                    if ( GetCell( column, row, T, boxMin.y ) ) {
+                        visitor( T[0] );
+                        visitor( T[1] );
+                    }
+                }
+            }
+        }
+
+        /** Gets both triangles of the cell (with the upward unit normals).
+         * @return false if the whole cell is below the given height.
+         */
+        bool GetCell( unsigned column, unsigned row, TriangleMesh::Triangle* T,
+            double above = -Const::Max ) const;
+
+        /** Casts the ray against the terrain, walking the cells under the ray
+         * (a 2D DDA) from the entry point; the first hit is the closest one.
+         * A ray starting below the surface hits at the distance 0.
+         */
+        bool RayCast( const Ray& ray, QueryHit& hit ) const;
+
+        /////////////////////////////////////////////////////////////////////////////////
+
+        /** Checks for collision between the terrain and a sphere.
+         */
+        unsigned Check( CollisionResolver& owner, const Sphere& B ) const;
+
+        /** Checks for collision between the terrain and a cuboid.
+         */
+        unsigned Check( CollisionResolver& owner, const Cuboid& B ) const;
+
+        /** Checks for collision between the terrain and a convex hull.
+         */
+        unsigned Check( CollisionResolver& owner, const ConvexHull& B ) const;
+
+        /////////////////////////////////////////////////////////////////////////////////
+
+        StorageType Storage;  //!< Holds the height storage type
+        unsigned Columns;     //!< Holds the number of vertices along the x-axis
+        unsigned Rows;        //!< Holds the number of vertices along the z-axis
+        double OriginX;       //!< Holds the x-coordinate of the first vertex
+        double OriginZ;       //!< Holds the z-coordinate of the first vertex
+        double Spacing;       //!< Holds the distance between the vertices
+        double MinHeight;     //!< Holds the lowest height
+        double MaxHeight;     //!< Holds the highest height
+
+    private:
+
+        double Scale;   //!< Holds the quantization step of Int16 heights
+        double Offset;  //!< Holds the height corresponding to Int16 zero
+
+        std::vector<float> Heights32;  //!< Holds the Float32 heights
+        std::vector<short> Heights16;  //!< Holds the Int16 heights
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_HEIGHT_FIELD_H_INCLUDED
@@ -9,6 +9,9 @@
 
 #include "WoRB.h"
 
+#include <algorithm>  // we use: std::sort, std::unique, std::lower_bound, std::max
+#include <cmath>      // we use: fabs, sqrt
+
 using namespace WoRB;
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -29,18 +32,57 @@ void CollisionResolver::ImpulseTransfers( double h, unsigned maxIterations, doub
         eps = 0.01;
     }
 
+    TransferImpulses( 0, CollisionCount, h, maxIterations, eps );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Performs the impulse transfers on the subset of the collisions.
+//
+unsigned CollisionResolver::TransferImpulses( const unsigned* subset, unsigned count,
+    double h, unsigned maxIterations, double eps, bool blocks )
+{
     // Iterate performing impulse transfers, until there are no contacts with
     // notable bouncing velocity jolts are found.
     //
-    for ( unsigned iteration = 0; iteration < maxIterations; ++iteration )
+    unsigned iteration = 0;
+    for ( ; iteration < maxIterations; ++iteration )
     {
         // Find the contact with the largest possible velocity jolt
         //
-        Collision* contact = FindLargestBouncingVelocity( eps );
+        Collision* contact = 0;
+        if ( ! subset ) {
+            contact = FindLargestBouncingVelocity( eps );
+        }
+        else
+        {
+            double largest = eps;
+            for ( unsigned k = 0; k < count; ++k )
+            {
+                Collision& c_k = Collisions[ subset[k] ];
+                if ( c_k.BouncingVelocity > largest )
+                {
+                    largest = c_k.BouncingVelocity;
+                    contact = &c_k;
+                }
+            }
+        }
+
         if ( ! contact ) {
             break; // Done, if bouncing velocity are not found
         }
 
+        // Resolve the whole manifold of the contact, if any
+        //
+        unsigned index = unsigned( contact - Collisions );
+        if ( blocks && ManifoldSize[ index ] > 1 )
+        {
+            if ( TransferManifold( ManifoldFirst[ index ], ManifoldSize[ index ], h ) ) {
+                ++BlockSolves;
+                continue;
+            }
+            ++BlockFallbacks;
+        }
+
         // Activate bodies participating in the collision that are lying inactive
         //
         contact->ActivateInactiveBodies ();
@@ -54,46 +96,647 @@ void CollisionResolver::ImpulseTransfers( double h, unsigned maxIterations, doub
         // contact velocities means that some of the relative closing
         // velocities need recomputing.
         //
-        RigidBody** bodies_in_contact = &contact->Body_A;
-        for( unsigned i = 0; i < CollisionCount; ++i )
+        PropagateJolts( &contact->Body_A, V_jolt, W_jolt, h );
+    }
+
+    ImpulseIterations += iteration;
+    return iteration;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Updates the velocities of the contacts of the bodies after their jolts.
+//
+void CollisionResolver::PropagateJolts( RigidBody* const bodies_in_contact[2],
+    const Quaternion V_jolt[2], const Quaternion W_jolt[2], double h )
+{
+    for( unsigned i = 0; i < CollisionCount; ++i )
+    {
+        Collision& c_i = Collisions[i];
+        RigidBody** b_i = &c_i.Body_A;
+
+        for( unsigned a = 0; a < 2; ++a ) // Each body in contact
         {
-            Collision& c_i = Collisions[i];
-            RigidBody** b_i = &c_i.Body_A;
+            if ( ! b_i[a] ) { 
+                continue; // Skip scenery objects
+            }
 
-            for( unsigned a = 0; a < 2; ++a ) // Each body in contact
+            // Check for a match with each body in the newly resolved contact
+            //
+            for( unsigned b = 0; b < 2; ++b )
             {
-                if ( ! b_i[a] ) { 
-                    continue; // Skip scenery objects
+                if ( b_i[a] != bodies_in_contact[b] ) {
+                    continue;
                 }
 
-                // Check for a match with each body in the newly resolved contact
+                // dV = V_j + ( W_j x r )
                 //
-                for( unsigned b = 0; b < 2; ++b )
-                {
-                    if ( b_i[a] != bodies_in_contact[b] ) {
-                        continue;
-                    }
-
-                    // dV = V_j + ( W_j x r )
-                    //
-                    Quaternion delta_V = 
-                        V_jolt[b] + W_jolt[b].Cross( c_i.RelativePosition[a] );
-
-                    // The sign of the change is negative if we're dealing
-                    // with the second body in a contact.
-                    //
-                    Quaternion dV_world = c_i.ToWorld.TransformInverse( delta_V );
-                    c_i.Velocity += a ? -dV_world : dV_world;
-
-                    // Recalculate bouncing velocity (derived quantity).
-                    // BouncingVelocity = - ( 1 + COR ) * Velocity.x
-                    // where Velocity.x = < V_ab, Normal_ab >
-                    //
-                    c_i.BouncingVelocity = c_i.GetBouncingVelocity( h );
+                Quaternion delta_V = 
+                    V_jolt[b] + W_jolt[b].Cross( c_i.RelativePosition[a] );
+
+                // The sign of the change is negative if we're dealing
+                // with the second body in a contact.
+                //
+                Quaternion dV_world = c_i.ToWorld.TransformInverse( delta_V );
+                c_i.Velocity += a ? -dV_world : dV_world;
+
+                // Recalculate bouncing velocity (derived quantity).
+                // BouncingVelocity = - ( 1 + COR ) * Velocity.x
+                // where Velocity.x = < V_ab, Normal_ab >
+                //
+                c_i.BouncingVelocity = c_i.GetBouncingVelocity( h );
+            }
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Resolves collisions using the impulse transfers, the manifolds as blocks.
+//
+namespace
+{
+    /** Gets the change of the velocity at the point `r_i` of the body (relative to
+     * its center) for the impulse `J` at the point `r_j`.
+     */
+    inline Quaternion ImpulseResponse( const RigidBody* body,
+        const Quaternion& r_j, const Quaternion& J, const Quaternion& r_i )
+    {
+        return body->InverseMass * J
+             + ( body->InverseInertiaWorld * r_j.Cross( J ) ).Cross( r_i );
+    }
+
+    /** Solves the linear system `A x = b` of the order `n` (at most 4) in place,
+     * using Gaussian elimination with partial pivoting. Returns false if the system
+     * is singular (a pivot is below `tiny`).
+     */
+    bool SolveLinear( double A[4][4], double b[4], double x[4], unsigned n, double tiny )
+    {
+        for ( unsigned k = 0; k < n; ++k )
+        {
+            unsigned pivot = k;
+            for ( unsigned i = k + 1; i < n; ++i ) {
+                if ( fabs( A[i][k] ) > fabs( A[pivot][k] ) ) {
+                    pivot = i;
+                }
+            }
+
+            if ( fabs( A[pivot][k] ) <= tiny ) {
+                return false;
+            }
+
+            if ( pivot != k )
+            {
+                for ( unsigned j = k; j < n; ++j ) {
+                    std::swap( A[k][j], A[pivot][j] );
+                }
+                std::swap( b[k], b[pivot] );
+            }
+
+            for ( unsigned i = k + 1; i < n; ++i )
+            {
+                double factor = A[i][k] / A[k][k];
+                for ( unsigned j = k; j < n; ++j ) {
+                    A[i][j] -= factor * A[k][j];
+                }
+                b[i] -= factor * b[k];
+            }
+        }
+
+        for ( unsigned k = n; k-- > 0; )
+        {
+            double sum = b[k];
+            for ( unsigned j = k + 1; j < n; ++j ) {
+                sum -= A[k][j] * x[j];
+            }
+            x[k] = sum / A[k][k];
+        }
+
+        return true;
+    }
+}
+
+void CollisionResolver::BlockImpulseTransfers( double h, unsigned maxIterations, double eps )
+{
+    if ( CollisionCount == 0 ) {
+        return; // Nothing to do
+    }
+
+    // Setup default parameters
+    //
+    if ( maxIterations == 0 ) {
+        maxIterations = 8 * CollisionCount;
+    }
+    if ( eps == 0 ) {
+        eps = 0.01;
+    }
+
+    FindManifolds ();
+    TransferImpulses( 0, CollisionCount, h, maxIterations, eps, true );
+}
+
+void CollisionResolver::FindManifolds ()
+{
+    // The manifolds are the runs of 2 to 4 consecutive contacts between the same
+    // bodies (the longer runs are resolved contact by contact)
+    //
+    ManifoldFirst.resize( CollisionCount );
+    ManifoldSize.resize( CollisionCount );
+
+    for ( unsigned i = 0; i < CollisionCount; )
+    {
+        unsigned end = i + 1;
+        while ( end < CollisionCount
+            && Collisions[end].Body_A == Collisions[i].Body_A
+            && Collisions[end].Body_B == Collisions[i].Body_B ) {
+            ++end;
+        }
+
+        unsigned size = end - i <= 4 ? end - i : 1;
+        for ( unsigned k = i; k < end; ++k ) {
+            ManifoldFirst[k] = size > 1 ? i : k;
+            ManifoldSize[k]  = size;
+        }
+
+        i = end;
+    }
+}
+
+bool CollisionResolver::TransferManifold( unsigned first, unsigned count, double h )
+{
+    Collision* manifold = Collisions + first;
+
+    RigidBody* body[2] = { manifold[0].Body_A, manifold[0].Body_B };
+
+    Quaternion n[4], r_A[4], r_B[4];
+    double K[4][4], b[4];
+
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        n[i]   = manifold[i].Normal;
+        r_A[i] = manifold[i].RelativePosition[0];
+        r_B[i] = body[1] ? manifold[i].RelativePosition[1] : Quaternion( 0.0 );
+        b[i]   = manifold[i].BouncingVelocity;
+    }
+
+    // The change of the normal velocity at the contact i for the unit normal
+    // impulse at the contact j
+    //
+    double largest = 0;
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        for ( unsigned j = 0; j < count; ++j )
+        {
+            Quaternion dV = ImpulseResponse( body[0], r_A[j], n[j], r_A[i] );
+            if ( body[1] ) {
+                dV += ImpulseResponse( body[1], r_B[j], n[j], r_B[i] );
+            }
+            K[i][j] = dV.Dot( n[i] );
+        }
+        largest = std::max( largest, K[i][i] );
+    }
+
+    // Find the normal impulses `lambda >= 0` such that the bouncing velocities
+    // are reached where the contacts push, and exceeded where they do not:
+    // w = K lambda - b >= 0, lambda . w = 0. The sets of the pushing contacts are
+    // tried from the largest one; the 4-point manifolds are singular (the body
+    // has only three degrees of freedom normal to the face), so one of the
+    // 3-point subsets solves them.
+    //
+    double lambda[4] = { 0, 0, 0, 0 };
+    double tolerance = 1e-9 * ( 1.0 + *std::max_element( b, b + count ) );
+    bool solved = false;
+
+    for ( unsigned size = count; size > 0 && ! solved; --size )
+    {
+        for ( unsigned mask = 1; mask < ( 1u << count ) && ! solved; ++mask )
+        {
+            unsigned index[4], m = 0;
+            for ( unsigned i = 0; i < count; ++i ) {
+                if ( mask & ( 1u << i ) ) {
+                    index[ m++ ] = i;
+                }
+            }
+            if ( m != size ) {
+                continue;
+            }
+
+            double A[4][4], rhs[4], x[4];
+            for ( unsigned i = 0; i < m; ++i )
+            {
+                for ( unsigned j = 0; j < m; ++j ) {
+                    A[i][j] = K[ index[i] ][ index[j] ];
+                }
+                rhs[i] = b[ index[i] ];
+            }
+
+            if ( ! SolveLinear( A, rhs, x, m, 1e-9 * largest ) ) {
+                continue;
+            }
+
+            double trial[4] = { 0, 0, 0, 0 };
+            bool feasible = true;
+            for ( unsigned i = 0; i < m && feasible; ++i ) {
+                feasible = x[i] >= -tolerance;
+                trial[ index[i] ] = std::max( x[i], 0.0 );
+            }
+
+            for ( unsigned i = 0; i < count && feasible; ++i )
+            {
+                double w = -b[i];
+                for ( unsigned j = 0; j < count; ++j ) {
+                    w += K[i][j] * trial[j];
+                }
+                feasible = w >= -tolerance * ( 1.0 + K[i][i] );
+            }
+
+            if ( feasible ) {
+                std::copy( trial, trial + count, lambda );
+                solved = true;
+            }
+        }
+    }
+
+    if ( ! solved ) {
+        return false;
+    }
+
+    // The total normal impulse and its moments about the centers of the bodies
+    //
+    Quaternion J( 0.0 ), torque_A( 0.0 ), torque_B( 0.0 );
+    Quaternion centre_A( 0.0 ), centre_B( 0.0 ), V_centre( 0.0 );
+    double normalImpulse = 0;
+
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        Quaternion J_i = lambda[i] * n[i];
+
+        J        += J_i;
+        torque_A += r_A[i].Cross( J_i );
+        torque_B += r_B[i].Cross( J_i );
+
+        centre_A += r_A[i];
+        centre_B += r_B[i];
+        V_centre += manifold[i].ToWorld( manifold[i].Velocity );
+
+        normalImpulse += lambda[i];
+    }
+
+    centre_A = centre_A * ( 1.0 / count );
+    centre_B = centre_B * ( 1.0 / count );
+    V_centre = V_centre * ( 1.0 / count ); // The velocities are affine in the position
+
+    // The friction impulse at the centre of the manifold removes the sliding
+    // velocity of the centre left after the normal impulses, within the friction
+    // cone of the total normal impulse
+    //
+    const double friction = manifold[0].Friction;
+
+    if ( friction > 0 && normalImpulse > 0 )
+    {
+        V_centre += body[0]->InverseMass * J
+                  + ( body[0]->InverseInertiaWorld * torque_A ).Cross( centre_A );
+        if ( body[1] ) {
+            V_centre += body[1]->InverseMass * J
+                      + ( body[1]->InverseInertiaWorld * torque_B ).Cross( centre_B );
+        }
+
+        Quaternion t[2] = {
+            manifold[0].ToWorld( Quaternion( 0, 0, 1, 0 ) ),
+            manifold[0].ToWorld( Quaternion( 0, 0, 0, 1 ) )
+        };
+
+        double T[2][2];
+        for ( unsigned a = 0; a < 2; ++a )
+        {
+            for ( unsigned c = 0; c < 2; ++c )
+            {
+                Quaternion dV = ImpulseResponse( body[0], centre_A, t[c], centre_A );
+                if ( body[1] ) {
+                    dV += ImpulseResponse( body[1], centre_B, t[c], centre_B );
+                }
+                T[a][c] = dV.Dot( t[a] );
+            }
+        }
+
+        double det = T[0][0] * T[1][1] - T[0][1] * T[1][0];
+        if ( fabs( det ) > 1e-18 * largest * largest )
+        {
+            double v0 = -V_centre.Dot( t[0] ), v1 = -V_centre.Dot( t[1] );
+            double f0 = (  T[1][1] * v0 - T[0][1] * v1 ) / det;
+            double f1 = ( -T[1][0] * v0 + T[0][0] * v1 ) / det;
+
+            double length = sqrt( f0 * f0 + f1 * f1 );
+            double limit = friction * normalImpulse;
+            if ( length > limit ) {
+                f0 *= limit / length;
+                f1 *= limit / length;
+            }
+
+            Quaternion J_friction = f0 * t[0] + f1 * t[1];
+
+            J        += J_friction;
+            torque_A += centre_A.Cross( J_friction );
+            torque_B += centre_B.Cross( J_friction );
+        }
+    }
+
+    // Apply the jolts on the bodies and update the contacts of both bodies
+    //
+    manifold[0].ActivateInactiveBodies ();
+
+    Quaternion V_jolt[2], W_jolt[2];
+
+    body[0]->LinearMomentum  += J;
+    body[0]->AngularMomentum += torque_A;
+
+    V_jolt[0] = body[0]->InverseMass * J;
+    W_jolt[0] = body[0]->InverseInertiaWorld * torque_A;
+
+    if ( body[1] )
+    {
+        body[1]->LinearMomentum  -= J;
+        body[1]->AngularMomentum -= torque_B;
+
+        V_jolt[1] = -( body[1]->InverseMass * J );
+        W_jolt[1] = -( body[1]->InverseInertiaWorld * torque_B );
+    }
+
+    PropagateJolts( body, V_jolt, W_jolt, h );
+
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Resolves collisions layer by layer from the bottom up (shock propagation).
+//
+void CollisionResolver::ShockPropagation( double h, unsigned maxIterations, double eps,
+    bool blocks )
+{
+    if ( CollisionCount == 0 ) {
+        return; // Nothing to do
+    }
+
+    if ( eps == 0 ) {
+        eps = 0.01;
+    }
+
+    // The contacts of a manifold connect the same bodies, so they stay together
+    // in the same layer
+    //
+    if ( blocks ) {
+        FindManifolds ();
+    }
+
+    const unsigned Unreached = ~0u;
+
+    // Collect the bodies in contact (sorted, so they can be found by bisection)
+    //
+    StackBodies.clear ();
+    for ( unsigned i = 0; i < CollisionCount; ++i )
+    {
+        StackBodies.push_back( Collisions[i].Body_A );
+        if ( Collisions[i].Body_B ) {
+            StackBodies.push_back( Collisions[i].Body_B );
+        }
+    }
+
+    std::sort( StackBodies.begin (), StackBodies.end () );
+    StackBodies.erase( std::unique( StackBodies.begin (), StackBodies.end () ),
+        StackBodies.end () );
+
+    const unsigned bodyCount = unsigned( StackBodies.size () );
+
+    // Find the bodies of every contact; the contacts of every body are kept
+    // as the compressed adjacency lists (StackStart, StackContacts)
+    //
+    StackLayer.resize( 2 * CollisionCount );
+    StackStart.assign( bodyCount + 1, 0 );
+
+    for ( unsigned i = 0; i < CollisionCount; ++i )
+    {
+        RigidBody** body = &Collisions[i].Body_A;
+        for ( unsigned a = 0; a < 2; ++a )
+        {
+            unsigned index = Unreached;
+            if ( body[a] )
+            {
+                index = unsigned( std::lower_bound( StackBodies.begin (),
+                    StackBodies.end (), body[a] ) - StackBodies.begin () );
+                ++StackStart[ index + 1 ];
+            }
+            StackLayer[ 2 * i + a ] = index;
+        }
+    }
+
+    for ( unsigned k = 0; k < bodyCount; ++k ) {
+        StackStart[ k + 1 ] += StackStart[k];
+    }
+
+    StackContacts.resize( StackStart[ bodyCount ] );
+    StackOrder.assign( StackStart.begin (), StackStart.end () - 1 ); // Next free slots
+
+    for ( unsigned i = 0; i < CollisionCount; ++i )
+    {
+        for ( unsigned a = 0; a < 2; ++a )
+        {
+            unsigned index = StackLayer[ 2 * i + a ];
+            if ( index != Unreached ) {
+                StackContacts[ StackOrder[ index ]++ ] = i;
+            }
+        }
+    }
+
+    // Breadth-first search from the ground: the bodies with infinite mass are
+    // at height 0, the bodies touching the scenery at height 1, and so on.
+    //
+    StackHeight.assign( bodyCount, Unreached );
+    StackOrder.clear (); // The queue
+
+    for ( unsigned k = 0; k < bodyCount; ++k )
+    {
+        if ( StackBodies[k]->InverseMass == 0 ) {
+            StackHeight[k] = 0;
+            StackOrder.push_back( k );
+        }
+    }
+
+    for ( unsigned i = 0; i < CollisionCount; ++i )
+    {
+        unsigned index = StackLayer[ 2 * i ];
+        if ( StackLayer[ 2 * i + 1 ] == Unreached && StackHeight[ index ] == Unreached ) {
+            StackHeight[ index ] = 1;
+            StackOrder.push_back( index );
+        }
+    }
+
+    unsigned top = 1;
+    for ( unsigned q = 0; q < StackOrder.size (); ++q )
+    {
+        unsigned k = StackOrder[q];
+
+        for ( unsigned e = StackStart[k]; e < StackStart[ k + 1 ]; ++e )
+        {
+            unsigned i = StackContacts[e];
+            unsigned other = StackLayer[ 2 * i ] == k
+                ? StackLayer[ 2 * i + 1 ] : StackLayer[ 2 * i ];
+
+            if ( other != Unreached && StackHeight[ other ] == Unreached )
+            {
+                StackHeight[ other ] = StackHeight[k] + 1;
+                if ( StackHeight[ other ] > top ) {
+                    top = StackHeight[ other ];
                 }
+                StackOrder.push_back( other );
+            }
+        }
+    }
+
+    // The bodies not supported by the ground form the top layer
+    //
+    for ( unsigned k = 0; k < bodyCount; ++k )
+    {
+        if ( StackHeight[k] == Unreached ) {
+            StackHeight[k] = top + 1;
+        }
+    }
+
+    // The layer of a contact is the height of its upper body. The lower body of
+    // a contact between the layers becomes Body_B, which is hidden while the layer
+    // is resolved, so it takes no impulses (i.e. it has infinite mass).
+    //
+    std::vector<unsigned>& layerStart = StackStart;
+    layerStart.assign( top + 3, 0 );
+
+    for ( unsigned i = 0; i < CollisionCount; ++i )
+    {
+        unsigned a = StackLayer[ 2 * i ], b = StackLayer[ 2 * i + 1 ];
+        unsigned height_A = StackHeight[a];
+        unsigned height_B = b == Unreached ? 0 : StackHeight[b];
+
+        if ( height_A < height_B ) {
+            Collisions[i].SwapBodies ();
+        }
+
+        unsigned layer = height_A > height_B ? height_A : height_B;
+
+        // Mark the contacts to hide Body_B with the top bit
+        //
+        StackLayer[ 2 * i ] = layer | ( height_A != height_B ? 0x80000000u : 0 );
+        ++layerStart[ layer + 1 ];
+    }
+
+    for ( unsigned L = 0; L < top + 2; ++L ) {
+        layerStart[ L + 1 ] += layerStart[L];
+    }
+
+    StackOrder.resize( CollisionCount );
+    StackHidden.assign( CollisionCount, 0 );
+    StackContacts.assign( layerStart.begin (), layerStart.end () - 1 ); // Next free slots
+
+    for ( unsigned i = 0; i < CollisionCount; ++i ) {
+        StackOrder[ StackContacts[ StackLayer[ 2 * i ] & 0x7FFFFFFFu ]++ ] = i;
+    }
+
+    // The layers are resolved as the resting contacts (inelastically); otherwise
+    // every layer would bounce off the one below faster, and the stack would blow
+    // up geometrically with its height.
+    //
+    StackRestitution.resize( CollisionCount );
+    for ( unsigned i = 0; i < CollisionCount; ++i )
+    {
+        StackRestitution[i] = Collisions[i].Restitution;
+        Collisions[i].Restitution = 0;
+        Collisions[i].BouncingVelocity = Collisions[i].GetBouncingVelocity( h );
+    }
+
+    // Resolve the layers from the bottom up
+    //
+    for ( unsigned L = 0; L < top + 2; ++L )
+    {
+        const unsigned begin = layerStart[L], end = layerStart[ L + 1 ];
+        if ( begin == end ) {
+            continue;
+        }
+
+        for ( unsigned k = begin; k < end; ++k )
+        {
+            Collision& contact = Collisions[ StackOrder[k] ];
+            if ( ! ( StackLayer[ 2 * StackOrder[k] ] & 0x80000000u ) ) {
+                continue;
+            }
+
+            // The support never wakes up from the weight of the bodies resting on it,
+            // but the moving support wakes up the bodies resting on it.
+            //
+            if ( ! contact.Body_A->IsActive && contact.BouncingVelocity > eps ) {
+                contact.Body_A->Activate ();
             }
+
+            StackHidden[ StackOrder[k] ] = contact.Body_B;
+            contact.Body_B = 0;
         }
+
+        TransferImpulses( &StackOrder[ begin ], end - begin, h,
+            maxIterations ? maxIterations : 8 * ( end - begin ), eps, blocks );
     }
+
+    // Restore the hidden bodies and the restitution
+    //
+    for ( unsigned i = 0; i < CollisionCount; ++i )
+    {
+        if ( StackHidden[i] ) {
+            Collisions[i].Body_B = StackHidden[i];
+        }
+        Collisions[i].Restitution = StackRestitution[i];
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Sorts the contacts by the order of their bodies.
+//
+namespace
+{
+    /** Gets the sort key of the contact: the lower order of its bodies.
+     */
+    inline unsigned BodyOrder( const Collision& contact )
+    {
+        unsigned order = contact.Body_A ? contact.Body_A->Order : ~0u;
+        if ( contact.Body_B && contact.Body_B->Order < order ) {
+            order = contact.Body_B->Order;
+        }
+        return order;
+    }
+}
+
+void CollisionResolver::SortByBodies( unsigned bodyCount )
+{
+    if ( CollisionCount < 2 || bodyCount == 0 ) {
+        return;
+    }
+
+    // Count the contacts of every body (the contacts without bodies go last),
+    // then place them at the start of their body
+    //
+    SortStart.assign( bodyCount + 3, 0 );
+
+    for ( unsigned i = 0; i < CollisionCount; ++i )
+    {
+        unsigned order = std::min( BodyOrder( Collisions[i] ), bodyCount );
+        ++SortStart[ order + 2 ];
+    }
+
+    for ( unsigned k = 2; k < SortStart.size (); ++k ) {
+        SortStart[k] += SortStart[k-1];
+    }
+
+    SortedCollisions.resize( CollisionCount );
+
+    for ( unsigned i = 0; i < CollisionCount; ++i )
+    {
+        unsigned order = std::min( BodyOrder( Collisions[i] ), bodyCount );
+        SortedCollisions[ SortStart[ order + 1 ]++ ] = Collisions[i];
+    }
+
+    std::copy( SortedCollisions.begin (), SortedCollisions.end (), Collisions );
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
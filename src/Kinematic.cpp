@@ -0,0 +1,139 @@
+/**
+ *  @file      Kinematic.cpp
+ *  @brief     Implementation of the scripted motion of the kinematic bodies.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-31
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+
+#include <cmath>  // we use: atan2, acos, sin, fmod
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Interpolates spherically between the unit quaternions (the shorter arc).
+     */
+    Quaternion Slerp( const Quaternion& a, Quaternion b, double u )
+    {
+        double cosine = a.Dot( b ) + a.w * b.w; // Dot is over the vector parts
+
+        if ( cosine < 0 ) {
+            b = -b;
+            cosine = -cosine;
+        }
+
+        if ( cosine > 0.9995 ) { // Almost parallel; interpolate linearly
+            return ( a + ( b - a ) * u ).Unit ();
+        }
+
+        double angle = acos( cosine );
+        double s = 1 / sin( angle );
+
+        return a * ( sin( ( 1 - u ) * angle ) * s ) + b * ( sin( u * angle ) * s );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void KinematicMotion::Move( RigidBody& body, double time, double h )
+{
+    Quaternion X, Q;
+    GetPose( time, X, Q );
+
+    X.w = 0;
+    Q.Normalize ();
+
+    Quaternion V, W;
+    Displacement = 0.0;
+
+    if ( h > 0 )
+    {
+        Displacement = X - body.Position;
+        Displacement.w = 0;
+
+        V = Displacement * ( 1 / h );
+
+        // The rotation during the time-step is dQ = Q * Q_last^-1 (the shorter arc);
+        // the angular velocity is along its axis.
+        //
+        Quaternion dQ = Q * body.Orientation.Conjugate ();
+        if ( dQ.w < 0 ) {
+            dQ = -dQ;
+        }
+
+        double sine = dQ.ImNorm ();
+        if ( sine > 1e-12 )
+        {
+            double angle = 2 * atan2( sine, dQ.w );
+            W = Quaternion( 0, dQ.x, dQ.y, dQ.z ) * ( angle / ( sine * h ) );
+        }
+    }
+
+    body.SetKinematicState( X, Q, V, W );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void KeyframedMotion::GetPose( double time, Quaternion& position, Quaternion& orientation )
+{
+    if ( Keys.empty () )
+    {
+        position    = 0.0;
+        orientation = 1.0;
+        return;
+    }
+
+    const Keyframe& first = Keys.front ();
+    const Keyframe& last  = Keys.back ();
+
+    if ( Loop && last.Time > first.Time )
+    {
+        double period = last.Time - first.Time;
+        time = first.Time + fmod( time - first.Time, period );
+        if ( time < first.Time ) {
+            time += period;
+        }
+    }
+
+    if ( time <= first.Time || Keys.size () == 1 )
+    {
+        position    = first.Position;
+        orientation = first.Orientation;
+        return;
+    }
+
+    if ( time >= last.Time )
+    {
+        position    = last.Position;
+        orientation = last.Orientation;
+        return;
+    }
+
+    // Find the first keyframe after the time
+    //
+    unsigned lo = 1, hi = unsigned( Keys.size () ) - 1;
+    while ( lo < hi )
+    {
+        unsigned mid = ( lo + hi ) / 2;
+        if ( Keys[mid].Time <= time ) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    const Keyframe& A = Keys[ lo - 1 ];
+    const Keyframe& B = Keys[ lo ];
+
+    double u = B.Time > A.Time ? ( time - A.Time ) / ( B.Time - A.Time ) : 1.0;
+
+    position    = A.Position + ( B.Position - A.Position ) * u;
+    orientation = Slerp( A.Orientation, B.Orientation, u );
+}
@@ -0,0 +1,145 @@
+#ifndef _WORB_KINEMATIC_H_INCLUDED
+#define _WORB_KINEMATIC_H_INCLUDED
+
+/**
+ *  @file      Kinematic.h
+ *  @brief     Definitions for the scripted motion of the kinematic bodies: the motion
+ *             given by a user callback and the motion along a keyframed path.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-31
+ *  @copyright GNU Public License.
+ */
+
+#include "RigidBody.h"
+
+#include <vector>  // we use: std::vector
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Represents the scripted motion of a kinematic body (see RigidBody::Kinematic).
+     *
+     * Every time-step, WorldOfRigidBodies moves the body to its pose at the end of
+     * the time-step and derives its velocity and angular velocity from the change
+     * of the pose, so the contacts see the body moving.
+     */
+    class KinematicMotion
+    {
+    public:
+
+        /** Holds the displacement of the body during the last time-step; the broadphase
+         * sweeps the bounds of the body across it.
+         */
+        Quaternion Displacement;
+
+        virtual ~KinematicMotion ()
+        {
+        }
+
+        /** Gets the position and the orientation of the body at the given time.
+         */
+        virtual void GetPose( double time, Quaternion& position, Quaternion& orientation ) = 0;
+
+        /** Moves the body to its pose at the given time, deriving the velocities from
+         * the motion during the time-step of length `h` (the velocities are zero,
+         * if `h` is zero).
+         */
+        void Move( RigidBody& body, double time, double h );
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Represents the motion given by a user supplied function.
+     */
+    class KinematicCallback : public KinematicMotion
+    {
+    public:
+
+        /** Represents the function returning the pose at the given time.
+         */
+        typedef void ( *PoseFunction )( double time,
+            Quaternion& position, Quaternion& orientation, void* context );
+
+        /** Points to the function returning the pose.
+         */
+        PoseFunction Function;
+
+        /** Holds the user data passed to the function.
+         */
+        void* Context;
+
+        KinematicCallback( PoseFunction function, void* context = 0 )
+            : Function( function )
+            , Context( context )
+        {
+        }
+
+        virtual void GetPose( double time, Quaternion& position, Quaternion& orientation )
+        {
+            Function( time, position, orientation, Context );
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Represents the motion along a path given by keyframes. The position is
+     * interpolated linearly and the orientation spherically between the keyframes;
+     * before the first and after the last keyframe the body rests.
+     */
+    class KeyframedMotion : public KinematicMotion
+    {
+        /** Holds the pose at the given time.
+         */
+        struct Keyframe
+        {
+            double     Time;
+            Quaternion Position;
+            Quaternion Orientation;
+        };
+
+        /** Holds the keyframes in increasing time.
+         */
+        std::vector<Keyframe> Keys;
+
+    public:
+
+        /** Indicates whether the path repeats after the last keyframe. For a smooth
+         * loop, the last keyframe should repeat the pose of the first one.
+         */
+        bool Loop;
+
+        KeyframedMotion ()
+            : Loop( false )
+        {
+        }
+
+        /** Adds the keyframe; the keyframes must be added in increasing time.
+         */
+        void Add( double time, const Quaternion& position, const Quaternion& orientation )
+        {
+            Keyframe key = { time, position, orientation.Unit () };
+            Keys.push_back( key );
+        }
+
+        /** Removes all the keyframes.
+         */
+        void Clear ()
+        {
+            Keys.clear ();
+        }
+
+        /** Gets the number of the keyframes.
+         */
+        unsigned Count () const
+        {
+            return unsigned( Keys.size () );
+        }
+
+        virtual void GetPose( double time, Quaternion& position, Quaternion& orientation );
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_KINEMATIC_H_INCLUDED
@@ -11,6 +11,8 @@
 #include "Utilities.h"
 #include "WoRB_TestBed.h"
 
+#include <cstring> // we use: strcmp
+
 /////////////////////////////////////////////////////////////////////////////////////////
 
 /** Definition of the static instance wrapper for our GLUT application.
@@ -24,6 +26,11 @@ static WoRB::GLUT_Framework<WoRB_TestBed> glut;
 /////////////////////////////////////////////////////////////////////////////////////////
 
 /** The main entry point for the stand-alone version.
+ *
+ * Options (after GLUT options): `--publish <name>` publishes the system state
+ * into the named shared memory segment (see SharedStatePublisher), which must not
+ * exist; `--replace` (given before) removes a stale segment left by a crashed
+ * publisher.
  */
 int main( int argc, char* argv [] )
 {
@@ -32,6 +39,18 @@ int main( int argc, char* argv [] )
     }
 
     Application.Initialize ();
+
+    bool replace = false;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( strcmp( argv[i], "--replace" ) == 0 ) {
+            replace = true;
+        }
+        else if ( strcmp( argv[i], "--publish" ) == 0 && i + 1 < argc ) {
+            Application.PublishState( argv[++i], replace );
+        }
+    }
     Application.SetupAnimation ();
 
     glut.Connect( Application );
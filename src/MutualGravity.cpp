@@ -0,0 +1,453 @@
+/**
+ *  @file      MutualGravity.cpp
+ *  @brief     Implementation of the MutualGravity class, the gravitational attraction
+ *             between the bodies approximated by the Barnes-Hut octree.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-03
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+
+#include <algorithm>  // we use: std::sort, std::min, std::max
+#include <cmath>      // we use: sqrt
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+MutualGravity::MutualGravity ()
+    : Extent( 0 )
+    , Enabled( false )
+    , G( Const::G )
+    , OpeningAngle( 0.5 )
+    , Softening( 0 )
+    , Threads( 1 )
+    , NodeCount( 0 )
+    , Interactions( 0 )
+{
+    Origin[0] = Origin[1] = Origin[2] = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Sorting the bodies
+
+unsigned MutualGravity::Gather( RigidBody* const* bodies, unsigned count, bool sort )
+{
+    Bodies.clear ();
+    for ( unsigned i = 0; i < count; ++i ) {
+        if ( bodies[i]->InverseMass > 0 ) {
+            Bodies.push_back( bodies[i] );
+        }
+    }
+
+    const unsigned n = unsigned( Bodies.size () );
+
+    X.resize( n ); Y.resize( n ); Z.resize( n ); Mass.resize( n );
+    AX.resize( n ); AY.resize( n ); AZ.resize( n ); Phi.resize( n );
+    BodyInteractions.resize( n );
+    Code.resize( n );
+
+    if ( n == 0 ) {
+        return 0;
+    }
+
+    // The bounding cube of the positions
+    //
+    double lo[3], hi[3];
+    for ( unsigned a = 0; a < 3; ++a ) {
+        lo[a] = hi[a] = Bodies[0]->Position[a];
+    }
+
+    for ( unsigned i = 1; i < n; ++i )
+    {
+        for ( unsigned a = 0; a < 3; ++a ) {
+            lo[a] = std::min( lo[a], Bodies[i]->Position[a] );
+            hi[a] = std::max( hi[a], Bodies[i]->Position[a] );
+        }
+    }
+
+    Extent = std::max( hi[0] - lo[0], std::max( hi[1] - lo[1], hi[2] - lo[2] ) );
+    Extent = Extent > 0 ? Extent * ( 1 + 1e-9 ) : 1;
+
+    for ( unsigned a = 0; a < 3; ++a ) {
+        Origin[a] = lo[a];
+    }
+
+    // Sort the bodies by the Morton codes of their cells
+    //
+    if ( sort )
+    {
+        const double scale = ( 1 << Levels ) / Extent;
+        const unsigned last = ( 1 << Levels ) - 1;
+
+        Keys.resize( n );
+        for ( unsigned i = 0; i < n; ++i )
+        {
+            unsigned cell[3];
+            for ( unsigned a = 0; a < 3; ++a ) {
+                cell[a] = std::min( last,
+                    unsigned( ( Bodies[i]->Position[a] - Origin[a] ) * scale ) );
+            }
+            Keys[i] = std::make_pair( MortonCode( cell[0], cell[1], cell[2] ), i );
+        }
+
+        std::sort( Keys.begin (), Keys.end () );
+
+        std::vector<RigidBody*> sorted( n );
+        for ( unsigned k = 0; k < n; ++k ) {
+            sorted[k] = Bodies[ Keys[k].second ];
+            Code[k] = Keys[k].first;
+        }
+        Bodies.swap( sorted );
+    }
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        const RigidBody& body = *Bodies[i];
+        X[i] = body.Position.x;
+        Y[i] = body.Position.y;
+        Z[i] = body.Position.z;
+        Mass[i] = body.Mass ();
+    }
+
+    return n;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Building the octree
+
+void MutualGravity::FindOctants( unsigned begin, unsigned end, unsigned level,
+    unsigned* start ) const
+{
+    // The octant is given by the 3 bits of the code below the prefix of the level;
+    // the codes are sorted, so the octants are consecutive runs
+    //
+    const unsigned shift = 3 * ( Levels - 1 - level );
+
+    unsigned i = begin;
+    for ( unsigned octant = 0; octant < 8; ++octant )
+    {
+        start[ octant ] = i;
+        while ( i < end && ( ( Code[i] >> shift ) & 7 ) == octant ) {
+            ++i;
+        }
+    }
+    start[8] = end;
+}
+
+void MutualGravity::Summarize( const std::vector<Node>& tree, Node& node ) const
+{
+    double m = 0, x = 0, y = 0, z = 0;
+
+    if ( node.ChildCount == 0 )
+    {
+        for ( unsigned i = node.Begin; i < node.End; ++i ) {
+            m += Mass[i];
+            x += Mass[i] * X[i];
+            y += Mass[i] * Y[i];
+            z += Mass[i] * Z[i];
+        }
+    }
+    else
+    {
+        for ( unsigned c = 0; c < node.ChildCount; ++c )
+        {
+            const Node& child = tree[ node.FirstChild + c ];
+            m += child.Mass;
+            x += child.Mass * child.X;
+            y += child.Mass * child.Y;
+            z += child.Mass * child.Z;
+        }
+    }
+
+    node.Mass = m;
+    node.X = m > 0 ? x / m : 0;
+    node.Y = m > 0 ? y / m : 0;
+    node.Z = m > 0 ? z / m : 0;
+}
+
+void MutualGravity::Build( std::vector<Node>& tree, unsigned index, unsigned begin,
+    unsigned end, unsigned level ) const
+{
+    Node node;
+    node.Begin = begin;
+    node.End   = end;
+    node.Size  = Extent / ( 1 << level );
+    node.FirstChild = 0;
+    node.ChildCount = 0;
+
+    if ( end - begin > LeafSize && level < Levels )
+    {
+        unsigned start[9];
+        FindOctants( begin, end, level, start );
+
+        // The children are allocated together, then their subtrees are appended
+        //
+        node.FirstChild = unsigned( tree.size () );
+        for ( unsigned octant = 0; octant < 8; ++octant ) {
+            node.ChildCount += start[ octant + 1 ] > start[ octant ] ? 1 : 0;
+        }
+        tree.resize( tree.size () + node.ChildCount );
+
+        unsigned child = node.FirstChild;
+        for ( unsigned octant = 0; octant < 8; ++octant ) {
+            if ( start[ octant + 1 ] > start[ octant ] ) {
+                Build( tree, child++, start[ octant ], start[ octant + 1 ], level + 1 );
+            }
+        }
+    }
+
+    Summarize( tree, node );
+    tree[ index ] = node;
+}
+
+void MutualGravity::SubtreeBatch( void* context, unsigned begin, unsigned end )
+{
+    MutualGravity& self = *static_cast<MutualGravity*>( context );
+
+    for ( unsigned k = begin; k < end; ++k )
+    {
+        std::vector<Node>& tree = self.Subtrees[k];
+        tree.resize( 1 );
+        self.Build( tree, 0, self.OctantStart[ 2 * k ], self.OctantStart[ 2 * k + 1 ], 1 );
+    }
+}
+
+void MutualGravity::BuildTree ()
+{
+    const unsigned n = unsigned( Bodies.size () );
+
+    Nodes.resize( 1 );
+
+    if ( n <= LeafSize ) {
+        Build( Nodes, 0, 0, n, 0 );
+        NodeCount = 1;
+        return;
+    }
+
+    // Split the root into the octants, whose subtrees are built in parallel
+    //
+    unsigned start[9];
+    FindOctants( 0, n, 0, start );
+
+    OctantStart.clear ();
+    for ( unsigned octant = 0; octant < 8; ++octant )
+    {
+        if ( start[ octant + 1 ] > start[ octant ] ) {
+            OctantStart.push_back( start[ octant ] );
+            OctantStart.push_back( start[ octant + 1 ] );
+        }
+    }
+
+    const unsigned children = unsigned( OctantStart.size () / 2 );
+    Subtrees.resize( children );
+
+    ParallelFor( children, Threads, SubtreeBatch, this );
+
+    // Append the subtrees: their roots become the children of the root, followed
+    // by their descendants, relocated
+    //
+    Nodes.resize( 1 + children );
+
+    Node& root = Nodes[0];
+    root.Begin = 0;
+    root.End = n;
+    root.Size = Extent;
+    root.FirstChild = 1;
+    root.ChildCount = children;
+
+    unsigned base = 1 + children;
+    for ( unsigned k = 0; k < children; ++k )
+    {
+        const std::vector<Node>& tree = Subtrees[k];
+        const unsigned offset = base - 1; // The local index 1 goes to `base`
+
+        for ( unsigned j = 0; j < tree.size (); ++j )
+        {
+            Node node = tree[j];
+            if ( node.ChildCount ) {
+                node.FirstChild += offset;
+            }
+            if ( j == 0 ) {
+                Nodes[ 1 + k ] = node;
+            }
+            else {
+                Nodes.push_back( node );
+            }
+        }
+
+        base += unsigned( tree.size () ) - 1;
+    }
+
+    Summarize( Nodes, Nodes[0] );
+    NodeCount = unsigned( Nodes.size () );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Evaluating the forces
+
+void MutualGravity::TraverseBatch( void* context, unsigned begin, unsigned end )
+{
+    MutualGravity& self = *static_cast<MutualGravity*>( context );
+
+    const double theta2 = self.OpeningAngle * self.OpeningAngle;
+    const double eps2 = self.Softening * self.Softening;
+    const double G = self.G;
+
+    const double* X = &self.X[0];
+    const double* Y = &self.Y[0];
+    const double* Z = &self.Z[0];
+    const double* M = &self.Mass[0];
+    const Node* nodes = &self.Nodes[0];
+
+    // Every level pushes at most 8 children
+    //
+    unsigned stack[ 8 * ( Levels + 1 ) + 1 ];
+
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        const double x = X[i], y = Y[i], z = Z[i];
+        double ax = 0, ay = 0, az = 0, phi = 0;
+        unsigned interactions = 0;
+
+        unsigned top = 0;
+        stack[ top++ ] = 0;
+
+        while ( top > 0 )
+        {
+            const Node& node = nodes[ stack[ --top ] ];
+
+            double dx = node.X - x, dy = node.Y - y, dz = node.Z - z;
+            double r2 = dx * dx + dy * dy + dz * dz;
+
+            bool inside = i >= node.Begin && i < node.End;
+
+            if ( node.ChildCount == 0 )
+            {
+                // Sum the bodies of the leaf directly
+                //
+                for ( unsigned j = node.Begin; j < node.End; ++j )
+                {
+                    if ( j == i ) {
+                        continue;
+                    }
+                    double ex = X[j] - x, ey = Y[j] - y, ez = Z[j] - z;
+                    double inverse = 1.0 / sqrt( ex * ex + ey * ey + ez * ez + eps2 );
+                    double gm = G * M[j] * inverse;
+                    double f = gm * inverse * inverse;
+                    ax += f * ex; ay += f * ey; az += f * ez;
+                    phi -= gm;
+                    ++interactions;
+                }
+            }
+            else if ( ! inside && node.Size * node.Size < theta2 * r2 )
+            {
+                // Far enough: the node as a whole
+                //
+                double inverse = 1.0 / sqrt( r2 + eps2 );
+                double gm = G * node.Mass * inverse;
+                double f = gm * inverse * inverse;
+                ax += f * dx; ay += f * dy; az += f * dz;
+                phi -= gm;
+                ++interactions;
+            }
+            else
+            {
+                for ( unsigned c = 0; c < node.ChildCount; ++c ) {
+                    stack[ top++ ] = node.FirstChild + c;
+                }
+            }
+        }
+
+        self.AX[i] = ax; self.AY[i] = ay; self.AZ[i] = az;
+        self.Phi[i] = phi;
+        self.BodyInteractions[i] = interactions;
+    }
+}
+
+void MutualGravity::DirectBatch( void* context, unsigned begin, unsigned end )
+{
+    MutualGravity& self = *static_cast<MutualGravity*>( context );
+
+    const unsigned n = unsigned( self.Bodies.size () );
+    const double eps2 = self.Softening * self.Softening;
+
+    for ( unsigned i = begin; i < end; ++i )
+    {
+        const double x = self.X[i], y = self.Y[i], z = self.Z[i];
+        double ax = 0, ay = 0, az = 0, phi = 0;
+
+        for ( unsigned j = 0; j < n; ++j )
+        {
+            if ( j == i ) {
+                continue;
+            }
+            double ex = self.X[j] - x, ey = self.Y[j] - y, ez = self.Z[j] - z;
+            double inverse = 1.0 / sqrt( ex * ex + ey * ey + ez * ez + eps2 );
+            double gm = self.G * self.Mass[j] * inverse;
+            double f = gm * inverse * inverse;
+            ax += f * ex; ay += f * ey; az += f * ez;
+            phi -= gm;
+        }
+
+        self.AX[i] = ax; self.AY[i] = ay; self.AZ[i] = az;
+        self.Phi[i] = phi;
+        self.BodyInteractions[i] = n - 1;
+    }
+}
+
+void MutualGravity::Scatter ()
+{
+    Interactions = 0;
+
+    for ( unsigned i = 0; i < Bodies.size (); ++i )
+    {
+        Interactions += BodyInteractions[i];
+
+        RigidBody& body = *Bodies[i];
+        if ( body.Kinematic ) {
+            continue;
+        }
+
+        // Half of the potential energy of every pair goes to each of its bodies
+        //
+        double m = Mass[i];
+        body.AddExternalForce( Quaternion( 0, m * AX[i], m * AY[i], m * AZ[i] ),
+            0.5 * m * Phi[i] );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void MutualGravity::Apply( RigidBody* const* bodies, unsigned count )
+{
+    const unsigned n = Gather( bodies, count, true );
+    if ( n < 2 ) {
+        NodeCount = 0;
+        Interactions = 0;
+        return;
+    }
+
+    BuildTree ();
+
+    ParallelFor( n, Threads, TraverseBatch, this );
+
+    Scatter ();
+}
+
+void MutualGravity::ApplyDirect( RigidBody* const* bodies, unsigned count )
+{
+    const unsigned n = Gather( bodies, count, false );
+    NodeCount = 0;
+
+    if ( n < 2 ) {
+        Interactions = 0;
+        return;
+    }
+
+    ParallelFor( n, Threads, DirectBatch, this );
+
+    Scatter ();
+}
@@ -0,0 +1,165 @@
+#ifndef _WORB_MUTUAL_GRAVITY_H_INCLUDED
+#define _WORB_MUTUAL_GRAVITY_H_INCLUDED
+
+/**
+ *  @file      MutualGravity.h
+ *  @brief     Definitions for the MutualGravity class, the gravitational attraction
+ *             between the bodies approximated by the Barnes-Hut octree.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-03
+ *  @copyright GNU Public License.
+ */
+
+#include "RigidBody.h"
+
+#include <vector>   // we use: std::vector
+#include <utility>  // we use: std::pair
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Applies the Newtonian gravitational attraction between all the bodies
+     * (see WorldOfRigidBodies::Attraction), in O(n log n) time.
+     *
+     * Every time-step, the bodies are sorted by the Morton codes of their positions
+     * and the octree is built over the sorted bodies: every node is a range of bodies
+     * sharing a prefix of the codes and holds their mass and centre of mass.
+     * The subtrees of the octants of the root are built in parallel.
+     * The attraction of a node is approximated by its centre of mass if the node
+     * is seen at an angle below the opening angle (`size / distance < theta`),
+     * otherwise its children are opened; the bodies of the leaves are summed
+     * directly. The traversals run in parallel over the bodies.
+     *
+     * The force is softened: the potential between two bodies is
+     * `-G m_1 m_2 / sqrt( r^2 + epsilon^2 )`, half of which is added to the potential
+     * energy of each body (and so to WorldOfRigidBodies::TotalPotentialEnergy).
+     * The bodies with infinite mass are neither attracted nor attracting, and
+     * the kinematic bodies attract without being attracted. The forces do not wake
+     * the bodies.
+     */
+    class MutualGravity
+    {
+        /** Represents a node of the octree: the bodies in range `[Begin,End)` of
+         * the sorted bodies, and the children at `[FirstChild,FirstChild+ChildCount)`
+         * (none for the leaves).
+         */
+        struct Node
+        {
+            double X, Y, Z;       //!< The centre of mass
+            double Mass;          //!< The total mass
+            double Size;          //!< The edge of the cell
+            unsigned Begin, End;
+            unsigned FirstChild, ChildCount;
+        };
+
+        enum { LeafSize = 8 };  //!< The most bodies in a leaf (unless at the finest level)
+        enum { Levels = 10 };   //!< The levels of the Morton codes (1024 cells per axis)
+
+        /** Holds the bodies in the order of the Morton codes, with their positions,
+         * masses and codes (structure of arrays, in the same order).
+         */
+        std::vector<RigidBody*> Bodies;
+        std::vector< std::pair<unsigned,unsigned> > Keys;
+        std::vector<double> X, Y, Z, Mass;
+        std::vector<unsigned> Code;
+
+        /** Holds the resulting accelerations and potentials of the bodies, and
+         * the number of the interactions evaluated for every body.
+         */
+        std::vector<double> AX, AY, AZ, Phi;
+        std::vector<unsigned> BodyInteractions;
+
+        /** Holds the nodes of the octree (the root first), the subtrees of
+         * the octants of the root, built in parallel and then appended, and
+         * the ranges of the bodies of the octants.
+         */
+        std::vector<Node> Nodes;
+        std::vector< std::vector<Node> > Subtrees;
+        std::vector<unsigned> OctantStart;
+
+        /** Holds the bounding cube of the bodies.
+         */
+        double Origin[3];
+        double Extent;
+
+        /** Collects the bodies with finite mass, sorts them and gathers their state.
+         * Returns the number of the bodies.
+         */
+        unsigned Gather( RigidBody* const* bodies, unsigned count, bool sort );
+
+        /** Finds the ranges of the bodies in range in the octants of the cell at
+         * the given level (`start` gets 9 entries).
+         */
+        void FindOctants( unsigned begin, unsigned end, unsigned level,
+            unsigned* start ) const;
+
+        /** Builds the node (already in the tree) for the bodies in range at the given
+         * level, then its descendants, appended to the tree.
+         */
+        void Build( std::vector<Node>& tree, unsigned index, unsigned begin,
+            unsigned end, unsigned level ) const;
+
+        /** Sets the mass and the centre of mass of the node from its children,
+         * or from its bodies if it is a leaf.
+         */
+        void Summarize( const std::vector<Node>& tree, Node& node ) const;
+
+        /** Builds the octree (the subtrees of the root in parallel).
+         */
+        void BuildTree ();
+
+        /** Adds the forces and the potential energies to the attracted bodies.
+         */
+        void Scatter ();
+
+        static void SubtreeBatch( void* context, unsigned begin, unsigned end );
+        static void TraverseBatch( void* context, unsigned begin, unsigned end );
+        static void DirectBatch( void* context, unsigned begin, unsigned end );
+
+    public:
+
+        /** Indicates whether the attraction is applied by the system.
+         */
+        bool Enabled;
+
+        /** Holds the gravitational constant (by default Const::G).
+         */
+        double G;
+
+        /** Holds the opening angle `theta` (0 opens all the nodes, i.e. the direct
+         * summation).
+         */
+        double OpeningAngle;
+
+        /** Holds the softening length `epsilon`, in `m`.
+         */
+        double Softening;
+
+        /** Holds the number of the threads building the tree and evaluating
+         * the forces.
+         */
+        unsigned Threads;
+
+        /** Holds the number of the nodes of the last octree and the number of
+         * the body-node and body-body interactions evaluated by the last Apply.
+         */
+        unsigned NodeCount;
+        unsigned long Interactions;
+
+        MutualGravity ();
+
+        /** Applies the attraction between the given bodies using the octree.
+         */
+        void Apply( RigidBody* const* bodies, unsigned count );
+
+        /** Applies the attraction between the given bodies by the direct summation
+         * over all the pairs, in O(n^2) time (the reference for Apply).
+         */
+        void ApplyDirect( RigidBody* const* bodies, unsigned count );
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_MUTUAL_GRAVITY_H_INCLUDED
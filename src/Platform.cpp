@@ -16,11 +16,18 @@
     #pragma warning(disable:4996) // vsprintf warning
 #else
     #include <unistd.h>
+    #include <time.h>
+    #include <pthread.h>
+    #include <sched.h>
 #endif
 
 #include <cstdarg>    // va_list
 #include <cstdio>     // vsprintf
 #include <cstdlib>    // exit
+#include <vector>     // std::vector
+#include <algorithm>  // std::min
+
+#include "Topology.h"
 
 namespace WoRB
 {
@@ -33,6 +40,373 @@ namespace WoRB
         #endif
     }
 
+    double MonotonicTime ()
+    {
+        #ifdef _WIN32
+            LARGE_INTEGER frequency, counter;
+            QueryPerformanceFrequency( &frequency );
+            QueryPerformanceCounter( &counter );
+            return double( counter.QuadPart ) / double( frequency.QuadPart );
+        #else
+            struct timespec ts;
+            clock_gettime( CLOCK_MONOTONIC, &ts );
+            return ts.tv_sec + 1e-9 * ts.tv_nsec;
+        #endif
+    }
+
+    bool PinThread( unsigned cpu )
+    {
+        #ifdef _WIN32
+            if ( cpu >= 8 * sizeof( DWORD_PTR ) ) {
+                return false;
+            }
+            return SetThreadAffinityMask( GetCurrentThread (), DWORD_PTR(1) << cpu ) != 0;
+        #elif defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO( &set );
+            CPU_SET( cpu, &set );
+            return pthread_setaffinity_np( pthread_self (), sizeof( set ), &set ) == 0;
+        #else
+            (void)cpu;
+            return false;
+        #endif
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////
+    // The pool of the workers of ParallelFor and ParallelRegion
+    //
+    // The workers are created when first needed and then parked on a condition
+    // variable between the regions; the calling thread of a region is its worker 0.
+    // A single region runs at a time: a region requested meanwhile (from another
+    // thread or from a worker of the running region) runs on its calling thread only.
+
+    #ifdef _WIN32
+        typedef SRWLOCK            PoolLock;
+        typedef CONDITION_VARIABLE PoolCondition;
+        #define WORB_POOL_LOCK      SRWLOCK_INIT
+        #define WORB_POOL_CONDITION CONDITION_VARIABLE_INIT
+
+        static void Acquire( PoolLock& lock )    { AcquireSRWLockExclusive( &lock ); }
+        static void Release( PoolLock& lock )    { ReleaseSRWLockExclusive( &lock ); }
+        static bool TryAcquire( PoolLock& lock ) { return TryAcquireSRWLockExclusive( &lock ) != 0; }
+        static void Broadcast( PoolCondition& c ) { WakeAllConditionVariable( &c ); }
+        static void Wait( PoolCondition& c, PoolLock& lock ) {
+            SleepConditionVariableSRW( &c, &lock, INFINITE, 0 );
+        }
+    #else
+        typedef pthread_mutex_t PoolLock;
+        typedef pthread_cond_t  PoolCondition;
+        #define WORB_POOL_LOCK      PTHREAD_MUTEX_INITIALIZER
+        #define WORB_POOL_CONDITION PTHREAD_COND_INITIALIZER
+
+        static void Acquire( PoolLock& lock )    { pthread_mutex_lock( &lock ); }
+        static void Release( PoolLock& lock )    { pthread_mutex_unlock( &lock ); }
+        static bool TryAcquire( PoolLock& lock ) { return pthread_mutex_trylock( &lock ) == 0; }
+        static void Broadcast( PoolCondition& c ) { pthread_cond_broadcast( &c ); }
+        static void Wait( PoolCondition& c, PoolLock& lock ) {
+            pthread_cond_wait( &c, &lock );
+        }
+    #endif
+
+    typedef void ( *RegionFunction )( void* context, unsigned worker, unsigned workers );
+
+    static PoolLock      PoolMutex    = WORB_POOL_LOCK;      // Guards the state below
+    static PoolLock      RegionOwner  = WORB_POOL_LOCK;      // Held during a region
+    static PoolCondition WorkersWake  = WORB_POOL_CONDITION; // A region was started
+    static PoolCondition WorkersIdle  = WORB_POOL_CONDITION; // The region was finished
+    static PoolCondition BarrierOpen  = WORB_POOL_CONDITION; // All reached the barrier
+
+    static unsigned       PoolSize     = 0; // The number of the pool workers (1, 2, ...)
+    static unsigned long  RegionRound  = 0; // The number of the started regions
+    static RegionFunction RegionBody   = 0;
+    static void*          RegionContext = 0;
+    static unsigned       RegionWorkers = 0; // The workers of the region, incl. the caller
+    static unsigned       RegionRunning = 0; // The pool workers still in the region
+    static unsigned       BarrierCount  = 0; // The workers waiting at the barrier
+    static unsigned long  BarrierRound  = 0; // The number of the passed barriers
+
+    // Holds the processors of the pinned workers, and the number of their changes.
+    //
+    static std::vector<unsigned> WorkerCpus;
+    static unsigned long CpuRound = 0;
+
+    void SetWorkerCpus( const unsigned* cpus, unsigned count )
+    {
+        Acquire( PoolMutex );
+        WorkerCpus.assign( cpus, cpus + count );
+        ++CpuRound;
+        Release( PoolMutex );
+    }
+
+    unsigned PinnedWorkerCount ()
+    {
+        Acquire( PoolMutex );
+        unsigned count = unsigned( WorkerCpus.size () );
+        Release( PoolMutex );
+        return count;
+    }
+
+    // Holds the start of a pool worker.
+    //
+    struct WorkerStart
+    {
+        unsigned Index;        // The index of the worker in the regions
+        unsigned long Round;   // The last region started before the worker
+    };
+
+    #ifdef _WIN32
+        static DWORD WINAPI PoolWorker( LPVOID arg )
+    #else
+        static void* PoolWorker( void* arg )
+    #endif
+    {
+        WorkerStart* start = static_cast<WorkerStart*>( arg );
+        const unsigned index = start->Index;
+        unsigned long seen = start->Round;
+        delete start;
+
+        // The processors the worker was created with, restored when the pinning stops
+        //
+        #ifdef _WIN32
+            DWORD_PTR former = 0, system = 0;
+            GetProcessAffinityMask( GetCurrentProcess (), &former, &system );
+        #elif defined(__linux__)
+            cpu_set_t former;
+            bool known = pthread_getaffinity_np(
+                pthread_self (), sizeof( former ), &former ) == 0;
+        #endif
+
+        unsigned long pinned = 0; // The CpuRound the worker is placed for
+
+        Acquire( PoolMutex );
+
+        for ( ;; )
+        {
+            while ( RegionRound == seen ) {
+                Wait( WorkersWake, PoolMutex );
+            }
+            seen = RegionRound;
+
+            if ( index >= RegionWorkers ) { // Not needed in this region
+                continue;
+            }
+
+            // Pinned once after every change of the processors
+            //
+            int cpu = -2; // Not changed
+            if ( pinned != CpuRound ) {
+                pinned = CpuRound;
+                cpu = WorkerCpus.empty () ? -1
+                    : int( WorkerCpus[ index % WorkerCpus.size () ] );
+            }
+
+            RegionFunction body = RegionBody;
+            void* context = RegionContext;
+            const unsigned workers = RegionWorkers;
+
+            Release( PoolMutex );
+
+            if ( cpu >= 0 ) {
+                PinThread( unsigned( cpu ) );
+            }
+            else if ( cpu == -1 ) {
+                #ifdef _WIN32
+                    SetThreadAffinityMask( GetCurrentThread (), former );
+                #elif defined(__linux__)
+                    if ( known ) {
+                        pthread_setaffinity_np( pthread_self (), sizeof( former ), &former );
+                    }
+                #endif
+            }
+
+            body( context, index, workers );
+
+            Acquire( PoolMutex );
+            if ( --RegionRunning == 0 ) {
+                Broadcast( WorkersIdle );
+            }
+        }
+
+        #ifndef _WIN32
+            return 0; // Never reached
+        #endif
+    }
+
+    #ifndef _WIN32
+        // A forked child has only the forking thread; the pool is locked across
+        // the fork, so the child gets it in a consistent state, without the workers.
+        //
+        static void BeforeFork () { Acquire( PoolMutex ); }
+        static void AfterFork ()  { Release( PoolMutex ); }
+        static void InChild ()    { PoolSize = 0; Release( PoolMutex ); }
+    #endif
+
+    // Starts the pool workers up to the given count (the pool is locked);
+    // returns the number of the pool workers.
+    //
+    static unsigned GrowPool( unsigned count )
+    {
+        #ifndef _WIN32
+            static bool registered = false;
+            if ( ! registered ) {
+                registered = pthread_atfork( BeforeFork, AfterFork, InChild ) == 0;
+            }
+        #endif
+
+        while ( PoolSize < count )
+        {
+            WorkerStart* start = new WorkerStart;
+            start->Index = PoolSize + 1;
+            start->Round = RegionRound;
+
+            #ifdef _WIN32
+                HANDLE handle = CreateThread( 0, 0, PoolWorker, start, 0, 0 );
+                if ( ! handle ) {
+                    delete start;
+                    break;
+                }
+                CloseHandle( handle );
+            #else
+                pthread_t thread;
+                if ( pthread_create( &thread, 0, PoolWorker, start ) != 0 ) {
+                    delete start;
+                    break;
+                }
+                pthread_detach( thread );
+            #endif
+
+            ++PoolSize;
+        }
+
+        return PoolSize;
+    }
+
+    void ParallelRegion( unsigned threads, RegionFunction body, void* context )
+    {
+        if ( threads <= 1 || ! TryAcquire( RegionOwner ) ) {
+            body( context, 0, 1 );
+            return;
+        }
+
+        Acquire( PoolMutex );
+
+        // The pool may be larger, grown by an earlier region; only the workers
+        // asked for take part
+        //
+        const unsigned workers = 1 + std::min( GrowPool( threads - 1 ), threads - 1 );
+
+        RegionBody    = body;
+        RegionContext = context;
+        RegionWorkers = workers;
+        RegionRunning = workers - 1;
+        BarrierCount  = 0;
+        ++RegionRound;
+
+        const int cpu = WorkerCpus.empty () ? -1 : int( WorkerCpus[0] );
+
+        Broadcast( WorkersWake );
+        Release( PoolMutex );
+
+        // The calling thread is the worker 0, restored to its former processors
+        //
+        #ifdef _WIN32
+            DWORD_PTR process = 0, system = 0;
+            if ( cpu >= 0 ) {
+                GetProcessAffinityMask( GetCurrentProcess (), &process, &system );
+                PinThread( unsigned( cpu ) );
+            }
+            body( context, 0, workers );
+            if ( cpu >= 0 ) {
+                SetThreadAffinityMask( GetCurrentThread (), process );
+            }
+        #else
+            #ifdef __linux__
+                cpu_set_t former;
+                bool restore = cpu >= 0
+                    && pthread_getaffinity_np( pthread_self (), sizeof( former ), &former ) == 0;
+                if ( restore ) {
+                    PinThread( unsigned( cpu ) );
+                }
+            #endif
+            body( context, 0, workers );
+            #ifdef __linux__
+                if ( restore ) {
+                    pthread_setaffinity_np( pthread_self (), sizeof( former ), &former );
+                }
+            #endif
+        #endif
+
+        Acquire( PoolMutex );
+        while ( RegionRunning > 0 ) {
+            Wait( WorkersIdle, PoolMutex );
+        }
+        Release( PoolMutex );
+
+        Release( RegionOwner );
+    }
+
+    void RegionBarrier( unsigned workers )
+    {
+        if ( workers <= 1 ) {
+            return;
+        }
+
+        Acquire( PoolMutex );
+
+        const unsigned long round = BarrierRound;
+        if ( ++BarrierCount == workers )
+        {
+            BarrierCount = 0;
+            ++BarrierRound;
+            Broadcast( BarrierOpen );
+        }
+        else
+        {
+            while ( BarrierRound == round ) {
+                Wait( BarrierOpen, PoolMutex );
+            }
+        }
+
+        Release( PoolMutex );
+    }
+
+    // Holds the arguments of ParallelFor during its region.
+    //
+    struct ParallelLoop
+    {
+        void ( *Body )( void* context, unsigned begin, unsigned end );
+        void* Context;
+        unsigned Count;
+    };
+
+    static void ParallelChunk( void* context, unsigned worker, unsigned workers )
+    {
+        const ParallelLoop& loop = *static_cast<ParallelLoop*>( context );
+
+        unsigned begin = unsigned( (unsigned long long)loop.Count * worker / workers );
+        unsigned end   = unsigned( (unsigned long long)loop.Count * ( worker + 1 ) / workers );
+        if ( end > begin ) {
+            loop.Body( loop.Context, begin, end );
+        }
+    }
+
+    void ParallelFor( unsigned count, unsigned threads,
+        void ( *body )( void* context, unsigned begin, unsigned end ), void* context )
+    {
+        if ( threads > count ) {
+            threads = count;
+        }
+        if ( threads <= 1 ) {
+            if ( count > 0 ) {
+                body( context, 0, count );
+            }
+            return;
+        }
+
+        ParallelLoop loop = { body, context, count };
+        ParallelRegion( threads, ParallelChunk, &loop );
+    }
+
     void Printf( const char* format, ... )
     {
         va_list args;
@@ -0,0 +1,861 @@
+#ifndef _WORB_POLICIES_H_INCLUDED
+#define _WORB_POLICIES_H_INCLUDED
+
+/**
+ *  @file      Policies.h
+ *  @brief     Definitions of the policy classes that configure WorldOfRigidBodies
+ *             at compile-time: broadphase, solver, integrator and diagnostics.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-24
+ *  @copyright GNU Public License.
+ *
+ * Every policy is a class whose instance is a member of WorldOfRigidBodies. Static
+ * policies are empty classes with inline methods, so a specialized instantiation
+ * has no run-time branching or indirect calls in the time-step loop. The `Dynamic`
+ * policies select the method at run-time and are meant for applications that
+ * have to switch between methods (and as a reference in benchmarks).
+ *
+ * The default policies reproduce the original time-step to within the ordering
+ * of ties: the candidate pairs are detected bucket by bucket (see CandidatePairs),
+ * not in the order the broadphase found them, so the contacts are registered
+ * in a different order than by the original `i < j` loop. The solvers pick
+ * the contact with the largest bouncing velocity (or penetration) first, taking
+ * the first one registered among equal values, so the results differ only where
+ * the contacts of different pairs tie (or when the collision registry overflows
+ * and other contacts are dropped).
+ *
+ * The policy interfaces are:
+ *
+ * @li Broadphase:  `void FindPairs( CandidatePairs&, Geometry* const* object, unsigned n )`;
+ *                  for the scene queries (see SceneQuery.h) also
+ *                  `void Update( Geometry* const* object, unsigned n )`, which brings
+ *                  the bounds up to date, and `template<class Visitor> void Query(
+ *                  const Quaternion& boxMin, const Quaternion& boxMax, Geometry* const*
+ *                  object, unsigned n, Visitor& ) const`, which calls `visitor( geometry )`
+ *                  for every geometry that may overlap the axis-aligned box;
+ *                  `void Remap( const unsigned* newIndex, unsigned n )`, called when
+ *                  the objects were reordered (`newIndex[i]` is the new index of
+ *                  the object `i`); `void Reset ()`, called when the objects were
+ *                  removed (the next objects may have the same count)
+ * @li Solver:      `void Resolve( CollisionResolver&, double h )`
+ * @li Integrator:  `void Integrate( RigidBody&, double h )`
+ * @li Diagnostics: `template<class World> void Update( World& )`
+ */
+
+#include "RigidBody.h"
+#include "Kinematic.h"
+#include "CollisionResolver.h"
+#include "CandidatePairs.h"
+#include "Compound.h"
+#include "ConvexHull.h"
+
+#include <vector>     // we use: std::vector
+#include <algorithm>  // we use: std::sort
+
+namespace WoRB
+{
+    /** Calls `body( context, begin, end )` for the consecutive chunks of [0, count)
+     * in parallel, using up to the given number of threads (including the calling
+     * thread); implemented in Platform.cpp.
+     *
+     * The threads are the workers of a pool, created once and parked between
+     * the calls (see ParallelRegion).
+     */
+    void ParallelFor( unsigned count, unsigned threads,
+        void ( *body )( void* context, unsigned begin, unsigned end ), void* context );
+
+    /** Calls `body( context, worker, workers )` at once on every worker of a parallel
+     * region of up to the given number of threads, the calling thread being
+     * the worker 0; implemented in Platform.cpp.
+     *
+     * The `workers` may be fewer than requested: a region started while another
+     * region runs (e.g. from its workers) runs on the calling thread alone. The workers
+     * may divide the work into phases separated by RegionBarrier.
+     */
+    void ParallelRegion( unsigned threads,
+        void ( *body )( void* context, unsigned worker, unsigned workers ), void* context );
+
+    /** Waits until all the `workers` workers of the running region reach the barrier
+     * (returns at once for a single worker); implemented in Platform.cpp.
+     */
+    void RegionBarrier( unsigned workers );
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // Broadphase policies
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Gets the radius of the sphere bounding the geometry (centered at its position),
+     * or a negative value if the geometry is unbounded (e.g. a half-space).
+     */
+    inline double BoundingRadius( const Geometry& geometry )
+    {
+        if ( geometry.IsSphere () ) {
+            return static_cast<const Sphere&>( geometry ).Radius;
+        }
+        if ( geometry.IsCuboid () ) {
+            return static_cast<const Cuboid&>( geometry ).HalfExtent.ImNorm ();
+        }
+        if ( geometry.IsCompound () ) {
+            return static_cast<const Compound&>( geometry ).Radius;
+        }
+        if ( geometry.IsConvexHull () ) {
+            return static_cast<const ConvexHull&>( geometry ).Radius;
+        }
+        return -1;
+    }
+
+    /** Gets the displacement of the geometry during the last time-step, across which
+     * its bounds are swept (non-zero only for the kinematic bodies).
+     */
+    inline Quaternion SweptDisplacement( const Geometry& geometry )
+    {
+        if ( geometry.Body && geometry.Body->Kinematic ) {
+            return geometry.Body->Kinematic->Displacement;
+        }
+        return Quaternion ();
+    }
+
+    /** Tests every pair of geometries (the original O(n^2) method).
+     */
+    class AllPairs
+    {
+    public:
+
+        void FindPairs( CandidatePairs& pairs, Geometry* const* object, unsigned count )
+        {
+            for ( unsigned i = 0; i < count; ++i )
+            {
+                for ( unsigned j = i + 1; j < count; ++j )
+                {
+                    pairs.Add( object[i], object[j] );
+                }
+            }
+        }
+
+        void Update( Geometry* const*, unsigned )
+        {
+        }
+
+        void Remap( const unsigned*, unsigned )
+        {
+        }
+
+        void Reset ()
+        {
+        }
+
+        template<class Visitor>
+        void Query( const Quaternion&, const Quaternion&,
+            Geometry* const* object, unsigned count, Visitor& visitor ) const
+        {
+            for ( unsigned i = 0; i < count; ++i ) {
+                visitor( *object[i] );
+            }
+        }
+    };
+
+    /** Sorts bounding intervals along the x-axis and tests only the pairs whose
+     * intervals overlap. Unbounded geometries are tested against every geometry.
+     *
+     * The sorted order is kept between the time-steps; since the bodies move little
+     * during a time-step, the insertion sort used to restore the order runs in
+     * nearly linear time. The intervals of the kinematic bodies are swept across
+     * their motion during the last time-step.
+     */
+    class SweepAndPrune
+    {
+    protected:
+
+        /** Holds the bounding interval of a geometry.
+         */
+        struct Interval
+        {
+            double   Min;    //!< Holds the lower bound
+            double   Max;    //!< Holds the upper bound
+            unsigned Index;  //!< Holds the index of the geometry
+        };
+
+        std::vector<Interval> Intervals;  //!< Holds the intervals in the sorted order
+        std::vector<unsigned> Unbounded;  //!< Holds the indices of unbounded geometries
+        unsigned ObjectCount;             //!< Holds the object count of the last sweep
+        double MaxWidth;                  //!< Holds the width of the widest interval
+
+        /** Adds the pair of geometries `i` and `j` in the order used by AllPairs
+         * (lower index first).
+         */
+        static void Pair( CandidatePairs& pairs, Geometry* const* object,
+            unsigned i, unsigned j )
+        {
+            if ( i < j ) {
+                pairs.Add( object[i], object[j] );
+            }
+            else {
+                pairs.Add( object[j], object[i] );
+            }
+        }
+
+        /** Computes the bounding interval of the geometry along the x-axis, swept
+         * across its motion during the last time-step.
+         */
+        static void Bound( Interval& interval, Geometry* const* object )
+        {
+            const Geometry& g = *object[ interval.Index ];
+            double x = g.Position ().x;
+            double r = BoundingRadius( g );
+            double x_last = x - SweptDisplacement( g ).x;
+            interval.Min = std::min( x, x_last ) - r;
+            interval.Max = std::max( x, x_last ) + r;
+        }
+
+        /** Moves the interval `k` back to its place among the sorted intervals
+         * before it (a step of the insertion sort).
+         */
+        void Insert( unsigned k )
+        {
+            Interval current = Intervals[k];
+            unsigned m = k;
+            for ( ; m > 0 && Intervals[m-1].Min > current.Min; --m ) {
+                Intervals[m] = Intervals[m-1];
+            }
+            Intervals[m] = current;
+        }
+
+        /** Adds the pairs of the sorted intervals in range [begin, end) with all
+         * the following intervals that overlap them.
+         */
+        void Sweep( CandidatePairs& pairs, Geometry* const* object,
+            unsigned begin, unsigned end ) const
+        {
+            const unsigned n = unsigned( Intervals.size () );
+
+            for ( unsigned a = begin; a < end; ++a )
+            {
+                const Interval& A = Intervals[a];
+
+                for ( unsigned b = a + 1; b < n && Intervals[b].Min <= A.Max; ++b ) {
+                    Pair( pairs, object, A.Index, Intervals[b].Index );
+                }
+            }
+        }
+
+        /** Adds the pairs of the unbounded geometries with all the other geometries.
+         */
+        void PairUnbounded( CandidatePairs& pairs, Geometry* const* object ) const
+        {
+            const unsigned n = unsigned( Intervals.size () );
+
+            for ( unsigned u = 0; u < Unbounded.size (); ++u )
+            {
+                for ( unsigned k = 0; k < n; ++k ) {
+                    Pair( pairs, object, Unbounded[u], Intervals[k].Index );
+                }
+                for ( unsigned v = u + 1; v < Unbounded.size (); ++v ) {
+                    Pair( pairs, object, Unbounded[u], Unbounded[v] );
+                }
+            }
+        }
+
+        /** Orders the intervals by their lower bounds, then by the geometries (the order
+         * the insertion sort keeps for the intervals in the object order).
+         */
+        static bool Precedes( const Interval& a, const Interval& b )
+        {
+            return a.Min < b.Min || ( a.Min == b.Min && a.Index < b.Index );
+        }
+
+        /** Rebuilds the list of intervals (in the object order). The new intervals are
+         * then sorted at once by Update: the insertion sort is quadratic for
+         * the geometries of a new scene in a random order.
+         */
+        void Rebuild( Geometry* const* object, unsigned count )
+        {
+            Intervals.clear ();
+            Unbounded.clear ();
+
+            for ( unsigned i = 0; i < count; ++i )
+            {
+                if ( BoundingRadius( *object[i] ) < 0 ) {
+                    Unbounded.push_back( i );
+                }
+                else {
+                    Interval interval = { 0, 0, i };
+                    Intervals.push_back( interval );
+                }
+            }
+
+            ObjectCount = count;
+        }
+
+    public:
+
+        SweepAndPrune ()
+            : ObjectCount( 0 )
+            , MaxWidth( 0 )
+        {
+        }
+
+        void FindPairs( CandidatePairs& pairs, Geometry* const* object, unsigned count )
+        {
+            Update( object, count );
+
+            // Sweep the bounded geometries, then test the unbounded geometries
+            // against all the other geometries
+            //
+            Sweep( pairs, object, 0, unsigned( Intervals.size () ) );
+            PairUnbounded( pairs, object );
+        }
+
+        /** Updates the bounds and restores the sorted order (insertion sort).
+         */
+        void Update( Geometry* const* object, unsigned count )
+        {
+            const bool rebuilt = count != ObjectCount;
+            if ( rebuilt ) {
+                Rebuild( object, count );
+            }
+
+            const unsigned n = unsigned( Intervals.size () );
+            MaxWidth = 0;
+
+            for ( unsigned k = 0; k < n; ++k )
+            {
+                Bound( Intervals[k], object );
+                MaxWidth = std::max( MaxWidth, Intervals[k].Max - Intervals[k].Min );
+                if ( ! rebuilt ) {
+                    Insert( k );
+                }
+            }
+
+            if ( rebuilt ) {
+                std::sort( Intervals.begin (), Intervals.end (), Precedes );
+            }
+        }
+
+        /** Renumbers the geometries in the intervals after the objects were reordered,
+         * keeping the sorted order.
+         */
+        void Remap( const unsigned* newIndex, unsigned count )
+        {
+            if ( count != ObjectCount ) { // Rebuilt by the next Update
+                return;
+            }
+
+            for ( unsigned k = 0; k < Intervals.size (); ++k ) {
+                Intervals[k].Index = newIndex[ Intervals[k].Index ];
+            }
+            for ( unsigned u = 0; u < Unbounded.size (); ++u ) {
+                Unbounded[u] = newIndex[ Unbounded[u] ];
+            }
+        }
+
+        /** Forgets the intervals, so they are rebuilt by the next Update even if
+         * the new objects have the same count.
+         */
+        void Reset ()
+        {
+            Intervals.clear ();
+            Unbounded.clear ();
+            ObjectCount = ~0u; // Differs from any count of the objects
+            MaxWidth = 0;
+        }
+
+        /** Visits the geometries whose intervals overlap the box along the x-axis
+         * (found by a binary search in the sorted intervals) and all the unbounded
+         * geometries. The bounds are those of the last Update (or FindPairs).
+         */
+        template<class Visitor>
+        void Query( const Quaternion& boxMin, const Quaternion& boxMax,
+            Geometry* const* object, unsigned count, Visitor& visitor ) const
+        {
+            if ( count != ObjectCount ) // Not updated since the objects changed
+            {
+                for ( unsigned i = 0; i < count; ++i ) {
+                    visitor( *object[i] );
+                }
+                return;
+            }
+
+            // The first interval that may reach the box starts at most MaxWidth
+            // before the box
+            //
+            const unsigned n = unsigned( Intervals.size () );
+            const double start = boxMin.x - MaxWidth;
+
+            unsigned lo = 0, hi = n;
+            while ( lo < hi )
+            {
+                unsigned mid = ( lo + hi ) / 2;
+                if ( Intervals[mid].Min < start ) {
+                    lo = mid + 1;
+                }
+                else {
+                    hi = mid;
+                }
+            }
+
+            for ( unsigned k = lo; k < n && Intervals[k].Min <= boxMax.x; ++k ) {
+                if ( Intervals[k].Max >= boxMin.x ) {
+                    visitor( *object[ Intervals[k].Index ] );
+                }
+            }
+
+            for ( unsigned u = 0; u < Unbounded.size (); ++u ) {
+                visitor( *object[ Unbounded[u] ] );
+            }
+        }
+    };
+
+    /** Runs the sweep and prune on multiple threads, finding the same pairs in
+     * the same order as SweepAndPrune.
+     *
+     * The bounds are computed in parallel before the (serial, nearly linear) insertion
+     * sort. The sorted intervals are then split into slabs along the x-axis, each
+     * with the same number of intervals, and every slab is swept on its own thread
+     * into its own list of pairs. A slab owns the pairs whose first interval starts
+     * in it, so the pairs with the intervals straddling into the following slabs
+     * are found exactly once. The lists are appended in the slab order, which is
+     * the order of the serial sweep, and the unbounded geometries are paired last.
+     */
+    class ParallelSweepAndPrune : public SweepAndPrune
+    {
+        /** Holds the pairs found in every slab.
+         */
+        std::vector<CandidatePairs> SlabPairs;
+
+        /** Holds the arguments of the parallel passes.
+         */
+        struct Batch
+        {
+            ParallelSweepAndPrune* self;
+            Geometry* const* object;
+        };
+
+        static void BoundBatch( void* context, unsigned begin, unsigned end )
+        {
+            Batch& batch = *static_cast<Batch*>( context );
+            for ( unsigned k = begin; k < end; ++k ) {
+                Bound( batch.self->Intervals[k], batch.object );
+            }
+        }
+
+        static void SweepBatch( void* context, unsigned begin, unsigned end )
+        {
+            Batch& batch = *static_cast<Batch*>( context );
+            ParallelSweepAndPrune& self = *batch.self;
+
+            const unsigned long long n = self.Intervals.size ();
+            const unsigned slabs = unsigned( self.SlabPairs.size () );
+
+            for ( unsigned s = begin; s < end; ++s )
+            {
+                self.SlabPairs[s].Clear ();
+                self.Sweep( self.SlabPairs[s], batch.object,
+                    unsigned( n * s / slabs ), unsigned( n * ( s + 1 ) / slabs ) );
+            }
+        }
+
+    public:
+
+        /** Holds the number of threads (including the calling thread), which is
+         * also the number of slabs.
+         */
+        unsigned Threads;
+
+        ParallelSweepAndPrune ()
+            : Threads( 4 )
+        {
+        }
+
+        void FindPairs( CandidatePairs& pairs, Geometry* const* object, unsigned count )
+        {
+            Update( object, count );
+
+            const unsigned slabs = Threads > 1 ? Threads : 1;
+            SlabPairs.resize( slabs );
+
+            Batch batch = { this, object };
+            ParallelFor( slabs, Threads, SweepBatch, &batch );
+
+            for ( unsigned s = 0; s < slabs; ++s ) {
+                pairs.Append( SlabPairs[s] );
+            }
+
+            PairUnbounded( pairs, object );
+        }
+
+        /** Updates the bounds in parallel and restores the sorted order.
+         */
+        void Update( Geometry* const* object, unsigned count )
+        {
+            const bool rebuilt = count != ObjectCount;
+            if ( rebuilt ) {
+                Rebuild( object, count );
+            }
+
+            const unsigned n = unsigned( Intervals.size () );
+
+            Batch batch = { this, object };
+            ParallelFor( n, Threads, BoundBatch, &batch );
+
+            MaxWidth = 0;
+            for ( unsigned k = 0; k < n; ++k )
+            {
+                MaxWidth = std::max( MaxWidth, Intervals[k].Max - Intervals[k].Min );
+                if ( ! rebuilt ) {
+                    Insert( k );
+                }
+            }
+
+            if ( rebuilt ) {
+                std::sort( Intervals.begin (), Intervals.end (), Precedes );
+            }
+        }
+    };
+
+    /** Selects the broadphase method at run-time.
+     */
+    class DynamicBroadphase
+    {
+        AllPairs      allPairs;
+        SweepAndPrune sweepAndPrune;
+
+    public:
+
+        /** Enumerates the available methods.
+         */
+        enum MethodType
+        {
+            UseAllPairs,
+            UseSweepAndPrune
+        };
+
+        /** Holds the method in use.
+         */
+        MethodType Method;
+
+        DynamicBroadphase ()
+            : Method( UseAllPairs )
+        {
+        }
+
+        void FindPairs( CandidatePairs& pairs, Geometry* const* object, unsigned count )
+        {
+            switch( Method )
+            {
+                case UseAllPairs:      allPairs.FindPairs( pairs, object, count );      break;
+                case UseSweepAndPrune: sweepAndPrune.FindPairs( pairs, object, count ); break;
+            }
+        }
+
+        void Update( Geometry* const* object, unsigned count )
+        {
+            switch( Method )
+            {
+                case UseAllPairs:      allPairs.Update( object, count );      break;
+                case UseSweepAndPrune: sweepAndPrune.Update( object, count ); break;
+            }
+        }
+
+        void Remap( const unsigned* newIndex, unsigned count )
+        {
+            allPairs.Remap( newIndex, count );
+            sweepAndPrune.Remap( newIndex, count );
+        }
+
+        void Reset ()
+        {
+            allPairs.Reset ();
+            sweepAndPrune.Reset ();
+        }
+
+        template<class Visitor>
+        void Query( const Quaternion& boxMin, const Quaternion& boxMax,
+            Geometry* const* object, unsigned count, Visitor& visitor ) const
+        {
+            switch( Method )
+            {
+                case UseAllPairs:
+                    allPairs.Query( boxMin, boxMax, object, count, visitor );
+                    break;
+                case UseSweepAndPrune:
+                    sweepAndPrune.Query( boxMin, boxMax, object, count, visitor );
+                    break;
+            }
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // Solver policies
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Resolves collisions using impulse transfers followed by position projections
+     * (the original method).
+     */
+    class SequentialImpulses
+    {
+    public:
+
+        void Resolve( CollisionResolver& collisions, double h )
+        {
+            collisions.UpdateDerivedQuantities( h );
+            collisions.ImpulseTransfers( h );
+            collisions.PositionProjections ();
+        }
+    };
+
+    /** Resolves the impacts using impulse transfers, the resting contacts using
+     * shock propagation, followed by position projections that keep the sleeping
+     * bodies in place; suitable for the tall stacks, which settle (and fall
+     * asleep) in far fewer impulse transfers.
+     */
+    class ShockPropagation
+    {
+    public:
+
+        /** Holds the bouncing velocity above which the contacts are impacts,
+         * resolved by the impulse transfers (by default, the velocity below which
+         * the restitution is ignored).
+         */
+        double ImpactVelocity;
+
+        /** Indicates whether the contact manifolds are resolved as blocks
+         * (see CollisionResolver::BlockImpulseTransfers).
+         */
+        bool UseBlockSolver;
+
+        ShockPropagation ()
+            : ImpactVelocity( 0.25 )
+            , UseBlockSolver( false )
+        {
+        }
+
+        void Resolve( CollisionResolver& collisions, double h )
+        {
+            collisions.UpdateDerivedQuantities( h );
+
+            if ( UseBlockSolver ) {
+                collisions.BlockImpulseTransfers( h, 0, ImpactVelocity );
+            }
+            else {
+                collisions.ImpulseTransfers( h, 0, ImpactVelocity );
+            }
+
+            collisions.ShockPropagation( h, 0, 0.01, UseBlockSolver );
+            collisions.PositionProjections( 0, 0.01, true );
+        }
+    };
+
+    /** Resolves collisions using impulse transfers only (the interpenetration
+     * is not corrected).
+     */
+    class ImpulsesOnly
+    {
+    public:
+
+        void Resolve( CollisionResolver& collisions, double h )
+        {
+            collisions.UpdateDerivedQuantities( h );
+            collisions.ImpulseTransfers( h );
+        }
+    };
+
+    /** Resolves collisions using impulse transfers with the contact manifolds
+     * resolved as blocks, followed by position projections; suitable for the boxes
+     * resting on their faces.
+     */
+    class BlockImpulses
+    {
+    public:
+
+        void Resolve( CollisionResolver& collisions, double h )
+        {
+            collisions.UpdateDerivedQuantities( h );
+            collisions.BlockImpulseTransfers( h );
+            collisions.PositionProjections ();
+        }
+    };
+
+    /** Resolves all the collisions at once using the accelerated projected gradient
+     * method, followed by position projections; suitable for the large coupled
+     * systems of contacts with high mass ratios (e.g. heavy bodies on light ones).
+     */
+    class AcceleratedImpulses
+    {
+    public:
+
+        /** Holds the number of the threads of the parallel products and projections.
+         */
+        unsigned Threads;
+
+        /** Holds the maximum number of the iterations (0 for the default).
+         */
+        unsigned MaxIterations;
+
+        /** Holds the tolerated velocity error at the contacts.
+         */
+        double Tolerance;
+
+        AcceleratedImpulses ()
+            : Threads( 1 )
+            , MaxIterations( 0 )
+            , Tolerance( 0.01 )
+        {
+        }
+
+        void Resolve( CollisionResolver& collisions, double h )
+        {
+            collisions.UpdateDerivedQuantities( h );
+            collisions.AcceleratedImpulses( h, MaxIterations, Tolerance, Threads );
+            collisions.PositionProjections ();
+        }
+    };
+
+    /** Selects the collision response method at run-time.
+     */
+    class DynamicSolver
+    {
+    public:
+
+        /** Indicates whether position projections follow the impulse transfers.
+         */
+        bool UsePositionProjections;
+
+        /** Indicates whether shock propagation follows the impulse transfers
+         * (the position projections then keep the sleeping bodies in place).
+         */
+        bool UseShockPropagation;
+
+        /** Indicates whether the contact manifolds are resolved as blocks.
+         */
+        bool UseBlockSolver;
+
+        DynamicSolver ()
+            : UsePositionProjections( true )
+            , UseShockPropagation( false )
+            , UseBlockSolver( false )
+        {
+        }
+
+        void Resolve( CollisionResolver& collisions, double h )
+        {
+            collisions.UpdateDerivedQuantities( h );
+
+            if ( UseBlockSolver ) {
+                collisions.BlockImpulseTransfers( h );
+            }
+            else {
+                collisions.ImpulseTransfers( h );
+            }
+
+            if ( UseShockPropagation ) {
+                collisions.ShockPropagation( h, 0, 0.01, UseBlockSolver );
+            }
+
+            if ( UsePositionProjections ) {
+                collisions.PositionProjections( 0, 0.01, UseShockPropagation );
+            }
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // Integrator policies
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Integrates the equations of motion using the semi-implicit Euler method
+     * (RigidBody::SolveODE; the original method).
+     */
+    class SemiImplicitEuler
+    {
+    public:
+
+        static void Step( RigidBody& body, double h )
+        {
+            body.SolveODE( h );
+        }
+
+        void Integrate( RigidBody& body, double h )
+        {
+            body.SolveODE( h );
+        }
+    };
+
+    /** Integrates the equations of motion using a user supplied function.
+     */
+    class DynamicIntegrator
+    {
+    public:
+
+        /** Points to the integration function called for every body.
+         */
+        void ( *Function )( RigidBody& body, double h );
+
+        DynamicIntegrator ()
+            : Function( SemiImplicitEuler::Step )
+        {
+        }
+
+        void Integrate( RigidBody& body, double h )
+        {
+            Function( body, h );
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // Diagnostics policies
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Calculates the total energy and momenta after every time-step
+     * (the original behaviour).
+     */
+    class FullDiagnostics
+    {
+    public:
+
+        template<class World>
+        void Update( World& worb )
+        {
+            worb.CalculateTotals ();
+        }
+    };
+
+    /** Skips the calculation of the totals; they are calculated only when the system
+     * is initialized (or when World::CalculateTotals is called explicitly).
+     */
+    class NoDiagnostics
+    {
+    public:
+
+        template<class World>
+        void Update( World& )
+        {
+        }
+    };
+
+    /** Enables or disables the calculation of the totals at run-time.
+     */
+    class DynamicDiagnostics
+    {
+    public:
+
+        /** Indicates whether the totals are calculated after every time-step.
+         */
+        bool Enabled;
+
+        DynamicDiagnostics ()
+            : Enabled( true )
+        {
+        }
+
+        template<class World>
+        void Update( World& worb )
+        {
+            if ( Enabled ) {
+                worb.CalculateTotals ();
+            }
+        }
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_POLICIES_H_INCLUDED
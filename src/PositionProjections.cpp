@@ -14,7 +14,8 @@ using namespace WoRB;
 /////////////////////////////////////////////////////////////////////////////////////////
 // Resolves collisions in the system using the position projection method.
 //
-void CollisionResolver::PositionProjections( unsigned maxIterations, double eps )
+void CollisionResolver::PositionProjections( unsigned maxIterations, double eps,
+    bool keepAsleep )
 {
     if ( CollisionCount == 0 ) {
         return; // Nothing to do
@@ -36,19 +37,23 @@ void CollisionResolver::PositionProjections( unsigned maxIterations, double eps
     {
         // Find the contact with the largest penetration
         //
-        Collision* contact = FindLargestPenetration( eps );
+        Collision* contact = FindLargestPenetration( eps, keepAsleep );
         if ( ! contact ) {
             break; // Done, if there are no penetrations
         }
 
-        // Activate bodies participating in the collision that are lying inactive
-        // @fixme (disabled since impulse transfer should wake bodies)
-        contact->ActivateInactiveBodies ();
+        // Activate bodies participating in the collision that are lying inactive,
+        // unless they are kept asleep; then they take part in the projection
+        // as if they had infinite mass.
+        //
+        if ( ! keepAsleep ) {
+            contact->ActivateInactiveBodies ();
+        }
 
         // Calculate and apply position/orientation jolt that resolve the penetration
         // 
         Quaternion X_jolt[2], Q_jolt[2];
-        contact->PositionProjection( X_jolt, Q_jolt, Relaxation );
+        contact->PositionProjection( X_jolt, Q_jolt, Relaxation, keepAsleep );
 
         // However, the resolution may have changed the penetration of other
         // bodies, so we need to update affected collision data.
@@ -88,7 +93,8 @@ void CollisionResolver::PositionProjections( unsigned maxIterations, double eps
 void Collision::PositionProjection(
         Quaternion X_jolt[2], // applied position change
         Quaternion Q_jolt[2], // applied orientation change
-        double relaxation     // Position projections relaxation coefficient
+        double relaxation,    // Position projections relaxation coefficient
+        bool keepAsleep       // Whether the inactive bodies are left in place
     )
 {
     RigidBody** Body = &Body_A;
@@ -102,7 +108,10 @@ void Collision::PositionProjection(
 
     for ( unsigned i = 0; i < 2; ++i ) 
     {
-        if ( ! Body[i] ) {
+        X_jolt[i] = 0.0;
+        Q_jolt[i] = 0.0;
+
+        if ( ! Body[i] || ( keepAsleep && ! Body[i]->IsActive ) ) {
             continue;
         }
 
@@ -126,7 +135,7 @@ void Collision::PositionProjection(
     //
     for ( unsigned i = 0; i < 2; ++i ) 
     {
-        if ( ! Body[i]) {
+        if ( ! Body[i] || ( keepAsleep && ! Body[i]->IsActive ) ) {
             continue;
         }
 
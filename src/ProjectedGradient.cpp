@@ -0,0 +1,536 @@
+/**
+ *  @file      ProjectedGradient.cpp
+ *  @brief     Implementation of the accelerated projected gradient method, which
+ *             resolves all the contacts at once.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-03
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+
+#include <algorithm>  // we use: std::sort, std::unique, std::lower_bound, std::max
+#include <cmath>      // we use: fabs, sqrt
+#include <cassert>    // we use: assert
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Holds the vectors of a parallel pass.
+     */
+    struct GradientBatch
+    {
+        CollisionResolver* Self;
+        const double* X;   //!< The impulses (three per contact, in the contact frames)
+        const double* Rhs; //!< The velocities added to the product, if any
+        double* Out;       //!< The velocities at the contacts
+    };
+
+    /** Holds the iteration of AcceleratedImpulses during its parallel region.
+     */
+    struct GradientIteration
+    {
+        CollisionResolver* Self;
+        unsigned MaxIterations;
+        double Eps;
+        unsigned Iterations; //!< The number of the iterations done
+        double Error;        //!< The residual of the last iteration
+    };
+
+    /** Gets the start of the chunk of the worker of `workers` in range [0, count).
+     */
+    inline unsigned ChunkStart( unsigned count, unsigned worker, unsigned workers )
+    {
+        return unsigned( (unsigned long long)count * worker / workers );
+    }
+
+    /** Projects the impulse onto the friction cone `|( y, z )| <= mu x`.
+     */
+    inline void ProjectOnCone( double* J, double mu )
+    {
+        double tangential = sqrt( J[1] * J[1] + J[2] * J[2] );
+
+        if ( mu <= 0 ) {
+            J[0] = std::max( J[0], 0.0 );
+            J[1] = J[2] = 0;
+        }
+        else if ( tangential <= mu * J[0] ) {
+            return; // Inside the cone
+        }
+        else if ( mu * tangential <= -J[0] ) {
+            J[0] = J[1] = J[2] = 0; // Inside the polar cone
+        }
+        else
+        {
+            double normal = ( J[0] + mu * tangential ) / ( mu * mu + 1 );
+            double scale = mu * normal / tangential;
+            J[0] = normal;
+            J[1] *= scale;
+            J[2] *= scale;
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// The products with the Delassus matrix.
+//
+void CollisionResolver::GradientBodyBatch( void* context, unsigned begin, unsigned end )
+{
+    const GradientBatch& batch = *static_cast<GradientBatch*>( context );
+    CollisionResolver& self = *batch.Self;
+
+    // Sum the impulses of the contacts of every body (the Jacobian by body)
+    //
+    for ( unsigned b = begin; b < end; ++b )
+    {
+        Quaternion P( 0.0 ), L( 0.0 );
+
+        for ( unsigned e = self.GradientStart[b]; e < self.GradientStart[ b + 1 ]; ++e )
+        {
+            unsigned k = self.GradientIncidence[e] / 2;
+            unsigned a = self.GradientIncidence[e] % 2;
+
+            const Collision& contact = self.Collisions[ self.GradientContacts[k] ];
+            const double* x = batch.X + 3 * k;
+
+            Quaternion J = contact.ToWorld( Quaternion( 0, x[0], x[1], x[2] ) );
+            if ( a ) {
+                J = -J;
+            }
+
+            P += J;
+            L += contact.RelativePosition[a].Cross( J );
+        }
+
+        self.GradientP[b] = P;
+        self.GradientL[b] = L;
+    }
+}
+
+void CollisionResolver::GradientContactBatch( void* context, unsigned begin, unsigned end )
+{
+    const GradientBatch& batch = *static_cast<GradientBatch*>( context );
+    CollisionResolver& self = *batch.Self;
+
+    // The change of the relative velocity at every contact
+    //
+    for ( unsigned k = begin; k < end; ++k )
+    {
+        const Collision& contact = self.Collisions[ self.GradientContacts[k] ];
+        Quaternion dV( 0.0 );
+
+        for ( unsigned a = 0; a < 2; ++a )
+        {
+            unsigned b = self.GradientSide[ 2 * k + a ];
+            if ( b == ~0u ) {
+                continue;
+            }
+
+            const RigidBody* body = self.GradientBodies[b];
+            Quaternion V = body->InverseMass * self.GradientP[b]
+                + ( body->InverseInertiaWorld * self.GradientL[b] )
+                    .Cross( contact.RelativePosition[a] );
+
+            dV += a ? -V : V;
+        }
+
+        Quaternion u = contact.ToWorld.TransformInverse( dV );
+
+        double* out = batch.Out + 3 * k;
+        out[0] = u.x;
+        out[1] = u.y;
+        out[2] = u.z;
+
+        if ( batch.Rhs ) {
+            out[0] += batch.Rhs[ 3 * k     ];
+            out[1] += batch.Rhs[ 3 * k + 1 ];
+            out[2] += batch.Rhs[ 3 * k + 2 ];
+        }
+    }
+}
+
+void CollisionResolver::GradientProductRegion( void* context,
+    unsigned worker, unsigned workers )
+{
+    const GradientBatch& batch = *static_cast<GradientBatch*>( context );
+    CollisionResolver& self = *batch.Self;
+
+    const unsigned n = unsigned( self.GradientBodies.size () );
+    const unsigned m = unsigned( self.GradientContacts.size () );
+
+    GradientBodyBatch( context,
+        ChunkStart( n, worker, workers ), ChunkStart( n, worker + 1, workers ) );
+
+    RegionBarrier( workers ); // The contacts need the sums of all their bodies
+
+    GradientContactBatch( context,
+        ChunkStart( m, worker, workers ), ChunkStart( m, worker + 1, workers ) );
+}
+
+void CollisionResolver::GradientProduct( const std::vector<double>& x, const double* rhs,
+    std::vector<double>& out )
+{
+    GradientBatch batch = { this, &x[0], rhs, &out[0] };
+
+    ParallelRegion( GradientThreads, GradientProductRegion, &batch );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// The projected gradient step, followed by the extrapolation.
+//
+void CollisionResolver::GradientProjectBatch( void* context, unsigned begin, unsigned end )
+{
+    const GradientBatch& batch = *static_cast<GradientBatch*>( context );
+    CollisionResolver& self = *batch.Self;
+
+    for ( unsigned k = begin; k < end; ++k )
+    {
+        const double t = self.GradientStep * self.GradientScale[k];
+
+        const double* y = &self.GradientY[ 3 * k ];
+        const double* g = &self.GradientG[ 3 * k ];
+        const double* gamma = &self.GradientGamma[ 3 * k ];
+        double* next = &self.GradientNext[ 3 * k ];
+
+        for ( unsigned c = 0; c < 3; ++c ) {
+            next[c] = y[c] - t * g[c];
+        }
+
+        ProjectOnCone( next, self.Collisions[ self.GradientContacts[k] ].Friction );
+
+        // The projected gradient (in velocity units) and the direction of the step
+        // relative to the last step
+        //
+        double residual = 0, dot = 0;
+        for ( unsigned c = 0; c < 3; ++c )
+        {
+            residual = std::max( residual, fabs( y[c] - next[c] ) / t );
+            dot += ( y[c] - next[c] ) * ( next[c] - gamma[c] );
+        }
+
+        self.GradientResidual[k] = residual;
+        self.GradientDot[k] = dot;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// The Nesterov-accelerated projected gradient iteration with the gradient restart.
+//
+// Every worker owns a chunk of the bodies and a chunk of the contacts. An iteration
+// has three phases: the impulse sums of the bodies, the gradient and the projection
+// at the contacts, and the extrapolation; the step lengths are computed by every
+// worker from the partial sums of all the workers.
+//
+void CollisionResolver::GradientIterateRegion( void* context,
+    unsigned worker, unsigned workers )
+{
+    GradientIteration& state = *static_cast<GradientIteration*>( context );
+    CollisionResolver& self = *state.Self;
+
+    const unsigned n = unsigned( self.GradientBodies.size () );
+    const unsigned m = unsigned( self.GradientContacts.size () );
+
+    const unsigned bodyBegin = ChunkStart( n, worker, workers );
+    const unsigned bodyEnd   = ChunkStart( n, worker + 1, workers );
+    const unsigned begin     = ChunkStart( m, worker, workers );
+    const unsigned end       = ChunkStart( m, worker + 1, workers );
+
+    GradientBatch batch = { &self, &self.GradientY[0], &self.GradientRhs[0],
+        &self.GradientG[0] };
+
+    // A region never gets more workers than it asks for (see ParallelRegion),
+    // and the partials are sized for these
+    //
+    assert( workers <= self.GradientThreads
+        && 2 * workers <= self.GradientPartial.size () );
+
+    double* partial = &self.GradientPartial[0];
+
+    double theta = 1, residual = 0;
+    unsigned iteration = 0;
+
+    for ( ; iteration < state.MaxIterations; ++iteration )
+    {
+        GradientBodyBatch( &batch, bodyBegin, bodyEnd );
+
+        RegionBarrier( workers );
+
+        GradientContactBatch( &batch, begin, end );
+        GradientProjectBatch( &batch, begin, end );
+
+        double dot = 0;
+        residual = 0;
+        for ( unsigned k = begin; k < end; ++k ) {
+            residual = std::max( residual, self.GradientResidual[k] );
+            dot += self.GradientDot[k];
+        }
+
+        partial[ 2 * worker     ] = residual;
+        partial[ 2 * worker + 1 ] = dot;
+
+        RegionBarrier( workers );
+
+        residual = 0;
+        dot = 0;
+        for ( unsigned w = 0; w < workers; ++w ) {
+            residual = std::max( residual, partial[ 2 * w ] );
+            dot += partial[ 2 * w + 1 ];
+        }
+
+        double thetaNext = 0.5 * theta * ( sqrt( theta * theta + 4 ) - theta );
+        double beta = theta * ( 1 - theta ) / ( theta * theta + thetaNext );
+
+        // Restart the momentum if the step went uphill
+        //
+        if ( dot > 0 ) {
+            beta = 0;
+            thetaNext = 1;
+        }
+
+        for ( unsigned j = 3 * begin; j < 3 * end; ++j )
+        {
+            double gamma = self.GradientNext[j];
+            self.GradientY[j] = gamma + beta * ( gamma - self.GradientGamma[j] );
+            self.GradientGamma[j] = gamma;
+        }
+
+        theta = thetaNext;
+
+        // All the workers reach the same decision
+        //
+        if ( residual < state.Eps ) {
+            ++iteration;
+            break;
+        }
+
+        RegionBarrier( workers ); // The bodies need the extrapolations of all contacts
+    }
+
+    if ( worker == 0 ) {
+        state.Iterations = iteration;
+        state.Error = residual;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Resolves all the collisions at once using the accelerated projected gradient method.
+//
+void CollisionResolver::AcceleratedImpulses( double h, unsigned maxIterations,
+    double eps, unsigned threads )
+{
+    GradientIterations = 0;
+    GradientError = 0;
+
+    if ( maxIterations == 0 ) {
+        maxIterations = 200;
+    }
+    if ( eps == 0 ) {
+        eps = 0.01;
+    }
+
+    GradientThreads = threads > 0 ? threads : 1;
+
+    const unsigned Unreached = ~0u;
+
+    // Collect the contacts to solve and their bodies
+    //
+    GradientContacts.clear ();
+    GradientBodies.clear ();
+
+    for ( unsigned i = 0; i < CollisionCount; ++i )
+    {
+        const Collision& contact = Collisions[i];
+        if ( contact.IsAsleep () ) {
+            continue;
+        }
+
+        GradientContacts.push_back( i );
+        GradientBodies.push_back( contact.Body_A );
+        if ( contact.Body_B ) {
+            GradientBodies.push_back( contact.Body_B );
+        }
+    }
+
+    const unsigned m = unsigned( GradientContacts.size () );
+    if ( m == 0 ) {
+        return;
+    }
+
+    std::sort( GradientBodies.begin (), GradientBodies.end () );
+    GradientBodies.erase( std::unique( GradientBodies.begin (), GradientBodies.end () ),
+        GradientBodies.end () );
+
+    const unsigned bodyCount = unsigned( GradientBodies.size () );
+
+    // The partial sums of every worker; the regions of the iteration run on
+    // at most GradientThreads workers
+    //
+    GradientThreads = std::min( GradientThreads, m );
+    GradientPartial.assign( 2 * GradientThreads, 0.0 );
+
+    // The Jacobian by body: the contacts of every body, as the compressed adjacency
+    // lists (GradientStart, GradientIncidence) of the contact sides `2 k + a`
+    //
+    GradientSide.resize( 2 * m );
+    GradientStart.assign( bodyCount + 1, 0 );
+
+    for ( unsigned k = 0; k < m; ++k )
+    {
+        RigidBody** body = &Collisions[ GradientContacts[k] ].Body_A;
+        for ( unsigned a = 0; a < 2; ++a )
+        {
+            unsigned index = Unreached;
+            if ( body[a] )
+            {
+                index = unsigned( std::lower_bound( GradientBodies.begin (),
+                    GradientBodies.end (), body[a] ) - GradientBodies.begin () );
+                ++GradientStart[ index + 1 ];
+            }
+            GradientSide[ 2 * k + a ] = index;
+        }
+    }
+
+    for ( unsigned b = 0; b < bodyCount; ++b ) {
+        GradientStart[ b + 1 ] += GradientStart[b];
+    }
+
+    GradientIncidence.resize( GradientStart[ bodyCount ] );
+    std::vector<unsigned> next( GradientStart.begin (), GradientStart.end () - 1 );
+
+    for ( unsigned k = 0; k < 2 * m; ++k )
+    {
+        if ( GradientSide[k] != Unreached ) {
+            GradientIncidence[ next[ GradientSide[k] ]++ ] = k;
+        }
+    }
+
+    GradientP.resize( bodyCount );
+    GradientL.resize( bodyCount );
+
+    // The velocities to remove: the bouncing velocity along the normal (to be
+    // reached) and the sliding velocity (to be cancelled by friction)
+    //
+    // The preconditioner: the inverse of the change of the normal velocity per unit
+    // normal impulse (the diagonal of N), the same for the three components so
+    // the scaled impulses stay in the friction cones
+    //
+    GradientRhs.resize( 3 * m );
+    GradientScale.resize( m );
+
+    for ( unsigned k = 0; k < m; ++k )
+    {
+        const Collision& contact = Collisions[ GradientContacts[k] ];
+        GradientRhs[ 3 * k     ] = -contact.BouncingVelocity;
+        GradientRhs[ 3 * k + 1 ] = contact.Velocity.y;
+        GradientRhs[ 3 * k + 2 ] = contact.Velocity.z;
+
+        double invRedMass = 0;
+        const RigidBody* body[2] = { contact.Body_A, contact.Body_B };
+        for ( unsigned a = 0; a < 2; ++a )
+        {
+            if ( body[a] )
+            {
+                const Quaternion& r = contact.RelativePosition[a];
+                Quaternion dW = body[a]->InverseInertiaWorld * r.Cross( contact.Normal );
+                invRedMass += body[a]->InverseMass + dW.Cross( r ).Dot( contact.Normal );
+            }
+        }
+
+        GradientScale[k] = invRedMass > 0 ? 1.0 / invRedMass : 0;
+    }
+
+    GradientGamma.assign( 3 * m, 0.0 );
+    GradientNext.assign( 3 * m, 0.0 );
+    GradientY.assign( 3 * m, 0.0 );
+    GradientG.resize( 3 * m );
+    GradientResidual.resize( m );
+    GradientDot.resize( m );
+
+    // Estimate the largest eigenvalue of `S N S` (S being the square root of
+    // the preconditioner), the Lipschitz constant of the scaled gradient, by the power
+    // iteration starting from the unit normal impulses
+    //
+    for ( unsigned k = 0; k < m; ++k ) {
+        GradientY[ 3 * k ] = 1;
+    }
+
+    double lipschitz = 0;
+    for ( unsigned n = 0; n < 8; ++n )
+    {
+        for ( unsigned j = 0; j < 3 * m; ++j ) {
+            GradientNext[j] = sqrt( GradientScale[ j / 3 ] ) * GradientY[j];
+        }
+
+        GradientProduct( GradientNext, 0, GradientG );
+
+        for ( unsigned j = 0; j < 3 * m; ++j ) {
+            GradientG[j] *= sqrt( GradientScale[ j / 3 ] );
+        }
+
+        double norm = 0;
+        for ( unsigned j = 0; j < 3 * m; ++j ) {
+            norm += GradientG[j] * GradientG[j];
+        }
+        norm = sqrt( norm );
+        if ( norm == 0 ) {
+            break;
+        }
+
+        double length = 0;
+        for ( unsigned j = 0; j < 3 * m; ++j ) {
+            length += GradientY[j] * GradientY[j];
+        }
+        lipschitz = norm / sqrt( length );
+
+        for ( unsigned j = 0; j < 3 * m; ++j ) {
+            GradientY[j] = GradientG[j] / norm;
+        }
+    }
+
+    if ( lipschitz <= 0 ) {
+        return;
+    }
+
+    // The power iteration approaches the largest eigenvalue from below
+    //
+    GradientStep = 1.0 / ( 1.2 * lipschitz );
+
+    GradientY.assign( 3 * m, 0.0 );
+    GradientNext.assign( 3 * m, 0.0 );
+
+    // Iterate, all the iterations in one parallel region
+    //
+    GradientIteration iteration = { this, maxIterations, eps, 0, 0 };
+
+    ParallelRegion( GradientThreads, GradientIterateRegion, &iteration );
+
+    GradientIterations = iteration.Iterations;
+    GradientError = iteration.Error;
+
+    // Apply the impulses to the bodies and update the velocities of the contacts
+    //
+    GradientProduct( GradientGamma, 0, GradientG );
+
+    for ( unsigned b = 0; b < bodyCount; ++b )
+    {
+        GradientBodies[b]->LinearMomentum  += GradientP[b];
+        GradientBodies[b]->AngularMomentum += GradientL[b];
+    }
+
+    for ( unsigned k = 0; k < m; ++k )
+    {
+        Collision& contact = Collisions[ GradientContacts[k] ];
+
+        contact.Velocity += Quaternion( 0, GradientG[ 3 * k ],
+            GradientG[ 3 * k + 1 ], GradientG[ 3 * k + 2 ] );
+        contact.BouncingVelocity = contact.GetBouncingVelocity( h );
+
+        if ( GradientGamma[ 3 * k ] > 0 ) {
+            contact.ActivateInactiveBodies ();
+        }
+    }
+}
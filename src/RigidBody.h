@@ -13,8 +13,13 @@
 #include "Quaternion.h"
 #include "QTensor.h"
 
+#include <vector>   // we use: std::vector
+#include <cstddef>  // we use: size_t
+
 namespace WoRB {
 
+    class KinematicMotion;
+
     /** Encapsulates a rigid body. 
      *
      * Rigid body is the basic simulation object in the World of Bodies (WoRB).
@@ -111,6 +116,27 @@ namespace WoRB {
         bool KineticEnergyDamping;
                                                                                    /*@}*/
         /////////////////////////////////////////////////////////////////////////////////
+        /** @name Kinematic bodies                                                     */
+                                                                                   /*@{*/
+        /** Points to the scripted motion of a kinematic body; null for a dynamic body.
+         *
+         * The pose of a kinematic body is set every time-step by the motion (see
+         * Kinematic.h) instead of being integrated. It has an infinite mass in the
+         * collisions, but its velocity contributes to the relative velocity at the
+         * contacts; it is not affected by gravity and not included in the totals.
+         */
+        KinematicMotion* Kinematic;
+                                                                                   /*@}*/
+        /////////////////////////////////////////////////////////////////////////////////
+        /** @name Ordering in the system                                               */
+                                                                                   /*@{*/
+        /** Holds the index of the object of the body in the system, which orders
+         * the bodies in space when the system reorders its objects (the contacts are
+         * sorted by it, see CollisionResolver::SortByBodies).
+         */
+        unsigned Order;
+                                                                                   /*@}*/
+        /////////////////////////////////////////////////////////////////////////////////
         /** @name Total force and torque accumulators
          *
          * These variables store the current total force, torque and acceleration of the 
@@ -137,6 +163,8 @@ namespace WoRB {
             , AverageKineticEnergy( 0 )
             , KineticEnergyThreshold( 0 )
             , KineticEnergyDamping( false )
+            , Kinematic( 0 )
+            , Order( 0 )
             , IsActive( false )
             , CanBeDeactivated( false )
         {
@@ -300,6 +328,14 @@ namespace WoRB {
             return InverseMass > 0.0;
         }
 
+        /** Returns true if the body never moves, i.e. it has an infinite mass and
+         * it is not kinematic. Static bodies take part in collisions as scenery.
+         */
+        bool IsStatic () const
+        {
+            return InverseMass == 0.0 && Kinematic == 0;
+        }
+
         /** Initializs the position, orientation, velocity and angular velocity
          * of the rigid body and updates other derived quantities.
          */
@@ -325,6 +361,52 @@ namespace WoRB {
         {
             InverseInertiaBody.SetInverseOf( I_body );
         }
+
+        /** Makes the body kinematic, moved by the given motion (with the infinite mass
+         * and moment of inertia), or dynamic again if the motion is null (in which
+         * case the mass and the moment of inertia have to be set up again).
+         */
+        void SetKinematic( KinematicMotion* motion )
+        {
+            Kinematic = motion;
+
+            if ( Kinematic )
+            {
+                InverseMass        = 0;
+                InverseInertiaBody = QTensor( 0.0, 0.0, 0.0 );
+                CanBeDeactivated   = false;
+                IsActive           = true;
+                Force              = 0.0;
+                Torque             = 0.0;
+            }
+        }
+
+        /** Sets the pose and the velocities of a kinematic body (or holds a static
+         * body at rest) and updates the other derived quantities (the momenta and
+         * the kinetic energy are zero).
+         */
+        void SetKinematicState
+        (
+            const Quaternion& X,  //!< The position
+            const Quaternion& Q,  //!< The orientation
+            const Quaternion& V,  //!< The velocity
+            const Quaternion& W   //!< The angular velocity in world space
+            )
+        {
+            Position        = X;
+            Orientation     = Q;
+            Velocity        = V;
+            AngularVelocity = W;
+
+            Orientation.Normalize ();
+            ToWorld.SetFromOrientationAndPosition( Orientation, Position );
+            InverseInertiaWorld = ToWorld( InverseInertiaBody );
+
+            LinearMomentum       = 0.0;
+            AngularMomentum      = 0.0;
+            TotalAngularMomentum = 0.0;
+            KineticEnergy        = 0;
+        }
                                                                                    /*@}*/
         /////////////////////////////////////////////////////////////////////////////////
         /** @name Flags controlling ODE solver activity for the body                   */
@@ -441,6 +523,80 @@ namespace WoRB {
         /////////////////////////////////////////////////////////////////////////////////
     };
 
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Maps the old addresses of the objects moved to other places in their arrays
+     * (see SolidArray::Permute) to their new addresses.
+     *
+     * An address anywhere in a moved element (e.g. of its Geometry or its RigidBody)
+     * is mapped to the same place in the element at the new index; the other
+     * addresses are kept.
+     */
+    class Relocation
+    {
+        struct Block
+        {
+            const char* Begin;        //!< Holds the address of the first element
+            const char* End;          //!< Holds the address past the last element
+            size_t Stride;            //!< Holds the size of an element
+            const unsigned* NewIndex; //!< Holds the new index of every element
+        };
+
+        std::vector<Block> Blocks;
+
+    public:
+
+        /** Adds an array of `count` elements of `stride` bytes, whose element `i` was
+         * moved to the index `newIndex[i]` (the indices are not copied).
+         */
+        void Add( const void* begin, unsigned count, size_t stride,
+            const unsigned* newIndex )
+        {
+            Block block;
+            block.Begin    = static_cast<const char*>( begin );
+            block.End      = block.Begin + count * stride;
+            block.Stride   = stride;
+            block.NewIndex = newIndex;
+            Blocks.push_back( block );
+        }
+
+        /** Forgets all the arrays.
+         */
+        void Clear ()
+        {
+            Blocks.clear ();
+        }
+
+        /** Indicates whether no array was added.
+         */
+        bool IsEmpty () const
+        {
+            return Blocks.empty ();
+        }
+
+        /** Gets the new address of the object.
+         */
+        template<class T>
+        T* operator () ( T* object ) const
+        {
+            const char* p = reinterpret_cast<const char*>( object );
+
+            for ( unsigned k = 0; k < Blocks.size (); ++k )
+            {
+                const Block& b = Blocks[k];
+                if ( p >= b.Begin && p < b.End )
+                {
+                    const size_t offset = size_t( p - b.Begin );
+                    const char* q = b.Begin + b.NewIndex[ offset / b.Stride ] * b.Stride
+                                  + offset % b.Stride;
+                    return reinterpret_cast<T*>( const_cast<char*>( q ) );
+                }
+            }
+
+            return object;
+        }
+    };
+
 } // WoRB
 
 #endif // _WORB_RIGID_BODY_H_INCLUDED
@@ -0,0 +1,537 @@
+/**
+ *  @file      SceneQuery.cpp
+ *  @brief     Implementation of the ray kernels and the ray cast, overlap and
+ *             closest-point queries against a single geometry.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-29
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+#include "TriangleContacts.h"
+
+#include <algorithm> // we use: std::min, std::max
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Ray kernels
+/////////////////////////////////////////////////////////////////////////////////////////
+
+bool WoRB::RaySphere( const Ray& ray, const Quaternion& center, double radius,
+    double& distance )
+{
+    Quaternion m = ray.Origin - center;
+
+    double c = m.ImSquaredNorm () - radius * radius;
+    if ( c <= 0 ) {
+        distance = 0; // The ray starts inside the sphere
+        return true;
+    }
+
+    double b = m.Dot( ray.Direction );
+    if ( b > 0 ) {
+        return false; // The ray points away from the sphere
+    }
+
+    double discriminant = b * b - c;
+    if ( discriminant < 0 ) {
+        return false;
+    }
+
+    double t = -b - sqrt( discriminant );
+    if ( t > ray.MaxDistance ) {
+        return false;
+    }
+
+    distance = t;
+    return true;
+}
+
+bool WoRB::RayBox( const Ray& ray, const QTensor& frame, const Quaternion& halfExtent,
+    double& distance, Quaternion& normal )
+{
+    // The ray in the box frame
+    //
+    Quaternion o = frame.TransformInverse( ray.Origin );
+
+    double tmin = 0, tmax = ray.MaxDistance;
+    int axis = -1;
+    double sign = 0;
+
+    for ( unsigned i = 0; i < 3; ++i )
+    {
+        double d = ray.Direction.Dot( frame.Column( i ) );
+        double h = halfExtent[i];
+
+        if ( fabs( d ) < 1e-14 )
+        {
+            if ( o[i] < -h || o[i] > h ) {
+                return false; // Parallel to the slab and outside it
+            }
+            continue;
+        }
+
+        double t1 = ( -h - o[i] ) / d;
+        double t2 = (  h - o[i] ) / d;
+        double s = -1; // Entering through the face at -h
+
+        if ( t1 > t2 ) {
+            std::swap( t1, t2 );
+            s = 1;
+        }
+        if ( t1 > tmin ) {
+            tmin = t1;
+            axis = int( i );
+            sign = s;
+        }
+        tmax = std::min( tmax, t2 );
+
+        if ( tmin > tmax ) {
+            return false;
+        }
+    }
+
+    distance = tmin;
+    normal = axis < 0 ? -ray.Direction : sign * frame.Column( unsigned( axis ) );
+    normal.w = 0;
+    return true;
+}
+
+bool WoRB::RayPlane( const Ray& ray, const Quaternion& normal, double offset, bool solid,
+    double& distance, Quaternion& hitNormal )
+{
+    double s = normal.Dot( ray.Origin ) - offset;
+    double d = normal.Dot( ray.Direction );
+
+    if ( solid && s <= 0 ) {
+        distance = 0; // The ray starts below the half-space surface
+        hitNormal = normal;
+        return true;
+    }
+
+    if ( fabs( d ) < 1e-14 || ( solid && d >= 0 ) ) {
+        return false;
+    }
+
+    double t = -s / d;
+    if ( t < 0 || t > ray.MaxDistance ) {
+        return false;
+    }
+
+    distance = t;
+    hitNormal = s >= 0 ? normal : -normal;
+    return true;
+}
+
+bool WoRB::RayHull( const Ray& ray, const ConvexHull& hull,
+    double& distance, Quaternion& normal )
+{
+    // The ray in the hull frame, clipped by the face planes (Cyrus-Beck)
+    //
+    const QTensor& frame = hull.Transform ();
+    Quaternion o = frame.TransformInverse( ray.Origin );
+    Quaternion d( 0, ray.Direction.Dot( frame.Column(0) ),
+                     ray.Direction.Dot( frame.Column(1) ),
+                     ray.Direction.Dot( frame.Column(2) ) );
+
+    double tmin = 0, tmax = ray.MaxDistance;
+    int face = -1;
+
+    for ( unsigned f = 0; f < hull.FaceCount (); ++f )
+    {
+        const Quaternion& plane = hull.GetPlane( f );
+        double numerator = plane.w - plane.Dot( o );
+        double denominator = plane.Dot( d );
+
+        if ( fabs( denominator ) < 1e-14 )
+        {
+            if ( numerator < 0 ) {
+                return false; // Parallel to the face and outside
+            }
+            continue;
+        }
+
+        double t = numerator / denominator;
+        if ( denominator < 0 ) { // Entering
+            if ( t > tmin ) {
+                tmin = t;
+                face = int( f );
+            }
+        }
+        else if ( t < tmax ) { // Leaving
+            tmax = t;
+        }
+
+        if ( tmin > tmax ) {
+            return false;
+        }
+    }
+
+    distance = tmin;
+
+    if ( face < 0 ) {
+        normal = -ray.Direction; // The ray starts inside the hull
+    }
+    else {
+        const Quaternion& N = hull.GetPlane( unsigned( face ) );
+        normal = N.x * frame.Column(0) + N.y * frame.Column(1) + N.z * frame.Column(2);
+    }
+    normal.w = 0;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Ray cast against a single geometry
+/////////////////////////////////////////////////////////////////////////////////////////
+
+bool WoRB::RayCast( const Ray& ray, const Geometry& shape, QueryHit& hit )
+{
+    double distance = 0;
+    Quaternion normal;
+    bool found = false;
+
+    if ( shape.IsSphere () )
+    {
+        Quaternion center = shape.Position ();
+        center.w = 0;
+        found = RaySphere( ray, center, static_cast<const Sphere&>( shape ).Radius, distance );
+        if ( found ) {
+            normal = distance > 0 ? ( ray.At( distance ) - center ).Unit () : -ray.Direction;
+        }
+    }
+    else if ( shape.IsCuboid () )
+    {
+        found = RayBox( ray, shape.Transform (), static_cast<const Cuboid&>( shape ).HalfExtent,
+            distance, normal );
+    }
+    else if ( shape.IsHalfSpace () )
+    {
+        const HalfSpace& plane = static_cast<const HalfSpace&>( shape );
+        found = RayPlane( ray, plane.Direction, plane.Offset, true, distance, normal );
+    }
+    else if ( shape.IsTruePlane () )
+    {
+        const TruePlane& plane = static_cast<const TruePlane&>( shape );
+        found = RayPlane( ray, plane.Direction, plane.Offset, false, distance, normal );
+    }
+    else if ( shape.IsConvexHull () )
+    {
+        found = RayHull( ray, static_cast<const ConvexHull&>( shape ), distance, normal );
+    }
+    else if ( shape.IsTriangleMesh () )
+    {
+        return static_cast<const TriangleMesh&>( shape ).RayCast( ray, hit );
+    }
+    else if ( shape.IsHeightField () )
+    {
+        return static_cast<const HeightField&>( shape ).RayCast( ray, hit );
+    }
+    else if ( shape.IsCompound () )
+    {
+        // The closest hit among the children, reported for the compound
+        //
+        const Compound& compound = static_cast<const Compound&>( shape );
+        Ray segment( ray );
+
+        for ( unsigned i = 0; i < compound.ChildCount (); ++i )
+        {
+            QueryHit child;
+            if ( RayCast( segment, compound.GetChild( i ), child ) ) {
+                hit = child;
+                segment.MaxDistance = child.Distance;
+                found = true;
+            }
+        }
+
+        if ( found ) {
+            hit.Shape = &shape;
+        }
+        return found;
+    }
+
+    if ( ! found ) {
+        return false;
+    }
+
+    hit.Shape    = &shape;
+    hit.Distance = distance;
+    hit.Position = ray.At( distance );
+    hit.Normal   = normal;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Overlap tests
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Tests the triangles of a mesh or a terrain against the query shape, until
+     * the first overlapping triangle is found.
+     */
+    struct TriangleOverlap
+    {
+        const TriangleMesh* Mesh;
+        const SupportShape& Query;
+        bool Found;
+
+        TriangleOverlap( const TriangleMesh* mesh, const SupportShape& query )
+            : Mesh( mesh )
+            , Query( query )
+            , Found( false )
+        {
+        }
+
+        void operator () ( unsigned index )
+        {
+            operator () ( Mesh->GetTriangle( index ) );
+        }
+
+        void operator () ( const TriangleMesh::Triangle& T )
+        {
+            if ( ! Found ) {
+                ConvexContact contact;
+                Found = ConvexQuery( SupportShape( T.A, T.B, T.C ), Query, contact );
+            }
+        }
+    };
+
+    /** Tests whether the geometry overlaps the axis-aligned box with the given
+     * center and half-extents, inflated by the margin.
+     */
+    bool OverlapsQuery( const Geometry& shape,
+        const Quaternion& center, const Quaternion& halfExtent, double margin )
+    {
+        SupportShape query( center, halfExtent, margin );
+        Quaternion extent = halfExtent + Quaternion( 0, margin, margin, margin );
+
+        if ( shape.IsSphere () || shape.IsCuboid () || shape.IsConvexHull () )
+        {
+            ConvexContact contact;
+            SupportShape A( shape, center, extent.ImNorm () );
+            return ConvexQuery( A, query, contact );
+        }
+        else if ( shape.IsHalfSpace () || shape.IsTruePlane () )
+        {
+            Quaternion N = shape.IsHalfSpace ()
+                ? static_cast<const HalfSpace&>( shape ).Direction
+                : static_cast<const TruePlane&>( shape ).Direction;
+            double offset = shape.IsHalfSpace ()
+                ? static_cast<const HalfSpace&>( shape ).Offset
+                : static_cast<const TruePlane&>( shape ).Offset;
+
+            // The distance of the center and the extent of the box along the normal
+            //
+            double s = N.Dot( center ) - offset;
+            double r = fabs( N.x ) * halfExtent.x + fabs( N.y ) * halfExtent.y
+                     + fabs( N.z ) * halfExtent.z + margin;
+
+            return shape.IsHalfSpace () ? s <= r : fabs( s ) <= r;
+        }
+        else if ( shape.IsTriangleMesh () )
+        {
+            const TriangleMesh& mesh = static_cast<const TriangleMesh&>( shape );
+            TriangleOverlap visitor( &mesh, query );
+            mesh.Query( center - extent, center + extent, visitor );
+            return visitor.Found;
+        }
+        else if ( shape.IsHeightField () )
+        {
+            // Either a triangle crosses the box or the lowest point of the box
+            // (under its center) tells on which side of the surface the box is
+            //
+            const HeightField& terrain = static_cast<const HeightField&>( shape );
+            TriangleOverlap visitor( 0, query );
+            terrain.Query( center - extent, center + extent, visitor );
+
+            unsigned column, row;
+            return visitor.Found
+                || ( terrain.FindCell( center.x, center.z, column, row )
+                     && center.y - extent.y <= terrain.HeightAt( center.x, center.z ) );
+        }
+        else if ( shape.IsCompound () )
+        {
+            const Compound& compound = static_cast<const Compound&>( shape );
+            for ( unsigned i = 0; i < compound.ChildCount (); ++i ) {
+                if ( OverlapsQuery( compound.GetChild( i ), center, halfExtent, margin ) ) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+}
+
+bool WoRB::Overlaps( const Geometry& shape, const Quaternion& boxMin, const Quaternion& boxMax )
+{
+    Quaternion center = 0.5 * ( boxMin + boxMax );
+    Quaternion halfExtent = 0.5 * ( boxMax - boxMin );
+    center.w = halfExtent.w = 0;
+
+    return OverlapsQuery( shape, center, halfExtent, 0 );
+}
+
+bool WoRB::Overlaps( const Geometry& shape, const Quaternion& center, double radius )
+{
+    return OverlapsQuery( shape, center, Quaternion( 0, 0, 0, 0 ), radius );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Closest-point queries
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Finds the closest point among the triangles of a mesh or a terrain.
+     */
+    struct TriangleClosestPoint
+    {
+        const TriangleMesh* Mesh;
+        Quaternion Point;
+        QueryHit& Closest;
+
+        TriangleClosestPoint( const TriangleMesh* mesh, const Quaternion& point,
+            QueryHit& closest )
+            : Mesh( mesh )
+            , Point( point )
+            , Closest( closest )
+        {
+        }
+
+        void operator () ( unsigned index )
+        {
+            operator () ( Mesh->GetTriangle( index ) );
+        }
+
+        void operator () ( const TriangleMesh::Triangle& T )
+        {
+            Quaternion P = ClosestPointOnTriangle( Point, T.A, T.B, T.C );
+            Quaternion d = Point - P;
+            double distance = d.ImNorm ();
+
+            if ( distance < Closest.Distance ) {
+                Closest.Distance = distance;
+                Closest.Position = P;
+                Closest.Normal = distance > 1e-12 ? d * ( 1.0 / distance )
+                               : T.Normal.Dot( d ) >= 0 ? T.Normal : -T.Normal;
+            }
+        }
+    };
+}
+
+bool WoRB::ClosestPoint( const Geometry& shape, const Quaternion& point, double maxDistance,
+    QueryHit& hit )
+{
+    QueryHit closest;
+    closest.Distance = maxDistance;
+
+    if ( shape.IsSphere () || shape.IsCuboid () || shape.IsConvexHull () )
+    {
+        // The query point has the margin maxDistance, so GJK reports the contact
+        // with the geometry whenever the geometry is within maxDistance
+        //
+        SupportShape A( shape, point, 0 );
+        SupportShape B( point, Quaternion( 0, 0, 0, 0 ), maxDistance );
+        ConvexContact contact;
+
+        if ( ! ConvexQuery( A, B, contact ) ) {
+            return false;
+        }
+
+        double distance = maxDistance - contact.Penetration;
+        closest.Normal = -contact.Normal;
+
+        if ( distance <= 0 ) { // The point is inside the geometry
+            closest.Distance = 0;
+            closest.Position = point;
+        }
+        else {
+            closest.Distance = distance;
+            closest.Position = contact.PointA;
+        }
+    }
+    else if ( shape.IsHalfSpace () || shape.IsTruePlane () )
+    {
+        Quaternion N = shape.IsHalfSpace ()
+            ? static_cast<const HalfSpace&>( shape ).Direction
+            : static_cast<const TruePlane&>( shape ).Direction;
+        double offset = shape.IsHalfSpace ()
+            ? static_cast<const HalfSpace&>( shape ).Offset
+            : static_cast<const TruePlane&>( shape ).Offset;
+
+        double s = N.Dot( point ) - offset;
+
+        if ( shape.IsHalfSpace () && s <= 0 ) { // The point is below the surface
+            closest.Distance = 0;
+            closest.Position = point;
+            closest.Normal = N;
+        }
+        else {
+            closest.Distance = fabs( s );
+            closest.Position = point - s * N;
+            closest.Normal = s >= 0 ? N : -N;
+        }
+    }
+    else if ( shape.IsTriangleMesh () )
+    {
+        const TriangleMesh& mesh = static_cast<const TriangleMesh&>( shape );
+        TriangleClosestPoint visitor( &mesh, point, closest );
+
+        Quaternion r( 0, maxDistance, maxDistance, maxDistance );
+        closest.Distance = Const::Max;
+        mesh.Query( point - r, point + r, visitor );
+    }
+    else if ( shape.IsHeightField () )
+    {
+        const HeightField& terrain = static_cast<const HeightField&>( shape );
+
+        unsigned column, row;
+        if ( terrain.FindCell( point.x, point.z, column, row )
+            && point.y <= terrain.HeightAt( point.x, point.z ) )
+        {
+            closest.Distance = 0; // The point is below the surface
+            closest.Position = point;
+            closest.Normal = Const::Y;
+        }
+        else
+        {
+            TriangleClosestPoint visitor( 0, point, closest );
+
+            Quaternion r( 0, maxDistance, maxDistance, maxDistance );
+            closest.Distance = Const::Max;
+            terrain.Query( point - r, point + r, visitor );
+        }
+    }
+    else if ( shape.IsCompound () )
+    {
+        const Compound& compound = static_cast<const Compound&>( shape );
+        bool found = false;
+
+        for ( unsigned i = 0; i < compound.ChildCount (); ++i )
+        {
+            QueryHit child;
+            if ( ClosestPoint( compound.GetChild( i ), point, closest.Distance, child ) ) {
+                closest = child;
+                found = true;
+            }
+        }
+
+        if ( ! found ) {
+            return false;
+        }
+    }
+
+    if ( closest.Distance > maxDistance ) {
+        return false;
+    }
+
+    closest.Position.w = 0;
+    closest.Normal.w = 0;
+
+    hit = closest;
+    hit.Shape = &shape;
+    return true;
+}
@@ -0,0 +1,447 @@
+#ifndef _WORB_SCENE_QUERY_H_INCLUDED
+#define _WORB_SCENE_QUERY_H_INCLUDED
+
+/**
+ *  @file      SceneQuery.h
+ *  @brief     Definitions for the scene queries: ray casts, overlap tests and
+ *             closest-point queries against all the geometries of a world,
+ *             accelerated by the broadphase and batched over threads.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-29
+ *  @copyright GNU Public License.
+ */
+
+#include "Policies.h"
+#include "TriangleMesh.h"
+#include "HeightField.h"
+
+#include <vector>     // we use: std::vector
+#include <algorithm>  // we use: std::sort
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Represents a ray (or a segment, if MaxDistance is finite).
+     */
+    struct Ray
+    {
+        Quaternion Origin;     //!< Holds the origin of the ray
+        Quaternion Direction;  //!< Holds the unit direction of the ray
+        double MaxDistance;    //!< Holds the length of the ray
+
+        Ray ()
+            : MaxDistance( Const::Max )
+        {
+        }
+
+        Ray( const Quaternion& origin, const Quaternion& direction,
+            double maxDistance = Const::Max )
+            : Origin( origin )
+            , Direction( direction.Unit () )
+            , MaxDistance( maxDistance )
+        {
+        }
+
+        /** Gets the point of the ray at the given distance from the origin.
+         */
+        Quaternion At( double distance ) const
+        {
+            return Origin + distance * Direction;
+        }
+    };
+
+    /** Holds the result of a ray cast or a closest-point query.
+     */
+    struct QueryHit
+    {
+        const Geometry* Shape;  //!< Points to the hit geometry (0 if none)
+        double Distance;        //!< Holds the distance from the ray or the query point
+        Quaternion Position;    //!< Holds the hit (or the closest) point on the surface
+        Quaternion Normal;      //!< Holds the surface normal at the point
+
+        QueryHit ()
+            : Shape( 0 )
+            , Distance( Const::Max )
+        {
+        }
+
+        /** Orders the hits by their distance.
+         */
+        bool operator < ( const QueryHit& hit ) const
+        {
+            return Distance < hit.Distance;
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // Ray kernels; every kernel reports the distance along the ray within
+    // [0, ray.MaxDistance], or 0 if the ray starts inside a solid geometry.
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Intersects the ray with the sphere.
+     */
+    bool RaySphere( const Ray& ray, const Quaternion& center, double radius,
+        double& distance );
+
+    /** Intersects the ray with the box given by its transform and half-extents
+     * (the slab test in the box frame).
+     */
+    bool RayBox( const Ray& ray, const QTensor& frame, const Quaternion& halfExtent,
+        double& distance, Quaternion& normal );
+
+    /** Intersects the ray with the plane `normal . x = offset`; a solid plane is
+     * a half-space (solid below the plane), otherwise the plane is two-sided.
+     */
+    bool RayPlane( const Ray& ray, const Quaternion& normal, double offset, bool solid,
+        double& distance, Quaternion& hitNormal );
+
+    /** Intersects the ray with the convex hull (clipping the ray by the face planes
+     * in the hull frame).
+     */
+    bool RayHull( const Ray& ray, const ConvexHull& hull,
+        double& distance, Quaternion& normal );
+
+    /** Intersects the ray with the (two-sided) triangle ABC.
+     * See Moller and Trumbore, Fast, Minimum Storage Ray/Triangle Intersection.
+     */
+    inline bool RayTriangle( const Ray& ray,
+        const Quaternion& A, const Quaternion& B, const Quaternion& C, double& distance )
+    {
+        Quaternion AB = B - A, AC = C - A;
+        Quaternion p = ray.Direction.Cross( AC );
+
+        double det = AB.Dot( p );
+        if ( fabs( det ) < 1e-14 ) {
+            return false; // The ray is parallel to the triangle
+        }
+
+        double inverse = 1.0 / det;
+        Quaternion s = ray.Origin - A;
+        double u = s.Dot( p ) * inverse;
+        if ( u < 0 || u > 1 ) {
+            return false;
+        }
+
+        Quaternion q = s.Cross( AB );
+        double v = ray.Direction.Dot( q ) * inverse;
+        if ( v < 0 || u + v > 1 ) {
+            return false;
+        }
+
+        double t = AC.Dot( q ) * inverse;
+        if ( t < 0 || t > ray.MaxDistance ) {
+            return false;
+        }
+
+        distance = t;
+        return true;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // Queries against a single geometry
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Casts the ray against the geometry using the kernel of its class.
+     * @return true if the geometry is hit within ray.MaxDistance.
+     */
+    bool RayCast( const Ray& ray, const Geometry& shape, QueryHit& hit );
+
+    /** Tests whether the geometry overlaps the axis-aligned box.
+     */
+    bool Overlaps( const Geometry& shape, const Quaternion& boxMin, const Quaternion& boxMax );
+
+    /** Tests whether the geometry overlaps the sphere.
+     */
+    bool Overlaps( const Geometry& shape, const Quaternion& center, double radius );
+
+    /** Finds the point of the geometry closest to the given point (the point itself
+     * if it is inside a solid geometry).
+     * @return true if the closest point is within maxDistance.
+     */
+    bool ClosestPoint( const Geometry& shape, const Quaternion& point, double maxDistance,
+        QueryHit& hit );
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Runs the scene queries against all the objects of a world.
+     *
+     * The candidates are found by the world's broadphase (see the `Query` method
+     * of the broadphase policies): for the SweepAndPrune broadphase only the objects
+     * whose bounding intervals overlap the query along the x-axis are tested,
+     * while AllPairs tests every object. The bounds are refreshed by Update,
+     * which has to be called whenever the bodies have moved (e.g. once per frame)
+     * before running the queries.
+     *
+     * The queries do not modify the world, so the batched queries run in parallel
+     * over `Threads` threads.
+     */
+    template<class World>
+    class SceneQuery
+    {
+        World& worb;
+
+        /** Tests the candidates against the ray, keeping either the closest hit
+         * or all the hits.
+         */
+        struct RayVisitor
+        {
+            Ray Segment;                 //!< Holds the ray shortened to the closest hit
+            QueryHit Closest;            //!< Holds the closest hit
+            std::vector<QueryHit>* All;  //!< Holds all the hits (if not 0)
+
+            RayVisitor( const Ray& ray, std::vector<QueryHit>* all )
+                : Segment( ray )
+                , All( all )
+            {
+            }
+
+            void operator () ( const Geometry& shape )
+            {
+                double radius = BoundingRadius( shape );
+                double distance;
+                if ( radius >= 0 && ! RaySphere( Segment, shape.Position (), radius, distance ) ) {
+                    return;
+                }
+
+                QueryHit hit;
+                if ( ! WoRB::RayCast( Segment, shape, hit ) ) {
+                    return;
+                }
+
+                if ( All ) {
+                    All->push_back( hit );
+                }
+                else {
+                    Closest = hit;
+                    Segment.MaxDistance = hit.Distance;
+                }
+            }
+        };
+
+        /** Collects the candidates that overlap the box or the sphere.
+         */
+        struct OverlapVisitor
+        {
+            Quaternion Min, Max, Center;
+            double Radius;  //!< Holds the sphere radius; negative for the box query
+            std::vector<const Geometry*>& Result;
+
+            OverlapVisitor( std::vector<const Geometry*>& result )
+                : Radius( -1 )
+                , Result( result )
+            {
+            }
+
+            void operator () ( const Geometry& shape )
+            {
+                if ( Radius < 0 ? Overlaps( shape, Min, Max ) : Overlaps( shape, Center, Radius ) ) {
+                    Result.push_back( &shape );
+                }
+            }
+        };
+
+        /** Keeps the closest point among the candidates.
+         */
+        struct PointVisitor
+        {
+            Quaternion Point;
+            QueryHit Closest;
+            double MaxDistance;
+
+            void operator () ( const Geometry& shape )
+            {
+                double radius = BoundingRadius( shape );
+                if ( radius >= 0 &&
+                     ( shape.Position () - Point ).ImNorm () - radius > MaxDistance ) {
+                    return;
+                }
+
+                QueryHit hit;
+                if ( WoRB::ClosestPoint( shape, Point, MaxDistance, hit ) ) {
+                    Closest = hit;
+                    MaxDistance = hit.Distance;
+                }
+            }
+        };
+
+        /** Holds the arguments of a batched query.
+         */
+        struct Batch
+        {
+            const SceneQuery* Query;
+            const Ray* Rays;
+            const Quaternion* Points;
+            double MaxDistance;
+            QueryHit* Hits;
+        };
+
+        static void RayBatch( void* context, unsigned begin, unsigned end )
+        {
+            const Batch& batch = *static_cast<const Batch*>( context );
+            for ( unsigned i = begin; i < end; ++i ) {
+                batch.Query->RayCast( batch.Rays[i], batch.Hits[i] );
+            }
+        }
+
+        static void PointBatch( void* context, unsigned begin, unsigned end )
+        {
+            const Batch& batch = *static_cast<const Batch*>( context );
+            for ( unsigned i = begin; i < end; ++i ) {
+                batch.Query->ClosestPoint( batch.Points[i], batch.MaxDistance, batch.Hits[i] );
+            }
+        }
+
+        static unsigned CountHits( const QueryHit* hits, unsigned count )
+        {
+            unsigned hitCount = 0;
+            for ( unsigned i = 0; i < count; ++i ) {
+                hitCount += hits[i].Shape ? 1 : 0;
+            }
+            return hitCount;
+        }
+
+    public:
+
+        /** Holds the number of threads running the batched queries.
+         */
+        unsigned Threads;
+
+        SceneQuery( World& world, unsigned threads = 1 )
+            : worb( world )
+            , Threads( threads )
+        {
+            Update ();
+        }
+
+        /** Brings the broadphase bounds and the frames of the compound children
+         * up to date with the current positions of the bodies.
+         */
+        void Update ()
+        {
+            worb.UpdateBounds ();
+
+            for ( unsigned i = 0; i < worb.GetObjectCount (); ++i )
+            {
+                const Geometry* object = worb.GetObject( i );
+                if ( object->IsCompound () ) {
+                    static_cast<const Compound*>( object )->UpdateFrames ();
+                }
+            }
+        }
+
+        /** Finds the closest geometry hit by the ray.
+         * @return true if a geometry is hit; otherwise hit.Shape is 0.
+         */
+        bool RayCast( const Ray& ray, QueryHit& hit ) const
+        {
+            RayVisitor visitor( ray, 0 );
+
+            Quaternion end = ray.At( ray.MaxDistance );
+            worb.QueryObjects( Min( ray.Origin, end ), Max( ray.Origin, end ), visitor );
+
+            hit = visitor.Closest;
+            return hit.Shape != 0;
+        }
+
+        /** Finds all the geometries hit by the ray, ordered by the distance.
+         * @return the number of hits.
+         */
+        unsigned RayCastAll( const Ray& ray, std::vector<QueryHit>& hits ) const
+        {
+            hits.clear ();
+            RayVisitor visitor( ray, &hits );
+
+            Quaternion end = ray.At( ray.MaxDistance );
+            worb.QueryObjects( Min( ray.Origin, end ), Max( ray.Origin, end ), visitor );
+
+            std::sort( hits.begin (), hits.end () );
+            return unsigned( hits.size () );
+        }
+
+        /** Finds the geometries overlapping the axis-aligned box.
+         * @return the number of the overlapping geometries.
+         */
+        unsigned Overlap( const Quaternion& boxMin, const Quaternion& boxMax,
+            std::vector<const Geometry*>& result ) const
+        {
+            result.clear ();
+            OverlapVisitor visitor( result );
+            visitor.Min = boxMin;
+            visitor.Max = boxMax;
+
+            worb.QueryObjects( boxMin, boxMax, visitor );
+            return unsigned( result.size () );
+        }
+
+        /** Finds the geometries overlapping the sphere.
+         * @return the number of the overlapping geometries.
+         */
+        unsigned Overlap( const Quaternion& center, double radius,
+            std::vector<const Geometry*>& result ) const
+        {
+            result.clear ();
+            OverlapVisitor visitor( result );
+            visitor.Center = center;
+            visitor.Radius = radius;
+
+            Quaternion r( 0, radius, radius, radius );
+            worb.QueryObjects( center - r, center + r, visitor );
+            return unsigned( result.size () );
+        }
+
+        /** Finds the closest point on the geometries within maxDistance from
+         * the given point.
+         * @return true if such point exists; otherwise hit.Shape is 0.
+         */
+        bool ClosestPoint( const Quaternion& point, double maxDistance, QueryHit& hit ) const
+        {
+            PointVisitor visitor;
+            visitor.Point = point;
+            visitor.MaxDistance = maxDistance;
+
+            Quaternion r( 0, maxDistance, maxDistance, maxDistance );
+            worb.QueryObjects( point - r, point + r, visitor );
+
+            hit = visitor.Closest;
+            return hit.Shape != 0;
+        }
+
+        /** Casts a batch of rays (in parallel), finding the closest hit per ray.
+         * @return the number of rays that hit a geometry.
+         */
+        unsigned RayCast( const Ray* rays, unsigned count, QueryHit* hits ) const
+        {
+            Batch batch = { this, rays, 0, 0, hits };
+            ParallelFor( count, Threads, RayBatch, &batch );
+            return CountHits( hits, count );
+        }
+
+        /** Finds the closest points for a batch of points (in parallel).
+         * @return the number of points that have a geometry within maxDistance.
+         */
+        unsigned ClosestPoint( const Quaternion* points, unsigned count, double maxDistance,
+            QueryHit* hits ) const
+        {
+            Batch batch = { this, 0, points, maxDistance, hits };
+            ParallelFor( count, Threads, PointBatch, &batch );
+            return CountHits( hits, count );
+        }
+
+    private:
+
+        static Quaternion Min( const Quaternion& a, const Quaternion& b )
+        {
+            return Quaternion( 0, std::min( a.x, b.x ), std::min( a.y, b.y ), std::min( a.z, b.z ) );
+        }
+
+        static Quaternion Max( const Quaternion& a, const Quaternion& b )
+        {
+            return Quaternion( 0, std::max( a.x, b.x ), std::max( a.y, b.y ), std::max( a.z, b.z ) );
+        }
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_SCENE_QUERY_H_INCLUDED
@@ -0,0 +1,177 @@
+#ifndef _WORB_SERVER_PROTOCOL_H_INCLUDED
+#define _WORB_SERVER_PROTOCOL_H_INCLUDED
+
+/**
+ *  @file      ServerProtocol.h
+ *  @brief     Definitions of the binary protocol spoken by the SimulationServer.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-22
+ *  @copyright GNU Public License.
+ *
+ * Every message (request or reply) starts with a MessageHeader followed by
+ * a command specific payload. All the values are in the host byte order, since
+ * the server is reachable only on the local host (through a Unix domain socket).
+ *
+ * Requests may be pipelined: a client may send any number of requests without
+ * waiting for the replies. Requests are executed in order and replies are sent
+ * in the same order, each carrying the `Tag` of its request. Requests with the
+ * `NoReply` flag get a reply only if they fail.
+ */
+
+#include <stdint.h> // we use: uint16_t, uint32_t, uint64_t
+
+namespace WoRB {
+namespace Protocol
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Enumerates the commands.
+     */
+    enum Command
+    {
+        LoadScene    = 1, //!< Payload: SceneParams, BodySpec[];  reply: Diagnostics
+        Step         = 2, //!< Payload: StepParams;               reply: Diagnostics
+        ApplyImpulse = 3, //!< Payload: BodyAction;               reply: (empty)
+        ApplyForce   = 4, //!< Payload: BodyAction;               reply: (empty)
+        QueryBodies  = 5, //!< Payload: BodyRange;   reply: StateHeader, BodyState[]
+        Checkpoint   = 6, //!< Payload: (empty);     reply: StateHeader, BodyState[]
+        Restore      = 7, //!< Payload: StateHeader, BodyState[]; reply: Diagnostics
+        Stream       = 8, //!< Payload: StreamParams;             reply: (empty)
+        StreamFrame  = 9  //!< Unsolicited message: StateHeader, BodyState[]
+    };
+
+    /** Enumerates the request flags.
+     */
+    enum Flags
+    {
+        NoReply = 0x0001  //!< Do not reply, unless the request fails
+    };
+
+    /** Enumerates the reply status codes.
+     */
+    enum Status
+    {
+        Ok          = 0,  //!< The request succeeded
+        BadRequest  = 1,  //!< Unknown command or malformed payload
+        NoScene     = 2,  //!< The scene is not loaded
+        OutOfRange  = 3,  //!< The body index is out of range
+        TooLarge    = 4   //!< The scene or the frames streamed by a Step exceed the server capacity
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Holds the header of every message.
+     */
+    struct MessageHeader
+    {
+        uint32_t Length;   //!< Holds the length of the message including the header
+        uint16_t Command;  //!< Holds the command (echoed in the reply)
+        uint16_t Flags;    //!< Holds the request flags
+        uint32_t Tag;      //!< Holds the client defined tag (echoed in the reply)
+        uint32_t Status;   //!< Holds the reply status (0 in requests)
+    };
+
+    /** Holds the system parameters of a LoadScene request.
+     */
+    struct SceneParams
+    {
+        double   Gravity[3];   //!< Holds the common gravity, in `m s^-2`
+        double   Restitution;  //!< Holds the coefficient of restitution
+        double   Relaxation;   //!< Holds the position projection relaxation
+        double   Friction;     //!< Holds the friction coefficient
+        uint32_t BodyCount;    //!< Holds the number of BodySpec that follow
+        uint32_t GroundPlane;  //!< Holds nonzero to add the ground plane y = 0
+    };
+
+    /** Holds the specification of a body in a LoadScene request.
+     */
+    struct BodySpec
+    {
+        uint32_t Geometry;         //!< Holds 0 for a sphere, 1 for a cuboid
+        uint32_t CanBeDeactivated; //!< Holds nonzero if the body can be deactivated
+        double   HalfExtent[3];    //!< Holds the half-extent (or radius in [0])
+        double   Mass;             //!< Holds the mass, in `kg`
+        double   X[3];             //!< Holds the position, in `m`
+        double   Q[4];             //!< Holds the orientation as (w, x, y, z)
+        double   V[3];             //!< Holds the velocity, in `m s^-1`
+        double   W[3];             //!< Holds the angular velocity, in `s^-1`
+    };
+
+    /** Holds the parameters of a Step request.
+     */
+    struct StepParams
+    {
+        uint32_t Count;    //!< Holds the number of time-steps to solve (at most 100000;
+                           //!< the streamed frames must fit in 64 MiB)
+        uint32_t Reserved; //!< Reserved; should be 0
+        double   TimeStep; //!< Holds the integrator time-step length (positive), in `s`
+    };
+
+    /** Holds the parameters of ApplyImpulse and ApplyForce requests.
+     */
+    struct BodyAction
+    {
+        uint32_t Body;      //!< Holds the index of the body
+        uint32_t Reserved;  //!< Reserved; should be 0
+        double   Vector[3]; //!< Holds the impulse (in `N s`) or the force (in `N`)
+        double   Point[3];  //!< Holds the point of application in world frame
+    };
+
+    /** Holds the parameters of a QueryBodies request.
+     */
+    struct BodyRange
+    {
+        uint32_t First;  //!< Holds the index of the first body
+        uint32_t Count;  //!< Holds the number of bodies
+    };
+
+    /** Holds the parameters of a Stream request.
+     */
+    struct StreamParams
+    {
+        uint32_t Interval; //!< Holds the stream period in time-steps (0 = disabled)
+        uint32_t Reserved; //!< Reserved; should be 0
+    };
+
+    /** Holds the system diagnostics; replied to LoadScene, Step and Restore.
+     */
+    struct Diagnostics
+    {
+        uint64_t TimeStepCount;        //!< Holds the number of time-steps
+        double   Time;                 //!< Holds the system local time, in `s`
+        double   TotalKineticEnergy;   //!< Holds the total kinetic energy, in `J`
+        double   TotalPotentialEnergy; //!< Holds the total potential energy, in `J`
+        uint32_t BodyCount;            //!< Holds the number of bodies
+        uint32_t ContactCount;         //!< Holds the number of contacts
+    };
+
+    /** Holds the header of the system state (followed by BodyState[]).
+     */
+    struct StateHeader
+    {
+        uint64_t TimeStepCount; //!< Holds the number of time-steps
+        double   Time;          //!< Holds the system local time, in `s`
+        uint32_t First;         //!< Holds the index of the first body that follows
+        uint32_t BodyCount;     //!< Holds the number of BodyState that follow
+    };
+
+    /** Holds the state variables of a single body.
+     */
+    struct BodyState
+    {
+        double   X[3];       //!< Holds the position, in `m`
+        double   Q[4];       //!< Holds the orientation as (w, x, y, z)
+        double   P[3];       //!< Holds the linear momentum, in `kg m s^-1`
+        double   L[3];       //!< Holds the angular momentum, in `kg m^2 s^-1`
+        double   V[3];       //!< Holds the velocity (derived), in `m s^-1`
+        double   W[3];       //!< Holds the angular velocity (derived), in `s^-1`
+        double   AverageKineticEnergy; //!< Holds the mean kinetic energy, in `J`
+        uint32_t IsActive;   //!< Holds nonzero if the body is active
+        uint32_t Reserved;   //!< Reserved; pads the record to 8-octet boundary
+    };
+
+} // namespace Protocol
+} // namespace WoRB
+
+#endif // _WORB_SERVER_PROTOCOL_H_INCLUDED
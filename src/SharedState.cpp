@@ -0,0 +1,364 @@
+/**
+ *  @file      SharedState.cpp
+ *  @brief     Implementation of the shared memory state publisher and reader.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-21
+ *  @copyright GNU Public License.
+ */
+
+#include "SharedState.h"
+
+#ifdef _WIN32
+    #include <Windows.h>
+    #pragma warning(disable:4996) // strncpy warning
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include <cstring> // we use: memset, strncpy
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Full memory barrier; orders the sequence lock updates and the frame data.
+//
+static inline void MemoryFence ()
+{
+    #ifdef _WIN32
+        MemoryBarrier ();
+    #else
+        __sync_synchronize ();
+    #endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Builds the platform specific name of the segment.
+//
+static void MakeSegmentName( char* buffer, size_t length, const char* name )
+{
+    #ifdef _WIN32
+        const char* prefix = "Local\\";
+    #else
+        const char* prefix = name[0] == '/' ? "" : "/";
+    #endif
+
+    size_t n = strlen( prefix );
+    strncpy( buffer, prefix, length );
+    strncpy( buffer + n, name, length - n - 1 );
+    buffer[ length - 1 ] = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+SharedMemory::SharedMemory ()
+    : Address( 0 )
+    , Length( 0 )
+    , Handle( 0 )
+    , IsOwner( false )
+{
+    Name[0] = 0;
+}
+
+SharedMemory::~SharedMemory ()
+{
+    Close ();
+}
+
+bool SharedMemory::Create( const char* name, size_t length, bool replace )
+{
+    Close ();
+    MakeSegmentName( Name, sizeof( Name ), name );
+
+    #ifdef _WIN32
+
+        (void)replace; // The segment is removed with its last handle; never stale
+
+        HANDLE h = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+            DWORD( (unsigned long long)length >> 32 ), DWORD( length ), Name );
+        if ( ! h ) {
+            return false;
+        }
+        if ( GetLastError () == ERROR_ALREADY_EXISTS ) {
+            CloseHandle( h ); // In use by another process
+            return false;
+        }
+        Address = MapViewOfFile( h, FILE_MAP_ALL_ACCESS, 0, 0, length );
+        if ( ! Address ) {
+            CloseHandle( h );
+            return false;
+        }
+        Handle = h;
+
+    #else
+
+        if ( replace ) {
+            shm_unlink( Name ); // Remove the stale segment left by a crashed process
+        }
+
+        int fd = shm_open( Name, O_CREAT | O_EXCL | O_RDWR, 0644 );
+        if ( fd < 0 ) {
+            return false;
+        }
+        if ( ftruncate( fd, off_t( length ) ) != 0 ) {
+            close( fd );
+            shm_unlink( Name );
+            return false;
+        }
+        void* addr = mmap( 0, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        close( fd );
+        if ( addr == MAP_FAILED ) {
+            shm_unlink( Name );
+            return false;
+        }
+        Address = addr;
+
+    #endif
+
+    Length  = length;
+    IsOwner = true;
+
+    return true;
+}
+
+bool SharedMemory::OpenReadOnly( const char* name )
+{
+    Close ();
+    MakeSegmentName( Name, sizeof( Name ), name );
+
+    #ifdef _WIN32
+
+        HANDLE h = OpenFileMappingA( FILE_MAP_READ, FALSE, Name );
+        if ( ! h ) {
+            return false;
+        }
+        Address = MapViewOfFile( h, FILE_MAP_READ, 0, 0, 0 );
+        if ( ! Address ) {
+            CloseHandle( h );
+            return false;
+        }
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery( Address, &info, sizeof( info ) );
+        Length = info.RegionSize;
+        Handle = h;
+
+    #else
+
+        int fd = shm_open( Name, O_RDONLY, 0 );
+        if ( fd < 0 ) {
+            return false;
+        }
+        struct stat st;
+        if ( fstat( fd, &st ) != 0 || st.st_size <= 0 ) {
+            close( fd );
+            return false;
+        }
+        void* addr = mmap( 0, size_t( st.st_size ), PROT_READ, MAP_SHARED, fd, 0 );
+        close( fd );
+        if ( addr == MAP_FAILED ) {
+            return false;
+        }
+        Address = addr;
+        Length  = size_t( st.st_size );
+
+    #endif
+
+    IsOwner = false;
+
+    return true;
+}
+
+void SharedMemory::Close ()
+{
+    if ( ! Address ) {
+        return;
+    }
+
+    #ifdef _WIN32
+        UnmapViewOfFile( Address );
+        CloseHandle( HANDLE( Handle ) );
+    #else
+        munmap( Address, Length );
+        if ( IsOwner ) {
+            shm_unlink( Name );
+        }
+    #endif
+
+    Address = 0;
+    Length  = 0;
+    Handle  = 0;
+    IsOwner = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+SharedStatePublisher::SharedStatePublisher ()
+    : Header( 0 )
+    , Frame( 0 )
+    , FrameNumber( 0 )
+{
+}
+
+bool SharedStatePublisher::Open( const char* name,
+    unsigned maxBodies, unsigned maxContacts, unsigned frameCount, bool replace )
+{
+    Close ();
+
+    if ( frameCount < 2 ) {
+        frameCount = 2; // The ring must have at least one frame that is not written
+    }
+
+    // Frames are aligned to a cache line, so that a frame being written does not
+    // share cache lines with the latest frame being read.
+    //
+    size_t frameSize = sizeof( SharedFrame )
+                     + maxBodies   * sizeof( SharedBody )
+                     + maxContacts * sizeof( SharedContact );
+    frameSize = ( frameSize + 63 ) & ~size_t( 63 );
+
+    if ( ! Segment.Create( name, SharedStateHeader::Size + frameCount * frameSize,
+            replace ) ) {
+        Printf( "WoRB: Failed to create shared memory segment '%s'"
+                " (it may already exist)\n", name );
+        return false;
+    }
+
+    char* base = (char*)Segment.GetAddress ();
+    memset( base, 0, Segment.GetLength () );
+
+    Header = (SharedStateHeader*)base;
+    Header->Version     = SharedStateHeader::LayoutVersion;
+    Header->FrameCount  = frameCount;
+    Header->FrameSize   = unsigned( frameSize );
+    Header->MaxBodies   = maxBodies;
+    Header->MaxContacts = maxContacts;
+    Header->LatestFrame = 0;
+
+    // The signature is written last; readers will not accept the segment before.
+    //
+    MemoryFence ();
+    Header->Magic = SharedStateHeader::Tag;
+
+    FrameNumber = 0;
+    Frame = 0;
+
+    return true;
+}
+
+void SharedStatePublisher::Close ()
+{
+    Segment.Close ();
+    Header = 0;
+    Frame = 0;
+}
+
+SharedFrame* SharedStatePublisher::BeginFrame ()
+{
+    if ( ! Header ) {
+        return 0;
+    }
+
+    // Take the oldest frame in the ring and mark it as being written
+    //
+    unsigned slot = unsigned( FrameNumber % Header->FrameCount );
+    Frame = (SharedFrame*)( (char*)Header + SharedStateHeader::Size
+                          + size_t( slot ) * Header->FrameSize );
+
+    Frame->Sequence = Frame->Sequence + 1; // odd
+    MemoryFence ();
+
+    Frame->PublishTime = MonotonicTime ();
+
+    return Frame;
+}
+
+void SharedStatePublisher::EndFrame ()
+{
+    if ( ! Frame ) {
+        return;
+    }
+
+    MemoryFence ();
+    Frame->Sequence = Frame->Sequence + 1; // even
+
+    MemoryFence ();
+    Header->LatestFrame = ++FrameNumber;
+
+    Frame = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+SharedStateReader::SharedStateReader ()
+    : Header( 0 )
+{
+}
+
+bool SharedStateReader::Open( const char* name )
+{
+    Close ();
+
+    if ( ! Segment.OpenReadOnly( name ) ) {
+        return false;
+    }
+
+    const SharedStateHeader* header = (const SharedStateHeader*)Segment.GetAddress ();
+    MemoryFence ();
+
+    if ( Segment.GetLength () < SharedStateHeader::Size
+        || header->Magic != SharedStateHeader::Tag
+        || header->Version != SharedStateHeader::LayoutVersion
+        || Segment.GetLength () < SharedStateHeader::Size
+                                  + size_t( header->FrameCount ) * header->FrameSize )
+    {
+        Segment.Close ();
+        return false;
+    }
+
+    Header = header;
+    return true;
+}
+
+void SharedStateReader::Close ()
+{
+    Segment.Close ();
+    Header = 0;
+}
+
+uint64_t SharedStateReader::GetFrameCount () const
+{
+    if ( ! Header ) {
+        return 0;
+    }
+
+    uint64_t count = Header->LatestFrame;
+    MemoryFence ();
+    return count;
+}
+
+const SharedFrame* SharedStateReader::GetLatestFrame( uint32_t& sequence ) const
+{
+    uint64_t latest = GetFrameCount ();
+    if ( latest == 0 ) {
+        return 0;
+    }
+
+    unsigned slot = unsigned( ( latest - 1 ) % Header->FrameCount );
+    const SharedFrame* frame = (const SharedFrame*)(
+        (const char*)Header + SharedStateHeader::Size + size_t( slot ) * Header->FrameSize
+    );
+
+    sequence = frame->Sequence;
+    MemoryFence ();
+
+    return ( sequence & 1 ) ? 0 : frame; // odd sequence: being overwritten
+}
+
+bool SharedStateReader::IsConsistent( const SharedFrame* frame, uint32_t sequence ) const
+{
+    MemoryFence ();
+    return frame->Sequence == sequence;
+}
@@ -0,0 +1,352 @@
+#ifndef _WORB_SHARED_STATE_H_INCLUDED
+#define _WORB_SHARED_STATE_H_INCLUDED
+
+/**
+ *  @file      SharedState.h
+ *  @brief     Definitions for the SharedStatePublisher and SharedStateReader classes,
+ *             which publish the system state into a shared memory ring of frames.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-21
+ *  @copyright GNU Public License.
+ *
+ * The shared memory segment consists of a SharedStateHeader followed by
+ * `FrameCount` fixed-size frames. Each frame holds a SharedFrame header, followed by
+ * `MaxBodies` SharedBody records and `MaxContacts` SharedContact records.
+ *
+ * Frames are versioned using a sequence lock: the (single) publisher makes the
+ * frame's sequence number odd while writing it and even when the frame is complete.
+ * A reader takes the latest frame, remembers its sequence number, reads the data
+ * in place (without copying) and afterwards verifies that the sequence number has
+ * not changed. The publisher never waits for readers.
+ */
+
+#include "WoRB.h"
+
+#include <stdint.h> // we use: uint32_t, uint64_t
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Holds the state of a single rigid body, as published in a shared frame.
+     */
+    struct SharedBody
+    {
+        double   X[3];      //!< Holds the position of the body, in `m`
+        double   Q[4];      //!< Holds the orientation of the body as (w, x, y, z)
+        uint32_t IsActive;  //!< Holds nonzero if the body is active
+        uint32_t Reserved;  //!< Reserved; pads the record to 8-octet boundary
+    };
+
+    /** Holds the data of a single contact, as published in a shared frame.
+     */
+    struct SharedContact
+    {
+        double   X[3];        //!< Holds the position of the contact in world frame
+        double   N[3];        //!< Holds the contact normal in world frame
+        double   Penetration; //!< Holds the penetration depth
+        uint32_t WithScenery; //!< Holds nonzero if the contact is with scenery
+        uint32_t Reserved;    //!< Reserved; pads the record to 8-octet boundary
+    };
+
+    /** Holds the header of a single frame (followed by bodies and contacts).
+     */
+    struct SharedFrame
+    {
+        volatile uint32_t Sequence; //!< Holds the sequence lock; odd while written
+        uint32_t BodyCount;         //!< Holds the number of valid body records
+        uint32_t ContactCount;      //!< Holds the number of valid contact records
+        uint32_t Reserved;          //!< Reserved; pads the record to 8-octet boundary
+        uint64_t TimeStepCount;     //!< Holds the number of integrator time-steps
+        double   Time;              //!< Holds the system local time, in `s`
+        double   PublishTime;       //!< Holds the MonotonicTime() of the publication
+        double   TotalKineticEnergy;      //!< Holds the total kinetic energy, in `J`
+        double   TotalPotentialEnergy;    //!< Holds the total potential energy, in `J`
+        double   TotalLinearMomentum[3];  //!< Holds the total linear momentum
+        double   TotalAngularMomentum[3]; //!< Holds the total angular momentum
+    };
+
+    /** Holds the header of the shared memory segment (followed by frames).
+     */
+    struct SharedStateHeader
+    {
+        uint32_t Magic;       //!< Holds the segment signature, SharedStateHeader::Tag
+        uint32_t Version;     //!< Holds the layout version
+        uint32_t FrameCount;  //!< Holds the number of frames in the ring
+        uint32_t FrameSize;   //!< Holds the size of a single frame, in octets
+        uint32_t MaxBodies;   //!< Holds the capacity of a frame for body records
+        uint32_t MaxContacts; //!< Holds the capacity of a frame for contact records
+        volatile uint64_t LatestFrame; //!< Holds the number of published frames
+
+        enum { Tag = 0x42526F57 /* 'WoRB' */, LayoutVersion = 1, Size = 64 };
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Encapsulates a mapping of a named shared memory segment.
+     */
+    class SharedMemory
+    {
+        void*  Address;  //!< Holds the address of the mapped segment
+        size_t Length;   //!< Holds the length of the mapped segment
+        void*  Handle;   //!< Holds the platform specific handle of the segment
+        bool   IsOwner;  //!< Indicates whether the segment is removed on close
+        char   Name[ 128 ]; //!< Holds the platform specific name of the segment
+
+        SharedMemory( const SharedMemory& ); // non-copyable
+        SharedMemory& operator = ( const SharedMemory& );
+
+    public:
+
+        SharedMemory ();
+        ~SharedMemory ();
+
+        /** Creates (and becomes the owner of) a segment of the given size.
+         * Fails if a segment of the same name exists, unless `replace` is set;
+         * then the existing segment (e.g. a stale one left by a crashed process)
+         * is removed first.
+         */
+        bool Create( const char* name, size_t length, bool replace = false );
+
+        /** Maps an existing segment for reading only.
+         */
+        bool OpenReadOnly( const char* name );
+
+        /** Unmaps the segment; removes its name from the system if owned.
+         */
+        void Close ();
+
+        /** Gets the address of the mapped segment (0 if not mapped).
+         */
+        void* GetAddress () const
+        {
+            return Address;
+        }
+
+        /** Gets the length of the mapped segment, in octets.
+         */
+        size_t GetLength () const
+        {
+            return Length;
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Publishes the state of a WorldOfRigidBodies into a shared memory ring.
+     */
+    class SharedStatePublisher
+    {
+        SharedMemory       Segment;     //!< Holds the mapped shared memory segment
+        SharedStateHeader* Header;      //!< Points to the segment header
+        SharedFrame*       Frame;       //!< Points to the frame currently written
+        uint64_t           FrameNumber; //!< Holds the number of published frames
+
+    public:
+
+        SharedStatePublisher ();
+
+        /** Creates the named shared memory segment with the given capacities.
+         * Fails if the segment exists (e.g. another publisher uses it), unless
+         * `replace` is set (see SharedMemory::Create).
+         */
+        bool Open( const char* name, unsigned maxBodies, unsigned maxContacts,
+            unsigned frameCount = 4, bool replace = false );
+
+        /** Closes and removes the shared memory segment.
+         */
+        void Close ();
+
+        /** Returns true if the shared memory segment is created.
+         */
+        bool IsOpen () const
+        {
+            return Header != 0;
+        }
+
+        /** Gets the frame capacity for body records.
+         */
+        unsigned MaxBodies () const
+        {
+            return Header ? Header->MaxBodies : 0;
+        }
+
+        /** Gets the frame capacity for contact records.
+         */
+        unsigned MaxContacts () const
+        {
+            return Header ? Header->MaxContacts : 0;
+        }
+
+        /** Starts writing the next frame in the ring (makes its sequence odd).
+         */
+        SharedFrame* BeginFrame ();
+
+        /** Completes the frame started with BeginFrame and makes it the latest.
+         */
+        void EndFrame ();
+
+        /** Gets the body records that follow the given frame header.
+         */
+        SharedBody* GetBodies( SharedFrame* frame ) const
+        {
+            return (SharedBody*)( frame + 1 );
+        }
+
+        /** Gets the contact records that follow the body records of the given frame.
+         */
+        SharedContact* GetContacts( SharedFrame* frame ) const
+        {
+            return (SharedContact*)( GetBodies( frame ) + Header->MaxBodies );
+        }
+
+        /** Publishes the current state of the given system as a new frame.
+         */
+        template<class World>
+        void Publish( const World& worb )
+        {
+            SharedFrame* frame = BeginFrame ();
+            if ( ! frame ) {
+                return;
+            }
+
+            frame->TimeStepCount = worb.TimeStepCount;
+            frame->Time          = worb.Time;
+
+            frame->TotalKineticEnergy   = worb.TotalKineticEnergy;
+            frame->TotalPotentialEnergy = worb.TotalPotentialEnergy;
+
+            for ( unsigned i = 0; i < 3; ++i ) {
+                frame->TotalLinearMomentum[i]  = worb.TotalLinearMomentum[i];
+                frame->TotalAngularMomentum[i] = worb.TotalAngularMomentum[i];
+            }
+
+            // Publish bodies (scenery objects are skipped)
+            //
+            SharedBody* body = GetBodies( frame );
+            unsigned bodyCount = 0;
+
+            for ( unsigned i = 0; i < worb.GetObjectCount (); ++i )
+            {
+                const RigidBody* b = worb.GetObject(i)->Body;
+                if ( ! b || bodyCount >= Header->MaxBodies ) {
+                    continue;
+                }
+
+                body->X[0] = b->Position.x;
+                body->X[1] = b->Position.y;
+                body->X[2] = b->Position.z;
+                body->Q[0] = b->Orientation.w;
+                body->Q[1] = b->Orientation.x;
+                body->Q[2] = b->Orientation.y;
+                body->Q[3] = b->Orientation.z;
+                body->IsActive = b->IsActive;
+
+                ++body; ++bodyCount;
+            }
+
+            // Publish contacts
+            //
+            SharedContact* contact = GetContacts( frame );
+            unsigned contactCount = 0;
+
+            for ( unsigned i = 0; i < worb.Collisions.Count (); ++i )
+            {
+                if ( contactCount >= Header->MaxContacts ) {
+                    break;
+                }
+
+                const Collision& c = worb.Collisions[i];
+
+                contact->X[0] = c.Position.x;
+                contact->X[1] = c.Position.y;
+                contact->X[2] = c.Position.z;
+                contact->N[0] = c.Normal.x;
+                contact->N[1] = c.Normal.y;
+                contact->N[2] = c.Normal.z;
+                contact->Penetration = c.Penetration;
+                contact->WithScenery = c.WithScenery ();
+
+                ++contact; ++contactCount;
+            }
+
+            frame->BodyCount    = bodyCount;
+            frame->ContactCount = contactCount;
+
+            EndFrame ();
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Reads frames published by a SharedStatePublisher in another process.
+     *
+     * Usage: <code>
+
+       uint32_t seq;
+       const SharedFrame* frame = reader.GetLatestFrame( seq );
+       if ( frame ) {
+           // ...read frame, reader.GetBodies( frame ) etc. in place...
+           if ( reader.IsConsistent( frame, seq ) ) {
+               // ...the data read are valid...
+           }
+       }
+
+       </code>
+     */
+    class SharedStateReader
+    {
+        SharedMemory             Segment; //!< Holds the mapped shared memory segment
+        const SharedStateHeader* Header;  //!< Points to the segment header
+
+    public:
+
+        SharedStateReader ();
+
+        /** Maps the named shared memory segment for reading.
+         */
+        bool Open( const char* name );
+
+        /** Unmaps the shared memory segment.
+         */
+        void Close ();
+
+        /** Gets the segment header (0 if not open).
+         */
+        const SharedStateHeader* GetHeader () const
+        {
+            return Header;
+        }
+
+        /** Gets the number of frames published so far.
+         */
+        uint64_t GetFrameCount () const;
+
+        /** Gets the latest completely published frame.
+         * @return 0 if there is no such frame (or it is being overwritten).
+         */
+        const SharedFrame* GetLatestFrame( uint32_t& sequence ) const;
+
+        /** Returns true if the frame has not been overwritten since GetLatestFrame.
+         */
+        bool IsConsistent( const SharedFrame* frame, uint32_t sequence ) const;
+
+        /** Gets the body records that follow the given frame header.
+         */
+        const SharedBody* GetBodies( const SharedFrame* frame ) const
+        {
+            return (const SharedBody*)( frame + 1 );
+        }
+
+        /** Gets the contact records that follow the body records of the given frame.
+         */
+        const SharedContact* GetContacts( const SharedFrame* frame ) const
+        {
+            return (const SharedContact*)( GetBodies( frame ) + Header->MaxBodies );
+        }
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_SHARED_STATE_H_INCLUDED
@@ -0,0 +1,83 @@
+/**
+ *  @file      ShmReader.cpp
+ *  @brief     An example of an external tool reading the state published by WoRB
+ *             into shared memory (see SharedStatePublisher).
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-21
+ *  @copyright GNU Public License.
+ *
+ * Usage: WoRB_ShmReader [name [count]]
+ *
+ * Waits for the segment `name` (default `worb`) to appear, then displays the latest
+ * consistent frame ten times per second (`count` times, or forever if 0).
+ */
+
+#include "SharedState.h"
+
+#include <cstdio>   // we use: printf
+#include <cstdlib>  // we use: atoi
+
+#ifdef _WIN32
+    #include <Windows.h>
+    static void SleepMs( unsigned ms ) { Sleep( ms ); }
+#else
+    #include <unistd.h>
+    static void SleepMs( unsigned ms ) { usleep( ms * 1000u ); }
+#endif
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+int main( int argc, char* argv[] )
+{
+    const char* name = argc >= 2 ? argv[1] : "worb";
+    int count = argc >= 3 ? atoi( argv[2] ) : 0;
+
+    SharedStateReader reader;
+
+    while ( ! reader.Open( name ) ) {
+        SleepMs( 100 ); // Wait for the publisher
+    }
+
+    printf( "Opened '%s': %u frames, %u bodies, %u contacts per frame\n", name,
+        reader.GetHeader()->FrameCount, reader.GetHeader()->MaxBodies,
+        reader.GetHeader()->MaxContacts );
+
+    for ( int n = 0; count == 0 || n < count; ++n, SleepMs( 100 ) )
+    {
+        uint32_t seq;
+        const SharedFrame* frame = reader.GetLatestFrame( seq );
+        if ( ! frame ) {
+            continue;
+        }
+
+        // Read the frame in place; the values are used only if the frame
+        // has not been overwritten in the meantime.
+        //
+        const SharedBody* body = reader.GetBodies( frame );
+        unsigned bodyCount     = frame->BodyCount;
+        unsigned contactCount  = frame->ContactCount;
+        double   t             = frame->Time;
+        double   E_k           = frame->TotalKineticEnergy;
+        double   E_p           = frame->TotalPotentialEnergy;
+        double   latency       = MonotonicTime () - frame->PublishTime;
+
+        double x0[3] = { 0, 0, 0 };
+        if ( bodyCount > 0 ) {
+            x0[0] = body->X[0]; x0[1] = body->X[1]; x0[2] = body->X[2];
+        }
+
+        if ( ! reader.IsConsistent( frame, seq ) ) {
+            continue; // Torn read; try again with the next frame
+        }
+
+        printf( "t = %8.3f  N = %4u  contacts = %4u  E_k = %10.3f  E_p = %10.3f"
+                "  x(1) = [ %7.3f %7.3f %7.3f ]  age = %.1f us\n",
+                t, bodyCount, contactCount, E_k, E_p, x0[0], x0[1], x0[2],
+                latency * 1e6 );
+    }
+
+    return 0;
+}
@@ -0,0 +1,824 @@
+/**
+ *  @file      SimulationServer.cpp
+ *  @brief     Implementation of the SimulationServer, SimulationSession and
+ *             SimulationClient classes.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-22
+ *  @copyright GNU Public License.
+ */
+
+#include "SimulationServer.h"
+
+#include <cstring>      // we use: memcpy, memset, strncpy
+#include <cfloat>       // we use: DBL_MAX
+
+#include <errno.h>      // we use: errno, EINTR
+#include <pthread.h>    // we use: pthread_create, pthread_detach
+#include <unistd.h>     // we use: close, unlink
+#include <sys/socket.h> // we use: socket, bind, listen, accept, send, recv
+#include <sys/un.h>     // we use: sockaddr_un
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0 // Platforms without MSG_NOSIGNAL should ignore SIGPIPE
+#endif
+
+using namespace WoRB;
+using namespace WoRB::Protocol;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// The largest message accepted by the server or the client; guards against
+// corrupted length fields.
+//
+static const uint32_t MaxMessageLength = 64u << 20;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Checks whether all the values are finite (NaN fails every comparison).
+//
+static bool IsFinite( const double* value, unsigned count )
+{
+    for ( unsigned i = 0; i < count; ++i ) {
+        if ( ! ( value[i] >= -DBL_MAX && value[i] <= DBL_MAX ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Appends raw octets to a buffer.
+//
+static void Append( std::vector<char>& buffer, const void* data, size_t length )
+{
+    if ( length > 0 ) {
+        const char* p = (const char*)data;
+        buffer.insert( buffer.end (), p, p + length );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Sends the whole buffer to the socket.
+//
+static bool SendAll( int socket, const char* data, size_t length )
+{
+    while ( length > 0 )
+    {
+        ssize_t rc = send( socket, data, length, MSG_NOSIGNAL );
+        if ( rc < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( rc <= 0 ) {
+            return false;
+        }
+        data   += rc;
+        length -= size_t( rc );
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Receives at least some data from the socket into the buffer.
+//
+static bool ReceiveSome( int socket, std::vector<char>& buffer )
+{
+    char chunk[ 64 * 1024 ];
+
+    for ( ;; )
+    {
+        ssize_t rc = recv( socket, chunk, sizeof( chunk ), 0 );
+        if ( rc < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( rc <= 0 ) {
+            return false; // Disconnected or failed
+        }
+        Append( buffer, chunk, size_t( rc ) );
+        return true;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// SimulationSession
+/////////////////////////////////////////////////////////////////////////////////////////
+
+SimulationSession::SimulationSession ()
+    : worb( 0 )
+    , IsLoaded( false )
+    , StreamInterval( 0 )
+{
+}
+
+SimulationSession::~SimulationSession ()
+{
+    Clear ();
+    delete worb;
+}
+
+void SimulationSession::Clear ()
+{
+    for ( unsigned i = 0; i < Spheres.size (); ++i ) {
+        delete Spheres[i];
+    }
+    for ( unsigned i = 0; i < Cuboids.size (); ++i ) {
+        delete Cuboids[i];
+    }
+
+    Spheres.clear ();
+    Cuboids.clear ();
+    Bodies.clear ();
+
+    if ( worb ) {
+        worb->RemoveObjects ();
+    }
+
+    IsLoaded = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void SimulationSession::Reply( std::vector<char>& output,
+    const MessageHeader& request, unsigned status,
+    const void* payload, unsigned length )
+{
+    MessageHeader reply;
+    reply.Length  = uint32_t( sizeof( MessageHeader ) + length );
+    reply.Command = request.Command;
+    reply.Flags   = 0;
+    reply.Tag     = request.Tag;
+    reply.Status  = status;
+
+    Append( output, &reply, sizeof( reply ) );
+    Append( output, payload, length );
+}
+
+void SimulationSession::GetDiagnostics( Diagnostics& diag ) const
+{
+    memset( &diag, 0, sizeof( diag ) );
+
+    if ( IsLoaded )
+    {
+        diag.TimeStepCount        = worb->TimeStepCount;
+        diag.Time                 = worb->Time;
+        diag.TotalKineticEnergy   = worb->TotalKineticEnergy;
+        diag.TotalPotentialEnergy = worb->TotalPotentialEnergy;
+        diag.BodyCount            = uint32_t( Bodies.size () );
+        diag.ContactCount         = worb->Collisions.Count ();
+    }
+}
+
+void SimulationSession::AppendState( std::vector<char>& output,
+    const MessageHeader& request, unsigned command,
+    unsigned first, unsigned count ) const
+{
+    MessageHeader reply;
+    reply.Length  = uint32_t( sizeof( MessageHeader ) + sizeof( StateHeader )
+                  + count * sizeof( BodyState ) );
+    reply.Command = command;
+    reply.Flags   = 0;
+    reply.Tag     = request.Tag;
+    reply.Status  = Ok;
+
+    StateHeader state;
+    state.TimeStepCount = worb->TimeStepCount;
+    state.Time          = worb->Time;
+    state.First         = first;
+    state.BodyCount     = count;
+
+    Append( output, &reply, sizeof( reply ) );
+    Append( output, &state, sizeof( state ) );
+
+    size_t offset = output.size ();
+    output.resize( offset + count * sizeof( BodyState ) );
+    BodyState* s = (BodyState*)&output[ offset ];
+
+    for ( unsigned i = 0; i < count; ++i, ++s )
+    {
+        const RigidBody* body = Bodies[ first + i ];
+
+        for ( unsigned k = 0; k < 3; ++k )
+        {
+            s->X[k] = body->Position[k];
+            s->P[k] = body->LinearMomentum[k];
+            s->L[k] = body->AngularMomentum[k];
+            s->V[k] = body->Velocity[k];
+            s->W[k] = body->AngularVelocity[k];
+        }
+
+        s->Q[0] = body->Orientation.w;
+        s->Q[1] = body->Orientation.x;
+        s->Q[2] = body->Orientation.y;
+        s->Q[3] = body->Orientation.z;
+
+        s->AverageKineticEnergy = body->AverageKineticEnergy;
+        s->IsActive = body->IsActive;
+        s->Reserved = 0;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long long SimulationSession::StreamFrameBytes( unsigned count ) const
+{
+    if ( ! StreamInterval ) {
+        return 0;
+    }
+
+    // Frames are streamed at the time-steps that are multiples of the interval
+    //
+    const unsigned long long first = worb->TimeStepCount;
+    const unsigned long long frames = ( first + count ) / StreamInterval
+                                    - first / StreamInterval;
+
+    return frames * ( sizeof( MessageHeader ) + sizeof( StateHeader )
+                    + Bodies.size () * sizeof( BodyState ) );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned SimulationSession::OnLoadScene( const char* payload, unsigned length )
+{
+    if ( length < sizeof( SceneParams ) ) {
+        return BadRequest;
+    }
+
+    SceneParams scene;
+    memcpy( &scene, payload, sizeof( scene ) );
+
+    if ( length != sizeof( SceneParams ) + scene.BodyCount * sizeof( BodySpec ) ) {
+        return BadRequest;
+    }
+    if ( ! IsFinite( scene.Gravity, 3 ) || ! IsFinite( &scene.Restitution, 1 )
+        || ! IsFinite( &scene.Relaxation, 1 ) || ! IsFinite( &scene.Friction, 1 ) ) {
+        return BadRequest;
+    }
+    if ( scene.BodyCount + ( scene.GroundPlane ? 1 : 0 ) > MaxObjects ) {
+        return TooLarge;
+    }
+
+    Clear ();
+
+    if ( ! worb ) {
+        worb = new World;
+    }
+
+    worb->RemoveObjects ();
+    worb->Gravity = SpatialVector( scene.Gravity[0], scene.Gravity[1], scene.Gravity[2] );
+    worb->Collisions.Restitution = scene.Restitution;
+    worb->Collisions.Relaxation  = scene.Relaxation;
+    worb->Collisions.Friction    = scene.Friction;
+
+    if ( scene.GroundPlane )
+    {
+        GroundPlane.Direction = Const::Y;
+        GroundPlane.Offset    = 0;
+        worb->Add( GroundPlane );
+    }
+
+    const char* p = payload + sizeof( SceneParams );
+
+    for ( unsigned i = 0; i < scene.BodyCount; ++i, p += sizeof( BodySpec ) )
+    {
+        BodySpec spec;
+        memcpy( &spec, p, sizeof( spec ) );
+
+        // Non-finite values would spread NaNs through the whole system
+        //
+        const bool finite = IsFinite( spec.HalfExtent, 3 ) && IsFinite( &spec.Mass, 1 )
+            && IsFinite( spec.X, 3 ) && IsFinite( spec.Q, 4 )
+            && IsFinite( spec.V, 3 ) && IsFinite( spec.W, 3 );
+
+        if ( ! finite || spec.Mass <= 0 || spec.HalfExtent[0] <= 0 || spec.Geometry > 1
+            || ( spec.Geometry == 1 && ( spec.HalfExtent[1] <= 0
+                                      || spec.HalfExtent[2] <= 0 ) )
+            || ( spec.Q[0] == 0 && spec.Q[1] == 0 && spec.Q[2] == 0 && spec.Q[3] == 0 ) )
+        {
+            Clear ();
+            return BadRequest;
+        }
+
+        SpatialVector X( spec.X[0], spec.X[1], spec.X[2] );
+        SpatialVector V( spec.V[0], spec.V[1], spec.V[2] );
+        SpatialVector W( spec.W[0], spec.W[1], spec.W[2] );
+        Quaternion Q = Quaternion( spec.Q[0], spec.Q[1], spec.Q[2], spec.Q[3] ).Unit ();
+
+        RigidBody* body = 0;
+
+        if ( spec.Geometry == 0 )
+        {
+            SolidSphere* sphere = new SolidSphere( X, Q, V, W,
+                spec.HalfExtent[0], spec.Mass );
+            Spheres.push_back( sphere );
+            worb->Add( sphere );
+            body = sphere;
+        }
+        else
+        {
+            SolidCuboid* cuboid = new SolidCuboid( X, Q, V, W,
+                SpatialVector( spec.HalfExtent[0], spec.HalfExtent[1], spec.HalfExtent[2] ),
+                spec.Mass );
+            Cuboids.push_back( cuboid );
+            worb->Add( cuboid );
+            body = cuboid;
+        }
+
+        body->CanBeDeactivated = spec.CanBeDeactivated != 0;
+        Bodies.push_back( body );
+    }
+
+    worb->InitializeODE ();
+    IsLoaded = true;
+
+    return Ok;
+}
+
+unsigned SimulationSession::OnApply( unsigned command, const char* payload,
+    unsigned length )
+{
+    if ( length != sizeof( BodyAction ) ) {
+        return BadRequest;
+    }
+
+    BodyAction action;
+    memcpy( &action, payload, sizeof( action ) );
+
+    if ( action.Body >= Bodies.size () ) {
+        return OutOfRange;
+    }
+
+    RigidBody* body = Bodies[ action.Body ];
+    SpatialVector vector( action.Vector[0], action.Vector[1], action.Vector[2] );
+    SpatialVector point ( action.Point[0],  action.Point[1],  action.Point[2]  );
+
+    if ( command == ApplyImpulse )
+    {
+        // The impulse changes the momenta instantaneously
+        //
+        body->LinearMomentum  += vector;
+        body->AngularMomentum += ( point - body->Position ).Cross( vector );
+        body->CalculateDerivedQuantities ();
+        body->Activate ();
+    }
+    else
+    {
+        // The force acts during the next time-step only (the accumulators are
+        // cleared at the end of every time-step).
+        //
+        body->AddForceAtPoint( point, vector );
+    }
+
+    return Ok;
+}
+
+unsigned SimulationSession::OnRestore( const char* payload, unsigned length )
+{
+    if ( length < sizeof( StateHeader ) ) {
+        return BadRequest;
+    }
+
+    StateHeader state;
+    memcpy( &state, payload, sizeof( state ) );
+
+    // The counts are checked without sums that may wrap around
+    //
+    const unsigned bytes = length - unsigned( sizeof( StateHeader ) );
+    if ( bytes % sizeof( BodyState ) != 0
+        || state.BodyCount != bytes / sizeof( BodyState ) ) {
+        return BadRequest;
+    }
+    if ( state.First > Bodies.size ()
+        || state.BodyCount > Bodies.size () - state.First ) {
+        return OutOfRange;
+    }
+
+    const char* p = payload + sizeof( StateHeader );
+
+    for ( unsigned i = 0; i < state.BodyCount; ++i, p += sizeof( BodyState ) )
+    {
+        BodyState s;
+        memcpy( &s, p, sizeof( s ) );
+
+        RigidBody* body = Bodies[ state.First + i ];
+
+        body->Position        = SpatialVector( s.X[0], s.X[1], s.X[2] );
+        body->Orientation     = Quaternion( s.Q[0], s.Q[1], s.Q[2], s.Q[3] );
+        body->LinearMomentum  = SpatialVector( s.P[0], s.P[1], s.P[2] );
+        body->AngularMomentum = SpatialVector( s.L[0], s.L[1], s.L[2] );
+        body->AverageKineticEnergy = s.AverageKineticEnergy;
+        body->IsActive = s.IsActive != 0;
+
+        body->CalculateDerivedQuantities ();
+        body->ClearAccumulators ();
+    }
+
+    worb->TimeStepCount = (unsigned long)state.TimeStepCount;
+    worb->Time          = state.Time;
+
+    return Ok;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+void SimulationSession::Execute( const MessageHeader& request, const char* payload,
+    std::vector<char>& output )
+{
+    unsigned length = request.Length - unsigned( sizeof( MessageHeader ) );
+    unsigned status = Ok;
+    bool     noReply = ( request.Flags & NoReply ) != 0;
+
+    if ( request.Command != LoadScene && ! IsLoaded )
+    {
+        Reply( output, request, NoScene );
+        return;
+    }
+
+    switch( request.Command )
+    {
+        case LoadScene:
+        case Step:
+        case Restore:
+        {
+            if ( request.Command == LoadScene ) {
+                status = OnLoadScene( payload, length );
+            }
+            else if ( request.Command == Restore ) {
+                status = OnRestore( payload, length );
+            }
+            else if ( length != sizeof( StepParams ) ) {
+                status = BadRequest;
+            }
+            else
+            {
+                StepParams step;
+                memcpy( &step, payload, sizeof( step ) );
+
+                // The time-step must be positive and finite (NaN fails
+                // every comparison)
+                //
+                if ( ! ( step.TimeStep > 0 && step.TimeStep <= DBL_MAX )
+                    || step.Count > MaxStepCount )
+                {
+                    status = BadRequest;
+                }
+                else if ( StreamFrameBytes( step.Count ) > MaxMessageLength )
+                {
+                    status = TooLarge; // The streamed frames would not fit
+                }
+                else
+                {
+                    for ( unsigned i = 0; i < step.Count; ++i )
+                    {
+                        worb->SolveODE( step.TimeStep );
+
+                        if ( StreamInterval
+                            && worb->TimeStepCount % StreamInterval == 0 ) {
+                            AppendState( output, request, StreamFrame,
+                                0, unsigned( Bodies.size () ) );
+                        }
+                    }
+                }
+            }
+
+            if ( status != Ok ) {
+                Reply( output, request, status );
+            }
+            else if ( ! noReply )
+            {
+                Diagnostics diag;
+                GetDiagnostics( diag );
+                Reply( output, request, Ok, &diag, sizeof( diag ) );
+            }
+            break;
+        }
+
+        case ApplyImpulse:
+        case ApplyForce:
+            status = OnApply( request.Command, payload, length );
+            if ( status != Ok || ! noReply ) {
+                Reply( output, request, status );
+            }
+            break;
+
+        case QueryBodies:
+        case Checkpoint:
+        {
+            BodyRange range;
+            range.First = 0;
+            range.Count = uint32_t( Bodies.size () );
+
+            if ( request.Command == QueryBodies )
+            {
+                if ( length != sizeof( BodyRange ) ) {
+                    Reply( output, request, BadRequest );
+                    break;
+                }
+                memcpy( &range, payload, sizeof( range ) );
+                if ( range.First > Bodies.size ()
+                    || range.Count > Bodies.size () - range.First ) {
+                    Reply( output, request, OutOfRange );
+                    break;
+                }
+            }
+
+            AppendState( output, request, request.Command, range.First, range.Count );
+            break;
+        }
+
+        case Stream:
+            if ( length != sizeof( StreamParams ) ) {
+                Reply( output, request, BadRequest );
+            }
+            else
+            {
+                StreamParams stream;
+                memcpy( &stream, payload, sizeof( stream ) );
+                StreamInterval = stream.Interval;
+                if ( ! noReply ) {
+                    Reply( output, request, Ok );
+                }
+            }
+            break;
+
+        default:
+            Reply( output, request, BadRequest );
+            break;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// SimulationServer
+/////////////////////////////////////////////////////////////////////////////////////////
+
+SimulationServer::SimulationServer ()
+    : Listener( -1 )
+    , IsRunning( false )
+{
+    Path[0] = 0;
+}
+
+SimulationServer::~SimulationServer ()
+{
+    Stop ();
+}
+
+bool SimulationServer::Listen( const char* path )
+{
+    Stop ();
+
+    sockaddr_un addr;
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+
+    if ( strlen( path ) >= sizeof( addr.sun_path ) ) {
+        Printf( "WoRB: Socket path too long: %s\n", path );
+        return false;
+    }
+
+    strncpy( addr.sun_path, path, sizeof( addr.sun_path ) - 1 );
+    strncpy( Path, path, sizeof( Path ) - 1 );
+    Path[ sizeof( Path ) - 1 ] = 0;
+
+    Listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( Listener < 0 ) {
+        Printf( "WoRB: Failed to create socket\n" );
+        return false;
+    }
+
+    unlink( Path ); // Remove any stale socket left by a crashed server
+
+    if ( bind( Listener, (sockaddr*)&addr, sizeof( addr ) ) != 0
+        || listen( Listener, 64 ) != 0 )
+    {
+        Printf( "WoRB: Failed to listen on %s\n", Path );
+        close( Listener );
+        Listener = -1;
+        return false;
+    }
+
+    IsRunning = true;
+    return true;
+}
+
+void SimulationServer::Stop ()
+{
+    IsRunning = false;
+
+    if ( Listener >= 0 )
+    {
+        close( Listener ); // Also interrupts the pending accept() in Run()
+        Listener = -1;
+        unlink( Path );
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// The thread entry point serving a single client.
+//
+static void* ServeThread( void* arg )
+{
+    SimulationServer::Serve( int( (intptr_t)arg ) );
+    return 0;
+}
+
+void SimulationServer::Run ()
+{
+    while ( IsRunning )
+    {
+        int client = accept( Listener, 0, 0 );
+        if ( client < 0 )
+        {
+            if ( errno == EINTR && IsRunning ) {
+                continue;
+            }
+            break; // The listener has been closed
+        }
+
+        pthread_t thread;
+        if ( pthread_create( &thread, 0, ServeThread, (void*)(intptr_t)client ) != 0 ) {
+            close( client );
+            continue;
+        }
+        pthread_detach( thread );
+    }
+}
+
+void SimulationServer::Serve( int socket )
+{
+    SimulationSession session;
+
+    std::vector<char> input;
+    std::vector<char> output;
+
+    // Execute all the complete requests that are buffered, then send all
+    // the replies at once. Pipelined requests are thus answered in batches.
+    //
+    while ( ReceiveSome( socket, input ) )
+    {
+        size_t offset = 0;
+        bool failed = false;
+
+        while ( input.size () - offset >= sizeof( MessageHeader ) )
+        {
+            MessageHeader request;
+            memcpy( &request, &input[ offset ], sizeof( request ) );
+
+            if ( request.Length < sizeof( MessageHeader )
+                || request.Length > MaxMessageLength ) {
+                failed = true; // The stream is out of sync; drop the client
+                break;
+            }
+            if ( input.size () - offset < request.Length ) {
+                break; // Incomplete request
+            }
+
+            session.Execute( request, &input[ offset ] + sizeof( MessageHeader ),
+                output );
+
+            offset += request.Length;
+
+            // Don't let the replies of pipelined requests pile up
+            //
+            if ( output.size () >= MaxMessageLength )
+            {
+                if ( ! SendAll( socket, &output[0], output.size () ) ) {
+                    failed = true;
+                    break;
+                }
+                output.clear ();
+            }
+        }
+
+        input.erase( input.begin (), input.begin () + offset );
+
+        if ( ! output.empty () )
+        {
+            if ( ! SendAll( socket, &output[0], output.size () ) ) {
+                failed = true;
+            }
+            output.clear ();
+        }
+
+        if ( failed ) {
+            break;
+        }
+    }
+
+    close( socket );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// SimulationClient
+/////////////////////////////////////////////////////////////////////////////////////////
+
+SimulationClient::SimulationClient ()
+    : Socket( -1 )
+    , InputOffset( 0 )
+{
+}
+
+SimulationClient::~SimulationClient ()
+{
+    Close ();
+}
+
+bool SimulationClient::Connect( const char* path )
+{
+    Close ();
+
+    sockaddr_un addr;
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    strncpy( addr.sun_path, path, sizeof( addr.sun_path ) - 1 );
+
+    Socket = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( Socket < 0 ) {
+        return false;
+    }
+
+    if ( connect( Socket, (sockaddr*)&addr, sizeof( addr ) ) != 0 ) {
+        Close ();
+        return false;
+    }
+
+    return true;
+}
+
+void SimulationClient::Close ()
+{
+    if ( Socket >= 0 ) {
+        close( Socket );
+        Socket = -1;
+    }
+
+    Output.clear ();
+    Input.clear ();
+    InputOffset = 0;
+}
+
+void SimulationClient::Send( unsigned command, unsigned tag,
+    const void* payload, unsigned length, unsigned flags )
+{
+    Send( command, tag, payload, length, 0, 0, flags );
+}
+
+void SimulationClient::Send( unsigned command, unsigned tag,
+    const void* part1, unsigned length1, const void* part2, unsigned length2,
+    unsigned flags )
+{
+    MessageHeader header;
+    header.Length  = uint32_t( sizeof( MessageHeader ) + length1 + length2 );
+    header.Command = uint16_t( command );
+    header.Flags   = uint16_t( flags );
+    header.Tag     = tag;
+    header.Status  = Ok;
+
+    Append( Output, &header, sizeof( header ) );
+    Append( Output, part1, length1 );
+    Append( Output, part2, length2 );
+}
+
+bool SimulationClient::Flush ()
+{
+    if ( Output.empty () ) {
+        return true;
+    }
+
+    bool ok = SendAll( Socket, &Output[0], Output.size () );
+    Output.clear ();
+
+    return ok;
+}
+
+bool SimulationClient::Receive( MessageHeader& header, std::vector<char>& payload )
+{
+    for ( ;; )
+    {
+        size_t available = Input.size () - InputOffset;
+
+        if ( available >= sizeof( MessageHeader ) )
+        {
+            memcpy( &header, &Input[ InputOffset ], sizeof( header ) );
+
+            if ( header.Length < sizeof( MessageHeader )
+                || header.Length > MaxMessageLength ) {
+                return false;
+            }
+
+            if ( available >= header.Length )
+            {
+                const char* p = &Input[ InputOffset ] + sizeof( MessageHeader );
+                payload.assign( p, p + header.Length - sizeof( MessageHeader ) );
+                InputOffset += header.Length;
+                return true;
+            }
+        }
+
+        // Compact the buffer before receiving more data
+        //
+        Input.erase( Input.begin (), Input.begin () + InputOffset );
+        InputOffset = 0;
+
+        if ( ! ReceiveSome( Socket, Input ) ) {
+            return false;
+        }
+    }
+}
@@ -0,0 +1,181 @@
+#ifndef _WORB_SIMULATION_SERVER_H_INCLUDED
+#define _WORB_SIMULATION_SERVER_H_INCLUDED
+
+/**
+ *  @file      SimulationServer.h
+ *  @brief     Definitions for the SimulationServer class, which serves simulations
+ *             to local clients over a Unix domain socket, and for its counterpart
+ *             SimulationClient.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-22
+ *  @copyright GNU Public License.
+ *
+ * Each client connection gets its own SimulationSession (i.e. its own system of
+ * rigid bodies) served by a dedicated thread. See ServerProtocol.h for the protocol.
+ */
+
+#include "WoRB.h"
+#include "ServerProtocol.h"
+
+#include <vector> // we use: std::vector
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Encapsulates a simulation owned by a single client connection.
+     */
+    class SimulationSession
+    {
+    public:
+
+        /** Holds the capacity of a session.
+         */
+        enum { MaxObjects = 4096, MaxCollisions = 16384 };
+
+        /** Holds the most time-steps solved by a single Step request.
+         */
+        enum { MaxStepCount = 100000 };
+
+        /** The system simulated in a session.
+         */
+        typedef WorldOfRigidBodies<MaxObjects,MaxCollisions> World;
+
+    private:
+
+        World* worb;                         //!< Holds the simulated system
+        HalfSpace GroundPlane;               //!< Holds the optional ground plane
+        std::vector<SolidSphere*> Spheres;   //!< Holds the spheres owned by session
+        std::vector<SolidCuboid*> Cuboids;   //!< Holds the cuboids owned by session
+        std::vector<RigidBody*>   Bodies;    //!< Holds the bodies in the scene order
+        bool IsLoaded;                       //!< Indicates whether a scene is loaded
+        unsigned StreamInterval;             //!< Holds the stream period in steps
+
+        SimulationSession( const SimulationSession& ); // non-copyable
+        SimulationSession& operator = ( const SimulationSession& );
+
+    public:
+
+        SimulationSession ();
+        ~SimulationSession ();
+
+        /** Executes a single request and appends the reply (if any) to the output.
+         */
+        void Execute( const Protocol::MessageHeader& request, const char* payload,
+            std::vector<char>& output );
+
+    private:
+
+        /** Removes all the bodies from the session.
+         */
+        void Clear ();
+
+        /** Appends a reply message to the output.
+         */
+        static void Reply( std::vector<char>& output,
+            const Protocol::MessageHeader& request, unsigned status,
+            const void* payload = 0, unsigned length = 0 );
+
+        /** Appends a message with the state of the given range of bodies.
+         */
+        void AppendState( std::vector<char>& output,
+            const Protocol::MessageHeader& request, unsigned command,
+            unsigned first, unsigned count ) const;
+
+        /** Gets the number of octets streamed by a Step of the given count.
+         */
+        unsigned long long StreamFrameBytes( unsigned count ) const;
+
+        /** Gets the current system diagnostics.
+         */
+        void GetDiagnostics( Protocol::Diagnostics& diag ) const;
+
+        unsigned OnLoadScene( const char* payload, unsigned length );
+        unsigned OnApply( unsigned command, const char* payload, unsigned length );
+        unsigned OnRestore( const char* payload, unsigned length );
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Serves simulation sessions to local clients over a Unix domain socket.
+     */
+    class SimulationServer
+    {
+        int Listener;          //!< Holds the listening socket
+        char Path[ 108 ];      //!< Holds the socket path
+        volatile bool IsRunning; //!< Indicates whether the server accepts clients
+
+    public:
+
+        SimulationServer ();
+        ~SimulationServer ();
+
+        /** Binds the server to the given socket path.
+         */
+        bool Listen( const char* path );
+
+        /** Accepts clients until Stop() is called; serves each in its own thread.
+         */
+        void Run ();
+
+        /** Stops accepting clients and removes the socket.
+         */
+        void Stop ();
+
+        /** Serves a single connected client until it disconnects.
+         */
+        static void Serve( int socket );
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Encapsulates a blocking client of the SimulationServer.
+     * Requests are buffered by Send() and transmitted together by Flush().
+     */
+    class SimulationClient
+    {
+        int Socket;                 //!< Holds the connected socket
+        std::vector<char> Output;   //!< Holds the requests not yet transmitted
+        std::vector<char> Input;    //!< Holds the received data not yet consumed
+        size_t InputOffset;         //!< Holds the offset of unconsumed data
+
+        SimulationClient( const SimulationClient& ); // non-copyable
+        SimulationClient& operator = ( const SimulationClient& );
+
+    public:
+
+        SimulationClient ();
+        ~SimulationClient ();
+
+        /** Connects to the server listening on the given socket path.
+         */
+        bool Connect( const char* path );
+
+        /** Closes the connection.
+         */
+        void Close ();
+
+        /** Appends a request to the output buffer.
+         */
+        void Send( unsigned command, unsigned tag,
+            const void* payload = 0, unsigned length = 0, unsigned flags = 0 );
+
+        /** Appends a request with two payload parts to the output buffer.
+         */
+        void Send( unsigned command, unsigned tag,
+            const void* part1, unsigned length1, const void* part2, unsigned length2,
+            unsigned flags = 0 );
+
+        /** Transmits all the buffered requests.
+         */
+        bool Flush ();
+
+        /** Receives the next message from the server (blocking).
+         */
+        bool Receive( Protocol::MessageHeader& header, std::vector<char>& payload );
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_SIMULATION_SERVER_H_INCLUDED
@@ -0,0 +1,299 @@
+#ifndef _WORB_SOLIDS_H_INCLUDED
+#define _WORB_SOLIDS_H_INCLUDED
+
+/**
+ *  @file      Solids.h
+ *  @brief     Definitions for the SolidSphere and SolidCuboid classes, i.e. rigid
+ *             bodies carrying their own geometry (without any rendering support).
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-21
+ *  @copyright GNU Public License.
+ */
+
+#include "RigidBody.h"
+#include "Geometry.h"
+#include "Policies.h"
+
+#include <new>  // we use: placement new, operator new
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Encapsulates a rigid body with geometry of a sphere.
+     * Used by headless applications; see Ball for the GLUT-rendered variant.
+     */
+    class SolidSphere : public Sphere, public RigidBody
+    {
+    public:
+
+        /** Creates a solid sphere at the given location.
+         */
+        SolidSphere(
+            const Quaternion& position, const Quaternion& orientation,
+            const Quaternion& velocity, const Quaternion& angularVelocity,
+            double radius, double mass
+            )
+        {
+            Body = this;
+
+            Radius = radius;
+
+            // The derived quantities are calculated once, by Set_XQVW (see SetMass)
+            //
+            Body->SetupMass( mass );
+            Body->SetMomentOfInertia( MomentOfInertia( mass ) );
+
+            Body->Set_XQVW( position, orientation, velocity, angularVelocity );
+            Body->Activate ();
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Encapsulates a rigid body with geometry of a rectangular parallelepiped.
+     * Used by headless applications; see Box for the GLUT-rendered variant.
+     */
+    class SolidCuboid : public Cuboid, public RigidBody
+    {
+    public:
+
+        /** Creates a solid cuboid at the given location.
+         */
+        SolidCuboid(
+            const Quaternion& position, const Quaternion& orientation,
+            const Quaternion& velocity, const Quaternion& angularVelocity,
+            const Quaternion& halfExtent, double mass
+            )
+        {
+            Body = this;
+
+            HalfExtent = halfExtent;
+
+            // The derived quantities are calculated once, by Set_XQVW (see SetMass)
+            //
+            Body->SetupMass( mass );
+            Body->SetMomentOfInertia( MomentOfInertia( mass ) );
+
+            Body->Set_XQVW( position, orientation, velocity, angularVelocity );
+            Body->Activate ();
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Encapsulates a rigid body with a compound geometry.
+     * The children are added with Compound::AddSphere and Compound::AddCuboid,
+     * after which the body is set up with Initialize.
+     */
+    class SolidCompound : public Compound, public RigidBody
+    {
+    public:
+
+        SolidCompound ()
+        {
+            Body = this;
+        }
+
+        /** Builds the compound and places it at the given location. The position
+         * is the origin of the frame in which the children were added.
+         */
+        void Initialize(
+            const Quaternion& position, const Quaternion& orientation,
+            const Quaternion& velocity, const Quaternion& angularVelocity
+            )
+        {
+            Quaternion centerOfMass = Build ();
+
+            QTensor R;
+            R.SetFromOrientationAndPosition( orientation.Unit (), 0.0 );
+
+            Body->Set_XQVW( position + R( centerOfMass ), orientation,
+                velocity, angularVelocity );
+            Body->Activate ();
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Encapsulates a rigid body with geometry of a convex hull of a set of points.
+     * The hull should be checked with ConvexHull::VertexCount after construction
+     * (it is empty if the points do not span a volume).
+     */
+    class SolidConvexHull : public ConvexHull, public RigidBody
+    {
+    public:
+
+        /** Creates a solid convex hull at the given location. The position is
+         * the origin of the frame in which the points are given.
+         */
+        SolidConvexHull(
+            const Quaternion& position, const Quaternion& orientation,
+            const Quaternion& velocity, const Quaternion& angularVelocity,
+            const double* points, unsigned count, double mass
+            )
+        {
+            Body = this;
+
+            Build( points, count );
+
+            SetMass( mass );
+
+            QTensor R;
+            R.SetFromOrientationAndPosition( orientation.Unit (), 0.0 );
+
+            Body->Set_XQVW( position + R( Centroid () ), orientation,
+                velocity, angularVelocity );
+            Body->Activate ();
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Holds an array of solids (SolidSphere or SolidCuboid) created at once.
+     *
+     * The storage of all the solids is allocated in one block, then the solids are
+     * constructed in place in parallel, each thread setting up the mass properties
+     * and the derived quantities of its range of solids (so the memory is also first
+     * touched by the thread that uses it). The solids are added to a system by
+     * WorldOfRigidBodies::Add, and are destroyed with the array. The system moves
+     * the solids within the array when it reorders the objects (see SortObjects).
+     */
+    template<class Solid>
+    class SolidArray
+    {
+        Solid*   Items;  //!< Holds the solids
+        unsigned Size;   //!< Holds the number of the solids
+
+        /** Holds the arguments of Create during the parallel construction.
+         */
+        template<class Shape>
+        struct Batch
+        {
+            Solid* Items;
+            const Shape* Shapes;
+            const double* Masses;
+            const Quaternion* Positions;
+            const Quaternion* Orientations;
+            const Quaternion* Velocities;
+            const Quaternion* AngularVelocities;
+        };
+
+        template<class Shape>
+        static void CreateBatch( void* context, unsigned begin, unsigned end )
+        {
+            const Batch<Shape>& batch = *static_cast< Batch<Shape>* >( context );
+            const Quaternion identity( 1.0 );
+            const Quaternion rest( 0.0 );
+
+            for ( unsigned i = begin; i < end; ++i )
+            {
+                new( batch.Items + i ) Solid(
+                    batch.Positions[i],
+                    batch.Orientations ? batch.Orientations[i] : identity,
+                    batch.Velocities ? batch.Velocities[i] : rest,
+                    batch.AngularVelocities ? batch.AngularVelocities[i] : rest,
+                    batch.Shapes[i], batch.Masses[i]
+                );
+            }
+        }
+
+        SolidArray( const SolidArray& );            // not copyable
+        SolidArray& operator = ( const SolidArray& );
+
+    public:
+
+        SolidArray ()
+            : Items( 0 )
+            , Size( 0 )
+        {
+        }
+
+        ~SolidArray ()
+        {
+            Clear ();
+        }
+
+        /** Destroys all the solids (they must be removed from the system first).
+         */
+        void Clear ()
+        {
+            for ( unsigned i = 0; i < Size; ++i ) {
+                Items[i].~Solid ();
+            }
+            operator delete( Items );
+            Items = 0;
+            Size = 0;
+        }
+
+        /** Creates the given number of solids, replacing the existing ones.
+         *
+         * The shape is the radius of a SolidSphere or the half-extent of a SolidCuboid.
+         * The orientations, the velocities and the angular velocities may be null,
+         * in which case the solids are created in the initial orientation and
+         * at rest. The solids are constructed on the given number of threads.
+         */
+        template<class Shape>
+        void Create( unsigned count, const Shape* shape, const double* mass,
+            const Quaternion* position, const Quaternion* orientation = 0,
+            const Quaternion* velocity = 0, const Quaternion* angularVelocity = 0,
+            unsigned threads = 1 )
+        {
+            Clear ();
+
+            Items = static_cast<Solid*>( operator new( count * sizeof( Solid ) ) );
+            Size = count;
+
+            Batch<Shape> batch = { Items, shape, mass,
+                position, orientation, velocity, angularVelocity };
+
+            ParallelFor( count, threads, CreateBatch<Shape>, &batch );
+        }
+
+        /** Moves the solids to the given order within the same storage: the solid
+         * `order[k]` becomes the solid `k`. The pointers to the solids then point to
+         * other solids (see Relocation).
+         */
+        void Permute( const unsigned* order )
+        {
+            Solid* moved = static_cast<Solid*>( operator new( Size * sizeof( Solid ) ) );
+
+            for ( unsigned k = 0; k < Size; ++k ) {
+                new( moved + k ) Solid( Items[ order[k] ] );
+            }
+
+            for ( unsigned k = 0; k < Size; ++k )
+            {
+                Items[k].~Solid ();
+                new( Items + k ) Solid( moved[k] );
+                Items[k].Body = Items + k;
+                moved[k].~Solid ();
+            }
+
+            operator delete( moved );
+        }
+
+        /** Gets the number of the solids.
+         */
+        unsigned Count () const
+        {
+            return Size;
+        }
+
+        /** Gets the solid with the given index.
+         */
+        Solid& operator [] ( unsigned index )
+        {
+            return Items[ index ];
+        }
+
+        const Solid& operator [] ( unsigned index ) const
+        {
+            return Items[ index ];
+        }
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_SOLIDS_H_INCLUDED
@@ -0,0 +1,217 @@
+/**
+ *  @file      Topology.cpp
+ *  @brief     Implementation of the detection of the NUMA nodes and of the first-touch
+ *             placement of the memory processed by the ParallelFor workers.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-03
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+#include <cstdio>   // we use: fopen, fgets, sprintf
+#include <cstdlib>  // we use: strtoul
+#include <cstring>  // we use: memset
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WIN32
+
+/** Parses the list of ranges in the format of `/sys` (e.g. "0-3,8-11").
+ */
+static void ParseList( const char* text, std::vector<unsigned>& list )
+{
+    list.clear ();
+
+    while ( *text >= '0' && *text <= '9' )
+    {
+        char* end = 0;
+        unsigned first = unsigned( strtoul( text, &end, 10 ) );
+        unsigned last = first;
+        if ( *end == '-' ) {
+            last = unsigned( strtoul( end + 1, &end, 10 ) );
+        }
+
+        for ( unsigned i = first; i <= last; ++i ) {
+            list.push_back( i );
+        }
+
+        text = *end == ',' ? end + 1 : end;
+    }
+}
+
+/** Reads the list of ranges from the file; returns false if it cannot be read.
+ */
+static bool ReadList( const char* path, std::vector<unsigned>& list )
+{
+    FILE* file = fopen( path, "r" );
+    if ( ! file ) {
+        return false;
+    }
+
+    char line[ 4096 ];
+    bool ok = fgets( line, sizeof( line ), file ) != 0;
+    fclose( file );
+
+    if ( ok ) {
+        ParseList( line, list );
+    }
+    return ok && ! list.empty ();
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+bool NumaTopology::Detect ()
+{
+    NodeCpus.clear ();
+
+    #ifdef _WIN32
+
+        ULONG highest = 0;
+        if ( GetNumaHighestNodeNumber( &highest ) )
+        {
+            for ( ULONG node = 0; node <= highest; ++node )
+            {
+                ULONGLONG mask = 0;
+                if ( ! GetNumaNodeProcessorMask( UCHAR( node ), &mask ) || ! mask ) {
+                    continue;
+                }
+
+                std::vector<unsigned> cpus;
+                for ( unsigned cpu = 0; cpu < 64; ++cpu ) {
+                    if ( mask & ( ULONGLONG(1) << cpu ) ) {
+                        cpus.push_back( cpu );
+                    }
+                }
+                NodeCpus.push_back( cpus );
+            }
+        }
+
+    #else
+
+        std::vector<unsigned> nodes;
+        if ( ReadList( "/sys/devices/system/node/online", nodes ) )
+        {
+            for ( unsigned i = 0; i < nodes.size (); ++i )
+            {
+                char path[ 128 ];
+                sprintf( path, "/sys/devices/system/node/node%u/cpulist", nodes[i] );
+
+                // The nodes with memory only have no processors
+                //
+                std::vector<unsigned> cpus;
+                if ( ReadList( path, cpus ) ) {
+                    NodeCpus.push_back( cpus );
+                }
+            }
+        }
+
+    #endif
+
+    if ( ! NodeCpus.empty () ) {
+        return true;
+    }
+
+    // Fall back to a single node with all the online processors
+    //
+    #ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo( &info );
+        unsigned count = unsigned( info.dwNumberOfProcessors );
+    #else
+        long count = sysconf( _SC_NPROCESSORS_ONLN );
+    #endif
+
+    NodeCpus.resize( 1 );
+    for ( unsigned cpu = 0; cpu < unsigned( count > 0 ? count : 1 ); ++cpu ) {
+        NodeCpus[0].push_back( cpu );
+    }
+
+    return false;
+}
+
+unsigned NumaTopology::CpuCount () const
+{
+    unsigned count = 0;
+    for ( unsigned i = 0; i < NodeCpus.size (); ++i ) {
+        count += unsigned( NodeCpus[i].size () );
+    }
+    return count;
+}
+
+unsigned NumaTopology::WorkerCpu( unsigned worker, unsigned workers ) const
+{
+    unsigned node = WorkerNode( worker, workers );
+
+    // The rank of the worker among the workers of its node
+    //
+    unsigned first = worker;
+    while ( first > 0 && WorkerNode( first - 1, workers ) == node ) {
+        --first;
+    }
+
+    const std::vector<unsigned>& cpus = NodeCpus[ node ];
+    return cpus[ ( worker - first ) % cpus.size () ];
+}
+
+std::vector<unsigned> NumaTopology::WorkerCpus( unsigned workers ) const
+{
+    std::vector<unsigned> cpus( workers );
+    for ( unsigned i = 0; i < workers; ++i ) {
+        cpus[i] = WorkerCpu( i, workers );
+    }
+    return cpus;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Holds the memory being placed.
+     */
+    struct TouchBatch
+    {
+        char* Memory;
+        size_t Length;
+        unsigned Workers;
+    };
+
+    /** Zeroes the chunks of the workers in range.
+     */
+    void TouchChunks( void* context, unsigned begin, unsigned end )
+    {
+        const TouchBatch* batch = static_cast<const TouchBatch*>( context );
+
+        for ( unsigned i = begin; i < end; ++i )
+        {
+            size_t first = size_t( (unsigned long long)batch->Length * i / batch->Workers );
+            size_t last  = size_t( (unsigned long long)batch->Length * ( i + 1 ) / batch->Workers );
+            memset( batch->Memory + first, 0, last - first );
+        }
+    }
+}
+
+void WoRB::FirstTouch( void* memory, size_t length )
+{
+    TouchBatch batch = { static_cast<char*>( memory ), length, PinnedWorkerCount () };
+
+    if ( batch.Workers <= 1 ) {
+        memset( memory, 0, length );
+        return;
+    }
+
+    // One chunk per worker, so the worker `i` touches the chunk `i`
+    //
+    ParallelFor( batch.Workers, batch.Workers, TouchChunks, &batch );
+}
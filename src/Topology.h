@@ -0,0 +1,174 @@
+#ifndef _WORB_TOPOLOGY_H_INCLUDED
+#define _WORB_TOPOLOGY_H_INCLUDED
+
+/**
+ *  @file      Topology.h
+ *  @brief     Definitions for the NumaTopology class, the placement of the ParallelFor
+ *             workers on the processors and the first-touch allocation of the arrays
+ *             processed by the workers.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-06-03
+ *  @copyright GNU Public License.
+ *
+ * On the machines with several sockets, every socket (NUMA node) has its own memory
+ * and the accesses to the memory of the other sockets go over the socket link.
+ * The operating system places a page of memory on the node of the thread that
+ * first writes to it (first touch). So that the workers use their local memory:
+ * @li the workers are pinned to the processors, spread over the nodes in contiguous
+ *     blocks (SetWorkerCpus), so the consecutive chunks of a ParallelFor range are
+ *     processed on the consecutive nodes;
+ * @li the arrays indexed by the same range are allocated with FirstTouchAllocator,
+ *     which has the pinned workers write the matching chunks of the new memory.
+ */
+
+#include <vector>   // we use: std::vector
+#include <cstddef>  // we use: size_t, ptrdiff_t
+#include <new>      // we use: operator new, placement new
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Holds the processors of every NUMA node of the machine.
+     */
+    class NumaTopology
+    {
+        std::vector< std::vector<unsigned> > NodeCpus;
+
+    public:
+
+        /** Detects the topology: on Linux from `/sys/devices/system/node`, on Windows
+         * from the NUMA API. Falls back to a single node with all the online
+         * processors. Returns false if the topology is not known (the fall back).
+         */
+        bool Detect ();
+
+        /** Gets the number of the nodes.
+         */
+        unsigned NodeCount () const
+        {
+            return unsigned( NodeCpus.size () );
+        }
+
+        /** Gets the processors of the node.
+         */
+        const std::vector<unsigned>& Cpus( unsigned node ) const
+        {
+            return NodeCpus[ node ];
+        }
+
+        /** Gets the total number of the processors.
+         */
+        unsigned CpuCount () const;
+
+        /** Gets the node of the worker, when `workers` workers are spread over
+         * the nodes in contiguous blocks.
+         */
+        unsigned WorkerNode( unsigned worker, unsigned workers ) const
+        {
+            return unsigned( (unsigned long long)worker * NodeCount () / workers );
+        }
+
+        /** Gets the processor of the worker (the workers of a node take its processors
+         * in turn).
+         */
+        unsigned WorkerCpu( unsigned worker, unsigned workers ) const;
+
+        /** Gets the processors of all the workers.
+         */
+        std::vector<unsigned> WorkerCpus( unsigned workers ) const;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Pins the calling thread to the processor; returns false if not supported or
+     * failed. Implemented in Platform.cpp.
+     */
+    bool PinThread( unsigned cpu );
+
+    /** Pins the ParallelFor worker `i` (the calling thread being the worker 0) to
+     * the processor `cpus[ i % count ]` from now on; `count` 0 stops the pinning.
+     * The pool workers are pinned once, when they next run; the calling thread
+     * is restored to its former processors after the loop.
+     * Implemented in Platform.cpp.
+     */
+    void SetWorkerCpus( const unsigned* cpus, unsigned count );
+
+    /** Gets the number of the pinned workers (0 if the workers are not pinned).
+     */
+    unsigned PinnedWorkerCount ();
+
+    /** Zeroes the memory from the pinned workers, each its chunk (proportional to
+     * the chunks of ParallelFor over the same number of workers), so its pages are
+     * placed on their nodes. Zeroes it from the calling thread if the workers are
+     * not pinned.
+     */
+    void FirstTouch( void* memory, size_t length );
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Allocator of the arrays processed in parallel, which places the new memory
+     * with FirstTouch (the small arrays are allocated as usual). The arrays must be
+     * allocated with their final size (e.g. constructed from a range) for the chunks
+     * to match the chunks of the workers.
+     */
+    template<class T>
+    class FirstTouchAllocator
+    {
+    public:
+
+        typedef T         value_type;
+        typedef T*        pointer;
+        typedef const T*  const_pointer;
+        typedef T&        reference;
+        typedef const T&  const_reference;
+        typedef size_t    size_type;
+        typedef ptrdiff_t difference_type;
+
+        template<class U> struct rebind { typedef FirstTouchAllocator<U> other; };
+
+        enum { MinLength = 64 * 1024 }; //!< The shortest length placed, in octets
+
+        FirstTouchAllocator () {}
+        template<class U> FirstTouchAllocator( const FirstTouchAllocator<U>& ) {}
+
+        pointer address( reference x ) const { return &x; }
+        const_pointer address( const_reference x ) const { return &x; }
+
+        pointer allocate( size_type n, const void* = 0 )
+        {
+            void* memory = ::operator new( n * sizeof( T ) );
+            if ( n * sizeof( T ) >= MinLength ) {
+                FirstTouch( memory, n * sizeof( T ) );
+            }
+            return static_cast<pointer>( memory );
+        }
+
+        void deallocate( pointer p, size_type )
+        {
+            ::operator delete( p );
+        }
+
+        size_type max_size () const
+        {
+            return size_type( -1 ) / sizeof( T );
+        }
+
+        void construct( pointer p, const T& value )
+        {
+            new( p ) T( value );
+        }
+
+        void destroy( pointer p )
+        {
+            p->~T ();
+        }
+
+        bool operator == ( const FirstTouchAllocator& ) const { return true; }
+        bool operator != ( const FirstTouchAllocator& ) const { return false; }
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_TOPOLOGY_H_INCLUDED
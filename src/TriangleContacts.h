@@ -0,0 +1,327 @@
+#ifndef _WORB_TRIANGLE_CONTACTS_H_INCLUDED
+#define _WORB_TRIANGLE_CONTACTS_H_INCLUDED
+
+/**
+ *  @file      TriangleContacts.h
+ *  @brief     Contact generation between bodies and static triangles, shared by
+ *             the triangle-based scenery geometries (TriangleMesh, HeightField).
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-26
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Finds the point of the triangle ABC closest to the point P.
+     * See Ericson, Real-Time Collision Detection, Section 5.1.5.
+     */
+    inline Quaternion ClosestPointOnTriangle( const Quaternion& P,
+        const Quaternion& A, const Quaternion& B, const Quaternion& C )
+    {
+        Quaternion AB = B - A, AC = C - A, AP = P - A;
+
+        double d1 = AB.Dot( AP ), d2 = AC.Dot( AP );
+        if ( d1 <= 0 && d2 <= 0 ) {
+            return A; // Vertex region A
+        }
+
+        Quaternion BP = P - B;
+        double d3 = AB.Dot( BP ), d4 = AC.Dot( BP );
+        if ( d3 >= 0 && d4 <= d3 ) {
+            return B; // Vertex region B
+        }
+
+        double vc = d1 * d4 - d3 * d2;
+        if ( vc <= 0 && d1 >= 0 && d3 <= 0 ) {
+            return A + AB * ( d1 / ( d1 - d3 ) ); // Edge region AB
+        }
+
+        Quaternion CP = P - C;
+        double d5 = AB.Dot( CP ), d6 = AC.Dot( CP );
+        if ( d6 >= 0 && d5 <= d6 ) {
+            return C; // Vertex region C
+        }
+
+        double vb = d5 * d2 - d1 * d6;
+        if ( vb <= 0 && d2 >= 0 && d6 <= 0 ) {
+            return A + AC * ( d2 / ( d2 - d6 ) ); // Edge region AC
+        }
+
+        double va = d3 * d6 - d5 * d4;
+        if ( va <= 0 && ( d4 - d3 ) >= 0 && ( d5 - d6 ) >= 0 ) {
+            return B + ( C - B ) * ( ( d4 - d3 ) / ( ( d4 - d3 ) + ( d5 - d6 ) ) );
+        }
+
+        double denom = 1.0 / ( va + vb + vc ); // Face region
+        return A + AB * ( vb * denom ) + AC * ( vc * denom );
+    }
+
+    /** Returns true if the projection of P onto the triangle plane lies inside.
+     */
+    inline bool IsAboveTriangle( const Quaternion& P, const TriangleMesh::Triangle& T )
+    {
+        return ( T.B - T.A ).Cross( P - T.A ).Dot( T.Normal ) >= 0
+            && ( T.C - T.B ).Cross( P - T.B ).Dot( T.Normal ) >= 0
+            && ( T.A - T.C ).Cross( P - T.C ).Dot( T.Normal ) >= 0;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Registers contacts with static triangles, skipping duplicated contact points
+     * (e.g. a vertex or an edge shared by the adjacent triangles).
+     */
+    class TriangleContactSink
+    {
+        enum { MaxPoints = 32 };
+
+        CollisionResolver& Owner;
+        RigidBody* Body;
+        Quaternion Points[ MaxPoints ];
+        unsigned PointCount;
+
+    public:
+
+        unsigned ContactCount;
+
+        TriangleContactSink( CollisionResolver& owner, RigidBody* body )
+            : Owner( owner ), Body( body ), PointCount( 0 ), ContactCount( 0 )
+        {
+        }
+
+        void Register( const Quaternion& X, const Quaternion& N, double penetration )
+        {
+            for ( unsigned i = 0; i < PointCount; ++i ) {
+                if ( ( Points[i] - X ).ImSquaredNorm () < 1e-12 ) {
+                    return;
+                }
+            }
+            if ( PointCount < MaxPoints ) {
+                Points[ PointCount++ ] = X;
+            }
+
+            ContactCount += Owner.RegisterNewContact( Body, 0, X, N, penetration );
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Generates contacts between a sphere and static triangles.
+     *
+     * Two-sided triangles push the sphere away along the direction from the closest
+     * point to its center. One-sided triangles (with the solid below, opposite to
+     * the normal) push a sphere whose center is below the triangle along the normal.
+     */
+    class SphereTriangleContacts
+    {
+        const Quaternion Center;
+        const double Radius;
+        const bool OneSided;
+
+    public:
+
+        TriangleContactSink Sink;
+
+        SphereTriangleContacts( CollisionResolver& owner, const Sphere& sphere,
+            bool oneSided = false )
+            : Center( sphere.Position () ), Radius( sphere.Radius ), OneSided( oneSided )
+            , Sink( owner, sphere.Body )
+        {
+        }
+
+        void Test( const TriangleMesh::Triangle& T )
+        {
+            if ( OneSided )
+            {
+                double s = T.Normal.Dot( Center - T.A );
+                if ( s < 0 && s > -Radius && IsAboveTriangle( Center, T ) )
+                {
+                    Sink.Register( Center - s * T.Normal, T.Normal, Radius - s );
+                    return;
+                }
+            }
+
+            Quaternion Q = ClosestPointOnTriangle( Center, T.A, T.B, T.C );
+            Quaternion D = Center - Q;
+            double distSq = D.ImSquaredNorm ();
+
+            if ( distSq >= Radius * Radius ) {
+                return;
+            }
+
+            double distance = sqrt( distSq );
+
+            // The normal points from the triangle towards the center of the sphere
+            //
+            Quaternion N = distance > 1e-9 ? D * ( 1.0 / distance )
+                         : ( T.Normal.Dot( D ) < 0 ? -T.Normal : T.Normal );
+
+            if ( OneSided && N.Dot( T.Normal ) < 0 ) {
+                return; // The center is below a one-sided triangle
+            }
+
+            Sink.Register( Q, N, Radius - distance );
+        }
+    };
+
+    /** Generates contacts between a cuboid and static triangles.
+     *
+     * Generates vertex-face contacts (cuboid vertices against triangles and triangle
+     * vertices against the cuboid faces); edge-edge contacts are not generated.
+     * Two-sided triangles take the normal on the side of the cuboid center.
+     */
+    class CuboidTriangleContacts
+    {
+        const Cuboid& Box;
+        const Quaternion Center;
+        const bool OneSided;
+        Quaternion Vertex[8];
+
+    public:
+
+        TriangleContactSink Sink;
+
+        CuboidTriangleContacts( CollisionResolver& owner, const Cuboid& box,
+            bool oneSided = false )
+            : Box( box ), Center( box.Position () ), OneSided( oneSided )
+            , Sink( owner, box.Body )
+        {
+            for ( unsigned i = 0; i < 8; ++i )
+            {
+                Quaternion v( 0, ( i & 1 ) ? 1 : -1, ( i & 2 ) ? 1 : -1, ( i & 4 ) ? 1 : -1 );
+                Vertex[i] = Box.Transform ()( v.ComponentWiseProduct( Box.HalfExtent ) );
+            }
+        }
+
+        void Test( const TriangleMesh::Triangle& T )
+        {
+            double s = T.Normal.Dot( Center - T.A );
+            Quaternion N = ( OneSided || s >= 0 ) ? T.Normal : -T.Normal;
+            s = N.Dot( Center - T.A );
+
+            // Separation test along the triangle normal
+            //
+            double projectedRadius = 0;
+            for ( unsigned i = 0; i < 3; ++i ) {
+                projectedRadius += fabs( Box.Axis(i).Dot( N ) ) * Box.HalfExtent[i];
+            }
+            if ( s >= projectedRadius || ( ! OneSided && s <= -projectedRadius ) ) {
+                return;
+            }
+
+            // Cuboid vertices below the triangle
+            //
+            for ( unsigned i = 0; i < 8; ++i )
+            {
+                double d = N.Dot( Vertex[i] - T.A );
+                if ( d < 0 && IsAboveTriangle( Vertex[i], T ) ) {
+                    Sink.Register( Vertex[i] - 0.5 * d * N, N, -d );
+                }
+            }
+
+            // Triangle vertices inside the cuboid
+            //
+            const Quaternion* corner[3] = { &T.A, &T.B, &T.C };
+
+            for ( unsigned v = 0; v < 3; ++v )
+            {
+                Quaternion p = Box.Transform ().TransformInverse( *corner[v] );
+
+                double minDepth = Const::Max;
+                unsigned axis = 0;
+                for ( unsigned i = 0; i < 3 && minDepth > 0; ++i )
+                {
+                    double depth = Box.HalfExtent[i] - fabs( p[i] );
+                    if ( depth < minDepth ) {
+                        minDepth = depth;
+                        axis = i;
+                    }
+                }
+
+                if ( minDepth > 0 )
+                {
+                    // Push the cuboid away from the vertex, through the nearest face
+                    //
+                    Quaternion face = p[axis] < 0 ? -Box.Axis( axis ) : Box.Axis( axis );
+                    Sink.Register( *corner[v], -face, minDepth );
+                }
+            }
+        }
+    };
+
+    /** Generates contacts between a convex hull and static triangles.
+     *
+     * Generates vertex-face contacts for the hull vertices below the triangle;
+     * if there are none, the deepest point is found with GJK/EPA (which covers
+     * the edge-edge and the triangle vertex-face contacts).
+     */
+    class ConvexTriangleContacts
+    {
+        const ConvexHull& Hull;
+        const Quaternion Center;
+        const bool OneSided;
+        SupportShape Shape;
+
+    public:
+
+        TriangleContactSink Sink;
+
+        ConvexTriangleContacts( CollisionResolver& owner, const ConvexHull& hull,
+            bool oneSided = false )
+            : Hull( hull ), Center( hull.Position () ), OneSided( oneSided )
+            , Shape( hull, Center, hull.Radius )
+            , Sink( owner, hull.Body )
+        {
+        }
+
+        void Test( const TriangleMesh::Triangle& T )
+        {
+            double s = T.Normal.Dot( Center - T.A );
+            Quaternion N = ( OneSided || s >= 0 ) ? T.Normal : -T.Normal;
+            s = N.Dot( Center - T.A );
+
+            if ( s >= Hull.Radius || ( ! OneSided && s <= -Hull.Radius ) ) {
+                return;
+            }
+
+            // Hull vertices below the triangle
+            //
+            unsigned count = Sink.ContactCount;
+            const QTensor& frame = Hull.Transform ();
+
+            for ( unsigned i = 0; i < Hull.VertexCount (); ++i )
+            {
+                Quaternion vertex = frame( Hull.GetVertex( i ) );
+                double d = N.Dot( vertex - T.A );
+                if ( d < 0 && IsAboveTriangle( vertex, T ) ) {
+                    Sink.Register( vertex - 0.5 * d * N, N, -d );
+                }
+            }
+
+            if ( Sink.ContactCount > count ) {
+                return;
+            }
+
+            // The deepest point of the hull and the triangle
+            //
+            SupportShape triangle( T.A, T.B, T.C );
+            ConvexContact contact;
+
+            if ( ConvexQuery( Shape, triangle, contact ) && contact.Penetration > 0 )
+            {
+                if ( OneSided && contact.Normal.Dot( T.Normal ) <= 0 ) {
+                    return; // The hull is pushed below a one-sided triangle
+                }
+                Sink.Register( 0.5 * ( contact.PointA + contact.PointB ),
+                    contact.Normal, contact.Penetration );
+            }
+        }
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_TRIANGLE_CONTACTS_H_INCLUDED
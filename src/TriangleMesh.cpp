@@ -0,0 +1,462 @@
+/**
+ *  @file      TriangleMesh.cpp
+ *  @brief     Implementation of the TriangleMesh BVH builder and the sphere-mesh
+ *             and cuboid-mesh collision detectors.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-26
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+#include "TriangleContacts.h"
+#include "SceneQuery.h"
+
+#include <algorithm> // we use: std::nth_element, std::min, std::max
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// BVH construction
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    enum
+    {
+        BinCount    = 16,  //!< The number of SAH bins along the split axis
+        MinLeafSize = 2,   //!< Nodes with this many triangles are always leaves
+        MaxLeafSize = 8,   //!< Larger nodes are split even if SAH suggests a leaf
+        MaxDepth    = 48   //!< Limits the depth (and the Query traversal stack)
+    };
+
+    /** Holds an axis-aligned box.
+     */
+    struct Box
+    {
+        double Min[3];
+        double Max[3];
+
+        void Clear ()
+        {
+            for ( unsigned k = 0; k < 3; ++k ) {
+                Min[k] = Const::Max;
+                Max[k] = -Const::Max;
+            }
+        }
+
+        void Grow( const double* p )
+        {
+            for ( unsigned k = 0; k < 3; ++k ) {
+                Min[k] = std::min( Min[k], p[k] );
+                Max[k] = std::max( Max[k], p[k] );
+            }
+        }
+
+        void Grow( const Box& b )
+        {
+            for ( unsigned k = 0; k < 3; ++k ) {
+                Min[k] = std::min( Min[k], b.Min[k] );
+                Max[k] = std::max( Max[k], b.Max[k] );
+            }
+        }
+
+        double HalfArea () const
+        {
+            if ( Min[0] > Max[0] ) {
+                return 0; // empty
+            }
+            double dx = Max[0] - Min[0], dy = Max[1] - Min[1], dz = Max[2] - Min[2];
+            return dx * dy + dy * dz + dz * dx;
+        }
+    };
+
+    /** Holds the bounds and the centroid of a triangle during the construction.
+     */
+    struct Primitive
+    {
+        Box      Bounds;
+        double   Center[3];
+        unsigned Index;
+    };
+
+    /** Compares primitives by their centroid along the given axis.
+     */
+    struct CenterLess
+    {
+        unsigned Axis;
+        CenterLess( unsigned axis ) : Axis( axis ) {}
+        bool operator () ( const Primitive& a, const Primitive& b ) const {
+            return a.Center[ Axis ] < b.Center[ Axis ];
+        }
+    };
+
+    /** Builds the flattened BVH in depth-first order.
+     */
+    class BVHBuilder
+    {
+        std::vector<TriangleMesh::Node>& Nodes;
+        std::vector<Primitive>& Prims;
+
+        /** Makes the node a leaf referring to the given range of primitives.
+         */
+        static void MakeLeaf( TriangleMesh::Node& node, unsigned first, unsigned count )
+        {
+            node.Offset = first;
+            node.Count  = count;
+        }
+
+    public:
+
+        BVHBuilder( std::vector<TriangleMesh::Node>& nodes, std::vector<Primitive>& prims )
+            : Nodes( nodes ), Prims( prims )
+        {
+        }
+
+        /** Builds the subtree over the given range; returns the index of its root.
+         */
+        unsigned Build( unsigned first, unsigned count, unsigned depth )
+        {
+            Box bounds, centers;
+            bounds.Clear ();
+            centers.Clear ();
+
+            for ( unsigned i = first; i < first + count; ++i ) {
+                bounds.Grow( Prims[i].Bounds );
+                centers.Grow( Prims[i].Center );
+            }
+
+            unsigned nodeIndex = unsigned( Nodes.size () );
+            TriangleMesh::Node node;
+            for ( unsigned k = 0; k < 3; ++k ) {
+                node.Min[k] = bounds.Min[k];
+                node.Max[k] = bounds.Max[k];
+            }
+            MakeLeaf( node, first, count );
+            Nodes.push_back( node );
+
+            if ( count <= MinLeafSize || depth >= MaxDepth ) {
+                return nodeIndex;
+            }
+
+            // Split along the axis with the largest extent of the centroids
+            //
+            unsigned axis = 0;
+            for ( unsigned k = 1; k < 3; ++k ) {
+                if ( centers.Max[k] - centers.Min[k] > centers.Max[axis] - centers.Min[axis] ) {
+                    axis = k;
+                }
+            }
+
+            double extent = centers.Max[axis] - centers.Min[axis];
+            if ( extent <= 0 ) {
+                return nodeIndex; // All centroids coincide
+            }
+
+            // Bin the primitives and evaluate the SAH cost of every split plane
+            //
+            Box      binBounds[ BinCount ];
+            unsigned binCount [ BinCount ];
+            for ( unsigned b = 0; b < BinCount; ++b ) {
+                binBounds[b].Clear ();
+                binCount[b] = 0;
+            }
+
+            double scale = BinCount * ( 1 - 1e-9 ) / extent;
+            for ( unsigned i = first; i < first + count; ++i )
+            {
+                unsigned b = unsigned( ( Prims[i].Center[axis] - centers.Min[axis] ) * scale );
+                binBounds[b].Grow( Prims[i].Bounds );
+                ++binCount[b];
+            }
+
+            double   rightArea [ BinCount ];
+            unsigned rightCount[ BinCount ];
+            Box acc;
+            acc.Clear ();
+            unsigned n = 0;
+            for ( unsigned b = BinCount - 1; b > 0; --b ) {
+                acc.Grow( binBounds[b] );
+                n += binCount[b];
+                rightArea [b] = acc.HalfArea ();
+                rightCount[b] = n;
+            }
+
+            double bestCost = Const::Max;
+            unsigned bestSplit = 0;
+            acc.Clear ();
+            n = 0;
+            for ( unsigned b = 1; b < BinCount; ++b )
+            {
+                acc.Grow( binBounds[b-1] );
+                n += binCount[b-1];
+                if ( n == 0 || rightCount[b] == 0 ) {
+                    continue;
+                }
+                double cost = n * acc.HalfArea () + rightCount[b] * rightArea[b];
+                if ( cost < bestCost ) {
+                    bestCost = cost;
+                    bestSplit = b;
+                }
+            }
+
+            // Keep the leaf if splitting does not pay off (the traversal cost of
+            // an interior node is taken to be one triangle test).
+            //
+            double leafCost = count * bounds.HalfArea ();
+            if ( count <= MaxLeafSize && bestCost + bounds.HalfArea () >= leafCost ) {
+                return nodeIndex;
+            }
+
+            // Partition the primitives around the split plane
+            //
+            unsigned mid = first;
+            if ( bestSplit > 0 )
+            {
+                for ( unsigned i = first; i < first + count; ++i )
+                {
+                    unsigned b = unsigned( ( Prims[i].Center[axis] - centers.Min[axis] ) * scale );
+                    if ( b < bestSplit ) {
+                        std::swap( Prims[i], Prims[mid++] );
+                    }
+                }
+            }
+
+            if ( mid == first || mid == first + count )
+            {
+                // Degenerate binning; fall back to the median split
+                //
+                mid = first + count / 2;
+                std::nth_element( Prims.begin () + first, Prims.begin () + mid,
+                    Prims.begin () + first + count, CenterLess( axis ) );
+            }
+
+            Build( first, mid - first, depth + 1 );
+            unsigned right = Build( mid, first + count - mid, depth + 1 );
+
+            Nodes[ nodeIndex ].Offset = right;
+            Nodes[ nodeIndex ].Count  = 0;
+
+            return nodeIndex;
+        }
+    };
+}
+
+bool TriangleMesh::Build( const double* vertices, unsigned vertexCount,
+    const unsigned* indices, unsigned triangleCount )
+{
+    Triangles.clear ();
+    Nodes.clear ();
+
+    std::vector<Primitive> prims( triangleCount );
+
+    for ( unsigned t = 0; t < triangleCount; ++t )
+    {
+        Primitive& p = prims[t];
+        p.Bounds.Clear ();
+        p.Index = t;
+
+        for ( unsigned v = 0; v < 3; ++v )
+        {
+            unsigned index = indices[ 3 * t + v ];
+            if ( index >= vertexCount ) {
+                return false;
+            }
+            p.Bounds.Grow( vertices + 3 * index );
+        }
+
+        for ( unsigned k = 0; k < 3; ++k ) {
+            p.Center[k] = 0.5 * ( p.Bounds.Min[k] + p.Bounds.Max[k] );
+        }
+    }
+
+    if ( triangleCount == 0 ) {
+        return true;
+    }
+
+    Nodes.reserve( 2 * triangleCount );
+    BVHBuilder( Nodes, prims ).Build( 0, triangleCount, 0 );
+
+    // Store the triangles in the leaf order
+    //
+    Triangles.resize( triangleCount );
+
+    for ( unsigned i = 0; i < triangleCount; ++i )
+    {
+        const unsigned* tri = indices + 3 * prims[i].Index;
+        const double* a = vertices + 3 * tri[0];
+        const double* b = vertices + 3 * tri[1];
+        const double* c = vertices + 3 * tri[2];
+
+        Triangle& T = Triangles[i];
+        T.A = Quaternion( 0, a[0], a[1], a[2] );
+        T.B = Quaternion( 0, b[0], b[1], b[2] );
+        T.C = Quaternion( 0, c[0], c[1], c[2] );
+
+        T.Normal = ( T.B - T.A ).Cross( T.C - T.A );
+        double norm = T.Normal.ImNorm ();
+        T.Normal = norm > 0 ? T.Normal * ( 1.0 / norm ) : Const::Y;
+    }
+
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Collision detection
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    /** Passes the triangles visited by TriangleMesh::Query to the contact generator.
+     */
+    template<class Contacts>
+    class MeshVisitor
+    {
+        const TriangleMesh& Mesh;
+        Contacts& Generator;
+
+    public:
+
+        MeshVisitor( const TriangleMesh& mesh, Contacts& generator )
+            : Mesh( mesh ), Generator( generator )
+        {
+        }
+
+        void operator () ( unsigned index )
+        {
+            Generator.Test( Mesh.GetTriangle( index ) );
+        }
+    };
+}
+
+unsigned TriangleMesh::Check( CollisionResolver& owner, const Sphere& B ) const
+{
+    if ( ! owner.HasSpaceForMoreContacts () ) {
+        return 0;
+    }
+
+    Quaternion center = B.Position ();
+    Quaternion r( 0, B.Radius, B.Radius, B.Radius );
+
+    SphereTriangleContacts contacts( owner, B );
+    MeshVisitor<SphereTriangleContacts> visitor( *this, contacts );
+    Query( center - r, center + r, visitor );
+
+    return contacts.Sink.ContactCount;
+}
+
+unsigned TriangleMesh::Check( CollisionResolver& owner, const Cuboid& B ) const
+{
+    if ( ! owner.HasSpaceForMoreContacts () ) {
+        return 0;
+    }
+
+    // The axis-aligned box enclosing the cuboid
+    //
+    Quaternion center = B.Position ();
+    Quaternion extent;
+    for ( unsigned k = 0; k < 3; ++k ) {
+        for ( unsigned i = 0; i < 3; ++i ) {
+            extent[k] += fabs( B.Axis(i)[k] ) * B.HalfExtent[i];
+        }
+    }
+
+    CuboidTriangleContacts contacts( owner, B );
+    MeshVisitor<CuboidTriangleContacts> visitor( *this, contacts );
+    Query( center - extent, center + extent, visitor );
+
+    return contacts.Sink.ContactCount;
+}
+
+unsigned TriangleMesh::Check( CollisionResolver& owner, const ConvexHull& B ) const
+{
+    if ( ! owner.HasSpaceForMoreContacts () ) {
+        return 0;
+    }
+
+    Quaternion center = B.Position ();
+    Quaternion r( 0, B.Radius, B.Radius, B.Radius );
+
+    ConvexTriangleContacts contacts( owner, B );
+    MeshVisitor<ConvexTriangleContacts> visitor( *this, contacts );
+    Query( center - r, center + r, visitor );
+
+    return contacts.Sink.ContactCount;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Ray casting
+/////////////////////////////////////////////////////////////////////////////////////////
+
+bool TriangleMesh::RayCast( const Ray& ray, QueryHit& hit ) const
+{
+    if ( Nodes.empty () ) {
+        return false;
+    }
+
+    // The inverse direction; a zero component becomes a large finite number,
+    // so the slab distances never become NaN
+    //
+    double inverse[3];
+    for ( unsigned k = 0; k < 3; ++k ) {
+        double d = ray.Direction[k];
+        inverse[k] = fabs( d ) > 1e-300 ? 1.0 / d : ( d >= 0 ? 1e300 : -1e300 );
+    }
+
+    Ray segment( ray );
+    unsigned closest = unsigned(-1);
+
+    unsigned stack[ 64 ];
+    unsigned top = 0;
+    stack[ top++ ] = 0;
+
+    while ( top > 0 )
+    {
+        const Node& node = Nodes[ stack[ --top ] ];
+
+        // The slab test against the node bounds, up to the closest hit
+        //
+        double tmin = 0, tmax = segment.MaxDistance;
+        for ( unsigned k = 0; k < 3 && tmin <= tmax; ++k )
+        {
+            double t1 = ( node.Min[k] - ray.Origin[k] ) * inverse[k];
+            double t2 = ( node.Max[k] - ray.Origin[k] ) * inverse[k];
+            tmin = std::max( tmin, std::min( t1, t2 ) );
+            tmax = std::min( tmax, std::max( t1, t2 ) );
+        }
+        if ( tmin > tmax ) {
+            continue;
+        }
+
+        if ( node.Count > 0 )
+        {
+            for ( unsigned i = node.Offset; i < node.Offset + node.Count; ++i )
+            {
+                const Triangle& T = Triangles[i];
+                double distance;
+                if ( RayTriangle( segment, T.A, T.B, T.C, distance ) ) {
+                    segment.MaxDistance = distance;
+                    closest = i;
+                }
+            }
+        }
+        else
+        {
+            unsigned index = unsigned( &node - &Nodes[0] );
+            stack[ top++ ] = node.Offset;  // right child
+            stack[ top++ ] = index + 1;    // left child (visited first)
+        }
+    }
+
+    if ( closest == unsigned(-1) ) {
+        return false;
+    }
+
+    const Quaternion& N = Triangles[ closest ].Normal;
+
+    hit.Shape    = this;
+    hit.Distance = segment.MaxDistance;
+    hit.Position = ray.At( hit.Distance );
+    hit.Normal   = N.Dot( ray.Direction ) > 0 ? -N : N;
+    return true;
+}
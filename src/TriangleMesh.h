@@ -0,0 +1,155 @@
+#ifndef _WORB_TRIANGLE_MESH_H_INCLUDED
+#define _WORB_TRIANGLE_MESH_H_INCLUDED
+
+/**
+ *  @file      TriangleMesh.h
+ *  @brief     Definitions for the TriangleMesh class, a static scenery geometry
+ *             with a bounding volume hierarchy (BVH) of its triangles.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-26
+ *  @copyright GNU Public License.
+ */
+
+#include "Geometry.h"
+
+#include <vector>  // we use: std::vector
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Encapsulates a static triangle mesh (scenery).
+     *
+     * The vertices are given in the world frame. The mesh is built once (at load
+     * time) into a BVH using the surface area heuristic (SAH). The nodes are
+     * stored in a flat array in depth-first order: the left child of an interior
+     * node follows the node, and the node holds the index of its right child.
+     * The triangles are reordered so that every leaf refers to a contiguous range.
+     *
+     * Triangles are two-sided; the contact normal is taken on the side of the
+     * body's center.
+     */
+    class TriangleMesh : public Geometry
+    {
+    public:
+
+        /** Holds a triangle with its precomputed unit normal.
+         */
+        struct Triangle
+        {
+            Quaternion A, B, C;  //!< Holds the vertices
+            Quaternion Normal;   //!< Holds the unit normal, `(B-A) x (C-A)` normalized
+        };
+
+        /** Holds a node of the flattened BVH.
+         */
+        struct Node
+        {
+            double   Min[3];   //!< Holds the lower corner of the node bounds
+            double   Max[3];   //!< Holds the upper corner of the node bounds
+            unsigned Offset;   //!< Holds the first triangle (leaf) or the right child
+            unsigned Count;    //!< Holds the number of triangles; 0 for interior nodes
+        };
+
+        TriangleMesh ()
+            : Geometry( Geometry::_TriangleMesh )
+        {
+        }
+
+        /** Builds the mesh from the given vertices (three coordinates per vertex)
+         * and triangles (three vertex indices per triangle).
+         * @return false if an index is out of range.
+         */
+        bool Build( const double* vertices, unsigned vertexCount,
+            const unsigned* indices, unsigned triangleCount );
+
+        /** Gets the number of triangles.
+         */
+        unsigned TriangleCount () const
+        {
+            return unsigned( Triangles.size () );
+        }
+
+        /** Gets the number of the BVH nodes.
+         */
+        unsigned NodeCount () const
+        {
+            return unsigned( Nodes.size () );
+        }
+
+        /** Gets the triangle with the given index (in the BVH order).
+         */
+        const Triangle& GetTriangle( unsigned index ) const
+        {
+            return Triangles[ index ];
+        }
+
+        /** Calls `visitor( triangleIndex )` for every triangle whose bounds overlap
+         * the given axis-aligned box.
+         */
+        template<class Visitor>
+        void Query( const Quaternion& boxMin, const Quaternion& boxMax,
+            Visitor& visitor ) const
+        {
+            if ( Nodes.empty () ) {
+                return;
+            }
+
+            unsigned stack[ 64 ];
+            unsigned top = 0;
+            stack[ top++ ] = 0;
+
+            while ( top > 0 )
+            {
+                const Node& node = Nodes[ stack[ --top ] ];
+
+                if ( node.Min[0] > boxMax.x || node.Max[0] < boxMin.x
+                  || node.Min[1] > boxMax.y || node.Max[1] < boxMin.y
+                  || node.Min[2] > boxMax.z || node.Max[2] < boxMin.z ) {
+                    continue;
+                }
+
+                if ( node.Count > 0 )
+                {
+                    for ( unsigned i = 0; i < node.Count; ++i ) {
+                        visitor( node.Offset + i );
+                    }
+                }
+                else
+                {
+                    unsigned index = unsigned( &node - &Nodes[0] );
+                    stack[ top++ ] = node.Offset;  // right child
+                    stack[ top++ ] = index + 1;    // left child (visited first)
+                }
+            }
+        }
+
+        /////////////////////////////////////////////////////////////////////////////////
+
+        /** Checks for collision between the mesh and a sphere.
+         */
+        unsigned Check( CollisionResolver& owner, const Sphere& B ) const;
+
+        /** Checks for collision between the mesh and a cuboid.
+         */
+        unsigned Check( CollisionResolver& owner, const Cuboid& B ) const;
+
+        /** Checks for collision between the mesh and a convex hull.
+         */
+        unsigned Check( CollisionResolver& owner, const ConvexHull& B ) const;
+
+        /** Casts the ray against the mesh, descending only the BVH nodes hit by
+         * the ray up to the closest hit found so far.
+         */
+        bool RayCast( const Ray& ray, QueryHit& hit ) const;
+
+    private:
+
+        std::vector<Triangle> Triangles;  //!< Holds the triangles in the BVH order
+        std::vector<Node>     Nodes;      //!< Holds the flattened BVH
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_TRIANGLE_MESH_H_INCLUDED
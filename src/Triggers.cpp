@@ -0,0 +1,142 @@
+/**
+ *  @file      Triggers.cpp
+ *  @brief     Implementation of the sensor overlap tests and the enter/exit events.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-30
+ *  @copyright GNU Public License.
+ */
+
+#include "WoRB.h"
+
+#include <algorithm>  // we use: std::sort, std::lower_bound
+#include <functional> // we use: std::less
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    typedef CandidatePairs::Pair Pair;
+
+    /** Orders the pairs by the sensor, then by the other geometry.
+     */
+    bool PairLess( const Pair& p, const Pair& q )
+    {
+        std::less<const Geometry*> less;
+        return less( p.A, q.A ) || ( p.A == q.A && less( p.B, q.B ) );
+    }
+
+    /** Checks whether the geometry has a support mapping (see SupportShape).
+     */
+    bool IsConvex( const Geometry& g )
+    {
+        return g.IsSphere () || g.IsCuboid () || g.IsConvexHull ()
+            || g.IsHalfSpace () || g.IsTruePlane ();
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+bool TriggerVolumes::Overlaps( const Geometry& sensor, const Geometry& other )
+{
+    ++Tests;
+
+    if ( IsConvex( sensor ) && IsConvex( other ) )
+    {
+        if ( BoundingRadius( sensor ) < 0 && BoundingRadius( other ) < 0 ) {
+            return false; // Two planes
+        }
+
+        SupportShape A( sensor, other.Position (), BoundingRadius( other ) );
+        SupportShape B( other, sensor.Position (), BoundingRadius( sensor ) );
+
+        ConvexContact contact;
+        return ConvexQuery( A, B, contact );
+    }
+
+    // Run the regular detector; any registered contact means an overlap
+    //
+    Resolver.Initialize ();
+    sensor.Detect( Resolver, &other );
+
+    return Resolver.Count () > 0;
+}
+
+void TriggerVolumes::Update( const CandidatePairs& pairs )
+{
+    const std::vector<Pair>& candidates = pairs.GetSensorPairs ();
+
+    Current.clear ();
+    Events.clear ();
+
+    for ( size_t i = 0; i < candidates.size (); ++i )
+    {
+        if ( Overlaps( *candidates[i].A, *candidates[i].B ) ) {
+            Current.push_back( candidates[i] );
+        }
+    }
+
+    std::sort( Current.begin (), Current.end (), PairLess );
+
+    // Merge the sorted sets: pairs only in the current set have entered,
+    // pairs only in the last set have left
+    //
+    size_t i = 0, j = 0;
+    while ( i < Current.size () || j < Overlapping.size () )
+    {
+        TriggerEvent event;
+
+        if ( j == Overlapping.size ()
+            || ( i < Current.size () && PairLess( Current[i], Overlapping[j] ) ) )
+        {
+            event.Type   = TriggerEvent::Enter;
+            event.Sensor = Current[i].A;
+            event.Other  = Current[i].B;
+            ++i;
+        }
+        else if ( i == Current.size () || PairLess( Overlapping[j], Current[i] ) )
+        {
+            event.Type   = TriggerEvent::Exit;
+            event.Sensor = Overlapping[j].A;
+            event.Other  = Overlapping[j].B;
+            ++j;
+        }
+        else // Still overlapping
+        {
+            ++i; ++j;
+            continue;
+        }
+
+        Events.push_back( event );
+    }
+
+    Overlapping.swap( Current );
+}
+
+void TriggerVolumes::Relocate( const Relocation& moved )
+{
+    for ( size_t i = 0; i < Overlapping.size (); ++i )
+    {
+        Overlapping[i].A = moved( Overlapping[i].A );
+        Overlapping[i].B = moved( Overlapping[i].B );
+    }
+
+    std::sort( Overlapping.begin (), Overlapping.end (), PairLess );
+
+    for ( size_t i = 0; i < Events.size (); ++i )
+    {
+        Events[i].Sensor = moved( Events[i].Sensor );
+        Events[i].Other  = moved( Events[i].Other );
+    }
+}
+
+bool TriggerVolumes::IsInside( const Geometry* sensor, const Geometry* other ) const
+{
+    Pair key = { sensor, other };
+    std::vector<Pair>::const_iterator i = std::lower_bound(
+        Overlapping.begin (), Overlapping.end (), key, PairLess );
+
+    return i != Overlapping.end () && i->A == sensor && i->B == other;
+}
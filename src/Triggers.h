@@ -0,0 +1,129 @@
+#ifndef _WORB_TRIGGERS_H_INCLUDED
+#define _WORB_TRIGGERS_H_INCLUDED
+
+/**
+ *  @file      Triggers.h
+ *  @brief     Definitions for the TriggerVolumes class, which keeps the persistent set
+ *             of geometries overlapping the sensors and reports the enter/exit events.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-30
+ *  @copyright GNU Public License.
+ */
+
+#include "CandidatePairs.h"
+#include "CollisionResolver.h"
+
+#include <vector>  // we use: std::vector
+
+namespace WoRB
+{
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Holds an event reported when a geometry enters or leaves a sensor.
+     */
+    struct TriggerEvent
+    {
+        /** Enumerates the kinds of events.
+         */
+        enum EventType
+        {
+            Enter,  //!< The geometry started to overlap the sensor
+            Exit    //!< The geometry stopped overlapping the sensor
+        };
+
+        EventType Type;         //!< Holds the kind of the event
+        const Geometry* Sensor; //!< Points to the sensor geometry
+        const Geometry* Other;  //!< Points to the geometry that entered or left
+    };
+
+    /////////////////////////////////////////////////////////////////////////////////////
+
+    /** Tracks the geometries overlapping the sensor geometries (see Geometry::Sensor).
+     *
+     * Every time-step, the sensor pairs found by the broadphase are tested for overlap
+     * (GJK for the convex geometries, the regular detectors into a private registry
+     * otherwise). The result is compared with the overlap set of the previous
+     * time-step and only the differences are reported as events, so monitoring
+     * a region costs as much as its broadphase candidates and never adds contacts
+     * to the solver.
+     */
+    class TriggerVolumes
+    {
+        typedef CandidatePairs::Pair Pair;
+
+        enum { ScratchSize = 4 };
+
+        /** Holds the overlapping pairs of the last update, sorted.
+         */
+        std::vector<Pair> Overlapping;
+
+        /** Holds the overlapping pairs being collected by the current update.
+         */
+        std::vector<Pair> Current;
+
+        /** Holds the private registry of the detectors used as the overlap tests.
+         */
+        Collision Scratch[ ScratchSize ];
+        CollisionResolver Resolver;
+
+        /** Tests whether the sensor overlaps the other geometry.
+         */
+        bool Overlaps( const Geometry& sensor, const Geometry& other );
+
+    public:
+
+        /** Holds the events of the last update, in the order of the overlap set.
+         */
+        std::vector<TriggerEvent> Events;
+
+        /** Holds the number of overlap tests performed.
+         */
+        unsigned long Tests;
+
+        TriggerVolumes ()
+            : Resolver( Scratch, ScratchSize )
+            , Tests( 0 )
+        {
+        }
+
+        /** Tests the sensor pairs, updates the overlap set and fills in the events.
+         */
+        void Update( const CandidatePairs& pairs );
+
+        /** Forgets all the overlaps and events (e.g. after the objects were removed);
+         * the geometries still overlapping a sensor will be reported as entering it.
+         */
+        void Clear ()
+        {
+            Overlapping.clear ();
+            Current.clear ();
+            Events.clear ();
+        }
+
+        /** Updates the geometries of the overlaps and the events moved in memory.
+         */
+        void Relocate( const Relocation& moved );
+
+        /** Gets the number of geometry-sensor pairs currently overlapping.
+         */
+        unsigned Count () const
+        {
+            return unsigned( Overlapping.size () );
+        }
+
+        /** Gets the overlapping sensor (A) and geometry (B) with the given index.
+         */
+        const Pair& operator [] ( unsigned index ) const
+        {
+            return Overlapping[ index ];
+        }
+
+        /** Checks whether the geometry currently overlaps the sensor.
+         */
+        bool IsInside( const Geometry* sensor, const Geometry* other ) const;
+    };
+
+} // namespace WoRB
+
+#endif // _WORB_TRIGGERS_H_INCLUDED
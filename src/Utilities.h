@@ -294,7 +294,7 @@ namespace WoRB
 
     /** Encapsulates a rigid body with geometry of a sphere.
      */
-    class Ball : public Sphere, public RigidBody, public GLUT_Renderer
+    class Ball : public SolidSphere, public GLUT_Renderer
     {
         const static int slices = 20; //!< Number of slices for glutSolidSphere()
         const static int stacks = 20; //!< Number of stacks for glutSolidSphere()
@@ -310,18 +310,11 @@ namespace WoRB
             Quaternion velocity, Quaternion angularVelocity,
             double radius, double mass
             )
+            : SolidSphere( position, orientation, velocity, angularVelocity,
+                           radius, mass )
         {
-            Body = this;
-
-            Radius = radius;
-
             ActiveColor   = Colorf( 0.9f, 0.7f, 0.7f, 0.8f );
             InactiveColor = Colorf( 0.7f, 0.7f, 0.9f, 0.8f );
-
-            SetMass( mass );
-
-            Body->Set_XQVW( position, orientation, velocity, angularVelocity );
-            Body->Activate ();
         }
 
         /////////////////////////////////////////////////////////////////////////////////
@@ -381,7 +374,7 @@ namespace WoRB
 
     /** Encapsulates a rigid body with geometry of a rectangular parallelepiped.
      */
-    class Box : public Cuboid, public RigidBody, public GLUT_Renderer
+    class Box : public SolidCuboid, public GLUT_Renderer
     {
     public:
 
@@ -393,11 +386,9 @@ namespace WoRB
             const Quaternion& velocity, const Quaternion& angularVelocity,
             const Quaternion& halfExtent, double mass
             )
+            : SolidCuboid( position, orientation, velocity, angularVelocity,
+                           halfExtent, mass )
         {
-            Body = this;
-
-            HalfExtent = halfExtent;
-
             double minsz = HalfExtent.x;
             minsz = HalfExtent.y < minsz ? HalfExtent.y : minsz;
             minsz = HalfExtent.z < minsz ? HalfExtent.z : minsz;
@@ -406,11 +397,6 @@ namespace WoRB
                                       : Colorf( 0.7f, 0.9f, 0.7f, 0.8f );
 
             InactiveColor = Colorf( 0.9f, 0.5f, 0.5f, 0.8f );
-
-            SetMass( mass );
-
-            Body->Set_XQVW( position, orientation, velocity, angularVelocity );
-            Body->Activate ();
         }
 
         /////////////////////////////////////////////////////////////////////////////////
@@ -11,11 +11,53 @@
  */
 
 #include "RigidBody.h"
+#include "Kinematic.h"
 #include "CollisionResolver.h"
+#include "Policies.h"
+#include "TriangleMesh.h"
+#include "HeightField.h"
+#include "Compound.h"
+#include "ConvexHull.h"
+#include "SceneQuery.h"
+#include "Triggers.h"
+#include "Granular.h"
+#include "ForceGenerators.h"
+#include "MutualGravity.h"
+#include "Solids.h"
+
+#include <vector>     // we use: std::vector
+#include <utility>    // we use: std::pair
+#include <algorithm>  // we use: std::sort
 
 namespace WoRB
 {
+    /** Spreads the lower 10 bits of the value so that there are two zero bits
+     * between every two bits (bit k moves to bit 3k).
+     */
+    inline unsigned SpreadBits( unsigned v )
+    {
+        v &= 0x3FF;
+        v = ( v | ( v << 16 ) ) & 0x030000FF;
+        v = ( v | ( v <<  8 ) ) & 0x0300F00F;
+        v = ( v | ( v <<  4 ) ) & 0x030C30C3;
+        v = ( v | ( v <<  2 ) ) & 0x09249249;
+        return v;
+    }
+
+    /** Gets the Morton code (the index along the Z-order curve) of the cell with
+     * the given coordinates on a grid of 1024^3 cells.
+     */
+    inline unsigned MortonCode( unsigned x, unsigned y, unsigned z )
+    {
+        return SpreadBits( x ) | ( SpreadBits( y ) << 1 ) | ( SpreadBits( z ) << 2 );
+    }
+
     /** Encapsulates a system of rigid bodies.
+     *
+     * Besides the capacities, the system is configured at compile-time by
+     * the policy classes defined in Policies.h. The defaults reproduce the original
+     * behaviour of the framework, except for the order in which the contacts are
+     * registered (see Policies.h).
      */
     template  
     <
@@ -25,7 +67,23 @@ namespace WoRB
 
         /** The maximum number of collisions the system can register.
          */
-        unsigned MaxCollisions
+        unsigned MaxCollisions,
+
+        /** The method finding the pairs of geometries to be tested for collision.
+         */
+        class Broadphase = AllPairs,
+
+        /** The collision response method.
+         */
+        class Solver = SequentialImpulses,
+
+        /** The method integrating the equations of motion of a single body.
+         */
+        class Integrator = SemiImplicitEuler,
+
+        /** The method calculating the system totals (energy, momenta).
+         */
+        class Diagnostics = FullDiagnostics
     >
     class WorldOfRigidBodies
     {
@@ -81,11 +139,18 @@ namespace WoRB
                 return i < worb->ObjectCount ? worb->Object[i]->Body : 0;
             }
 
+            /** Gets the reference to the current rigid body.
+             */
+            RigidBody& operator * () 
+            {
+                return *worb->Object[i]->Body;
+            }
+
             /** Removes all objects from the WoRB instance.
              */
             void Clear ()
             {
-                worb->ObjectCount = 0;
+                worb->RemoveObjects ();
                 i = 0;
             }
 
@@ -109,6 +174,146 @@ namespace WoRB
          */
         Geometry* Object[ MaxObjects ];
 
+        /** Holds the number of the moving (dynamic and kinematic) bodies.
+         */
+        unsigned MovableCount;
+
+        /** Points to the moving bodies; the static bodies and the scenery are left out
+         * of the loops over the bodies in the time-step (see PartitionBodies).
+         */
+        RigidBody* Movable[ MaxObjects ];
+
+        /** Holds the number of the objects at the last partitioning.
+         */
+        unsigned PartitionedCount;
+
+        /** Holds the index in Object of every object by its handle (the index in the
+         * order of addition) and the handle of every object in Object; the objects
+         * are reordered by SortObjects, while the handles stay.
+         */
+        unsigned Slot[ MaxObjects ];
+        unsigned Handle[ MaxObjects ];
+
+        /** Holds the scratch data of SortObjects: the sort keys with the old indices,
+         * the new index of every object and the objects in the new order.
+         */
+        std::vector< std::pair<unsigned,unsigned> > SortKeys;
+        std::vector<unsigned> NewIndex;
+        std::vector<Geometry*> SortedObjects;
+
+        /** Describes an array of solids added by Add( SolidArray& ), whose solids are
+         * moved within the array to the order of the objects (see MoveSolids).
+         */
+        struct SolidStorage
+        {
+            void* Array;       //!< Points to the SolidArray
+            const char* Begin; //!< Holds the address of the Geometry of the first solid
+            unsigned Count;    //!< Holds the number of the solids
+            size_t Stride;     //!< Holds the size of a solid
+            void ( *Permute )( void* array, const unsigned* order );
+        };
+
+        std::vector<SolidStorage> Storages;
+
+        /** Holds the scratch data of MoveSolids: the order and the new index of
+         * every solid by array, and the addresses of the moved solids.
+         */
+        std::vector< std::vector<unsigned> > StorageOrder, StorageIndex;
+        Relocation Moved;
+
+        template<class Solid>
+        static void PermuteSolids( void* array, const unsigned* order )
+        {
+            static_cast< SolidArray<Solid>* >( array )->Permute( order );
+        }
+
+        /** Moves the solids of the arrays added by Add( SolidArray& ) within their
+         * arrays to the order of the objects, then updates the pointers to them kept
+         * by the system.
+         */
+        void MoveSolids ()
+        {
+            const unsigned arrays = unsigned( Storages.size () );
+
+            StorageOrder.resize( arrays );
+            StorageIndex.resize( arrays );
+            for ( unsigned a = 0; a < arrays; ++a ) {
+                StorageOrder[a].clear ();
+            }
+
+            // The order of an array: its solids in the order of the objects
+            //
+            for ( unsigned k = 0; k < ObjectCount; ++k )
+            {
+                const char* p = reinterpret_cast<const char*>( Object[k] );
+                for ( unsigned a = 0; a < arrays; ++a )
+                {
+                    const SolidStorage& s = Storages[a];
+                    if ( p >= s.Begin && p < s.Begin + s.Count * s.Stride ) {
+                        StorageOrder[a].push_back( unsigned( ( p - s.Begin ) / s.Stride ) );
+                        break;
+                    }
+                }
+            }
+
+            Moved.Clear ();
+
+            for ( unsigned a = 0; a < arrays; ++a )
+            {
+                const SolidStorage& s = Storages[a];
+                const std::vector<unsigned>& order = StorageOrder[a];
+                if ( order.size () != s.Count ) { // Some solids were added twice
+                    continue;
+                }
+
+                std::vector<unsigned>& newIndex = StorageIndex[a];
+                newIndex.resize( s.Count );
+                for ( unsigned k = 0; k < s.Count; ++k ) {
+                    newIndex[ order[k] ] = k;
+                }
+
+                s.Permute( s.Array, &order[0] );
+                Moved.Add( s.Begin, s.Count, s.Stride, &newIndex[0] );
+            }
+
+            if ( Moved.IsEmpty () ) {
+                return;
+            }
+
+            for ( unsigned k = 0; k < ObjectCount; ++k ) {
+                Object[k] = Moved( Object[k] );
+            }
+
+            Collisions.Relocate( Moved );
+            Triggers.Relocate( Moved );
+            Forces.Relocate( Moved );
+        }
+
+        /** Prepares the dynamic and the static bodies among the objects in range
+         * for InitializeODE (the kinematic bodies are moved by their scripted motions
+         * on the calling thread).
+         */
+        static void InitializeBatch( void* context, unsigned begin, unsigned end )
+        {
+            WorldOfRigidBodies& self = *static_cast<WorldOfRigidBodies*>( context );
+
+            for ( unsigned i = begin; i < end; ++i )
+            {
+                RigidBody* body = self.Object[i]->Body;
+                if ( ! body || body->Kinematic ) {
+                    continue;
+                }
+
+                if ( body->IsStatic () ) {
+                    body->SetKinematicState( body->Position, body->Orientation, 0.0, 0.0 );
+                }
+                else {
+                    body->CalculateDerivedQuantities ();
+                }
+                body->ClearAccumulators ();
+            }
+        }
+
     public:
 
         /////////////////////////////////////////////////////////////////////////////////
@@ -153,12 +358,55 @@ namespace WoRB
          */
         Collision CollisionRegistry[ MaxCollisions ];
 
+        /** Holds the candidate pairs found by the broadphase.
+         */
+        CandidatePairs Pairs;
+
+        /** Holds the geometries overlapping the sensors and the enter/exit events
+         * of the last time-step.
+         */
+        TriggerVolumes Triggers;
+
+        /** Holds the springs, drags, buoyancies and force fields, applied to the bodies
+         * before every integration (in addition to the gravity).
+         */
+        ForceRegistry Forces;
+
+        /** Holds the mutual gravitational attraction between the bodies, applied
+         * before every integration if enabled (disabled by default).
+         */
+        MutualGravity Attraction;
+
+        /////////////////////////////////////////////////////////////////////////////////
+
+        Broadphase  BroadphaseMethod;   //!< Holds the broadphase policy
+        Solver      SolverMethod;       //!< Holds the collision response policy
+        Integrator  IntegratorMethod;   //!< Holds the integrator policy
+        Diagnostics DiagnosticsMethod;  //!< Holds the diagnostics policy
+
+        /** Holds the number of time-steps between the spatial reorderings of
+         * the objects (see SortObjects); 0 keeps the order of addition.
+         * When enabled, the contacts are also sorted by their bodies before they
+         * are resolved.
+         */
+        unsigned ReorderInterval;
+
+        /** Holds the number of the threads of the passes over all the objects
+         * in InitializeODE.
+         */
+        unsigned Threads;
+
         /////////////////////////////////////////////////////////////////////////////////
 
         /** Constructs an instance of WoRB class.
          */
         WorldOfRigidBodies ()
-            : Collisions( CollisionRegistry, MaxCollisions )
+            : ObjectCount( 0 )
+            , MovableCount( 0 )
+            , PartitionedCount( 0 )
+            , Collisions( CollisionRegistry, MaxCollisions )
+            , ReorderInterval( 0 )
+            , Threads( 1 )
         {
         }
 
@@ -169,25 +417,237 @@ namespace WoRB
         void RemoveObjects ()
         {
             ObjectCount = 0;
+            MovableCount = 0;
+            PartitionedCount = 0;
+            Storages.clear ();
+            BroadphaseMethod.Reset ();
+            Triggers.Clear ();
+            Forces.Clear ();
         }
 
         /** Adds new object to the system.
+         * Returns false (and adds nothing) if the system is full.
          */
-        void Add( Geometry* object )
+        bool Add( Geometry* object )
         {
+            if ( ObjectCount >= MaxObjects ) {
+                return false;
+            }
+
+            Slot[ ObjectCount ] = Handle[ ObjectCount ] = ObjectCount;
             Object[ ObjectCount++ ] = object;
+            return true;
         }
 
         /** Adds new object to the system.
+         * Returns false (and adds nothing) if the system is full.
          */
-        void Add( Geometry& object )
+        bool Add( Geometry& object )
         {
-            Object[ ObjectCount++ ] = &object;
+            return Add( &object );
+        }
+
+        /** Adds all the solids of the array to the system (see SolidArray).
+         * Returns false (and adds nothing) if the array does not fit.
+         *
+         * The solids are moved within the array when the objects are reordered
+         * (see SortObjects), so the pointers and the indices of the solids kept
+         * by the application change; the handles of GetObject stay.
+         */
+        template<class Solid>
+        bool Add( SolidArray<Solid>& solids )
+        {
+            const unsigned count = solids.Count ();
+            if ( count > MaxObjects - ObjectCount ) {
+                return false;
+            }
+
+            for ( unsigned i = 0; i < count; ++i )
+            {
+                Slot[ ObjectCount ] = Handle[ ObjectCount ] = ObjectCount;
+                Object[ ObjectCount++ ] = &solids[i];
+            }
+
+            if ( count > 0 )
+            {
+                const Geometry* first = &solids[0];
+                SolidStorage storage = { &solids, reinterpret_cast<const char*>( first ),
+                    count, sizeof( Solid ), PermuteSolids<Solid> };
+                Storages.push_back( storage );
+            }
+
+            return true;
+        }
+
+        /** Gets the number of objects (rigid bodies and scenery) in the system.
+         */
+        unsigned GetObjectCount () const
+        {
+            return ObjectCount;
+        }
+
+        /** Gets the object with the given index (in the order of addition, which
+         * does not change when the objects are reordered).
+         */
+        const Geometry* GetObject( unsigned index ) const
+        {
+            return Object[ Slot[ index ] ];
+        }
+
+        /** Gets the number of the moving (dynamic and kinematic) bodies, as found by
+         * the last PartitionBodies.
+         */
+        unsigned GetMovableCount () const
+        {
+            return MovableCount;
+        }
+
+        /** Separates the moving bodies from the static bodies (bodies with the infinite
+         * mass that are not kinematic; see RigidBody::IsStatic). Static bodies are
+         * neither integrated nor included in the totals.
+         *
+         * The moving bodies are kept in the order of the objects, i.e. in the order
+         * of addition until the objects are reordered (see SortObjects).
+         *
+         * Called by InitializeODE and by SolveODE when objects were added; it has to
+         * be called again if the mass of a body is changed to or from infinite.
+         */
+        void PartitionBodies ()
+        {
+            MovableCount = 0;
+
+            for ( unsigned i = 0; i < ObjectCount; ++i )
+            {
+                RigidBody* body = Object[i]->Body;
+                if ( ! body ) {
+                    continue;
+                }
+                body->Order = i;
+                if ( ! body->IsStatic () ) {
+                    Movable[ MovableCount++ ] = body;
+                }
+            }
+
+            PartitionedCount = ObjectCount;
+        }
+
+        /** Reorders the objects by the Morton code of their positions, so that
+         * the objects close in space are close in the loops over the objects and
+         * in the contacts sorted by their bodies (see RigidBody::Order); the unbounded
+         * geometries are moved to the end. The handles of GetObject and the state
+         * of the broadphase are kept.
+         *
+         * The solids of the arrays added by Add( SolidArray& ) are also moved within
+         * their arrays to the new order (see MoveSolids), so the loops over the bodies
+         * walk through the memory; of the other objects, owned by the application,
+         * only the pointers are reordered.
+         */
+        void SortObjects ()
+        {
+            const unsigned n = ObjectCount;
+            if ( n < 2 ) {
+                return;
+            }
+
+            // Find the box bounding the positions of the bounded geometries
+            //
+            Quaternion lo, hi;
+            bool empty = true;
+
+            for ( unsigned i = 0; i < n; ++i )
+            {
+                if ( BoundingRadius( *Object[i] ) < 0 ) {
+                    continue;
+                }
+                const Quaternion& p = Object[i]->Position ();
+                if ( empty ) {
+                    lo = hi = p;
+                    empty = false;
+                    continue;
+                }
+                lo.x = std::min( lo.x, p.x ); hi.x = std::max( hi.x, p.x );
+                lo.y = std::min( lo.y, p.y ); hi.y = std::max( hi.y, p.y );
+                lo.z = std::min( lo.z, p.z ); hi.z = std::max( hi.z, p.z );
+            }
+
+            // Sort the objects by the cells of a 1024^3 grid over the box; the sort
+            // is stable for the objects in the same cell (keyed by the old index)
+            //
+            const double extent = std::max( hi.x - lo.x,
+                std::max( hi.y - lo.y, hi.z - lo.z ) );
+            const double scale = extent > 0 ? 1023.0 / extent : 0.0;
+
+            SortKeys.resize( n );
+            for ( unsigned i = 0; i < n; ++i )
+            {
+                unsigned key = ~0u;
+                if ( BoundingRadius( *Object[i] ) >= 0 )
+                {
+                    const Quaternion& p = Object[i]->Position ();
+                    key = MortonCode(
+                        unsigned( ( p.x - lo.x ) * scale ),
+                        unsigned( ( p.y - lo.y ) * scale ),
+                        unsigned( ( p.z - lo.z ) * scale ) );
+                }
+                SortKeys[i] = std::make_pair( key, i );
+            }
+
+            std::sort( SortKeys.begin (), SortKeys.end () );
+
+            // Permute the objects and their handles (the keys are no longer needed
+            // and hold the handles meanwhile), then update the broadphase
+            //
+            NewIndex.resize( n );
+            SortedObjects.resize( n );
+
+            for ( unsigned k = 0; k < n; ++k )
+            {
+                const unsigned i = SortKeys[k].second;
+                NewIndex[i] = k;
+                SortedObjects[k] = Object[i];
+                SortKeys[k].first = Handle[i];
+            }
+
+            for ( unsigned k = 0; k < n; ++k )
+            {
+                Object[k] = SortedObjects[k];
+                Handle[k] = SortKeys[k].first;
+                Slot[ Handle[k] ] = k;
+            }
+
+            BroadphaseMethod.Remap( &NewIndex[0], n );
+
+            if ( ! Storages.empty () ) {
+                MoveSolids ();
+            }
+
+            PartitionBodies ();
+        }
+
+        /** Brings the broadphase bounds up to date with the current positions
+         * (the bounds are otherwise updated only during the time-steps).
+         */
+        void UpdateBounds ()
+        {
+            BroadphaseMethod.Update( Object, ObjectCount );
+        }
+
+        /** Calls `visitor( geometry )` for every object that may overlap the given
+         * axis-aligned box, as found by the broadphase (see SceneQuery.h).
+         */
+        template<class Visitor>
+        void QueryObjects( const Quaternion& boxMin, const Quaternion& boxMax,
+            Visitor& visitor ) const
+        {
+            BroadphaseMethod.Query( boxMin, boxMax, Object, ObjectCount, visitor );
         }
 
         /////////////////////////////////////////////////////////////////////////////////
 
-        /** Prepares ODE (recalculates derived quantities)
+        /** Prepares ODE (recalculates derived quantities) and registers all
+         * the objects with the broadphase at once.
+         *
+         * The derived quantities are calculated in parallel (see Threads).
          */
         void InitializeODE ()
         {
@@ -195,24 +655,47 @@ namespace WoRB
             TimeStepCount = 0;
 
             Collisions.Initialize ();
+            Triggers.Clear ();
+
+            ParallelFor( ObjectCount, Threads, InitializeBatch, this );
 
-            for ( RigidBodies body = RigidBodies(this); body.Exists(); ++body )
+            PartitionBodies ();
+
+            for ( unsigned i = 0; i < MovableCount; ++i )
             {
-                body->CalculateDerivedQuantities ();
-                body->ClearAccumulators ();
+                RigidBody& body = *Movable[i];
+                if ( body.Kinematic ) {
+                    body.Kinematic->Move( body, Time, 0 );
+                    body.ClearAccumulators ();
+                }
             }
 
+            UpdateBounds ();
+            CalculateTotals ();
+        }
+
+        /** Calculates the total energy and momenta of the system
+         * (the static and the kinematic bodies are not included).
+         */
+        void CalculateTotals ()
+        {
             TotalKineticEnergy   = 0;
             TotalPotentialEnergy = 0;
             TotalLinearMomentum  = 0;
             TotalAngularMomentum = 0;
 
-            for ( RigidBodies body = RigidBodies(this); body.Exists(); ++body )
+            for ( unsigned i = 0; i < MovableCount; ++i )
             {
-                TotalKineticEnergy   += body->KineticEnergy;
-                TotalPotentialEnergy += body->PotentialEnergy;
-                TotalLinearMomentum  += body->LinearMomentum;
-                TotalAngularMomentum += body->TotalAngularMomentum;
+                const RigidBody& body = *Movable[i];
+
+                if ( body.Kinematic ) {
+                    continue;
+                }
+
+                TotalKineticEnergy   += body.KineticEnergy;
+                TotalPotentialEnergy += body.PotentialEnergy;
+                TotalLinearMomentum  += body.LinearMomentum;
+                TotalAngularMomentum += body.TotalAngularMomentum;
             }
         }
 
@@ -225,26 +708,60 @@ namespace WoRB
             double h    //!< Integrator time-step length
             )
         {
+            if ( PartitionedCount != ObjectCount ) { // Objects were added
+                PartitionBodies ();
+            }
+
+            if ( ReorderInterval && TimeStepCount % ReorderInterval == 0 ) {
+                SortObjects ();
+            }
+
             /////////////////////////////////////////////////////////////////////////////
             // Calculate and accumulate all external and internal forces
             //
 
-            // Add gravity
+            // Add gravity (kinematic bodies are not affected by forces)
             //
-            for ( RigidBodies body = RigidBodies(this); body.Exists(); ++body )
+            for ( unsigned i = 0; i < MovableCount; ++i )
             {
-                Quaternion f_g = body->Mass() * Gravity;
-                double E_p = - f_g.Dot( body->Position );
+                RigidBody& body = *Movable[i];
+
+                if ( body.Kinematic ) {
+                    continue;
+                }
+
+                Quaternion f_g = body.Mass() * Gravity;
+                double E_p = - f_g.Dot( body.Position );
+
+                body.AddExternalForce( f_g, E_p );
+            }
+
+            // Add the forces of the registered force generators
+            //
+            Forces.Apply( Gravity );
 
-                body->AddExternalForce( f_g, E_p );
+            // Add the mutual attraction between the bodies
+            //
+            if ( Attraction.Enabled ) {
+                Attraction.Apply( Movable, MovableCount );
             }
 
             /////////////////////////////////////////////////////////////////////////////
-            // Solve ODE for every object in the system
+            // Solve ODE for every object in the system; kinematic bodies are moved
+            // to their scripted pose at the end of the time-step instead.
             //
-            for ( RigidBodies body = RigidBodies(this); body.Exists(); ++body )
+            const double t_next = h * ( TimeStepCount + 1 );
+
+            for ( unsigned i = 0; i < MovableCount; ++i )
             {
-                body->SolveODE( h );
+                RigidBody& body = *Movable[i];
+
+                if ( body.Kinematic ) {
+                    body.Kinematic->Move( body, t_next, h );
+                }
+                else {
+                    IntegratorMethod.Integrate( body, h );
+                }
             }
 
             // Solve system local time (avoiding `Time += h` cause of rounding-errors).
@@ -254,48 +771,43 @@ namespace WoRB
             /////////////////////////////////////////////////////////////////////////////
             // Calculate derived quantities
 
-            TotalKineticEnergy   = 0;
-            TotalPotentialEnergy = 0;
-            TotalLinearMomentum  = 0;
-            TotalAngularMomentum = 0;
-
-            for ( RigidBodies body = RigidBodies(this); body.Exists(); ++body )
-            {
-                TotalKineticEnergy   += body->KineticEnergy;
-                TotalPotentialEnergy += body->PotentialEnergy;
-                TotalLinearMomentum  += body->LinearMomentum;
-                TotalAngularMomentum += body->TotalAngularMomentum;
-            }
+            DiagnosticsMethod.Update( *this );
 
             /////////////////////////////////////////////////////////////////////////////
             // Collision Detection
 
             Collisions.Initialize ();
 
-            // Detect and register collisions between all objects in the system
+            // Find the candidate pairs of objects, then detect and register collisions
+            // between them (bucket by bucket, see CandidatePairs).
             //
-            for ( unsigned i = 0; i < ObjectCount; ++i )
-            {
-                for ( unsigned j = i + 1; j < ObjectCount; ++j )
-                {
-                    Object[i]->Detect( Collisions, Object[j] );
-                }
-            }
+            Pairs.Clear ();
+            BroadphaseMethod.FindPairs( Pairs, Object, ObjectCount );
+            Pairs.Detect( Collisions );
 
-            Collisions.UpdateDerivedQuantities( h );
+            // Test the sensors for overlap and report the enter/exit events
+            // (sensors never register collisions)
+            //
+            Triggers.Update( Pairs );
 
             /////////////////////////////////////////////////////////////////////////////
             // Collision Response
 
-            Collisions.ImpulseTransfers( h );
-            Collisions.PositionProjections ();
+            // Resolve the contacts in the order of their bodies (i.e. in the spatial
+            // order), so the successive contacts mostly share the bodies
+            //
+            if ( ReorderInterval ) {
+                Collisions.SortByBodies( ObjectCount );
+            }
+
+            SolverMethod.Resolve( Collisions, h );
 
             /////////////////////////////////////////////////////////////////////////////
             // Prepare force and torque accumulators for the next time-step
             //
-            for ( RigidBodies body = RigidBodies(this); body.Exists(); ++body )
+            for ( unsigned i = 0; i < MovableCount; ++i )
             {
-                body->ClearAccumulators ();
+                Movable[i]->ClearAccumulators ();
             }
         }
     };
@@ -307,6 +819,11 @@ namespace WoRB
     /** Reports a severe error (with errorId compatible with MATLAB) and quits.
      */
     void SevereError( const char* errorId, const char* format, ... );
+
+    /** Gets the time elapsed from an arbitrary fixed point in the past, in `s`.
+     * The clock is monotonic and shared between the processes on the same host.
+     */
+    double MonotonicTime ();
 }
 
 /**
@@ -325,10 +842,13 @@ namespace WoRB
  *
  * @li Create an instance of WorldOfRigidBodies
  * @li Populate WorldOfRigidBodies::Objects with the list of instantiated rigid bodies
+ *     (large scenes of spheres and cuboids can be created at once in a SolidArray)
  *
  * The main loop of the simulation
  *
- * @li Apply any temporary internal or external forces, e.g. spring forces or thrusts.
+ * @li Apply any temporary internal or external forces, e.g. thrusts (the springs,
+ *     drags, buoyancies and force fields can be registered in
+ *     WorldOfRigidBodies::Forces instead).
  * @li Call WorldOfRigidBodies::SolveODE
  * @li Render the bodies.
  *
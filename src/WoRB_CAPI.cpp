@@ -0,0 +1,373 @@
+/**
+ *  @file      WoRB_CAPI.cpp
+ *  @brief     Implementation of the stable C interface of the WoRB framework.
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-23
+ *  @copyright GNU Public License.
+ */
+
+#define WORB_BUILD_LIBRARY
+
+#include "WoRB_CAPI.h"
+#include "WoRB.h"
+
+#include <new>      // we use: std::nothrow
+#include <vector>   // we use: std::vector
+
+using namespace WoRB;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+/** Implements the opaque world handle.
+ *
+ * The rigid bodies are kept in a single array, separately from their geometries,
+ * so that the state of all bodies can be viewed in place with a constant stride.
+ */
+struct worb_world
+{
+    enum
+    {
+        MaxObjects    = 16384,  //!< The capacity of the system (bodies and scenery)
+        MaxCollisions = 65536,  //!< The capacity of the collision registry
+        MaxScenery    = 16      //!< The maximum number of scenery objects
+    };
+
+    /** The type of the simulated system. With up to MaxObjects bodies, the
+     * candidate pairs are found by sweep and prune instead of testing all pairs.
+     */
+    typedef WorldOfRigidBodies<MaxObjects,MaxCollisions,SweepAndPrune> World;
+
+    World worb;                     //!< Holds the simulated system
+    RigidBody* Bodies;              //!< Holds all the rigid bodies (fixed capacity)
+    size_t Capacity;                //!< Holds the capacity of `Bodies`
+    size_t BodyCount;               //!< Holds the number of rigid bodies
+    std::vector<Sphere> Spheres;    //!< Holds the geometries of spheres
+    std::vector<Cuboid> Cuboids;    //!< Holds the geometries of cuboids
+    HalfSpace Scenery[ MaxScenery ]; //!< Holds the scenery
+    unsigned SceneryCount;          //!< Holds the number of scenery objects
+
+    worb_world( size_t capacity )
+        : Bodies( new(std::nothrow) RigidBody[ capacity ? capacity : 1 ] )
+        , Capacity( capacity )
+        , BodyCount( 0 )
+        , SceneryCount( 0 )
+    {
+        // Geometries are never reallocated, since the system refers to them.
+        //
+        Spheres.reserve( capacity );
+        Cuboids.reserve( capacity );
+
+        worb.RemoveObjects ();
+        worb.InitializeODE ();
+    }
+
+    ~worb_world ()
+    {
+        delete [] Bodies;
+    }
+
+    /** Initializes the next body from the given arrays.
+     */
+    RigidBody& NextBody( size_t i, const double* position, const double* orientation,
+        const double* velocity, const double* angular_velocity )
+    {
+        RigidBody& body = Bodies[ BodyCount ];
+
+        Quaternion Q = orientation
+            ? Quaternion( orientation[4*i], orientation[4*i+1],
+                          orientation[4*i+2], orientation[4*i+3] ).Unit ()
+            : Quaternion( 1.0 );
+
+        body.Set_XQVW(
+            SpatialVector( position[3*i], position[3*i+1], position[3*i+2] ), Q,
+            velocity ? SpatialVector( velocity[3*i], velocity[3*i+1], velocity[3*i+2] )
+                     : Quaternion( 0.0 ),
+            angular_velocity ? SpatialVector( angular_velocity[3*i],
+                    angular_velocity[3*i+1], angular_velocity[3*i+2] )
+                : Quaternion( 0.0 )
+        );
+
+        return body;
+    }
+
+    /** Registers the geometry of the last created body with the system.
+     */
+    void Commit( Geometry& geometry )
+    {
+        geometry.Body->CalculateDerivedQuantities ();
+        geometry.Body->ClearAccumulators ();
+        geometry.Body->Activate ();
+
+        worb.Add( geometry );
+        ++BodyCount;
+    }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+int worb_abi_version( void )
+{
+    return WORB_ABI_VERSION;
+}
+
+worb_world* worb_create( size_t max_bodies )
+{
+    if ( max_bodies + worb_world::MaxScenery > worb_world::MaxObjects ) {
+        return 0;
+    }
+
+    worb_world* world = new(std::nothrow) worb_world( max_bodies );
+    if ( world && ! world->Bodies ) {
+        delete world;
+        world = 0;
+    }
+
+    return world;
+}
+
+void worb_destroy( worb_world* world )
+{
+    delete world;
+}
+
+int worb_set_gravity( worb_world* world, const double gravity[3] )
+{
+    if ( ! world || ! gravity ) {
+        return WORB_INVALID_ARGUMENT;
+    }
+
+    world->worb.Gravity = SpatialVector( gravity[0], gravity[1], gravity[2] );
+    return WORB_OK;
+}
+
+int worb_set_contact_parameters( worb_world* world,
+    double restitution, double relaxation, double friction )
+{
+    if ( ! world || restitution < 0 || relaxation < 0 || friction < 0 ) {
+        return WORB_INVALID_ARGUMENT;
+    }
+
+    world->worb.Collisions.Restitution = restitution;
+    world->worb.Collisions.Relaxation  = relaxation;
+    world->worb.Collisions.Friction    = friction;
+
+    return WORB_OK;
+}
+
+int worb_add_half_space( worb_world* world, const double normal[3], double offset )
+{
+    if ( ! world || ! normal ) {
+        return WORB_INVALID_ARGUMENT;
+    }
+    if ( world->SceneryCount >= worb_world::MaxScenery ) {
+        return WORB_CAPACITY;
+    }
+
+    Quaternion n = SpatialVector( normal[0], normal[1], normal[2] );
+    if ( n.ImNorm () == 0 ) {
+        return WORB_INVALID_ARGUMENT;
+    }
+
+    HalfSpace& plane = world->Scenery[ world->SceneryCount++ ];
+    plane.Direction = n.Unit ();
+    plane.Offset    = offset;
+
+    world->worb.Add( plane );
+
+    return WORB_OK;
+}
+
+int worb_add_spheres( worb_world* world, size_t count,
+    const double* radius, const double* mass,
+    const double* position, const double* orientation,
+    const double* velocity, const double* angular_velocity,
+    size_t* first )
+{
+    if ( ! world || ! radius || ! mass || ! position ) {
+        return WORB_INVALID_ARGUMENT;
+    }
+    if ( count > world->Capacity - world->BodyCount ) {
+        return WORB_CAPACITY;
+    }
+    for ( size_t i = 0; i < count; ++i ) {
+        if ( ! ( radius[i] > 0 ) || ! ( mass[i] > 0 ) ) {
+            return WORB_INVALID_ARGUMENT;
+        }
+    }
+
+    if ( first ) {
+        *first = world->BodyCount;
+    }
+
+    for ( size_t i = 0; i < count; ++i )
+    {
+        RigidBody& body = world->NextBody( i, position, orientation,
+            velocity, angular_velocity );
+
+        world->Spheres.push_back( Sphere () );
+        Sphere& sphere = world->Spheres.back ();
+
+        sphere.Body   = &body;
+        sphere.Radius = radius[i];
+        sphere.SetMass( mass[i] );
+
+        world->Commit( sphere );
+    }
+
+    return WORB_OK;
+}
+
+int worb_add_cuboids( worb_world* world, size_t count,
+    const double* half_extent, const double* mass,
+    const double* position, const double* orientation,
+    const double* velocity, const double* angular_velocity,
+    size_t* first )
+{
+    if ( ! world || ! half_extent || ! mass || ! position ) {
+        return WORB_INVALID_ARGUMENT;
+    }
+    if ( count > world->Capacity - world->BodyCount ) {
+        return WORB_CAPACITY;
+    }
+    for ( size_t i = 0; i < count; ++i ) {
+        if ( ! ( half_extent[3*i] > 0 ) || ! ( half_extent[3*i+1] > 0 )
+            || ! ( half_extent[3*i+2] > 0 ) || ! ( mass[i] > 0 ) ) {
+            return WORB_INVALID_ARGUMENT;
+        }
+    }
+
+    if ( first ) {
+        *first = world->BodyCount;
+    }
+
+    for ( size_t i = 0; i < count; ++i )
+    {
+        RigidBody& body = world->NextBody( i, position, orientation,
+            velocity, angular_velocity );
+
+        world->Cuboids.push_back( Cuboid () );
+        Cuboid& cuboid = world->Cuboids.back ();
+
+        cuboid.Body = &body;
+        cuboid.HalfExtent = SpatialVector(
+            half_extent[3*i], half_extent[3*i+1], half_extent[3*i+2] );
+        cuboid.SetMass( mass[i] );
+
+        world->Commit( cuboid );
+    }
+
+    return WORB_OK;
+}
+
+int worb_set_can_be_deactivated( worb_world* world, size_t body, int flag )
+{
+    if ( ! world || body >= world->BodyCount ) {
+        return WORB_INVALID_ARGUMENT;
+    }
+
+    world->Bodies[ body ].SetCanBeDeactivated( flag != 0 );
+    return WORB_OK;
+}
+
+size_t worb_body_count( const worb_world* world )
+{
+    return world ? world->BodyCount : 0;
+}
+
+int worb_step( worb_world* world, double h, size_t count )
+{
+    if ( ! world || ! ( h > 0 ) ) {
+        return WORB_INVALID_ARGUMENT;
+    }
+
+    for ( size_t i = 0; i < count; ++i ) {
+        world->worb.SolveODE( h );
+    }
+
+    return WORB_OK;
+}
+
+int worb_apply_impulse( worb_world* world, size_t body,
+    const double impulse[3], const double point[3] )
+{
+    if ( ! world || ! impulse || ! point || body >= world->BodyCount ) {
+        return WORB_INVALID_ARGUMENT;
+    }
+
+    RigidBody& b = world->Bodies[ body ];
+    SpatialVector J( impulse[0], impulse[1], impulse[2] );
+    Quaternion r = SpatialVector( point[0], point[1], point[2] ) - b.Position;
+
+    b.LinearMomentum  += J;
+    b.AngularMomentum += r.Cross( J );
+    b.CalculateDerivedQuantities ();
+    b.Activate ();
+
+    return WORB_OK;
+}
+
+int worb_apply_force( worb_world* world, size_t body,
+    const double force[3], const double point[3] )
+{
+    if ( ! world || ! force || ! point || body >= world->BodyCount ) {
+        return WORB_INVALID_ARGUMENT;
+    }
+
+    world->Bodies[ body ].AddForceAtPoint(
+        SpatialVector( point[0], point[1], point[2] ),
+        SpatialVector( force[0], force[1], force[2] )
+    );
+
+    return WORB_OK;
+}
+
+worb_view worb_get_view( const worb_world* world, int field )
+{
+    worb_view view = { 0, sizeof( RigidBody ), 0, 0 };
+
+    if ( ! world ) {
+        return view;
+    }
+
+    const RigidBody& b = world->Bodies[0];
+
+    switch( field )
+    {
+        case WORB_POSITION:         view.data = &b.Position.x;        view.width = 3; break;
+        case WORB_ORIENTATION:      view.data = &b.Orientation.w;     view.width = 4; break;
+        case WORB_VELOCITY:         view.data = &b.Velocity.x;        view.width = 3; break;
+        case WORB_ANGULAR_VELOCITY: view.data = &b.AngularVelocity.x; view.width = 3; break;
+        case WORB_LINEAR_MOMENTUM:  view.data = &b.LinearMomentum.x;  view.width = 3; break;
+        case WORB_ANGULAR_MOMENTUM: view.data = &b.AngularMomentum.x; view.width = 3; break;
+        case WORB_KINETIC_ENERGY:   view.data = &b.KineticEnergy;     view.width = 1; break;
+        default:
+            return view;
+    }
+
+    view.count = world->BodyCount;
+    return view;
+}
+
+int worb_get_diagnostics( const worb_world* world, worb_diagnostics* diag )
+{
+    if ( ! world || ! diag ) {
+        return WORB_INVALID_ARGUMENT;
+    }
+
+    const worb_world::World& worb = world->worb;
+
+    diag->time                   = worb.Time;
+    diag->time_step_count        = worb.TimeStepCount;
+    diag->total_kinetic_energy   = worb.TotalKineticEnergy;
+    diag->total_potential_energy = worb.TotalPotentialEnergy;
+    diag->body_count             = world->BodyCount;
+    diag->contact_count          = worb.Collisions.Count ();
+
+    for ( unsigned k = 0; k < 3; ++k ) {
+        diag->total_linear_momentum[k]  = worb.TotalLinearMomentum[k];
+        diag->total_angular_momentum[k] = worb.TotalAngularMomentum[k];
+    }
+
+    return WORB_OK;
+}
@@ -0,0 +1,193 @@
+#ifndef _WORB_CAPI_H_INCLUDED
+#define _WORB_CAPI_H_INCLUDED
+
+/**
+ *  @file      WoRB_CAPI.h
+ *  @brief     The stable C interface of the WoRB framework (`libworb`).
+ *  @author    Mikica Kocic
+ *  @version   0.1
+ *  @date      2012-05-23
+ *  @copyright GNU Public License.
+ *
+ * The interface exposes a system of rigid bodies through an opaque handle, so that
+ * the framework can be embedded into hosts written in other languages (or loaded
+ * as a plugin) without compiling the C++ templates into the host.
+ *
+ * Bodies are created in bulk and identified by their index, which is assigned in
+ * the creation order and never changes. The state of all bodies is kept in
+ * a single array, so the host can read positions, orientations etc. in place,
+ * through strided views returned by `worb_get_view()`:
+ *
+ *     worb_view x = worb_get_view( world, WORB_POSITION );
+ *     for ( i = 0; i < x.count; ++i ) {
+ *         const double* p = (const double*)( (const char*)x.data + i * x.stride );
+ *         // p[0], p[1], p[2] are the coordinates of the i-th body
+ *     }
+ *
+ * Views remain valid until the world is destroyed (the body array is allocated
+ * once, with the capacity given to `worb_create()`), but their `count` grows
+ * as bodies are added. The data is updated in place by `worb_step()`.
+ *
+ * All functions returning `int` return WORB_OK on success or a negative error code.
+ */
+
+#include <stddef.h> /* we use: size_t */
+
+#ifdef _WIN32
+    #ifdef WORB_BUILD_LIBRARY
+        #define WORB_API __declspec(dllexport)
+    #else
+        #define WORB_API __declspec(dllimport)
+    #endif
+#else
+    #define WORB_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+/** The version of the interface; incremented on incompatible changes.
+ */
+#define WORB_ABI_VERSION 1
+
+/** Enumerates the error codes.
+ */
+enum worb_status
+{
+    WORB_OK               =  0, /**< The call succeeded                              */
+    WORB_INVALID_ARGUMENT = -1, /**< An argument is null, out of range or malformed  */
+    WORB_CAPACITY         = -2  /**< The world capacity would be exceeded            */
+};
+
+/** Enumerates the body state arrays that can be viewed in place.
+ */
+enum worb_field
+{
+    WORB_POSITION         = 0, /**< double[3], position, in `m`                      */
+    WORB_ORIENTATION      = 1, /**< double[4], orientation quaternion (w, x, y, z)   */
+    WORB_VELOCITY         = 2, /**< double[3], velocity, in `m s^-1`                 */
+    WORB_ANGULAR_VELOCITY = 3, /**< double[3], angular velocity, in `s^-1`           */
+    WORB_LINEAR_MOMENTUM  = 4, /**< double[3], linear momentum, in `kg m s^-1`       */
+    WORB_ANGULAR_MOMENTUM = 5, /**< double[3], angular momentum, in `kg m^2 s^-1`    */
+    WORB_KINETIC_ENERGY   = 6  /**< double[1], kinetic energy, in `J`                */
+};
+
+/** Represents a strided view into a body state array.
+ * The element of the i-th body starts at `(const char*)data + i * stride`.
+ */
+typedef struct worb_view
+{
+    const double* data;   /**< Points to the element of the first body (or null)     */
+    size_t        stride; /**< Holds the distance between elements, in octets        */
+    size_t        count;  /**< Holds the number of bodies                            */
+    size_t        width;  /**< Holds the number of doubles in an element             */
+}
+    worb_view;
+
+/** Holds the system diagnostics.
+ */
+typedef struct worb_diagnostics
+{
+    double        time;                   /**< The system local time, in `s`         */
+    unsigned long time_step_count;        /**< The number of integrator time-steps   */
+    double        total_kinetic_energy;   /**< The total kinetic energy, in `J`      */
+    double        total_potential_energy; /**< The total potential energy, in `J`    */
+    double        total_linear_momentum[3];  /**< In `kg m s^-1`                     */
+    double        total_angular_momentum[3]; /**< In `kg m^2 s^-1`                   */
+    size_t        body_count;             /**< The number of rigid bodies            */
+    size_t        contact_count;          /**< The number of contacts in last step   */
+}
+    worb_diagnostics;
+
+/** The opaque handle of a system of rigid bodies.
+ */
+typedef struct worb_world worb_world;
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+/** Gets the version of the interface implemented by the library (WORB_ABI_VERSION).
+ */
+WORB_API int worb_abi_version( void );
+
+/** Creates an empty world able to hold `max_bodies` rigid bodies.
+ * Returns null if `max_bodies` exceeds the framework limits.
+ */
+WORB_API worb_world* worb_create( size_t max_bodies );
+
+/** Destroys the world and invalidates all its views.
+ */
+WORB_API void worb_destroy( worb_world* world );
+
+/** Sets the common gravity, in `m s^-2`.
+ */
+WORB_API int worb_set_gravity( worb_world* world, const double gravity[3] );
+
+/** Sets the coefficient of restitution, the position projection relaxation and
+ * the friction coefficient of the contacts.
+ */
+WORB_API int worb_set_contact_parameters( worb_world* world,
+    double restitution, double relaxation, double friction );
+
+/** Adds a static half-space `{ x : dot(normal, x) <= offset }` to the scenery.
+ */
+WORB_API int worb_add_half_space( worb_world* world,
+    const double normal[3], double offset );
+
+/** Creates `count` spheres. Arrays hold one element per body, densely packed;
+ * `orientation`, `velocity` and `angular_velocity` may be null (identity, zero).
+ * The index of the first created body is stored in `first` (if not null).
+ */
+WORB_API int worb_add_spheres( worb_world* world, size_t count,
+    const double* radius, const double* mass,
+    const double* position, const double* orientation,
+    const double* velocity, const double* angular_velocity,
+    size_t* first );
+
+/** Creates `count` cuboids given by their half-extents (3 doubles per body).
+ * The remaining arguments are as for worb_add_spheres().
+ */
+WORB_API int worb_add_cuboids( worb_world* world, size_t count,
+    const double* half_extent, const double* mass,
+    const double* position, const double* orientation,
+    const double* velocity, const double* angular_velocity,
+    size_t* first );
+
+/** Allows or disallows deactivation of the resting body.
+ */
+WORB_API int worb_set_can_be_deactivated( worb_world* world, size_t body, int flag );
+
+/** Gets the number of rigid bodies.
+ */
+WORB_API size_t worb_body_count( const worb_world* world );
+
+/** Solves `count` time-steps of length `h`.
+ */
+WORB_API int worb_step( worb_world* world, double h, size_t count );
+
+/** Applies an impulse (in `N s`) at the given point (in world frame) of the body.
+ */
+WORB_API int worb_apply_impulse( worb_world* world, size_t body,
+    const double impulse[3], const double point[3] );
+
+/** Applies a force (in `N`) at the given point of the body during the next step.
+ */
+WORB_API int worb_apply_force( worb_world* world, size_t body,
+    const double force[3], const double point[3] );
+
+/** Gets a strided view into the given body state array.
+ * Returns a view with null `data` if the arguments are invalid.
+ */
+WORB_API worb_view worb_get_view( const worb_world* world, int field );
+
+/** Gets the system diagnostics.
+ */
+WORB_API int worb_get_diagnostics( const worb_world* world, worb_diagnostics* diag );
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _WORB_CAPI_H_INCLUDED */
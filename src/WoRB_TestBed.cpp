@@ -58,6 +58,19 @@ void WoRB_TestBed::Run ()
     IsInitialized = false;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+// Starts publishing the system state into the named shared memory segment.
+//
+bool WoRB_TestBed::PublishState( const char* name, bool replace )
+{
+    if ( ! Publisher.Open( name, 256, 1024, 4, replace ) ) {
+        return false;
+    }
+
+    Printf( "WoRB: Publishing system state to shared memory '%s'\n", name );
+    return true;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 // Delayed constructor
 //
@@ -272,6 +285,12 @@ void WoRB_TestBed::Simulate ()
     //
     OnProcessData ();
 
+    // Publish the state to external tools (visualizers, dashboards etc.)
+    //
+    if ( Publisher.IsOpen () ) {
+        Publisher.Publish( worb );
+    }
+
     if ( FinalTime > 0 && worb.Time >= FinalTime )
     {
         IsRunning = false;
@@ -309,6 +328,22 @@ void WoRB_TestBed::Simulate ()
     }
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+// Sets the model-view transform of the camera.
+//
+void WoRB_TestBed::SetupCamera ()
+{
+    glLoadIdentity ();
+
+    gluLookAt( /*eye*/ CameraZoom, 0, 0, /*center*/ 0, 0, 0, /*up*/ 0, 1, 0 );
+
+    glTranslated ( -CameraZoom,      0, 0    ); // move away = zoom out
+    glRotated    ( -CameraElevation, 0, 0, 1 ); // z-rotate = elevation
+    glRotated    (  CameraAngle,     0, 1, 0 ); // y-rotate = angle
+
+    glTranslated ( -CameraLookAt.x, -CameraLookAt.y, -CameraLookAt.z );
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 // Renders the current scene.
 //
@@ -324,15 +359,7 @@ void WoRB_TestBed::DisplayEventHandler ()
     // Clear the viewport and setup the camera direction
     //
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-    glLoadIdentity ();
-
-    gluLookAt( /*eye*/ CameraZoom, 0, 0, /*center*/ 0, 0, 0, /*up*/ 0, 1, 0 );
-
-    glTranslated ( -CameraZoom,      0, 0    ); // move away = zoom out
-    glRotated    ( -CameraElevation, 0, 0, 1 ); // z-rotate = elevation
-    glRotated    (  CameraAngle,     0, 1, 0 ); // y-rotate = angle
-
-    glTranslated ( -CameraLookAt.x, -CameraLookAt.y, -CameraLookAt.z );
+    SetupCamera ();
 
     if ( CameraElevation >= -8.0 )
     {
@@ -552,12 +579,13 @@ void WoRB_TestBed::RenderDebugInfo ()
         GLOrthoScreen _inScreenCoordinates; // Establish temporary transform for text
 
         glColor3d( 0, 0, 0 );
-        RenderPrintf( 10, 4 * 25, 
+        RenderPrintf( 10, 5 * 25, 
             "Shortcut keys:\n"
             "  1, 2, ... for different simulation\n"
             "  (P)ause, (S)ingle-step, (Q)uit\n"
             "  (A)xes, (V)ariables, (C)ontacts, (T)rajectories\n"
-            "  (W)ireframe, Floor (M)irror, (F)ullscreen"
+            "  (W)ireframe, Floor (M)irror, (F)ullscreen\n"
+            "  Right-click: follow the body (or look at the point) under the cursor"
         );
         glColor3d( 0, 0, 1 );
         RenderPrintf( 10, 10, 
@@ -652,6 +680,58 @@ void WoRB_TestBed::MotionEventHandler( int x, int y )
     LastMouse.y = y;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////
+// Casts a ray from the camera through the given window point; the camera follows
+// the picked body or looks at the picked point on the scenery.
+//
+void WoRB_TestBed::PickObject( int x, int y )
+{
+    // Unproject the window point at the near and the far clipping plane
+    //
+    GLdouble modelView[16], projection[16];
+    GLint viewport[4];
+
+    glMatrixMode( GL_MODELVIEW );
+    glPushMatrix ();
+    SetupCamera ();
+    glGetDoublev( GL_MODELVIEW_MATRIX, modelView );
+    glPopMatrix ();
+
+    glGetDoublev( GL_PROJECTION_MATRIX, projection );
+    glGetIntegerv( GL_VIEWPORT, viewport );
+
+    GLdouble winY = viewport[3] - y - 1;
+    GLdouble nx, ny, nz, fx, fy, fz;
+
+    if ( ! gluUnProject( x, winY, 0, modelView, projection, viewport, &nx, &ny, &nz )
+      || ! gluUnProject( x, winY, 1, modelView, projection, viewport, &fx, &fy, &fz ) ) {
+        return;
+    }
+
+    Ray ray( Quaternion( 0, nx, ny, nz ), Quaternion( 0, fx - nx, fy - ny, fz - nz ) );
+
+    SceneQuery<World> query( worb );
+    QueryHit hit;
+
+    if ( ! query.RayCast( ray, hit ) ) {
+        return;
+    }
+
+    for ( unsigned i = 0; i < Objects.size (); ++i )
+    {
+        if ( &Objects[i]->GetGeometry () == hit.Shape )
+        {
+            FollowObject = i;
+            Printf( "WoRB: Picked object %u (%s) at %g m\n", 
+                i + 1, hit.Shape->GetName (), hit.Distance );
+            return;
+        }
+    }
+
+    FollowObject = 0xFFFFu;
+    CameraLookAt = hit.Position;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////
 // Called when GLUT detects a key press.
 //
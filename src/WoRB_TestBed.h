@@ -13,6 +13,7 @@
 
 #include "WoRB.h"
 #include "Utilities.h"
+#include "SharedState.h"
 
 #include <vector> // for GLUT_Renderer collection
 
@@ -26,14 +27,25 @@ protected:
 
     /////////////////////////////////////////////////////////////////////////////////////
 
+    /** The type of the WoRB physics simulation framework. The resting contacts
+     * are resolved by shock propagation, so the tall stacks of the test-suites
+     * settle and fall asleep.
+     */
+    typedef WoRB::WorldOfRigidBodies<256,1024,
+        WoRB::AllPairs, WoRB::ShockPropagation> World;
+
     /** Holds the WoRB physics simulation framework.
      */
-    WoRB::WorldOfRigidBodies<256,1024> worb;
+    World worb;
 
     /** Final simulation time, s.
      */
     double FinalTime;
 
+    /** Holds the publisher of the system state into shared memory (if opened).
+     */
+    WoRB::SharedStatePublisher Publisher;
+
     /////////////////////////////////////////////////////////////////////////////////////
 
     typedef std::vector<WoRB::GLUT_Renderer*> RBObjects;
@@ -202,6 +214,11 @@ public:
      */
     void Run ();
 
+    /** Starts publishing the system state into the named shared memory segment,
+     * replacing an existing (stale) segment only if `replace` is set.
+     */
+    bool PublishState( const char* name, bool replace = false );
+
     /** Clears the current simulation data and prepares a new simulation.
       */
     void ClearTestBed ();
@@ -243,6 +260,14 @@ public:
      */
     void SetupProjection ();
 
+    /** Sets the model-view transform of the camera.
+     */
+    void SetupCamera ();
+
+    /** Picks the object under the given window point (using a ray cast).
+     */
+    void PickObject( int x, int y );
+
     /** Handles on-window-close event.
      */
     void CloseEventHandler ()
@@ -274,6 +299,12 @@ public:
      */
     void MouseEventHandler( int button, int state, int x, int y )
     {
+        // Pick the object under the cursor on the right-click
+        //
+        if ( button == GLUT_RIGHT_BUTTON && state == GLUT_DOWN ) {
+            PickObject( x, y );
+        }
+
         // Remember the current mouse state and position
         //
         LastMouse.button = button;